@@ -22,11 +22,14 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "MathFunctions.h"
 
+#include <algorithm>
 #include <cmath>
+#include <set>
 
 using namespace caret;
 using namespace std;
@@ -92,6 +95,169 @@ void AlgorithmCiftiAverage::useParameters(OperationParameters* myParams, Progres
     }
 }
 
+namespace
+{
+    const int64_t BLOCK_ELEMENTS = 1<<17;//elements per accumulator array, each thread has five, so memory doesn't depend on the number of files
+    
+    ///compensated summation, so the result doesn't drift with the number of files
+    inline void kahanAdd(double& sum, double& compensation, const double& value)
+    {
+        const double y = value - compensation;
+        const double t = sum + y;
+        compensation = (t - sum) - y;
+        sum = t;
+    }
+    
+    struct BlockAccumulator
+    {
+        vector<double> m_sum, m_sumComp, m_sumSq, m_sumSqComp, m_weight;
+        vector<float> m_row;
+        void reset(const int64_t& numElements, const int64_t& rowSize, const bool& squares)
+        {
+            m_sum.assign(numElements, 0.0);
+            m_sumComp.assign(numElements, 0.0);
+            m_weight.assign(numElements, 0.0);
+            if (squares)
+            {
+                m_sumSq.assign(numElements, 0.0);
+                m_sumSqComp.assign(numElements, 0.0);
+            }
+            m_row.resize(rowSize);
+        }
+    };
+    
+    enum AccumulateMode
+    {
+        WEIGHTED_SUM,//sum of weight * value and of weights over numeric values, or over values strictly inside the cutoffs if given
+        SHIFTED_MOMENTS//sum and sum of squares of (value - shift), and count, over numeric values
+    };
+    
+    ///reads a block of rows from every file and accumulates them, each thread reads a fixed subset of the files into its own accumulator
+    void accumulateBlock(const vector<const CiftiFile*>& ciftiList, const vector<float>* weightsPtr, const int64_t& firstRow, const int64_t& numBlockRows,
+                         const int64_t& rowSize, const AccumulateMode& mode, const float* shift, const float* cutoffLow, const float* cutoffHigh,
+                         vector<BlockAccumulator>& threadAccum)
+    {
+        const int numFiles = (int)ciftiList.size();
+        const int numThreads = (int)threadAccum.size();
+        bool failed = false;
+        AString message;
+        for (int t = 0; t < numThreads; ++t)
+        {//reset all of them here, the runtime may start fewer threads than requested, and all accumulators are summed afterwards
+            threadAccum[t].reset(numBlockRows * rowSize, rowSize, mode == SHIFTED_MOMENTS);
+        }
+#pragma omp CARET_PAR num_threads(numThreads)
+        {
+            int thread = 0;
+#ifdef CARET_OMP
+            thread = omp_get_thread_num();
+#endif
+            BlockAccumulator& accum = threadAccum[thread];
+            bool threadFailed = false;//per-thread, so the loop never reads a flag another thread may be writing
+            AString threadMessage;
+#pragma omp CARET_FOR schedule(static)
+            for (int j = 0; j < numFiles; ++j)
+            {
+                if (threadFailed) continue;//can't break out of a parallel for, or throw out of a parallel region
+                const double weight = (weightsPtr == NULL ? 1.0 : (*weightsPtr)[j]);
+                try
+                {
+                    for (int64_t r = 0; r < numBlockRows; ++r)
+                    {
+                        ciftiList[j]->getRow(accum.m_row.data(), firstRow + r);
+                        const float* row = accum.m_row.data();
+                        const int64_t base = r * rowSize;
+                        if (mode == SHIFTED_MOMENTS)
+                        {
+                            for (int64_t k = 0; k < rowSize; ++k)
+                            {
+                                if (MathFunctions::isNumeric(row[k]))
+                                {
+                                    const double diff = (double)row[k] - shift[base + k];
+                                    kahanAdd(accum.m_sum[base + k], accum.m_sumComp[base + k], diff);
+                                    kahanAdd(accum.m_sumSq[base + k], accum.m_sumSqComp[base + k], diff * diff);
+                                    accum.m_weight[base + k] += 1.0;
+                                }
+                            }
+                        } else if (cutoffLow != NULL) {
+                            for (int64_t k = 0; k < rowSize; ++k)
+                            {
+                                if (row[k] > cutoffLow[base + k] && row[k] < cutoffHigh[base + k])//implicitly excludes NaN and inf
+                                {
+                                    kahanAdd(accum.m_sum[base + k], accum.m_sumComp[base + k], row[k] * weight);
+                                    accum.m_weight[base + k] += weight;
+                                }
+                            }
+                        } else {
+                            for (int64_t k = 0; k < rowSize; ++k)
+                            {
+                                if (MathFunctions::isNumeric(row[k]))
+                                {
+                                    kahanAdd(accum.m_sum[base + k], accum.m_sumComp[base + k], row[k] * weight);
+                                    accum.m_weight[base + k] += weight;
+                                }
+                            }
+                        }
+                    }
+                } catch (CaretException& e) {
+                    threadFailed = true;
+                    threadMessage = e.whatString();
+                } catch (exception& e) {
+                    threadFailed = true;
+                    threadMessage = e.what();
+                }
+            }
+            if (threadFailed)
+            {
+#pragma omp critical
+                {
+                    failed = true;
+                    message = threadMessage;
+                }
+            }
+        }
+        if (failed) throw AlgorithmException(message);
+    }
+    
+    ///combine the per-thread weighted sums of one block into output rows and write them
+    void writeWeightedMeans(const vector<BlockAccumulator>& threadAccum, const int64_t& firstRow, const int64_t& numBlockRows, const int64_t& rowSize, CiftiFile* ciftiOut)
+    {
+        const int numThreads = (int)threadAccum.size();
+        vector<float> outrow(rowSize);
+        for (int64_t r = 0; r < numBlockRows; ++r)
+        {
+            for (int64_t k = 0; k < rowSize; ++k)
+            {
+                const int64_t index = r * rowSize + k;
+                double sum = 0.0, sumComp = 0.0, weight = 0.0;
+                for (int t = 0; t < numThreads; ++t)
+                {
+                    kahanAdd(sum, sumComp, threadAccum[t].m_sum[index] - threadAccum[t].m_sumComp[index]);
+                    weight += threadAccum[t].m_weight[index];
+                }
+                if (weight != 0.0)
+                {
+                    outrow[k] = sum / weight;
+                } else {
+                    outrow[k] = 0.0f;
+                }
+            }
+            ciftiOut->setRow(outrow.data(), firstRow + r);
+        }
+    }
+    
+    ///files are read concurrently, except when the same file object is given more than once
+    int getNumberOfReadingThreads(const vector<const CiftiFile*>& ciftiList)
+    {
+        int ret = 1;
+#ifdef CARET_OMP
+        ret = max(1, min((int)ciftiList.size(), omp_get_max_threads()));
+#endif
+        set<const CiftiFile*> uniqueFiles(ciftiList.begin(), ciftiList.end());
+        if (uniqueFiles.size() != ciftiList.size()) ret = 1;
+        return ret;
+    }
+}
+
 AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const vector<float>* weightsPtr) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
@@ -106,7 +272,8 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     CaretAssert(ciftiList[0] != NULL);
     CiftiXML baseXML = ciftiList[0]->getCiftiXML();
     if (baseXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti average currently only supports 2D files");
-    int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW), numFiles = (int)ciftiList.size();
+    int64_t numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    int numFiles = (int)ciftiList.size();
     for (int i = 1; i < numFiles; ++i)
     {
         CaretAssert(ciftiList[i] != NULL);
@@ -116,50 +283,14 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
         }
     }
     ciftiOut->setCiftiXML(baseXML);
-    vector<double> accum(rowSize);
-    vector<float> myrow(rowSize);
-    for (int i = 0; i < numRows; ++i)
+    const int64_t blockRows = min(numRows, max((int64_t)1, BLOCK_ELEMENTS / max((int64_t)1, rowSize)));
+    vector<BlockAccumulator> threadAccum(getNumberOfReadingThreads(ciftiList));
+    for (int64_t firstRow = 0; firstRow < numRows; firstRow += blockRows)
     {
-        vector<double> weightaccum(rowSize, 0.0);
-        for (int j = 0; j < rowSize; ++j)
-        {
-            accum[j] = 0.0;
-        }
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrow.data(), i);
-            if (weightsPtr == NULL)
-            {
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    if (MathFunctions::isNumeric(myrow[k]))
-                    {
-                        weightaccum[k] += 1.0;
-                        accum[k] += myrow[k];
-                    }
-                }
-            } else {
-                float weight = (*weightsPtr)[j];
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    if (MathFunctions::isNumeric(myrow[k]))
-                    {
-                        weightaccum[k] += weight;
-                        accum[k] += myrow[k] * weight;
-                    }
-                }
-            }
-        }
-        for (int k = 0; k < rowSize; ++k)
-        {
-            if (weightaccum[k] != 0.0)
-            {
-                myrow[k] = accum[k] / weightaccum[k];
-            } else {
-                myrow[k] = 0.0f;
-            }
-        }
-        ciftiOut->setRow(myrow.data(), i);
+        const int64_t numBlockRows = min(blockRows, numRows - firstRow);
+        accumulateBlock(ciftiList, weightsPtr, firstRow, numBlockRows, rowSize, WEIGHTED_SUM, NULL, NULL, NULL, threadAccum);
+        writeWeightedMeans(threadAccum, firstRow, numBlockRows, rowSize, ciftiOut);
+        myProgress.reportProgress((float)(firstRow + numBlockRows) / numRows);
     }
 }
 
@@ -179,7 +310,8 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     CaretAssert(ciftiList[0] != NULL);
     CiftiXML baseXML = ciftiList[0]->getCiftiXML();
     if (baseXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti average currently only supports 2D files");
-    int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW), numFiles = (int)ciftiList.size();
+    int64_t numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    int numFiles = (int)ciftiList.size();
     for (int i = 1; i < numFiles; ++i)
     {
         CaretAssert(ciftiList[i] != NULL);
@@ -190,75 +322,51 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     }
     bool haveWarned = false;
     ciftiOut->setCiftiXML(baseXML);
-    vector<vector<float> > myrows(numFiles, vector<float>(rowSize));
-    for (int i = 0; i < numRows; ++i)
+    const int64_t blockRows = min(numRows, max((int64_t)1, BLOCK_ELEMENTS / max((int64_t)1, rowSize)));
+    vector<BlockAccumulator> threadAccum(getNumberOfReadingThreads(ciftiList));
+    vector<float> shift(blockRows * rowSize), cutoffLow(blockRows * rowSize), cutoffHigh(blockRows * rowSize);
+    for (int64_t firstRow = 0; firstRow < numRows; firstRow += blockRows)
     {
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrows[j].data(), i);
+        const int64_t numBlockRows = min(blockRows, numRows - firstRow);
+        for (int64_t r = 0; r < numBlockRows; ++r)
+        {//shift by the first file's values so the single-pass variance doesn't lose precision
+            float* shiftRow = shift.data() + r * rowSize;
+            ciftiList[0]->getRow(shiftRow, firstRow + r);
+            for (int64_t k = 0; k < rowSize; ++k)
+            {
+                if (!MathFunctions::isNumeric(shiftRow[k])) shiftRow[k] = 0.0f;
+            }
         }
-        vector<float> outrow(rowSize);
-        for (int k = 0; k < rowSize; ++k)
+        accumulateBlock(ciftiList, NULL, firstRow, numBlockRows, rowSize, SHIFTED_MOMENTS, shift.data(), NULL, NULL, threadAccum);
+        const int numThreads = (int)threadAccum.size();
+        for (int64_t index = 0; index < numBlockRows * rowSize; ++index)
         {
-            double accum = 0.0;
-            double weightaccum = 0.0;
-            int nonnumeric = 0;
-            for (int j = 0; j < numFiles; ++j)
+            double sum = 0.0, sumComp = 0.0, sumSq = 0.0, sumSqComp = 0.0, count = 0.0;
+            for (int t = 0; t < numThreads; ++t)
             {
-                if (MathFunctions::isNumeric(myrows[j][k]))
-                {
-                    accum += myrows[j][k];
-                } else {
-                    ++nonnumeric;
-                }
+                kahanAdd(sum, sumComp, threadAccum[t].m_sum[index] - threadAccum[t].m_sumComp[index]);
+                kahanAdd(sumSq, sumSqComp, threadAccum[t].m_sumSq[index] - threadAccum[t].m_sumSqComp[index]);
+                count += threadAccum[t].m_weight[index];
             }
-            if (nonnumeric >= numFiles - 1)
+            if (count < 2.0)
             {
                 if (!haveWarned)
                 {
                     CaretLogWarning("found element where less than 2 files have numeric values");
                     haveWarned = true;
                 }
-                outrow[k] = 0.0f;
+                cutoffLow[index] = 1.0f;//empty range, so the output is 0
+                cutoffHigh[index] = -1.0f;
             } else {
-                float mean = accum / (numFiles - nonnumeric);
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
-                {
-                    if (MathFunctions::isNumeric(myrows[j][k]))
-                    {
-                        float temp = myrows[j][k] - mean;
-                        accum += temp * temp;
-                    }
-                }
-                float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
-                float cutoffLow = mean - sigmaBelow * stdev;
-                float cutoffHigh = mean + sigmaAbove * stdev;
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
-                {
-                    if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)//implicitly excludes NaN and inf
-                    {
-                        if (weightsPtr != NULL)
-                        {
-                            float weight = (*weightsPtr)[j];
-                            accum += myrows[j][k] * weight;
-                            weightaccum += weight;
-                        } else {
-                            accum += myrows[j][k];
-                            weightaccum += 1.0;
-                        }
-                    }
-                }
-                if (weightaccum != 0.0)
-                {
-                    outrow[k] = accum / weightaccum;
-                } else {
-                    outrow[k] = 0.0f;
-                }
+                float mean = shift[index] + sum / count;
+                float stdev = sqrt(max(0.0, (sumSq - sum * sum / count) / (count - 1.0)));
+                cutoffLow[index] = mean - sigmaBelow * stdev;
+                cutoffHigh[index] = mean + sigmaAbove * stdev;
             }
         }
-        ciftiOut->setRow(outrow.data(), i);
+        accumulateBlock(ciftiList, weightsPtr, firstRow, numBlockRows, rowSize, WEIGHTED_SUM, NULL, cutoffLow.data(), cutoffHigh.data(), threadAccum);
+        writeWeightedMeans(threadAccum, firstRow, numBlockRows, rowSize, ciftiOut);
+        myProgress.reportProgress((float)(firstRow + numBlockRows) / numRows);
     }
 }
 
@@ -30,7 +30,7 @@
 #include "CaretOMP.h"
 #include "FileInformation.h"
 #include "CaretPointer.h"
-#include "dot_wrapper.h"
+#include "DotMatrixHelper.h"
 #include <fstream>
 #include <utility>
 #include <algorithm>
@@ -178,9 +178,9 @@ void AlgorithmCiftiCorrelation::useParameters(OperationParameters* myParams, Pro
     {
         if (ciftiRoiMode)
         {
-            AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, ciftiRoi, weights, fisherZ, memLimitGB, noDemean);
+            AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, ciftiRoi, weights, fisherZ, memLimitGB, noDemean, covariance);
         } else {
-            AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoi, rightRoi, cerebRoi, volRoi, weights, fisherZ, memLimitGB, noDemean);
+            AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoi, rightRoi, cerebRoi, volRoi, weights, fisherZ, memLimitGB, noDemean, covariance);
         }
     } else {
         AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, weights, fisherZ, memLimitGB, noDemean, covariance);
@@ -223,11 +223,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
+    vector<int> chunkRows, chunkPosition(numRows, -1);
     for (int startrow = 0; startrow < numRows; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numRows) endrow = numRows;
         outRows.resize(endrow - startrow);
+        chunkRows.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -238,41 +240,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
+            chunkRows[i - startrow] = i;
+            chunkPosition[i] = i - startrow;
         }
-        int curRow = 0;//because we can't trust the order threads hit the critical section
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (myrow >= startrow && myrow < endrow)//check whether we are in the output memory area
-                {
-                    if (j >= myrow)//if so, only compute one half, and store both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(j, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[myrow - startrow][j] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(j, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
-        }
+        processChunk(chunkRows, chunkPosition, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], i);
+            chunkPosition[i] = -1;
         }
         if (!cacheFullInput)
         {
@@ -409,13 +384,13 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             cacheRow(i);
         }
     }
-    CaretArray<int> indexReverse(numRows, -1);
+    vector<int> chunkRows, chunkPosition(numRows, -1);
     for (int startrow = 0; startrow < numSelected; startrow += numCacheRows)
     {
         int endrow = startrow + numCacheRows;
         if (endrow > numSelected) endrow = numSelected;
         outRows.resize(endrow - startrow);
-        int curRow = 0;//because we can't trust the order threads hit the critical section
+        chunkRows.resize(endrow - startrow);
         for (int i = startrow; i < endrow; ++i)
         {
             if (!cacheFullInput)
@@ -426,42 +401,14 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
             {
                 outRows[i - startrow] = CaretArray<float>(numRows);
             }
-            indexReverse[ciftiIndexList[i].first] = i;
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < numRows; ++i)
-        {
-            float movingRrs;
-            int myrow;
-            const float* movingRow;
-#pragma omp critical
-            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
-                myrow = curRow;//so, manually force it to read sequentially
-                ++curRow;
-                movingRow = getRow(myrow, movingRrs);
-            }
-            for (int j = startrow; j < endrow; ++j)
-            {
-                if (indexReverse[myrow] != -1)//check if we are on a row that is in the output memory range
-                {
-                    if (indexReverse[myrow] <= j)//if so, only compute one of the elements, then store it both places
-                    {
-                        float cacheRrs;
-                        const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                        outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                        outRows[indexReverse[myrow] - startrow][ciftiIndexList[j].first] = outRows[j - startrow][myrow];
-                    }
-                } else {
-                    float cacheRrs;
-                    const float* cacheRow = getRow(ciftiIndexList[j].first, cacheRrs, true);
-                    outRows[j - startrow][myrow] = correlate(movingRow, movingRrs, cacheRow, cacheRrs, fisherZ);
-                }
-            }
+            chunkRows[i - startrow] = ciftiIndexList[i].first;
+            chunkPosition[ciftiIndexList[i].first] = i - startrow;
         }
+        processChunk(chunkRows, chunkPosition, outRows, fisherZ);
         for (int i = startrow; i < endrow; ++i)
         {
             myCiftiOut->setRow(outRows[i - startrow], ciftiIndexList[i].second);
-            indexReverse[ciftiIndexList[i].first] = -1;
+            chunkPosition[ciftiIndexList[i].first] = -1;
         }
         if (!cacheFullInput)
         {
@@ -517,30 +464,98 @@ AlgorithmCiftiCorrelation::AlgorithmCiftiCorrelation(ProgressObject* myProgObj,
     AlgorithmCiftiCorrelation(myProgObj, myCifti, myCiftiOut, leftRoiPtr, rightRoiPtr, cerebRoiPtr, volRoiPtr, weights, fisherZ, memLimitGB, noDemean, covariance);//HACK: pass through our progress object
 }
 
-float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
+void AlgorithmCiftiCorrelation::processChunk(const vector<int>& chunkRows, const vector<int>& chunkPosition, vector<CaretArray<float> >& outRows, const bool& fisherZ)
+{//compute all rows against the cached chunk rows as a blocked matrix multiply, each thread takes a block of rows, and then multiplies it by cache-sized tiles of the chunk
+    int numRows = m_inputCifti->getNumberOfRows();
+    int numChunk = (int)chunkRows.size();
+    int64_t dotLength = getDotLength();
+    vector<const float*> chunkPtrs(numChunk);
+    vector<float> chunkRrs(numChunk);
+    for (int i = 0; i < numChunk; ++i)
+    {
+        chunkPtrs[i] = getRow(chunkRows[i], chunkRrs[i], true);
+    }
+    int curRow = 0;//because we can't trust the order threads hit the critical section
+#pragma omp CARET_PAR
+    {
+        vector<const float*> movingPtrs(m_movingBlockRows);
+        vector<float> movingRrs(m_movingBlockRows);
+        vector<double> tileOut((int64_t)m_movingBlockRows * m_tileRows);
+        while (true)
+        {
+            int blockStart, blockEnd;
+#pragma omp critical
+            {//CiftiFile may explode if we request multiple rows concurrently (needs mutexes), but we should force sequential requests anyway
+                blockStart = curRow;//so, manually force it to read sequentially
+                blockEnd = min(blockStart + m_movingBlockRows, numRows);
+                curRow = blockEnd;
+                for (int i = blockStart; i < blockEnd; ++i)
+                {
+                    movingPtrs[i - blockStart] = getRow(i, movingRrs[i - blockStart], false, i - blockStart);
+                }
+            }
+            if (blockStart >= numRows) break;
+            int numMoving = blockEnd - blockStart;
+            for (int tileStart = 0; tileStart < numChunk; tileStart += m_tileRows)
+            {
+                int tileEnd = min(tileStart + m_tileRows, numChunk);
+                bool needed = false;//rows that are in the chunk only compute the upper triangle, so skip tiles that are entirely below it
+                for (int i = 0; i < numMoving; ++i)
+                {
+                    int position = chunkPosition[blockStart + i];
+                    if (position == -1 || position < tileEnd)
+                    {
+                        needed = true;
+                        break;
+                    }
+                }
+                if (!needed) continue;
+                DotMatrixHelper::rowBlockDot(movingPtrs.data(), numMoving, chunkPtrs.data() + tileStart, tileEnd - tileStart, dotLength, tileOut.data(), m_tileRows);
+                for (int i = 0; i < numMoving; ++i)
+                {
+                    int myrow = blockStart + i;
+                    int position = chunkPosition[myrow];
+                    const double* tileRow = tileOut.data() + (int64_t)i * m_tileRows - tileStart;
+                    if (position != -1)//check whether we are in the output memory area
+                    {
+                        for (int j = max(position, tileStart); j < tileEnd; ++j)//if so, only compute one half, and store both places
+                        {
+                            outRows[j][myrow] = correlate(tileRow[j], movingRrs[i], chunkRrs[j], position == j, fisherZ);
+                            outRows[position][chunkRows[j]] = outRows[j][myrow];
+                        }
+                    } else {
+                        for (int j = tileStart; j < tileEnd; ++j)
+                        {
+                            outRows[j][myrow] = correlate(tileRow[j], movingRrs[i], chunkRrs[j], false, fisherZ);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+float AlgorithmCiftiCorrelation::correlate(const double& accum, const float& rrs1, const float& rrs2, const bool& sameRow, const bool& fisherZ)
 {
     double r;
-    if (row1 == row2 && !m_covariance)
+    if (sameRow && !m_covariance)
     {
         r = 1.0;//short circuit for same row
     } else {
         if (m_weightedMode)
-        {
-            int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-            double accum = sddot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
+        {//rows have already had the weighted row means subtracted out, and weights applied, and were compacted to not include any zero weights
             if (m_covariance)
             {
                 if (m_binaryWeights)
                 {
-                    r = accum / numWeights;
+                    r = accum / m_weightIndexes.size();
                 } else {
                     r = accum / rrs1;//NOTE: will equal rrs2 as it only depends on weights, and is not square root
                 }
             } else {
-                r = accum / (rrs1 * rrs2);//as do these
+                r = accum / (rrs1 * rrs2);
             }
-        } else {
-            double accum = sddot(row1, row2, m_numCols);//these have already had the row means subtracted out
+        } else {//these have already had the row means subtracted out
             if (m_covariance)
             {
                 r = accum / m_numCols;
@@ -564,6 +579,12 @@ float AlgorithmCiftiCorrelation::correlate(const float* row1, const float& rrs1,
     return r;
 }
 
+int AlgorithmCiftiCorrelation::getDotLength() const
+{
+    if (m_weightedMode) return (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
+    return m_numCols;
+}
+
 void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>* weights, const bool& noDemean, const bool& covariance)
 {
     m_noDemean = noDemean;
@@ -605,6 +626,13 @@ void AlgorithmCiftiCorrelation::init(const CiftiFile* input, const vector<float>
     } else {
         m_weightedMode = false;
     }
+    int dotLength = getDotLength();
+    m_tileRows = DotMatrixHelper::getTileRows(dotLength, DotMatrixHelper::L2_TARGET_BYTES);//tile of cached rows is reused by every row in a moving block
+    m_movingBlockRows = DotMatrixHelper::getTileRows(dotLength, 4 * DotMatrixHelper::L2_TARGET_BYTES);//more rows per block means fewer passes through the cached rows
+    int64_t maxTileOutRows = (4 * DotMatrixHelper::L2_TARGET_BYTES) / ((int64_t)m_tileRows * sizeof(double));//short rows give wide tiles, so also keep the per-thread tile output within a fixed budget
+    maxTileOutRows -= maxTileOutRows % DotMatrixHelper::BLOCK_B_ROWS;
+    if (maxTileOutRows < DotMatrixHelper::BLOCK_B_ROWS) maxTileOutRows = DotMatrixHelper::BLOCK_B_ROWS;
+    if (m_movingBlockRows > maxTileOutRows) m_movingBlockRows = (int)maxTileOutRows;
 }
 
 void AlgorithmCiftiCorrelation::cacheRow(const int& ciftiIndex)
@@ -638,7 +666,7 @@ void AlgorithmCiftiCorrelation::clearCache()
     m_cacheUsed = 0;
 }
 
-const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached)
+const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& rootResidSqr, const bool& mustBeCached, const int& tempSlot)
 {
     float* ret;
     CaretAssertVectorIndex(m_rowInfo, ciftiIndex);
@@ -651,7 +679,7 @@ const float* AlgorithmCiftiCorrelation::getRow(const int& ciftiIndex, float& roo
         {
             throw AlgorithmException("something very bad happened, notify the developers");
         }
-        ret = getTempRow();
+        ret = getTempRow(tempSlot);
         m_inputCifti->getRow(ret, ciftiIndex);
         if (!m_rowInfo[ciftiIndex].m_haveCalculated)
         {
@@ -744,8 +772,7 @@ void AlgorithmCiftiCorrelation::computeRowStats(const float* row, float& mean, f
 }
 
 void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
-{
-    if (m_noDemean) return;//skip subtracting zero from everything
+{//NOTE: in weighted mode, this also compacts the row, so it must be done even with -no-demean (where mean is zero)
     if (m_weightedMode)
     {
         int weightsize = (int)m_weightIndexes.size();
@@ -762,6 +789,7 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
             }
         }
     } else {
+        if (m_noDemean) return;//skip subtracting zero from everything
         for (int i = 0; i < m_numCols; ++i)
         {
             row[i] -= mean;
@@ -769,8 +797,10 @@ void AlgorithmCiftiCorrelation::doSubtract(float* row, const float& mean)
     }
 }
 
-float* AlgorithmCiftiCorrelation::getTempRow()
+float* AlgorithmCiftiCorrelation::getTempRow(const int& tempSlot)
 {
+    CaretAssert(tempSlot >= 0 && tempSlot < m_movingBlockRows);
+    int64_t blockSize = (int64_t)m_movingBlockRows * m_numCols;
 #ifdef CARET_OMP
     int oldsize = (int)m_tempRows.size();
     int threadNum = omp_get_thread_num();
@@ -779,17 +809,17 @@ float* AlgorithmCiftiCorrelation::getTempRow()
         m_tempRows.resize(threadNum + 1);
         for (int i = oldsize; i <= threadNum; ++i)
         {
-            m_tempRows[i] = CaretArray<float>(m_numCols);
+            m_tempRows[i] = CaretArray<float>(blockSize);
         }
     }
-    return m_tempRows[threadNum].getArray();
+    return m_tempRows[threadNum].getArray() + (int64_t)tempSlot * m_numCols;
 #else
     if (m_tempRows.size() == 0)
     {
         m_tempRows.resize(1);
-        m_tempRows[0] = CaretArray<float>(m_numCols);
+        m_tempRows[0] = CaretArray<float>(blockSize);
     }
-    return m_tempRows[0].getArray();
+    return m_tempRows[0].getArray() + (int64_t)tempSlot * m_numCols;
 #endif
 }
 
@@ -800,10 +830,16 @@ int AlgorithmCiftiCorrelation::numRowsForMem(const float& memLimitGB, bool& cach
     int64_t targetBytes = (int64_t)(memLimitGB * 1024 * 1024 * 1024);
     if (m_inputCifti->isInMemory()) targetBytes -= numRows * m_numCols * 4;//count in-memory input against the total too
 #ifdef CARET_OMP
-    targetBytes -= inrowBytes * omp_get_max_threads();
+    int numThreads = omp_get_max_threads();
 #else
-    targetBytes -= inrowBytes;//1 row in memory that isn't a reference to cache
+    int numThreads = 1;
 #endif
+    while (m_movingBlockRows > DotMatrixHelper::BLOCK_B_ROWS &&
+           (int64_t)m_movingBlockRows * (inrowBytes + m_tileRows * sizeof(double)) * numThreads > targetBytes / 4)
+    {//don't let the per-thread blocks take over the memory limit
+        m_movingBlockRows = max(m_movingBlockRows / 2, (int)DotMatrixHelper::BLOCK_B_ROWS);
+    }
+    targetBytes -= (int64_t)m_movingBlockRows * (inrowBytes + m_tileRows * sizeof(double)) * numThreads;//block of rows and tile output per thread, that aren't references to cache
     targetBytes -= numRows * sizeof(RowInfo);//storage for mean, stdev, and info about caching
     int64_t perRowBytes = inrowBytes + outrowBytes;//cache and memory collation for output rows
     if (numRows * m_numCols * 4 < targetBytes * 0.7f)//if caching the entire input file would take less than 70% of remaining allotted memory, do it to reduce IO
@@ -21,7 +21,9 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "MetricFile.h"
@@ -29,6 +31,7 @@
 #include "ReductionOperation.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 
@@ -205,6 +208,139 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
     AlgorithmCiftiParcellate(myProgObj, myCiftiIn, myCiftiLabel, direction, myCiftiOut, method, excludeLow, excludeHigh, onlyNumeric);
 }
 
+namespace
+{
+    ///parcellates along the row, one job per row, parcelWeights is NULL for unweighted reduction
+    class ParcellateRowWorker : public CiftiRowPipeline::Worker
+    {
+        const CiftiFile* m_ciftiIn;
+        CiftiFile* m_ciftiOut;
+        const vector<vector<float> >* m_parcelWeights;
+        ReductionEnum::Enum m_method;
+        float m_excludeLow, m_excludeHigh;
+        bool m_onlyNumeric, m_isLabel;
+        int m_labelDir;
+        int64_t m_numCols;
+        vector<vector<int64_t> > m_indices, m_parcelMembers;
+        vector<float> m_unassignedKeys;
+        vector<vector<float> > m_threadScratch;//float so we can use ReductionOperation
+    public:
+        ParcellateRowWorker(const CiftiFile* myCiftiIn, CiftiFile* myCiftiOut, const vector<int>& indexToParcel, const vector<vector<float> >* parcelWeights,
+                            const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric, const bool& isLabel, const int& labelDir)
+        {
+            m_ciftiIn = myCiftiIn;
+            m_ciftiOut = myCiftiOut;
+            m_parcelWeights = parcelWeights;
+            m_method = method;
+            m_excludeLow = excludeLow;
+            m_excludeHigh = excludeHigh;
+            m_onlyNumeric = onlyNumeric;
+            m_isLabel = isLabel;
+            m_labelDir = labelDir;
+            vector<int64_t> dims = myCiftiIn->getDimensions();
+            m_numCols = dims[0];
+            m_indices = CiftiRowPipeline::getIndexList(vector<int64_t>(dims.begin() + 1, dims.end()));
+            const CiftiXML& myOutXML = myCiftiOut->getCiftiXML();
+            m_parcelMembers.resize(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
+            for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
+            {
+                if (indexToParcel[j] != -1)
+                {
+                    m_parcelMembers[indexToParcel[j]].push_back(j);
+                }
+            }
+            size_t maxCount = 0;
+            for (size_t j = 0; j < m_parcelMembers.size(); ++j)
+            {
+                CaretAssert(parcelWeights == NULL || (*parcelWeights)[j].size() == m_parcelMembers[j].size());
+                maxCount = max(maxCount, m_parcelMembers[j].size());
+            }
+            if (isLabel)
+            {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                const CiftiLabelsMap& myLabelsMap = myOutXML.getLabelsMap(labelDir);
+                m_unassignedKeys.resize(myLabelsMap.getLength());
+                for (int64_t i = 0; i < myLabelsMap.getLength(); ++i)
+                {
+                    m_unassignedKeys[i] = myLabelsMap.getMapLabelTable(i)->getUnassignedLabelKey();
+                }
+            }
+            int numThreads = 1;
+#ifdef CARET_OMP
+            numThreads = omp_get_max_threads();
+#endif
+            m_threadScratch.resize(numThreads, vector<float>(maxCount));
+        }
+        int64_t getNumJobs() const { return m_indices.size(); }
+        int64_t getJobFloats() const { return m_numCols + m_parcelMembers.size(); }
+        void readJob(const int64_t& job, vector<float>& inputOut)
+        {
+            inputOut.resize(m_numCols);
+            m_ciftiIn->getRow(inputOut.data(), m_indices[job]);
+        }
+        void computeJob(const int64_t& job, const vector<float>& input, vector<float>& outputOut, const int& thread)
+        {
+            int numParcels = (int)m_parcelMembers.size();
+            outputOut.resize(numParcels);
+            float* parcelData = m_threadScratch[thread].data();
+            for (int j = 0; j < numParcels; ++j)
+            {
+                const vector<int64_t>& members = m_parcelMembers[j];
+                int64_t count = (int64_t)members.size();
+                for (int64_t k = 0; k < count; ++k)
+                {
+                    if (m_isLabel)
+                    {
+                        parcelData[k] = floor(input[members[k]] + 0.5f);//round to nearest integer to be safe
+                    } else {
+                        parcelData[k] = input[members[k]];
+                    }
+                }
+                if (count > 0 && (m_method != ReductionEnum::SAMPSTDEV || count > 1))
+                {
+                    if (m_parcelWeights != NULL)
+                    {
+                        const float* weights = (*m_parcelWeights)[j].data();
+                        if (m_excludeLow > 0.0f && m_excludeHigh > 0.0f)
+                        {
+                            outputOut[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData, weights, count, m_method, m_excludeLow, m_excludeHigh);
+                        } else {
+                            if (m_onlyNumeric)
+                            {
+                                outputOut[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData, weights, count, m_method);
+                            } else {
+                                outputOut[j] = ReductionOperation::reduceWeighted(parcelData, weights, count, m_method);
+                            }
+                        }
+                    } else {
+                        if (m_excludeLow > 0.0f && m_excludeHigh > 0.0f)
+                        {
+                            outputOut[j] = ReductionOperation::reduceExcludeDev(parcelData, count, m_method, m_excludeLow, m_excludeHigh);
+                        } else {
+                            if (m_onlyNumeric)
+                            {
+                                outputOut[j] = ReductionOperation::reduceOnlyNumeric(parcelData, count, m_method);
+                            } else {
+                                outputOut[j] = ReductionOperation::reduce(parcelData, count, m_method);
+                            }
+                        }
+                    }
+                } else {
+                    if (m_isLabel)
+                    {
+                        outputOut[j] = m_unassignedKeys[m_indices[job][m_labelDir - 1]];
+                    } else {
+                        outputOut[j] = 0.0f;
+                    }
+                }
+            }
+        }
+        void writeJob(const int64_t& job, const vector<float>& output)
+        {
+            m_ciftiOut->setRow(output.data(), m_indices[job]);
+        }
+    };
+}
+
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                                    const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric) : AbstractAlgorithm(myProgObj)
 {
@@ -272,59 +408,8 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     }
     if (direction == CiftiXML::ALONG_ROW)
     {
-        vector<float> scratchOutRow(numParcels);
-        vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-        for (int j = 0; j < numParcels; ++j)
-        {
-            parcelData[j].reserve(parcelCounts[j]);
-        }
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
-        {
-            for (int j = 0; j < numParcels; ++j)
-            {
-                parcelData[j].clear();//doesn't change allocation
-            }
-            myCiftiIn->getRow(scratchRow.data(), *iter);
-            for (int64_t j = 0; j < numCols; ++j)
-            {
-                int parcel = indexToParcel[j];
-                if (parcel != -1)
-                {
-                    if (isLabel)
-                    {
-                        parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                    } else {
-                        parcelData[parcel].push_back(scratchRow[j]);
-                    }
-                }
-            }
-            for (int j = 0; j < numParcels; ++j)
-            {
-                CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
-                if (parcelCounts[j] > 0 && (method != ReductionEnum::SAMPSTDEV || parcelCounts[j] > 1))
-                {
-                    if (excludeLow > 0.0f && excludeHigh > 0.0f)
-                    {
-                        scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelData[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                    } else {
-                        if (onlyNumeric)
-                        {
-                            scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelData[j].data(), parcelData[j].size(), method);
-                        } else {
-                            scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), method);
-                        }
-                    }
-                } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                    if (isLabel)
-                    {
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                    } else {
-                        scratchOutRow[j] = 0.0f;
-                    }
-                }
-            }
-            myCiftiOut->setRow(scratchOutRow.data(), *iter);
-        }
+        ParcellateRowWorker myWorker(myCiftiIn, myCiftiOut, indexToParcel, NULL, method, excludeLow, excludeHigh, onlyNumeric, isLabel, labelDir);
+        CiftiRowPipeline::run(myWorker, myWorker.getNumJobs(), myWorker.getJobFloats());
     } else {
         vector<float> scratchOutRow(numCols);
         vector<int64_t> otherDims = dims;
@@ -450,59 +535,8 @@ namespace
         vector<float> scratchRow(numCols);
         if (direction == CiftiXML::ALONG_ROW)
         {
-            vector<float> scratchOutRow(numParcels);
-            vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-            for (int j = 0; j < numParcels; ++j)
-            {
-                parcelData[j].reserve(parcelWeights[j].size());
-            }
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
-            {
-                for (int j = 0; j < numParcels; ++j)
-                {
-                    parcelData[j].clear();//doesn't change allocation
-                }
-                myCiftiIn->getRow(scratchRow.data(), *iter);
-                for (int64_t j = 0; j < numCols; ++j)
-                {
-                    int parcel = indexToParcel[j];
-                    if (parcel != -1)
-                    {
-                        if (isLabel)
-                        {
-                            parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                        } else {
-                            parcelData[parcel].push_back(scratchRow[j]);
-                        }
-                    }
-                }
-                for (int j = 0; j < numParcels; ++j)
-                {
-                    CaretAssert(parcelWeights[j].size() == parcelData[j].size());
-                    if (parcelData[j].size() > 0 && (method != ReductionEnum::SAMPSTDEV || parcelData[j].size() > 1))
-                    {
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
-                        {
-                            scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
-                            {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
-                            } else {
-                                scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
-                            }
-                        }
-                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                        if (isLabel)
-                        {
-                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                        } else {
-                            scratchOutRow[j] = 0.0f;
-                        }
-                    }
-                }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
-            }
+            ParcellateRowWorker myWorker(myCiftiIn, myCiftiOut, indexToParcel, &parcelWeights, method, excludeLow, excludeHigh, onlyNumeric, isLabel, labelDir);
+            CiftiRowPipeline::run(myWorker, myWorker.getNumJobs(), myWorker.getJobFloats());
         } else {
             vector<float> scratchOutRow(numCols);
             vector<int64_t> otherDims = dims;
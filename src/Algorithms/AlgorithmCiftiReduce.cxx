@@ -22,8 +22,9 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
-#include "MultiDimIterator.h"
+#include "CiftiRowPipeline.h"
 #include "ReductionOperation.h"
 
 #include <vector>
@@ -46,7 +47,7 @@ OperationParameters* AlgorithmCiftiReduce::getParameters()
     OperationParameters* ret = new OperationParameters();
     ret->addCiftiParameter(1, "cifti-in", "the cifti file to reduce");
     
-    ret->addStringParameter(2, "operation", "the reduction operator to use");
+    ret->addStringParameter(2, "operation", "the reduction operator to use, or a comma separated list of them");
     
     ret->addCiftiOutputParameter(3, "cifti-out", "the output cifti file");
     
@@ -62,6 +63,8 @@ OperationParameters* AlgorithmCiftiReduce::getParameters()
     ret->setHelpText(
         AString("For the specified direction (default ROW), perform a reduction operation along that direction.  ") +
         CiftiXML::directionFromStringExplanation() + "  " +
+        "If more than one operator is given, separated by commas (for example, MEAN,STDEV,MEDIAN), the output has one map per operator along that direction, " +
+        "in the order given, and the input is read only once.  " +
         "The reduction operators are as follows:\n\n" + ReductionOperation::getHelpInfo()
     );
     return ret;
@@ -80,133 +83,196 @@ void AlgorithmCiftiReduce::useParameters(OperationParameters* myParams, Progress
     }
     OptionalParameter* excludeOpt = myParams->getOptionalParameter(4);
     bool onlyNumeric = myParams->getOptionalParameter(5)->m_present;
-    bool ok = false;
-    ReductionEnum::Enum myReduce = ReductionEnum::fromName(opString, &ok);
-    if (!ok) throw AlgorithmException("unrecognized operation string '" + opString + "'");
+    vector<ReductionEnum::Enum> myReduces;
+    try
+    {
+        myReduces = ReductionOperation::typesFromString(opString);
+    } catch (CaretException& e) {
+        throw AlgorithmException(e.whatString());
+    }
     if (excludeOpt->m_present)
     {
         if (onlyNumeric) CaretLogWarning("-only-numeric is redundant when -exclude-outliers is specified");
-        AlgorithmCiftiReduce(myProgObj, ciftiIn, myReduce, ciftiOut, excludeOpt->getDouble(1), excludeOpt->getDouble(2), direction);
+        AlgorithmCiftiReduce(myProgObj, ciftiIn, myReduces, ciftiOut, excludeOpt->getDouble(1), excludeOpt->getDouble(2), direction);
     } else {
-        AlgorithmCiftiReduce(myProgObj, ciftiIn, myReduce, ciftiOut, onlyNumeric, direction);
+        AlgorithmCiftiReduce(myProgObj, ciftiIn, myReduces, ciftiOut, onlyNumeric, direction);
     }
 }
 
-AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
-                                           const bool& onlyNumeric, const int& direction) : AbstractAlgorithm(myProgObj)
+namespace
 {
-    LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
-    const CiftiXML& inputXML = ciftiIn->getCiftiXML();
-    CiftiXML myOutXML = inputXML;
-    if (direction >= myOutXML.getNumberOfDimensions()) throw AlgorithmException("specified reduction direction doesn't exist in input cifti file");
-    CiftiScalarsMap newMap;
-    newMap.setLength(1);
-    newMap.setMapName(0, ReductionEnum::toName(myReduce));
-    myOutXML.setMap(direction, newMap);
-    ciftiOut->setCiftiXML(myOutXML);
-    vector<int64_t> inDims = inputXML.getDimensions();
-    if (direction == CiftiXML::ALONG_ROW)
+    ///one job per output row (or set of rows, one per reduction, when not reducing along the row):
+    ///when reducing along the row, it reads one input row, otherwise all input rows along the reduction direction
+    class ReduceWorker : public CiftiRowPipeline::Worker
     {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = -1;
-            if (onlyNumeric)
+        const CiftiFile* m_ciftiIn;
+        CiftiFile* m_ciftiOut;
+        vector<ReductionEnum::Enum> m_reduces;
+        bool m_onlyNumeric, m_excludeDev;
+        float m_sigmaBelow, m_sigmaAbove;
+        int m_direction;
+        vector<int64_t> m_inDims;
+        vector<vector<int64_t> > m_indices;//when not reducing along row, has a dummy value in place of the reduction direction
+        vector<vector<float> > m_threadScratch, m_threadResults;
+        vector<ReductionOperation::Scratch> m_threadReduceScratch;
+        void doReduce(const float* data, const int64_t& count, float* resultsOut, const int& thread)
+        {
+            if (m_excludeDev)
             {
-                result = ReductionOperation::reduceOnlyNumeric(scratchInRow.data(), inDims[0], myReduce);
+                ReductionOperation::reduceMultipleExcludeDev(data, count, m_reduces, m_sigmaBelow, m_sigmaAbove, resultsOut, m_threadReduceScratch[thread]);
+            } else if (m_onlyNumeric) {
+                ReductionOperation::reduceMultipleOnlyNumeric(data, count, m_reduces, resultsOut, m_threadReduceScratch[thread]);
             } else {
-                result = ReductionOperation::reduce(scratchInRow.data(), inDims[0], myReduce);
+                ReductionOperation::reduceMultiple(data, count, m_reduces, resultsOut, m_threadReduceScratch[thread]);
             }
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
         }
-    } else {
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
-        vector<int64_t> otherDims = inDims;
-        otherDims.erase(otherDims.begin() + direction);//direction isn't 0
-        otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
-        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+    public:
+        ReduceWorker(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const vector<ReductionEnum::Enum>& myReduces, const bool& onlyNumeric,
+                     const bool& excludeDev, const float& sigmaBelow, const float& sigmaAbove, const int& direction)
         {
-            vector<int64_t> indexvec = *iter;
-            indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
-            for (int64_t i = 0; i < inDims[direction]; ++i)
+            m_ciftiIn = ciftiIn;
+            m_ciftiOut = ciftiOut;
+            m_reduces = myReduces;
+            m_onlyNumeric = onlyNumeric;
+            m_excludeDev = excludeDev;
+            m_sigmaBelow = sigmaBelow;
+            m_sigmaAbove = sigmaAbove;
+            m_direction = direction;
+            m_inDims = ciftiIn->getDimensions();
+            int numThreads = 1;
+#ifdef CARET_OMP
+            numThreads = omp_get_max_threads();
+#endif
+            m_threadReduceScratch.resize(numThreads);
+            m_threadResults.resize(numThreads, vector<float>(m_reduces.size()));
+            if (direction == CiftiXML::ALONG_ROW)
             {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
+                m_indices = CiftiRowPipeline::getIndexList(vector<int64_t>(m_inDims.begin() + 1, m_inDims.end()));// + 1 to exclude row dimension, because getRow/setRow
+            } else {
+                vector<int64_t> otherDims = m_inDims;
+                otherDims.erase(otherDims.begin() + direction);//direction isn't 0
+                otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
+                m_indices = CiftiRowPipeline::getIndexList(otherDims);
+                for (size_t i = 0; i < m_indices.size(); ++i)
+                {
+                    m_indices[i].insert(m_indices[i].begin() + direction - 1, -1);//dummy value in place of reduce direction
+                }
+                m_threadScratch.resize(numThreads, vector<float>(m_inDims[direction]));
             }
-            for (int64_t i = 0; i < inDims[0]; ++i)
+        }
+        int64_t getNumJobs() const { return m_indices.size(); }
+        int64_t getJobFloats() const
+        {
+            const int64_t numReduces = m_reduces.size();
+            if (m_direction == CiftiXML::ALONG_ROW) return m_inDims[0] + numReduces;
+            return m_inDims[0] * (m_inDims[m_direction] + numReduces);
+        }
+        void readJob(const int64_t& job, vector<float>& inputOut)
+        {
+            if (m_direction == CiftiXML::ALONG_ROW)
             {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
-                }
-                if (onlyNumeric)
+                inputOut.resize(m_inDims[0]);
+                m_ciftiIn->getRow(inputOut.data(), m_indices[job]);
+            } else {
+                inputOut.resize(m_inDims[0] * m_inDims[m_direction]);
+                vector<int64_t> indexvec = m_indices[job];
+                for (int64_t i = 0; i < m_inDims[m_direction]; ++i)
                 {
-                    outRow[i] = ReductionOperation::reduceOnlyNumeric(reduceScratch.data(), inDims[direction], myReduce);
-                } else {
-                    outRow[i] = ReductionOperation::reduce(reduceScratch.data(), inDims[direction], myReduce);
+                    indexvec[m_direction - 1] = i;
+                    m_ciftiIn->getRow(inputOut.data() + i * m_inDims[0], indexvec);
                 }
             }
-            indexvec[direction - 1] = 0;//only one element along reduce output direction
-            ciftiOut->setRow(outRow.data(), indexvec);
-        }
-    }
-}
-
-AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
-                                           const float& sigmaBelow, const float& sigmaAbove, const int& direction) : AbstractAlgorithm(myProgObj)
-{
-    LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
-    const CiftiXML& inputXML = ciftiIn->getCiftiXML();
-    CiftiXML myOutXML = inputXML;
-    if (direction >= myOutXML.getNumberOfDimensions()) throw AlgorithmException("specified reduction direction doesn't exist in input cifti file");
-    CiftiScalarsMap newMap;
-    newMap.setLength(1);
-    newMap.setMapName(0, ReductionEnum::toName(myReduce));
-    myOutXML.setMap(direction, newMap);
-    ciftiOut->setCiftiXML(myOutXML);
-    vector<int64_t> inDims = inputXML.getDimensions();
-    if (direction == CiftiXML::ALONG_ROW)
-    {
-        vector<float> scratchInRow(inDims[0]);
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(inDims.begin() + 1, inDims.end())); !iter.atEnd(); ++iter)
-        {// + 1 to exclude row dimension, because getRow/setRow
-            ciftiIn->getRow(scratchInRow.data(), *iter);
-            float result = ReductionOperation::reduceExcludeDev(scratchInRow.data(), inDims[0], myReduce, sigmaBelow, sigmaAbove);
-            ciftiOut->setRow(&result, *iter);//if reducing along row, length of output row is 1
         }
-    } else {
-        vector<vector<float> > scratchInRows(inDims[direction], vector<float>(inDims[0]));
-        vector<float> outRow(inDims[0]), reduceScratch(inDims[direction]);//reduction isn't along row, so out rows will be same length as in rows
-        vector<int64_t> otherDims = inDims;
-        otherDims.erase(otherDims.begin() + direction);//direction isn't 0
-        otherDims.erase(otherDims.begin());//remove row direction because getRow/setRow
-        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+        void computeJob(const int64_t&, const vector<float>& input, vector<float>& outputOut, const int& thread)
         {
-            vector<int64_t> indexvec = *iter;
-            indexvec.insert(indexvec.begin() + direction - 1, -1);//dummy value in place of reduce direction
-            for (int64_t i = 0; i < inDims[direction]; ++i)
+            const int64_t numReduces = m_reduces.size();
+            if (m_direction == CiftiXML::ALONG_ROW)
             {
-                indexvec[direction - 1] = i;
-                ciftiIn->getRow(scratchInRows[i].data(), indexvec);
+                outputOut.resize(numReduces);//if reducing along row, length of output row is the number of reductions
+                doReduce(input.data(), m_inDims[0], outputOut.data(), thread);
+            } else {
+                outputOut.resize(m_inDims[0] * numReduces);//reduction isn't along row, so out rows will be same length as in rows, one row per reduction
+                vector<float>& reduceScratch = m_threadScratch[thread];
+                vector<float>& results = m_threadResults[thread];
+                for (int64_t i = 0; i < m_inDims[0]; ++i)
+                {
+                    for (int64_t j = 0; j < m_inDims[m_direction]; ++j)
+                    {//need reduction input in contiguous array
+                        reduceScratch[j] = input[j * m_inDims[0] + i];
+                    }
+                    doReduce(reduceScratch.data(), m_inDims[m_direction], results.data(), thread);
+                    for (int64_t r = 0; r < numReduces; ++r)
+                    {
+                        outputOut[r * m_inDims[0] + i] = results[r];
+                    }
+                }
             }
-            for (int64_t i = 0; i < inDims[0]; ++i)
+        }
+        void writeJob(const int64_t& job, const vector<float>& output)
+        {
+            if (m_direction == CiftiXML::ALONG_ROW)
             {
-                for (int64_t j = 0; j < inDims[direction]; ++j)
-                {//need reduction input in contiguous array
-                    reduceScratch[j] = scratchInRows[j][i];
+                m_ciftiOut->setRow(output.data(), m_indices[job]);
+            } else {
+                vector<int64_t> indexvec = m_indices[job];
+                for (int64_t r = 0; r < (int64_t)m_reduces.size(); ++r)
+                {//one element along reduce output direction per reduction
+                    indexvec[m_direction - 1] = r;
+                    m_ciftiOut->setRow(output.data() + r * m_inDims[0], indexvec);
                 }
-                outRow[i] = ReductionOperation::reduceExcludeDev(reduceScratch.data(), inDims[direction], myReduce, sigmaBelow, sigmaAbove);
             }
-            indexvec[direction - 1] = 0;//only one element along reduce output direction
-            ciftiOut->setRow(outRow.data(), indexvec);
         }
+    };
+    
+    void reduceCifti(const CiftiFile* ciftiIn, const vector<ReductionEnum::Enum>& myReduces, CiftiFile* ciftiOut, const bool& onlyNumeric,
+                     const bool& excludeDev, const float& sigmaBelow, const float& sigmaAbove, const int& direction)
+    {
+        CaretAssert(direction >= 0);
+        if (myReduces.empty()) throw AlgorithmException("no reduction operation specified");
+        const CiftiXML& inputXML = ciftiIn->getCiftiXML();
+        CiftiXML myOutXML = inputXML;
+        if (direction >= myOutXML.getNumberOfDimensions()) throw AlgorithmException("specified reduction direction doesn't exist in input cifti file");
+        CiftiScalarsMap newMap;
+        newMap.setLength(myReduces.size());
+        for (int i = 0; i < (int)myReduces.size(); ++i)
+        {
+            newMap.setMapName(i, ReductionEnum::toName(myReduces[i]));
+        }
+        myOutXML.setMap(direction, newMap);
+        ciftiOut->setCiftiXML(myOutXML);
+        ReduceWorker myWorker(ciftiIn, ciftiOut, myReduces, onlyNumeric, excludeDev, sigmaBelow, sigmaAbove, direction);
+        CiftiRowPipeline::run(myWorker, myWorker.getNumJobs(), myWorker.getJobFloats());
     }
 }
 
+AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
+                                           const bool& onlyNumeric, const int& direction) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    reduceCifti(ciftiIn, vector<ReductionEnum::Enum>(1, myReduce), ciftiOut, onlyNumeric, false, 0.0f, 0.0f, direction);
+}
+
+AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const ReductionEnum::Enum& myReduce, CiftiFile* ciftiOut,
+                                           const float& sigmaBelow, const float& sigmaAbove, const int& direction) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    reduceCifti(ciftiIn, vector<ReductionEnum::Enum>(1, myReduce), ciftiOut, false, true, sigmaBelow, sigmaAbove, direction);
+}
+
+AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const vector<ReductionEnum::Enum>& myReduces, CiftiFile* ciftiOut,
+                                           const bool& onlyNumeric, const int& direction) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    reduceCifti(ciftiIn, myReduces, ciftiOut, onlyNumeric, false, 0.0f, 0.0f, direction);
+}
+
+AlgorithmCiftiReduce::AlgorithmCiftiReduce(ProgressObject* myProgObj, const CiftiFile* ciftiIn, const vector<ReductionEnum::Enum>& myReduces, CiftiFile* ciftiOut,
+                                           const float& sigmaBelow, const float& sigmaAbove, const int& direction) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    reduceCifti(ciftiIn, myReduces, ciftiOut, false, true, sigmaBelow, sigmaAbove, direction);
+}
+
 float AlgorithmCiftiReduce::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
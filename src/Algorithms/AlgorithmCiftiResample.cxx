@@ -30,6 +30,7 @@
 #include "AlgorithmVolumeAffineResample.h"
 #include "AlgorithmVolumeWarpfieldResample.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 #include "LabelFile.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
@@ -702,6 +703,114 @@ namespace
             }
         }
     }
+    
+    ///resamples along row, one job per row - computation is serial, because the caches hold scratch files, and the volume steps use openmp internally
+    class RowResampleWorker : public CiftiRowPipeline::Worker
+    {
+        const CiftiFile* m_ciftiIn;
+        CiftiFile* m_ciftiOut;
+        map<StructureEnum::Enum, ResampleCache>& m_surfCache, &m_volCache;
+        vector<StructureEnum::Enum> m_surfList, m_volList;
+        vector<int> m_unassignedLabelKey;
+        bool m_labelMode, m_resetLabelVolume, m_surfLargest;
+        float m_voldilatemm, m_surfdilatemm, m_volDilateExponent, m_surfDilateExponent;
+        const VolumeFile* m_warpfield;//NULL means use m_affine
+        const FloatMatrix* m_affine;
+        VolumeFile::InterpType m_volMethod;
+        AlgorithmVolumeDilate::Method m_volDilateMethod;
+        AlgorithmMetricDilate::Method m_surfDilateMethod;
+        int64_t m_inLength, m_outLength;
+    public:
+        RowResampleWorker(const CiftiFile* myCiftiIn, CiftiFile* myCiftiOut, map<StructureEnum::Enum, ResampleCache>& surfCache, map<StructureEnum::Enum, ResampleCache>& volCache,
+                          const vector<int>& unassignedLabelKey, const bool& resetLabelVolume, const bool& surfLargest, const float& voldilatemm, const float& surfdilatemm,
+                          const VolumeFile* warpfield, const FloatMatrix* affine, const VolumeFile::InterpType& myVolMethod,
+                          const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent,
+                          const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent) :
+            m_surfCache(surfCache), m_volCache(volCache)
+        {
+            m_ciftiIn = myCiftiIn;
+            m_ciftiOut = myCiftiOut;
+            const CiftiXML& myOutXML = myCiftiOut->getCiftiXML();
+            const CiftiBrainModelsMap& outModels = myOutXML.getBrainModelsMap(CiftiXML::ALONG_ROW);
+            m_surfList = outModels.getSurfaceStructureList();
+            m_volList = outModels.getVolumeStructureList();
+            m_unassignedLabelKey = unassignedLabelKey;
+            m_labelMode = (myCiftiIn->getCiftiXML().getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS);
+            m_resetLabelVolume = resetLabelVolume;
+            m_surfLargest = surfLargest;
+            m_voldilatemm = voldilatemm;
+            m_surfdilatemm = surfdilatemm;
+            m_warpfield = warpfield;
+            m_affine = affine;
+            CaretAssert((warpfield == NULL) != (affine == NULL));
+            m_volMethod = myVolMethod;
+            m_volDilateMethod = volDilateMethod;
+            m_volDilateExponent = volDilateExponent;
+            m_surfDilateMethod = surfDilateMethod;
+            m_surfDilateExponent = surfDilateExponent;
+            m_inLength = myCiftiIn->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW);
+            m_outLength = myOutXML.getDimensionLength(CiftiXML::ALONG_ROW);
+        }
+        int64_t getNumJobs() const { return m_ciftiIn->getCiftiXML().getDimensionLength(CiftiXML::ALONG_COLUMN); }
+        int64_t getJobFloats() const { return m_inLength + m_outLength; }
+        bool canComputeInParallel() const { return false; }
+        void readJob(const int64_t& row, vector<float>& inputOut)
+        {
+            inputOut.resize(m_inLength);
+            m_ciftiIn->getRow(inputOut.data(), row);
+        }
+        void computeJob(const int64_t& row, const vector<float>& inRow, vector<float>& outRow, const int&)
+        {
+            outRow.resize(m_outLength);
+            int unassignedKey = (m_labelMode ? m_unassignedLabelKey[row] : 0);
+            for (int i = 0; i < (int)m_surfList.size(); ++i)
+            {
+                map<StructureEnum::Enum, ResampleCache>::iterator iter = m_surfCache.find(m_surfList[i]);
+                CaretAssert(iter != m_surfCache.end());
+                processRowSurface(iter->second, inRow, outRow, m_ciftiIn->getCiftiXML(), m_surfdilatemm, m_surfLargest, unassignedKey, row, m_surfDilateMethod, m_surfDilateExponent);
+            }
+            for (int i = 0; i < (int)m_volList.size(); ++i)
+            {
+                map<StructureEnum::Enum, ResampleCache>::iterator iter = m_volCache.find(m_volList[i]);
+                CaretAssert(iter != m_volCache.end());
+                ResampleCache& myCache = iter->second;
+                if (m_labelMode && m_resetLabelVolume)//gets initialized to 0 when not using labels
+                {
+                    myCache.tempVol1->setValueAllVoxels(unassignedKey);
+                }
+                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
+                for (int j = 0; j < inMapSize; ++j)
+                {
+                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
+                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
+                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
+                }
+                const VolumeFile* toResample = myCache.tempVol1;
+                if (m_voldilatemm > 0.0f)
+                {
+                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
+                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, m_voldilatemm, m_volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, m_volDilateExponent);
+                    toResample = myCache.tempVol3;
+                }
+                if (m_warpfield != NULL)
+                {
+                    AlgorithmVolumeWarpfieldResample(NULL, toResample, m_warpfield, myCache.refDims, myCache.refSform, m_volMethod, myCache.tempVol2);
+                } else {
+                    AlgorithmVolumeAffineResample(NULL, toResample, *m_affine, myCache.refDims, myCache.refSform, m_volMethod, myCache.tempVol2);
+                }
+                for (int j = 0; j < outMapSize; ++j)
+                {
+                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
+                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
+                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                }
+            }
+        }
+        void writeJob(const int64_t& row, const vector<float>& output)
+        {
+            m_ciftiOut->setRow(output.data(), row);
+        }
+    };
 }
 
 AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const int& direction, const CiftiFile* myTemplate, const int& templateDir,
@@ -723,7 +832,6 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
     CiftiXML myOutXML = myInputXML;
     myOutXML.setMap(direction, *(myTemplate->getCiftiXML().getMap(templateDir)));
-    bool labelMode = (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS);
     const CiftiBrainModelsMap& outModels = myOutXML.getBrainModelsMap(direction);
     vector<StructureEnum::Enum> surfList = outModels.getSurfaceStructureList(), volList = outModels.getVolumeStructureList();
     myCiftiOut->setCiftiXML(myOutXML);
@@ -764,8 +872,6 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
             processVolumeWarpfield(myCiftiIn, direction, volList[i], myVolMethod, myCiftiOut, voldilatemm, warpfield, volDilateMethod, volDilateExponent);
         }
     } else {//avoid cifti separate/replace with ALONG_ROW
-        vector<StructureEnum::Enum> surfList = outModels.getSurfaceStructureList(), volList = outModels.getVolumeStructureList();
-        int numSurfStructs = (int)surfList.size(), numVolStructs = (int)volList.size();
         vector<int> unassignedLabelKey;
         if (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS)
         {
@@ -781,50 +887,9 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
-        int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
-        {
-            myCiftiIn->getRow(inRow.data(), row);
-            for (int i = 0; i < numSurfStructs; ++i)
-            {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
-                CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row, surfDilateMethod, surfDilateExponent);
-            }
-            for (int i = 0; i < numVolStructs; ++i)
-            {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                if (labelMode)//gets initialized to 0 when not using labels
-                {
-                    myCache.tempVol1->setValueAllVoxels(unassignedLabelKey[row]);
-                }
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
-                {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
-                {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
-                }
-            }
-            myCiftiOut->setRow(outRow.data(), row);
-        }
+        RowResampleWorker myWorker(myCiftiIn, myCiftiOut, surfCache, volCache, unassignedLabelKey, true, surfLargest, voldilatemm, surfdilatemm,
+                                   warpfield, NULL, myVolMethod, volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent);
+        CiftiRowPipeline::run(myWorker, myWorker.getNumJobs(), myWorker.getJobFloats());
     }
 }
 
@@ -887,8 +952,6 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
             processVolumeAffine(myCiftiIn, direction, volList[i], myVolMethod, myCiftiOut, voldilatemm, affine, volDilateMethod, volDilateExponent);
         }
     } else {//avoid cifti separate/replace with ALONG_ROW
-        vector<StructureEnum::Enum> surfList = outModels.getSurfaceStructureList(), volList = outModels.getVolumeStructureList();
-        int numSurfStructs = (int)surfList.size(), numVolStructs = (int)volList.size();
         vector<int> unassignedLabelKey;
         if (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS)
         {
@@ -904,46 +967,9 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curLeftSphere, newLeftSphere, curLeftAreas, newLeftAreas,
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
-        int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
-        {
-            myCiftiIn->getRow(inRow.data(), row);
-            for (int i = 0; i < numSurfStructs; ++i)
-            {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
-                CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row, surfDilateMethod, surfDilateExponent);
-            }
-            for (int i = 0; i < numVolStructs; ++i)
-            {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
-                {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
-                {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
-                }
-            }
-            myCiftiOut->setRow(outRow.data(), row);
-        }
+        RowResampleWorker myWorker(myCiftiIn, myCiftiOut, surfCache, volCache, unassignedLabelKey, false, surfLargest, voldilatemm, surfdilatemm,
+                                   NULL, &affine, myVolMethod, volDilateMethod, volDilateExponent, surfDilateMethod, surfDilateExponent);
+        CiftiRowPipeline::run(myWorker, myWorker.getNumJobs(), myWorker.getJobFloats());
     }
 }
 
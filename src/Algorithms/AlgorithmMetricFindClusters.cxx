@@ -21,6 +21,7 @@
 #include "AlgorithmMetricFindClusters.h"
 #include "AlgorithmException.h"
 
+#include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
@@ -143,6 +144,46 @@ void AlgorithmMetricFindClusters::useParameters(OperationParameters* myParams, P
     AlgorithmMetricFindClusters(myProgObj, mySurf, myMetric, threshVal, minArea, myMetricOut, lessThan, myRoi, myAreas, columnNum, startVal, NULL, sizeRatio, distanceCutoff);
 }
 
+void AlgorithmMetricFindClusters::findConnectedClusters(TopologyHelper* myTopoHelp, const float* nodeAreas, vector<int>& marked,
+                                                        vector<int32_t>& members, vector<int64_t>& clusterStart, vector<double>& clusterAreas)
+{
+    int numNodes = myTopoHelp->getNumberOfNodes();
+    CaretAssert((int)marked.size() == numNodes);
+    members.clear();
+    clusterStart.clear();
+    clusterAreas.clear();
+    for (int i = 0; i < numNodes; ++i)
+    {
+        if (marked[i] != 0)
+        {
+            const int markVal = marked[i];
+            int64_t start = (int64_t)members.size();
+            clusterStart.push_back(start);
+            members.push_back(i);
+            marked[i] = 0;//unmark it when added to list to prevent multiples
+            double area = 0.0;
+            for (int64_t index = start; index < (int64_t)members.size(); ++index)//NOTE: vector grows inside loop
+            {
+                int node = members[index];
+                area += nodeAreas[node];
+                const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
+                int numNeigh = (int)neighbors.size();
+                for (int n = 0; n < numNeigh; ++n)
+                {
+                    const int32_t& neighbor = neighbors[n];
+                    if (marked[neighbor] == markVal)
+                    {
+                        members.push_back(neighbor);
+                        marked[neighbor] = 0;
+                    }
+                }
+            }
+            clusterAreas.push_back(area);
+        }
+    }
+    clusterStart.push_back((int64_t)members.size());
+}
+
 namespace
 {
     struct Cluster
@@ -176,41 +217,26 @@ namespace
                 }
             }
         }
+        vector<int32_t> members;
+        vector<int64_t> clusterStart;
+        vector<double> clusterAreas;
+        AlgorithmMetricFindClusters::findConnectedClusters(myTopoHelp, nodeAreas, marked, members, clusterStart, clusterAreas);
         vector<Cluster> clusters;
         float biggestSize = 0.0f;
         int biggestCluster = -1;
-        for (int i = 0; i < numNodes; ++i)
+        for (int c = 0; c < (int)clusterAreas.size(); ++c)
         {
-            if (marked[i])
-            {
+            if (clusterAreas[c] > minArea)
+            {//keep member list around so we can put it into the output immediately if it is large enough
                 Cluster newCluster;
-                newCluster.members.push_back(i);
-                marked[i] = 0;//unmark it when added to list to prevent multiples
-                for (int index = 0; index < (int)newCluster.members.size(); ++index)//NOTE: vector grows inside loop
+                newCluster.members.assign(members.begin() + clusterStart[c], members.begin() + clusterStart[c + 1]);
+                newCluster.area = clusterAreas[c];
+                if (newCluster.area > biggestSize)
                 {
-                    int node = newCluster.members[index];//keep list around so we can put it into the output immediately if it is large enough
-                    newCluster.area += nodeAreas[node];
-                    const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
-                    int numNeigh = (int)neighbors.size();
-                    for (int n = 0; n < numNeigh; ++n)
-                    {
-                        const int32_t& neighbor = neighbors[n];
-                        if (marked[neighbor])
-                        {
-                            newCluster.members.push_back(neighbor);
-                            marked[neighbor] = 0;
-                        }
-                    }
-                }
-                if (newCluster.area > minArea)
-                {
-                    if (newCluster.area > biggestSize)
-                    {
-                        biggestSize = newCluster.area;
-                        biggestCluster = (int)clusters.size();
-                    }
-                    clusters.push_back(newCluster);
+                    biggestSize = newCluster.area;
+                    biggestCluster = (int)clusters.size();
                 }
+                clusters.push_back(newCluster);
             }
         }
         vector<int32_t> pathScratch;
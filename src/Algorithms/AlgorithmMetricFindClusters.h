@@ -23,8 +23,12 @@
 
 #include "AbstractAlgorithm.h"
 
+#include <vector>
+
 namespace caret {
     
+    class TopologyHelper;
+    
     class AlgorithmMetricFindClusters : public AbstractAlgorithm
     {
         AlgorithmMetricFindClusters();
@@ -35,6 +39,10 @@ namespace caret {
         AlgorithmMetricFindClusters(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, const float& minVal, const float& minArea,
                                     MetricFile* myMetricOut, const bool& lessThan = false, const MetricFile* myRoi = NULL, const MetricFile* myAreas = NULL,
                                     const int& columnNum = -1, const int& startVal = 1, int* endVal = NULL, const float& areaRatio = -1.0f, const float& distanceCutoff = -1.0f);
+        ///groups connected vertices that have the same nonzero value in marked into clusters, and zeroes marked
+        ///cluster c is members[clusterStart[c]] through members[clusterStart[c + 1] - 1], and its area is clusterAreas[c]
+        static void findConnectedClusters(TopologyHelper* myTopoHelp, const float* nodeAreas, std::vector<int>& marked,
+                                          std::vector<int32_t>& members, std::vector<int64_t>& clusterStart, std::vector<double>& clusterAreas);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -0,0 +1,354 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AlgorithmMetricPermutation.h"
+#include "AlgorithmException.h"
+
+#include "AlgorithmMetricFindClusters.h"
+#include "AlgorithmMetricTFCE.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CaretPointer.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "TfceHelper.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace caret;
+using namespace std;
+
+AString AlgorithmMetricPermutation::getCommandSwitch()
+{
+    return "-metric-permutation";
+}
+
+AString AlgorithmMetricPermutation::getShortDescription()
+{
+    return "ONE-SAMPLE SIGN-FLIP PERMUTATION TEST ON A METRIC FILE";
+}
+
+OperationParameters* AlgorithmMetricPermutation::getParameters()
+{
+    OperationParameters* ret = new OperationParameters();
+    ret->addSurfaceParameter(1, "surface", "the surface to compute on");
+    
+    ret->addMetricParameter(2, "metric-in", "the input metric, one column per subject");
+    
+    ret->addIntegerParameter(3, "num-permutations", "the number of permutations, including the unpermuted data");
+    
+    ret->addMetricOutputParameter(4, "p-out", "the FWE-corrected p-values");
+    
+    OptionalParameter* statOpt = ret->createOptionalParameter(5, "-statistic", "output the enhanced statistic of the unpermuted data");
+    statOpt->addMetricOutputParameter(1, "stat-out", "the output metric");
+    
+    OptionalParameter* nullOpt = ret->createOptionalParameter(6, "-null-distribution", "output the maximum statistic of each permutation");
+    nullOpt->addStringParameter(1, "null-out", "output - text file, one value per line");//fake output formatting
+    
+    OptionalParameter* roiOpt = ret->createOptionalParameter(7, "-roi", "only test within a region of interest");
+    roiOpt->addMetricParameter(1, "roi-metric", "the area to test, as a metric");
+    
+    OptionalParameter* corrAreaOpt = ret->createOptionalParameter(8, "-corrected-areas", "vertex areas to use instead of computing them from the surface");
+    corrAreaOpt->addMetricParameter(1, "area-metric", "the corrected vertex areas, as a metric");
+    
+    OptionalParameter* paramsOpt = ret->createOptionalParameter(9, "-tfce-parameters", "set parameters for TFCE integral");
+    paramsOpt->addDoubleParameter(1, "E", "exponent for cluster area (default 1.0)");
+    paramsOpt->addDoubleParameter(2, "H", "exponent for threshold value (default 2.0)");
+    
+    OptionalParameter* clusterOpt = ret->createOptionalParameter(10, "-cluster-extent", "use cluster extent instead of TFCE");
+    clusterOpt->addDoubleParameter(1, "threshold", "the t-statistic threshold that defines clusters");
+    
+    OptionalParameter* seedOpt = ret->createOptionalParameter(11, "-seed", "seed the sign flips, for different but repeatable permutations");
+    seedOpt->addIntegerParameter(1, "seed", "the seed value (default 1)");
+    
+    ret->setHelpText(
+        AString("Tests whether the mean across columns differs from zero, by randomly flipping the sign of each column.  ") +
+        "Each column should be one subject's map of differences or contrast estimates, with errors symmetric around zero.  " +
+        "For each permutation, a one-sample t-statistic is computed at every vertex, and is enhanced by TFCE (as in -metric-tfce), or when -cluster-extent is specified, " +
+        "replaced by the area of the cluster of vertices beyond the threshold that contains it.  " +
+        "Positive and negative values are enhanced separately, and the null distribution is the maximum absolute enhanced value across vertices in each permutation.\n\n" +
+        "The first permutation is always the unpermuted data, so the smallest possible p-value is 1 / <num-permutations>.  " +
+        "The surface topology and vertex areas are computed once, and permutations are run in parallel.  " +
+        "The sign flips depend only on the seed, so results do not change with the number of threads."
+    );
+    return ret;
+}
+
+void AlgorithmMetricPermutation::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
+{
+    SurfaceFile* mySurf = myParams->getSurface(1);
+    MetricFile* myMetric = myParams->getMetric(2);
+    int numPermutations = (int)myParams->getInteger(3);
+    MetricFile* myPValueOut = myParams->getOutputMetric(4);
+    MetricFile* myStatOut = NULL;
+    OptionalParameter* statOpt = myParams->getOptionalParameter(5);
+    if (statOpt->m_present)
+    {
+        myStatOut = statOpt->getOutputMetric(1);
+    }
+    AString nullName;
+    OptionalParameter* nullOpt = myParams->getOptionalParameter(6);
+    if (nullOpt->m_present)
+    {
+        nullName = nullOpt->getString(1);
+    }
+    MetricFile* myRoi = NULL;
+    OptionalParameter* roiOpt = myParams->getOptionalParameter(7);
+    if (roiOpt->m_present)
+    {
+        myRoi = roiOpt->getMetric(1);
+    }
+    MetricFile* corrAreaMetric = NULL;
+    OptionalParameter* corrAreaOpt = myParams->getOptionalParameter(8);
+    if (corrAreaOpt->m_present)
+    {
+        corrAreaMetric = corrAreaOpt->getMetric(1);
+    }
+    float param_e = 1.0f, param_h = 2.0f;
+    OptionalParameter* paramsOpt = myParams->getOptionalParameter(9);
+    if (paramsOpt->m_present)
+    {
+        param_e = (float)paramsOpt->getDouble(1);
+        param_h = (float)paramsOpt->getDouble(2);
+    }
+    float clusterThresh = -1.0f;
+    OptionalParameter* clusterOpt = myParams->getOptionalParameter(10);
+    if (clusterOpt->m_present)
+    {
+        clusterThresh = (float)clusterOpt->getDouble(1);
+        if (clusterThresh <= 0.0f) throw AlgorithmException("cluster threshold must be positive");
+    }
+    int seed = 1;
+    OptionalParameter* seedOpt = myParams->getOptionalParameter(11);
+    if (seedOpt->m_present)
+    {
+        seed = (int)seedOpt->getInteger(1);
+    }
+    ofstream nullFile;
+    if (nullOpt->m_present)
+    {//open it before the permutations, so a bad path fails early
+        nullFile.open(nullName.toLocal8Bit().constData());
+        if (!nullFile) throw AlgorithmException("failed to open output text file '" + nullName + "'");
+    }
+    vector<float> nullDist;
+    AlgorithmMetricPermutation(myProgObj, mySurf, myMetric, numPermutations, myPValueOut, myStatOut, (nullOpt->m_present ? &nullDist : NULL),
+                               myRoi, corrAreaMetric, clusterThresh, param_e, param_h, seed);
+    if (nullOpt->m_present)
+    {
+        nullFile.precision(9);
+        for (int i = 0; i < (int)nullDist.size(); ++i)
+        {
+            nullFile << nullDist[i] << endl;
+        }
+        if (!nullFile) throw AlgorithmException("failed to write output text file '" + nullName + "'");
+    }
+}
+
+namespace
+{
+    const int PERMUTATION_BATCH = 64;//permutations per progress report
+    
+    //splitmix64, small and fast, and the same on every platform, unlike rand()
+    uint64_t nextRandom(uint64_t& state)
+    {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    
+    //one-sample t with the given signs, two passes so that a mean far from zero doesn't cancel out the variance
+    void computeTStat(const vector<float>& vertexMajor, const int& numNodes, const float* signs, const int& numSubjects,
+                      const float* roiData, float* tOut)
+    {
+        for (int i = 0; i < numNodes; ++i)
+        {
+            tOut[i] = 0.0f;
+            if (roiData != NULL && !(roiData[i] > 0.0f)) continue;
+            const float* values = vertexMajor.data() + (int64_t)i * numSubjects;
+            double sum = 0.0;
+            for (int s = 0; s < numSubjects; ++s)
+            {
+                sum += signs[s] * values[s];
+            }
+            double mean = sum / numSubjects;
+            double sumSquares = 0.0;
+            for (int s = 0; s < numSubjects; ++s)
+            {
+                double diff = signs[s] * values[s] - mean;
+                sumSquares += diff * diff;
+            }
+            double variance = sumSquares / (numSubjects - 1);
+            if (variance > 0.0)
+            {
+                tOut[i] = (float)(mean / sqrt(variance / numSubjects));
+            }
+        }
+    }
+    
+    //each member gets the signed area of its cluster, positive and negative clusters are separate, even when adjacent
+    void clusterExtent(const float* tData, TopologyHelper* myTopoHelp, const float* nodeAreas, const float& clusterThresh,
+                       vector<int>& marked, vector<int32_t>& members, vector<int64_t>& clusterStart, vector<double>& clusterAreas, float* outData)
+    {
+        int numNodes = myTopoHelp->getNumberOfNodes();
+        for (int i = 0; i < numNodes; ++i)
+        {
+            outData[i] = 0.0f;
+            if (tData[i] > clusterThresh)
+            {
+                marked[i] = 1;
+            } else if (tData[i] < -clusterThresh) {
+                marked[i] = -1;
+            } else {
+                marked[i] = 0;
+            }
+        }
+        AlgorithmMetricFindClusters::findConnectedClusters(myTopoHelp, nodeAreas, marked, members, clusterStart, clusterAreas);
+        int numClusters = (int)clusterAreas.size();
+        for (int c = 0; c < numClusters; ++c)
+        {
+            float outVal = (float)((tData[members[clusterStart[c]]] > 0.0f ? 1.0 : -1.0) * clusterAreas[c]);
+            for (int64_t index = clusterStart[c]; index < clusterStart[c + 1]; ++index)
+            {
+                outData[members[index]] = outVal;
+            }
+        }
+    }
+}
+
+AlgorithmMetricPermutation::AlgorithmMetricPermutation(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, const int& numPermutations, MetricFile* myPValueOut,
+                                                       MetricFile* myStatOut, vector<float>* nullOut, const MetricFile* myRoi, const MetricFile* corrAreaMetric,
+                                                       const float& clusterThresh, const float& param_e, const float& param_h, const int& seed) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    int numNodes = mySurf->getNumberOfNodes();
+    if (myMetric->getNumberOfNodes() != numNodes) throw AlgorithmException("metric and surface have different number of vertices");
+    if (myRoi != NULL && myRoi->getNumberOfNodes() != numNodes) throw AlgorithmException("roi metric and surface have different number of vertices");
+    if (corrAreaMetric != NULL && corrAreaMetric->getNumberOfNodes() != numNodes) throw AlgorithmException("corrected area metric and surface have different number of vertices");
+    int numSubjects = myMetric->getNumberOfColumns();
+    if (numSubjects < 2) throw AlgorithmException("input metric must have at least 2 columns");
+    if (numPermutations < 1) throw AlgorithmException("number of permutations must be positive");
+    const float* roiData = NULL, *areaData = NULL;
+    if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(0);
+    vector<float> surfAreaData;
+    if (corrAreaMetric == NULL)
+    {
+        mySurf->computeNodeAreas(surfAreaData);
+        areaData = surfAreaData.data();
+    } else {
+        areaData = corrAreaMetric->getValuePointerForColumn(0);
+    }
+    bool useTfce = !(clusterThresh > 0.0f);
+    CaretPointer<TfceHelper> myTfce;
+    if (useTfce)
+    {
+        myTfce = AlgorithmMetricTFCE::createTfceHelper(mySurf, areaData, param_e, param_h);
+    }
+    vector<float> vertexMajor((int64_t)numNodes * numSubjects);//each vertex's subjects together, since every permutation sums across them
+    for (int s = 0; s < numSubjects; ++s)
+    {
+        const float* column = myMetric->getValuePointerForColumn(s);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            vertexMajor[(int64_t)i * numSubjects + s] = column[i];
+        }
+    }
+    vector<float> signs((int64_t)numPermutations * numSubjects, 1.0f);//generate all flips up front, so they don't depend on thread scheduling
+    uint64_t state = (uint64_t)(int64_t)seed;
+    for (int p = 1; p < numPermutations; ++p)
+    {
+        for (int s = 0; s < numSubjects; ++s)
+        {
+            if (nextRandom(state) >> 63) signs[(int64_t)p * numSubjects + s] = -1.0f;
+        }
+    }
+    vector<float> maxStats(numPermutations, 0.0f), observed(numNodes, 0.0f);
+    for (int batchStart = 0; batchStart < numPermutations; batchStart += PERMUTATION_BATCH)
+    {
+        int batchEnd = min(batchStart + PERMUTATION_BATCH, numPermutations);
+#pragma omp CARET_PAR
+        {
+            vector<float> tStat(numNodes), enhanced(numNodes);
+            vector<int> marked(numNodes);
+            vector<int32_t> members;
+            vector<int64_t> clusterStart;
+            vector<double> clusterAreas;
+            TfceHelper::Workspace work;
+            CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int p = batchStart; p < batchEnd; ++p)
+            {
+                computeTStat(vertexMajor, numNodes, signs.data() + (int64_t)p * numSubjects, numSubjects, roiData, tStat.data());
+                if (useTfce)
+                {
+                    myTfce->enhance(tStat.data(), enhanced.data(), roiData, work);
+                } else {
+                    clusterExtent(tStat.data(), myTopoHelp, areaData, clusterThresh, marked, members, clusterStart, clusterAreas, enhanced.data());
+                }
+                float maxVal = 0.0f;
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    maxVal = max(maxVal, abs(enhanced[i]));
+                }
+                maxStats[p] = maxVal;
+                if (p == 0) observed = enhanced;
+            }
+        }
+        myProgress.reportProgress(((float)batchEnd) / numPermutations);
+    }
+    vector<float> sortedMax = maxStats;
+    sort(sortedMax.begin(), sortedMax.end());
+    vector<float> pValues(numNodes, 1.0f);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        float absVal = abs(observed[i]);
+        if (absVal > 0.0f)
+        {//the unpermuted data is in the null, so the count is always at least 1
+            int64_t numAtLeast = sortedMax.end() - lower_bound(sortedMax.begin(), sortedMax.end(), absVal);
+            pValues[i] = ((float)numAtLeast) / numPermutations;
+        }
+    }
+    myPValueOut->setNumberOfNodesAndColumns(numNodes, 1);
+    myPValueOut->setStructure(mySurf->getStructure());
+    myPValueOut->setColumnName(0, "FWE p");
+    myPValueOut->setValuesForColumn(0, pValues.data());
+    if (myStatOut != NULL)
+    {
+        myStatOut->setNumberOfNodesAndColumns(numNodes, 1);
+        myStatOut->setStructure(mySurf->getStructure());
+        myStatOut->setColumnName(0, (useTfce ? "TFCE t" : "cluster extent"));
+        myStatOut->setValuesForColumn(0, observed.data());
+    }
+    if (nullOut != NULL) *nullOut = maxStats;
+}
+
+float AlgorithmMetricPermutation::getAlgorithmInternalWeight()
+{
+    return 1.0f;//override this if needed, if the progress bar isn't smooth
+}
+
+float AlgorithmMetricPermutation::getSubAlgorithmWeight()
+{
+    return 0.0f;
+}
@@ -0,0 +1,51 @@
+#ifndef __ALGORITHM_METRIC_PERMUTATION_H__
+#define __ALGORITHM_METRIC_PERMUTATION_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AbstractAlgorithm.h"
+
+#include <vector>
+
+namespace caret {
+    
+    class AlgorithmMetricPermutation : public AbstractAlgorithm
+    {
+        AlgorithmMetricPermutation();
+    protected:
+        static float getSubAlgorithmWeight();
+        static float getAlgorithmInternalWeight();
+    public:
+        ///clusterThresh <= 0 uses TFCE, otherwise cluster extent at that t threshold, nullOut gets the maximum statistic of each permutation
+        AlgorithmMetricPermutation(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, const int& numPermutations, MetricFile* myPValueOut,
+                                   MetricFile* myStatOut = NULL, std::vector<float>* nullOut = NULL, const MetricFile* myRoi = NULL, const MetricFile* corrAreaMetric = NULL,
+                                   const float& clusterThresh = -1.0f, const float& param_e = 1.0f, const float& param_h = 2.0f, const int& seed = 1);
+        static OperationParameters* getParameters();
+        static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
+        static AString getCommandSwitch();
+        static AString getShortDescription();
+    };
+
+    typedef TemplateAutoOperation<AlgorithmMetricPermutation> AutoAlgorithmMetricPermutation;
+
+}
+
+#endif //__ALGORITHM_METRIC_PERMUTATION_H__
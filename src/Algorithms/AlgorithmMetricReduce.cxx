@@ -89,20 +89,14 @@ AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const Me
     metricOut->setNumberOfNodesAndColumns(numNodes, 1);
     metricOut->setStructure(metricIn->getStructure());
     metricOut->setColumnName(0, ReductionEnum::toName(myReduce));
-    vector<float> scratch(numCols);
-    for (int node = 0; node < numNodes; ++node)
+    vector<const float*> columns(numCols);
+    for (int col = 0; col < numCols; ++col)
     {
-        for (int col = 0; col < numCols; ++col)
-        {
-            scratch[col] = metricIn->getValue(node, col);
-        }
-        if (onlyNumeric)
-        {
-            metricOut->setValue(node, 0, ReductionOperation::reduceOnlyNumeric(scratch.data(), numCols, myReduce));
-        } else {
-            metricOut->setValue(node, 0, ReductionOperation::reduce(scratch.data(), numCols, myReduce));
-        }
+        columns[col] = metricIn->getValuePointerForColumn(col);
     }
+    vector<float> outCol(numNodes);
+    ReductionOperation::reduceAcrossColumns(columns, numNodes, vector<ReductionEnum::Enum>(1, myReduce), vector<float*>(1, outCol.data()), onlyNumeric);
+    metricOut->setValuesForColumn(0, outCol.data());
 }
 
 AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const MetricFile* metricIn, const ReductionEnum::Enum& myReduce, MetricFile* metricOut, const float& sigmaBelow, const float& sigmaAbove) : AbstractAlgorithm(myProgObj)
@@ -114,15 +108,14 @@ AlgorithmMetricReduce::AlgorithmMetricReduce(ProgressObject* myProgObj, const Me
     metricOut->setNumberOfNodesAndColumns(numNodes, 1);
     metricOut->setStructure(metricIn->getStructure());
     metricOut->setColumnName(0, ReductionEnum::toName(myReduce));
-    vector<float> scratch(numCols);
-    for (int node = 0; node < numNodes; ++node)
+    vector<const float*> columns(numCols);
+    for (int col = 0; col < numCols; ++col)
     {
-        for (int col = 0; col < numCols; ++col)
-        {
-            scratch[col] = metricIn->getValue(node, col);
-        }
-        metricOut->setValue(node, 0, ReductionOperation::reduceExcludeDev(scratch.data(), numCols, myReduce, sigmaBelow, sigmaAbove));
+        columns[col] = metricIn->getValuePointerForColumn(col);
     }
+    vector<float> outCol(numNodes);
+    ReductionOperation::reduceAcrossColumns(columns, numNodes, vector<ReductionEnum::Enum>(1, myReduce), vector<float*>(1, outCol.data()), false, true, sigmaBelow, sigmaAbove);
+    metricOut->setValuesForColumn(0, outCol.data());
 }
 
 float AlgorithmMetricReduce::getAlgorithmInternalWeight()
@@ -27,6 +27,7 @@
 #include "PaletteColorMapping.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -203,16 +204,26 @@ AlgorithmMetricSmoothing::AlgorithmMetricSmoothing(ProgressObject* myProgObj, co
         myMetricOut->setStructure(mySurf->getStructure());
         for (int32_t col = 0; col < numCols; ++col)
         {
-            myProgress.setTask("Smoothing Column " + AString::number(col));
             myMetricOut->setColumnName(col, myMetric->getColumnName(col) + ", smooth " + AString::number(myKernel));
             *(myMetricOut->getPaletteColorMapping(col)) = *(myMetric->getPaletteColorMapping(col));//copy the palette settings
-            if (myRoi != NULL && matchRoiColumns)
+        }
+        if (myRoi != NULL && matchRoiColumns)
+        {
+            for (int32_t col = 0; col < numCols; ++col)
             {
+                myProgress.setTask("Smoothing Column " + AString::number(col));
                 mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, col, fixZeros);
-            } else {
-                mySmoothObj->smoothColumn(myMetric, col, myMetricOut, col, myRoi, 0, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
+            }
+        } else {//same roi for every column, so smooth blocks of columns at once
+            const int32_t columnsPerPass = MetricSmoothingObject::getColumnsPerPass();
+            for (int32_t col = 0; col < numCols; col += columnsPerPass)
+            {
+                int32_t passColumns = min(columnsPerPass, numCols - col);
+                myProgress.setTask("Smoothing Columns " + AString::number(col) + " to " + AString::number(col + passColumns - 1));
+                mySmoothObj->smoothColumns(myMetric, col, passColumns, myMetricOut, myRoi, fixZeros);
+                myProgress.reportProgress(precomputeWeightWork + ((float)col + passColumns) / numCols);
             }
-            myProgress.reportProgress(precomputeWeightWork + ((float)col + 1) / numCols);
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
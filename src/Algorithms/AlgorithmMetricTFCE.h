@@ -22,22 +22,23 @@
 /*LICENSE_END*/
 
 #include "AbstractAlgorithm.h"
+#include "CaretPointer.h"
 
 namespace caret {
     
-    class TopologyHelper;
+    class TfceHelper;
     
     class AlgorithmMetricTFCE : public AbstractAlgorithm
     {
         AlgorithmMetricTFCE();
-        void processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
-        void tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
         AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, const float& presmooth = 0.0f,
                             const MetricFile* myRoi = NULL, const float& param_e = 1.0f, const float& param_h = 2.0f, const int& columnNum = -1, const MetricFile* corrAreaMetric = NULL);
+        ///builds the surface adjacency once, so callers that run TFCE many times (permutations) can reuse it
+        static CaretPointer<TfceHelper> createTfceHelper(const SurfaceFile* mySurf, const float* areaData, const float& param_e, const float& param_h);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -94,23 +94,15 @@ AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const Vo
         *(volumeOut->getMapLabelTable(0)) = *(volumeIn->getMapLabelTable(0));
     }
     int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
-    vector<float> scratchArray(myDims[3]), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
+    vector<const float*> frames(myDims[3]);
     for (int c = 0; c < myDims[4]; ++c)
     {
-        for (int64_t i = 0; i < frameSize; ++i)
+        for (int b = 0; b < myDims[3]; ++b)
         {
-            for (int b = 0; b < myDims[3]; ++b)
-            {
-                const float* tempFrame = volumeIn->getFrame(b, c);
-                scratchArray[b] = tempFrame[i];
-            }
-            if (onlyNumeric)
-            {
-                outFrame[i] = ReductionOperation::reduceOnlyNumeric(scratchArray.data(), myDims[3], myReduce);
-            } else {
-                outFrame[i] = ReductionOperation::reduce(scratchArray.data(), myDims[3], myReduce);
-            }
+            frames[b] = volumeIn->getFrame(b, c);
         }
+        ReductionOperation::reduceAcrossColumns(frames, frameSize, vector<ReductionEnum::Enum>(1, myReduce), vector<float*>(1, outFrame.data()), onlyNumeric);
         volumeOut->setFrame(outFrame.data(), 0, c);
     }
 }
@@ -128,18 +120,15 @@ AlgorithmVolumeReduce::AlgorithmVolumeReduce(ProgressObject* myProgObj, const Vo
         *(volumeOut->getMapLabelTable(0)) = *(volumeIn->getMapLabelTable(0));
     }
     int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
-    vector<float> scratchArray(myDims[3]), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
+    vector<const float*> frames(myDims[3]);
     for (int c = 0; c < myDims[4]; ++c)
     {
-        for (int64_t i = 0; i < frameSize; ++i)
+        for (int b = 0; b < myDims[3]; ++b)
         {
-            for (int b = 0; b < myDims[3]; ++b)
-            {
-                const float* tempFrame = volumeIn->getFrame(b, c);
-                scratchArray[b] = tempFrame[i];
-            }
-            outFrame[i] = ReductionOperation::reduceExcludeDev(scratchArray.data(), myDims[3], myReduce, sigmaBelow, sigmaAbove);
+            frames[b] = volumeIn->getFrame(b, c);
         }
+        ReductionOperation::reduceAcrossColumns(frames, frameSize, vector<ReductionEnum::Enum>(1, myReduce), vector<float*>(1, outFrame.data()), false, true, sigmaBelow, sigmaAbove);
         volumeOut->setFrame(outFrame.data(), 0, c);
     }
 }
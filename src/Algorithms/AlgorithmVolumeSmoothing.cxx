@@ -24,12 +24,179 @@
 #include "Vector3D.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "CaretPointer.h"
 #include "CaretAssert.h"
+#include <algorithm>
 #include <cmath>
+#include <complex>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const double FFT_COST_FACTOR = 8.0;//rough ratio of the per-element cost of an FFT butterfly (in double, including gather/scatter) to a direct convolution tap
+    const double FFT_ZERO_TOLERANCE = 1e-9;//weight sums below this fraction of the largest possible weight sum on the line are rounding error from the FFT, real contributions are at least about exp(-4.5)^3
+    
+    int fftSizeFor(const int& length, const int& range)
+    {//circular convolution of this size doesn't wrap around onto any output we use
+        int ret = 1;
+        while (ret < length + range) ret <<= 1;
+        return ret;
+    }
+    
+    bool fftIsFaster(const int& length, const int& range)
+    {
+        int fftSize = fftSizeFor(length, range);
+        int log2Size = 0;
+        while ((1 << log2Size) < fftSize) ++log2Size;
+        return (double)length * (2 * range + 1) > FFT_COST_FACTOR * fftSize * log2Size;
+    }
+    
+    //weightsIn == NULL means each input has weight 1, or 0 for zero values when maskZeros is true
+    void convolveLineDirect(const float* valuesIn, const float* weightsIn, const int64_t& inStride, const int& length, const float* kernel, const int& range, const bool& maskZeros,
+                            float* valuesOut, float* weightsOut, const int64_t& outStride)
+    {
+        for (int i = 0; i < length; ++i)
+        {
+            int imin = i - range, imax = i + range + 1;//one-after array size convention
+            if (imin < 0) imin = 0;
+            if (imax > length) imax = length;
+            float sum = 0.0f, weightsum = 0.0f;
+            for (int ikern = imin; ikern < imax; ++ikern)
+            {
+                float value = valuesIn[ikern * inStride];
+                float weight = kernel[ikern - i + range];
+                if (weightsIn == NULL)
+                {
+                    if (!maskZeros || value != 0.0f)
+                    {
+                        weightsum += weight;
+                        sum += weight * value;
+                    }
+                } else {
+                    weightsum += weight * weightsIn[ikern * inStride];
+                    sum += weight * value;
+                }
+            }
+            valuesOut[i * outStride] = sum;
+            weightsOut[i * outStride] = weightsum;
+        }
+    }
+    
+    ///convolves lines of a fixed length with a fixed symmetric kernel by radix-2 FFT, for kernels too large for direct convolution to be efficient
+    ///since the kernel is real, the values and the weights are convolved at once as the real and imaginary parts of one signal
+    class LineConvolver
+    {
+        int m_length, m_fftSize;
+        double m_kernelSum;
+        vector<complex<double> > m_kernelFFT, m_twiddle;
+        vector<int> m_bitReverse;
+        void transform(complex<double>* data, const bool& inverse) const
+        {
+            for (int i = 0; i < m_fftSize; ++i)
+            {
+                if (i < m_bitReverse[i]) swap(data[i], data[m_bitReverse[i]]);
+            }
+            for (int len = 2; len <= m_fftSize; len <<= 1)
+            {
+                const int half = len / 2, step = m_fftSize / len;
+                for (int start = 0; start < m_fftSize; start += len)
+                {
+                    for (int j = 0; j < half; ++j)
+                    {
+                        complex<double> twiddle = (inverse ? conj(m_twiddle[j * step]) : m_twiddle[j * step]);
+                        complex<double> even = data[start + j], odd = data[start + j + half] * twiddle;
+                        data[start + j] = even + odd;
+                        data[start + j + half] = even - odd;
+                    }
+                }
+            }
+        }
+    public:
+        LineConvolver(const float* kernel, const int& range, const int& length)
+        {
+            const double PI = 3.14159265358979323846;
+            m_length = length;
+            m_fftSize = fftSizeFor(length, range);
+            m_twiddle.resize(m_fftSize / 2);
+            for (int i = 0; i < m_fftSize / 2; ++i)
+            {
+                double angle = -2.0 * PI * i / m_fftSize;
+                m_twiddle[i] = complex<double>(cos(angle), sin(angle));
+            }
+            m_bitReverse.resize(m_fftSize);
+            int log2Size = 0;
+            while ((1 << log2Size) < m_fftSize) ++log2Size;
+            for (int i = 0; i < m_fftSize; ++i)
+            {
+                int reversed = 0;
+                for (int bit = 0; bit < log2Size; ++bit)
+                {
+                    if (i & (1 << bit)) reversed |= 1 << (log2Size - 1 - bit);
+                }
+                m_bitReverse[i] = reversed;
+            }
+            m_kernelFFT.assign(m_fftSize, complex<double>(0.0, 0.0));
+            m_kernelSum = 0.0;
+            int useRange = min(range, length - 1);//offsets longer than the line can't contribute, and could overlap in the circular layout
+            for (int offset = -useRange; offset <= useRange; ++offset)
+            {//include the 1 / size normalization of the inverse transform
+                m_kernelFFT[(offset + m_fftSize) % m_fftSize] = complex<double>(kernel[offset + range] / (double)m_fftSize, 0.0);
+                m_kernelSum += abs(kernel[offset + range]);
+            }
+            transform(m_kernelFFT.data(), false);
+        }
+        
+        ///same inputs and outputs as convolveLineDirect, returns false without writing output if the line contains non-finite values,
+        ///because the FFT would spread them to the entire line
+        bool convolve(const float* valuesIn, const float* weightsIn, const int64_t& inStride, const bool& maskZeros,
+                      float* valuesOut, float* weightsOut, const int64_t& outStride, vector<complex<double> >& scratch) const
+        {
+            scratch.resize(m_fftSize);
+            double maxWeight = 0.0;
+            for (int i = 0; i < m_length; ++i)
+            {
+                float value = valuesIn[i * inStride];
+                if (value - value != 0.0f) return false;//catches inf and NaN
+                float weight;
+                if (weightsIn == NULL)
+                {
+                    weight = ((!maskZeros || value != 0.0f) ? 1.0f : 0.0f);
+                } else {
+                    weight = weightsIn[i * inStride];
+                    if (weight - weight != 0.0f) return false;
+                }
+                if (abs(weight) > maxWeight) maxWeight = abs(weight);
+                scratch[i] = complex<double>(value, weight);//masked values are zero, so they don't need to be multiplied by their weight
+            }
+            for (int i = m_length; i < m_fftSize; ++i)
+            {
+                scratch[i] = complex<double>(0.0, 0.0);
+            }
+            transform(scratch.data(), false);
+            for (int i = 0; i < m_fftSize; ++i)
+            {
+                scratch[i] *= m_kernelFFT[i];
+            }
+            transform(scratch.data(), true);
+            const double tolerance = FFT_ZERO_TOLERANCE * m_kernelSum * maxWeight;//rounding error scales with the magnitude of the sums, which is at most this
+            for (int i = 0; i < m_length; ++i)
+            {
+                if (abs(scratch[i].imag()) <= tolerance)
+                {//direct convolution gives exactly zero when nothing contributes, so match that instead of dividing rounding errors
+                    valuesOut[i * outStride] = 0.0f;
+                    weightsOut[i * outStride] = 0.0f;
+                } else {
+                    valuesOut[i * outStride] = scratch[i].real();
+                    weightsOut[i * outStride] = scratch[i].imag();
+                }
+            }
+            return true;
+        }
+    };
+}
+
 //makes the program issue warning only once per launch, prevents repeated calls by other algorithms from spamming
 bool AlgorithmVolumeSmoothing::haveWarned = false;
 
@@ -170,7 +337,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                     const float* inFrame = inVol->getFrame(s, c);
                     if (roiVol == NULL)
                     {
-                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
+                        smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                     } else {
                         smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                     }
@@ -191,7 +358,7 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
                 const float* inFrame = inVol->getFrame(subvol, c);
                 if (roiVol == NULL)
                 {
-                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, inVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
+                    smoothFrame(inFrame, myDims, scratchFrame, scratchFrame2, scratchWeights, scratchWeights2, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 } else {
                     smoothFrameROI(inFrame, myDims, scratchFrame, scratchFrame2, scratchFrame3, scratchWeights, scratchWeights2, lists, inVol, roiVol, iweights, jweights, kweights, irange, jrange, krange, fixZeros);
                 }
@@ -273,86 +440,145 @@ AlgorithmVolumeSmoothing::AlgorithmVolumeSmoothing(ProgressObject* myProgObj, co
     }
 }
 
-void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
+bool AlgorithmVolumeSmoothing::axisUsesFFT(const int64_t& length, const int& range)
+{
+    return fftIsFaster((int)length, range);
+}
+
+void AlgorithmVolumeSmoothing::smoothFrame(const float* inFrame, vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights, int irange, int jrange, int krange, const bool& fixZeros)
 {//this function should ONLY get invoked when the volume is orthogonal (axes are perpendicular, not necessarily aligned with x, y, z, and not necessarily equal spacing)
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
+    const int64_t rowSize = myDims[0], sliceSize = myDims[0] * myDims[1];
+    CaretPointer<LineConvolver> iConv, jConv, kConv;//only use FFT for an axis when it is estimated to be faster than direct convolution
+    if (fftIsFaster(myDims[0], irange)) iConv.grabNew(new LineConvolver(iweights, irange, myDims[0]));
+    if (fftIsFaster(myDims[1], jrange)) jConv.grabNew(new LineConvolver(jweights, jrange, myDims[1]));
+    if (fftIsFaster(myDims[2], krange)) kConv.grabNew(new LineConvolver(kweights, krange, myDims[2]));
+#pragma omp CARET_PAR
     {
-        for (int j = 0; j < myDims[1]; ++j)
+        vector<complex<double> > fftScratch;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int k = 0; k < myDims[2]; ++k)//smooth along i axis
         {
-            for (int i = 0; i < myDims[0]; ++i)
+            for (int j = 0; j < myDims[1]; ++j)
             {
-                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                if (imin < 0) imin = 0;
-                if (imax > myDims[0]) imax = myDims[0];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(0, j, k, 0);//extra 0 on a default parameter is to prevent int->pointer vs int->int64 conversion ambiguity
-                int64_t curInd = baseInd + i;
-                for (int ikern = imin; ikern < imax; ++ikern)
+                int64_t baseInd = j * rowSize + k * sliceSize;
+                if (iConv == NULL || !iConv->convolve(inFrame + baseInd, NULL, 1, fixZeros, scratchFrame + baseInd, scratchWeights + baseInd, 1, fftScratch))
+                {//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
+                    convolveLineDirect(inFrame + baseInd, NULL, 1, myDims[0], iweights, irange, fixZeros, scratchFrame + baseInd, scratchWeights + baseInd, 1);
+                }
+            }
+        }
+    }
+    if (jConv != NULL)//now j
+    {
+#pragma omp CARET_PAR
+        {
+            vector<complex<double> > fftScratch;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int k = 0; k < myDims[2]; ++k)
+            {
+                for (int i = 0; i < myDims[0]; ++i)
                 {
-                    int64_t thisIndex = baseInd + ikern;
-                    if ((!fixZeros || inFrame[thisIndex] != 0.0f))
+                    int64_t baseInd = i + k * sliceSize;
+                    if (!jConv->convolve(scratchFrame + baseInd, scratchWeights + baseInd, rowSize, false, scratchFrame2 + baseInd, scratchWeights2 + baseInd, rowSize, fftScratch))
                     {
-                        float weight = iweights[ikern - i + irange];
-                        weightsum += weight;
-                        sum += weight * inFrame[thisIndex];
+                        convolveLineDirect(scratchFrame + baseInd, scratchWeights + baseInd, rowSize, myDims[1], jweights, jrange, false, scratchFrame2 + baseInd, scratchWeights2 + baseInd, rowSize);
                     }
                 }
-                scratchWeights[curInd] = weightsum;
-                scratchFrame[curInd] = sum;//don't divide yet, we will divide later after we gather the weighted sums of the weighted sums of the weight sums (yes, that repetition is right)
             }
         }
-    }
+    } else {
 #pragma omp CARET_PARFOR schedule(dynamic)
-    for (int k = 0; k < myDims[2]; ++k)//now j
-    {
-        for (int i = 0; i < myDims[0]; ++i)
+        for (int k = 0; k < myDims[2]; ++k)
         {
-            for (int j = 0; j < myDims[1]; ++j)//step along the dimension being smoothed last for best cache coherence
-            {
+            for (int j = 0; j < myDims[1]; ++j)
+            {//accumulate whole rows at a time, so the inner loop is contiguous and can be vectorized
                 int jmin = j - jrange, jmax = j + jrange + 1;//one-after array size convention
                 if (jmin < 0) jmin = 0;
                 if (jmax > myDims[1]) jmax = myDims[1];
-                float sum = 0.0f, weightsum = 0.0f;
-                int64_t baseInd = inVol->getIndex(i, 0, k);
-                int64_t curInd = baseInd + j * myDims[0];
-                for (int jkern = jmin; jkern < jmax; ++jkern)
+                float* sumRow = scratchFrame2 + j * rowSize + k * sliceSize;
+                float* weightRow = scratchWeights2 + j * rowSize + k * sliceSize;
+                for (int i = 0; i < myDims[0]; ++i)
                 {
-                    int64_t thisIndex = baseInd + jkern * myDims[0];
-                    float weight = jweights[jkern - j + jrange];
-                    weightsum += weight * scratchWeights[thisIndex];
-                    sum += weight * scratchFrame[thisIndex];
+                    sumRow[i] = 0.0f;
+                    weightRow[i] = 0.0f;
                 }
-                scratchWeights2[curInd] = weightsum;
-                scratchFrame2[curInd] = sum;//we now have the weighted sum of the weight sums
+                for (int jkern = jmin; jkern < jmax; ++jkern)
+                {
+                    const float weight = jweights[jkern - j + jrange];
+                    const float* inSumRow = scratchFrame + jkern * rowSize + k * sliceSize;
+                    const float* inWeightRow = scratchWeights + jkern * rowSize + k * sliceSize;
+                    for (int i = 0; i < myDims[0]; ++i)
+                    {
+                        weightRow[i] += weight * inWeightRow[i];
+                        sumRow[i] += weight * inSumRow[i];
+                    }
+                }//we now have the weighted sum of the weight sums
             }
         }
     }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int j = 0; j < myDims[1]; ++j)//and finally k
+#pragma omp CARET_PAR
     {
-        for (int i = 0; i < myDims[0]; ++i)
+        vector<complex<double> > fftScratch;
+        if (kConv != NULL)//and finally k
         {
-            for (int k = 0; k < myDims[2]; ++k)//ditto
+            vector<float> sumLine(myDims[2]), weightLine(myDims[2]);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < myDims[1]; ++j)
             {
-                int64_t baseInd = inVol->getIndex(i, j, 0);
-                int64_t curInd = baseInd + k * myDims[0] * myDims[1];
-                int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
-                if (kmin < 0) kmin = 0;
-                if (kmax > myDims[2]) kmax = myDims[2];
-                float sum = 0.0f, weightsum = 0.0f;
-                for (int kkern = kmin; kkern < kmax; ++kkern)
+                for (int i = 0; i < myDims[0]; ++i)
                 {
-                    int64_t thisIndex = baseInd + kkern * myDims[0] * myDims[1];
-                    float weight = kweights[kkern - k + krange];
-                    weightsum += weight * scratchWeights2[thisIndex];
-                    sum += weight * scratchFrame2[thisIndex];
+                    int64_t baseInd = i + j * rowSize;
+                    if (!kConv->convolve(scratchFrame2 + baseInd, scratchWeights2 + baseInd, sliceSize, false, sumLine.data(), weightLine.data(), 1, fftScratch))
+                    {
+                        convolveLineDirect(scratchFrame2 + baseInd, scratchWeights2 + baseInd, sliceSize, myDims[2], kweights, krange, false, sumLine.data(), weightLine.data(), 1);
+                    }
+                    for (int k = 0; k < myDims[2]; ++k)
+                    {
+                        if (weightLine[k] != 0.0f)
+                        {
+                            scratchFrame[baseInd + k * sliceSize] = sumLine[k] / weightLine[k];//NOW we can divide
+                        } else {
+                            scratchFrame[baseInd + k * sliceSize] = 0.0f;
+                        }
+                    }
                 }
-                if (weightsum != 0.0f)
+            }
+        } else {
+            vector<float> sumRow(myDims[0]), weightRow(myDims[0]);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int j = 0; j < myDims[1]; ++j)
+            {
+                for (int k = 0; k < myDims[2]; ++k)
                 {
-                    scratchFrame[curInd] = sum / weightsum;//NOW we can divide
-                } else {
-                    scratchFrame[curInd] = 0.0f;
+                    int kmin = k - krange, kmax = k + krange + 1;//one-after array size convention
+                    if (kmin < 0) kmin = 0;
+                    if (kmax > myDims[2]) kmax = myDims[2];
+                    for (int i = 0; i < myDims[0]; ++i)
+                    {
+                        sumRow[i] = 0.0f;
+                        weightRow[i] = 0.0f;
+                    }
+                    for (int kkern = kmin; kkern < kmax; ++kkern)
+                    {
+                        const float weight = kweights[kkern - k + krange];
+                        const float* inSumRow = scratchFrame2 + j * rowSize + kkern * sliceSize;
+                        const float* inWeightRow = scratchWeights2 + j * rowSize + kkern * sliceSize;
+                        for (int i = 0; i < myDims[0]; ++i)
+                        {
+                            weightRow[i] += weight * inWeightRow[i];
+                            sumRow[i] += weight * inSumRow[i];
+                        }
+                    }
+                    float* outRow = scratchFrame + j * rowSize + k * sliceSize;
+                    for (int i = 0; i < myDims[0]; ++i)
+                    {
+                        if (weightRow[i] != 0.0f)
+                        {
+                            outRow[i] = sumRow[i] / weightRow[i];//NOW we can divide
+                        } else {
+                            outRow[i] = 0.0f;
+                        }
+                    }
                 }
             }
         }
@@ -33,7 +33,7 @@ namespace caret {
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
         void smoothFrame(const float* inFrame, std::vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchWeights,
-                         CaretArray<float> scratchWeights2, const VolumeFile* inVol, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
+                         CaretArray<float> scratchWeights2, CaretArray<float> iweights, CaretArray<float> jweights, CaretArray<float> kweights,
                          int irange, int jrange, int krange, const bool& fixZeros);
         void smoothFrameROI(const float* inFrame, std::vector<int64_t> myDims, CaretArray<float> scratchFrame, CaretArray<float> scratchFrame2, CaretArray<float> scratchFrame3,
                                               CaretArray<float> scratchWeights, CaretArray<float> scratchWeights2, std::vector<int> lists[3],
@@ -47,6 +47,8 @@ namespace caret {
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
         static AString getShortDescription();
+        ///whether an axis of this length and kernel range (in voxels) is smoothed by FFT rather than direct convolution
+        static bool axisUsesFFT(const int64_t& length, const int& range);
     };
 
     typedef TemplateAutoOperation<AlgorithmVolumeSmoothing> AutoAlgorithmVolumeSmoothing;
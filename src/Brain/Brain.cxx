@@ -53,6 +53,7 @@
 #include "CiftiParcelSeriesFile.h"
 #include "CiftiParcelScalarFile.h"
 #include "CiftiScalarDataSeriesFile.h"
+#include "DataFilePrefetcher.h"
 #include "DisplayPropertiesAnnotation.h"
 #include "DisplayPropertiesBorders.h"
 #include "DisplayPropertiesFiberOrientation.h"
@@ -4947,6 +4948,7 @@ Brain::addReadOrReloadDataFile(const FileModeAddReadReload fileMode,
     AString dataFileName = convertFilePathNameToAbsolutePathName(dataFileNameIn);
     
     CaretDataFile* caretDataFileRead = NULL;
+    bool addedToSpecFileFlag = false;
 
     switch (fileMode) {
         case FILE_MODE_ADD:
@@ -5116,7 +5118,7 @@ Brain::addReadOrReloadDataFile(const FileModeAddReadReload fileMode,
             dataFileName = caretDataFileRead->getFileName();
             
             m_specFile->addCaretDataFile(caretDataFileRead);
-            
+            addedToSpecFileFlag = true;
         }
         m_specFile->addDataFile(dataFileType,
                                 structure,
@@ -5135,10 +5137,14 @@ Brain::addReadOrReloadDataFile(const FileModeAddReadReload fileMode,
     catch (DataFileException& dfe) {
         /*
          * If "caretDataFile" is not NULL, then we were trying to
-         * RELOAD a file so remove it from the "loaded files"
+         * RELOAD or ADD a file so remove it from the "loaded files".
+         * A file being added is only there if adding got that far.
          */
         if (caretDataFile != NULL) {
-            m_specFile->removeCaretDataFile(caretDataFile);
+            if ((fileMode == FILE_MODE_RELOAD)
+                || addedToSpecFileFlag) {
+                m_specFile->removeCaretDataFile(caretDataFile);
+            }
         }
         else {
             if (caretDataFileRead != NULL) {
@@ -5209,6 +5215,51 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Add a data file that was read by a DataFilePrefetcher.
+ *
+ * @param caretDataFile
+ *    File that was read.  The brain takes ownership of the file and
+ *    deletes it if it cannot be added.
+ * @param dataFileType
+ *    Type of data file.
+ * @param structure
+ *    Struture of file (used if not invalid)
+ * @param dataFileName
+ *    Absolute name of the data file.
+ * @throws DataFileException
+ *    If the file cannot be added.
+ */
+void
+Brain::addPrefetchedDataFile(CaretDataFile* caretDataFile,
+                             const DataFileTypeEnum::Enum dataFileType,
+                             const StructureEnum::Enum structure,
+                             const AString& dataFileName)
+{
+    CaretAssert(caretDataFile);
+    
+    try {
+        /*
+         * Adding a file does not validate CIFTI files as reading does
+         */
+        const CiftiMappableDataFile* ciftiMapFile = dynamic_cast<const CiftiMappableDataFile*>(caretDataFile);
+        if (ciftiMapFile != NULL) {
+            validateCiftiMappableDataFile(ciftiMapFile);
+        }
+        
+        addReadOrReloadDataFile(FILE_MODE_ADD,
+                                caretDataFile,
+                                dataFileType,
+                                structure,
+                                dataFileName,
+                                false);
+    }
+    catch (const DataFileException& dfe) {
+        delete caretDataFile;
+        throw dfe;
+    }
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -5272,8 +5323,14 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
 
     /*
      * Note: Need to read palette first since some of the individual file
-     * reading routines update palette coloring when file is read
+     * reading routines update palette coloring when file is read.
+     * Files are added to the prefetcher in the order they are added
+     * to the brain, so the palette files are first.  Since palette files
+     * are not prefetched, they are read here while other files are
+     * read by the prefetcher's threads.
      */
+    DataFilePrefetcher prefetcher;
+    std::vector<StructureEnum::Enum> prefetchStructures;
     const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
     for (int32_t ig = -1; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = ((ig == -1)
@@ -5289,43 +5346,72 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
             if (dataFileInfo->isLoadingSelected()) {
-                const AString filename = dataFileInfo->getFileName();
-                const StructureEnum::Enum structure = dataFileInfo->getStructure();
-
-                /*
-                 * Send event indicating progress of file reading
-                 */
-                FileInformation fileInfo(dataFileInfo->getFileName());
-                progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
-                                            + fileInfo.getFileName()));
-                EventManager::get()->sendEvent(progressUpdate.getPointer());
-                
-                /*
-                 * If user cancelled, reset brain and get out!
-                 */
-                if (progressUpdate.isCancelled()) {
-                    resetBrain();
-                    return;
-                }
-                
-                try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
-                }
-                catch (const DataFileException& e) {
-                    if (errorMessage.isEmpty() == false) {
-                        errorMessage += "\n";
-                    }
-                    errorMessage += e.whatString();
-                }
-                
-                fileReadCounter++;
+                prefetcher.addFile(dataFileType,
+                                   convertFilePathNameToAbsolutePathName(dataFileInfo->getFileName()));
+                prefetchStructures.push_back(dataFileInfo->getStructure());
             }
         }
     }
+    prefetcher.start();
+    
+    const int32_t numPrefetchFiles = static_cast<int32_t>(prefetchStructures.size());
+    for (int32_t iFile = 0; iFile < numPrefetchFiles; iFile++) {
+        const DataFileTypeEnum::Enum dataFileType = prefetcher.getFileType(iFile);
+        const AString filename = prefetcher.getFileName(iFile);
+        const StructureEnum::Enum structure = prefetchStructures[iFile];
+        
+        /*
+         * Send event indicating progress of file reading
+         */
+        FileInformation fileInfo(filename);
+        progressUpdate.setProgress(fileReadCounter,
+                                   ("Reading "
+                                    + fileInfo.getFileName()));
+        EventManager::get()->sendEvent(progressUpdate.getPointer());
+        
+        /*
+         * Wait for the file to be read, updating progress
+         * so that the user may cancel.
+         * If user cancelled, reset brain and get out!
+         */
+        bool cancelledFlag = progressUpdate.isCancelled();
+        while ( ! cancelledFlag) {
+            if (prefetcher.waitForFile(iFile, 100)) {
+                break;
+            }
+            EventManager::get()->sendEvent(progressUpdate.getPointer());
+            cancelledFlag = progressUpdate.isCancelled();
+        }
+        if (cancelledFlag) {
+            prefetcher.cancel();
+            resetBrain();
+            return;
+        }
+        
+        try {
+            CaretDataFile* caretDataFile = prefetcher.takeFile(iFile);
+            if (caretDataFile != NULL) {
+                addPrefetchedDataFile(caretDataFile,
+                                      dataFileType,
+                                      structure,
+                                      filename);
+            }
+            else {
+                readDataFile(dataFileType,
+                             structure,
+                             filename,
+                             false);
+            }
+        }
+        catch (const DataFileException& e) {
+            if (errorMessage.isEmpty() == false) {
+                errorMessage += "\n";
+            }
+            errorMessage += e.whatString();
+        }
+        
+        fileReadCounter++;
+    }
     
     m_specFile->clearModified();
     
@@ -5544,8 +5630,12 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     
     
     /*
-     * Load new files and add existing files that were previously loaded.
+     * Files that are not already loaded are read by a prefetcher,
+     * in the order they are added to the brain.
      */
+    DataFilePrefetcher prefetcher;
+    std::vector<const SpecFileDataFile*> selectedFiles;
+    std::vector<int32_t> selectedFilesPrefetchIndex;
     const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
     for (int32_t ig = 0; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
@@ -5554,65 +5644,105 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
         for (int32_t iFile = 0; iFile < numFiles; iFile++) {
             const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
             if (fileInfo->isLoadingSelected()) {
-                try {
-                    
+                int32_t prefetchIndex = -1;
+                if (specFilesEntryToNonModifiedFile.find(fileInfo) == specFilesEntryToNonModifiedFile.end()) {
                     AString filename = fileInfo->getFileName();
-                    
-                    std::map<const SpecFileDataFile*, CaretDataFile*>::iterator specToFileIter = specFilesEntryToNonModifiedFile.find(fileInfo);
-                    if (specToFileIter != specFilesEntryToNonModifiedFile.end()) {
-                        const QString msg = ("Adding previous file "
-                                             + FileInformation(filename).getFileName());
-                        progressEvent.setProgressMessage(msg);
-                        EventManager::get()->sendEvent(progressEvent.getPointer());
-                        if (progressEvent.isCancelled()) {
-                            resetBrain(keepSceneFiles,
-                                       keepSpecFile);
-                            return;
-                        }
-                        
-                        CaretDataFile* caretDataFile = specToFileIter->second;
-                        addReadOrReloadDataFile(FILE_MODE_ADD,
-                                                caretDataFile,
-                                                caretDataFile->getDataFileType(),
-                                                caretDataFile->getStructure(),
-                                                filename,
-                                                false);
-                    }
-                    else {
-                        const StructureEnum::Enum structure = fileInfo->getStructure();
-                        
-                        const QString msg = ("Loading "
-                                             + FileInformation(filename).getFileName());
-                        progressEvent.setProgressMessage(msg);
-                        EventManager::get()->sendEvent(progressEvent.getPointer());
-                        if (progressEvent.isCancelled()) {
-                            resetBrain(keepSceneFiles,
-                                       keepSpecFile);
-                            return;
-                        }
-                        
-                        if (sceneFileOnNetwork) {
-                            if (DataFile::isFileOnNetwork(filename) == false) {
-                                const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
-                                if (lastSlashIndex >= 0) {
-                                    const AString newName = (sceneFileName.left(lastSlashIndex)
-                                                             + "/"
-                                                             + filename);
-                                    filename = newName;
-                                }
+                    if (sceneFileOnNetwork) {
+                        if (DataFile::isFileOnNetwork(filename) == false) {
+                            const int32_t lastSlashIndex = sceneFileName.lastIndexOf("/");
+                            if (lastSlashIndex >= 0) {
+                                const AString newName = (sceneFileName.left(lastSlashIndex)
+                                                         + "/"
+                                                         + filename);
+                                filename = newName;
                             }
                         }
-                        readDataFile(dataFileType,
-                                     structure,
-                                     filename,
-                                     false);
                     }
+                    prefetchIndex = prefetcher.addFile(dataFileType,
+                                                       convertFilePathNameToAbsolutePathName(filename));
+                }
+                selectedFiles.push_back(fileInfo);
+                selectedFilesPrefetchIndex.push_back(prefetchIndex);
+            }
+        }
+    }
+    prefetcher.start();
+    
+    /*
+     * Load new files and add existing files that were previously loaded.
+     */
+    const int32_t numSelectedFiles = static_cast<int32_t>(selectedFiles.size());
+    for (int32_t iSelected = 0; iSelected < numSelectedFiles; iSelected++) {
+        const SpecFileDataFile* fileInfo = selectedFiles[iSelected];
+        const int32_t prefetchIndex = selectedFilesPrefetchIndex[iSelected];
+        try {
+            
+            AString filename = fileInfo->getFileName();
+            
+            std::map<const SpecFileDataFile*, CaretDataFile*>::iterator specToFileIter = specFilesEntryToNonModifiedFile.find(fileInfo);
+            if (specToFileIter != specFilesEntryToNonModifiedFile.end()) {
+                const QString msg = ("Adding previous file "
+                                     + FileInformation(filename).getFileName());
+                progressEvent.setProgressMessage(msg);
+                EventManager::get()->sendEvent(progressEvent.getPointer());
+                if (progressEvent.isCancelled()) {
+                    prefetcher.cancel();
+                    resetBrain(keepSceneFiles,
+                               keepSpecFile);
+                    return;
+                }
+                
+                CaretDataFile* caretDataFile = specToFileIter->second;
+                addReadOrReloadDataFile(FILE_MODE_ADD,
+                                        caretDataFile,
+                                        caretDataFile->getDataFileType(),
+                                        caretDataFile->getStructure(),
+                                        filename,
+                                        false);
+            }
+            else {
+                CaretAssert(prefetchIndex >= 0);
+                const DataFileTypeEnum::Enum dataFileType = prefetcher.getFileType(prefetchIndex);
+                const StructureEnum::Enum structure = fileInfo->getStructure();
+                filename = prefetcher.getFileName(prefetchIndex);
+                
+                const QString msg = ("Loading "
+                                     + FileInformation(filename).getFileName());
+                progressEvent.setProgressMessage(msg);
+                EventManager::get()->sendEvent(progressEvent.getPointer());
+                bool cancelledFlag = progressEvent.isCancelled();
+                while ( ! cancelledFlag) {
+                    if (prefetcher.waitForFile(prefetchIndex, 100)) {
+                        break;
+                    }
+                    EventManager::get()->sendEvent(progressEvent.getPointer());
+                    cancelledFlag = progressEvent.isCancelled();
                 }
-                catch (const DataFileException& e) {
-                    sceneAttributes->addToErrorMessage(e.whatString());
+                if (cancelledFlag) {
+                    prefetcher.cancel();
+                    resetBrain(keepSceneFiles,
+                               keepSpecFile);
+                    return;
+                }
+                
+                CaretDataFile* caretDataFile = prefetcher.takeFile(prefetchIndex);
+                if (caretDataFile != NULL) {
+                    addPrefetchedDataFile(caretDataFile,
+                                          dataFileType,
+                                          structure,
+                                          filename);
+                }
+                else {
+                    readDataFile(dataFileType,
+                                 structure,
+                                 filename,
+                                 false);
                 }
             }
         }
+        catch (const DataFileException& e) {
+            sceneAttributes->addToErrorMessage(e.whatString());
+        }
     }
     
     m_isSpecFileBeingRead = false;
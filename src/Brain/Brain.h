@@ -478,6 +478,11 @@ namespace caret {
                           const AString& dataFileName,
                           const bool markDataFileAsModified);
         
+        void addPrefetchedDataFile(CaretDataFile* caretDataFile,
+                                   const DataFileTypeEnum::Enum dataFileType,
+                                   const StructureEnum::Enum structure,
+                                   const AString& dataFileName);
+        
         /**
          * Is the data file with the given name already loaded?
          *
@@ -61,6 +61,7 @@ namespace caret {
     
     class Border;
     class Brain;
+    class BrainOpenGLSurfaceBufferCache;
     class BrainOpenGLTextRenderInterface;
     class BrainOpenGLTextureManager;
     class BrainOpenGLViewportContent;
@@ -158,6 +159,8 @@ namespace caret {
         
         virtual BrainOpenGLTextureManager* getTextureManager() = 0;
         
+        virtual BrainOpenGLSurfaceBufferCache* getSurfaceBufferCache() = 0;
+        
         /**
          * @return Half-size of the model window height.
          */
@@ -53,6 +53,7 @@
 #include "BrainOpenGLShapeRing.h"
 #include "BrainOpenGLShapeRingOutline.h"
 #include "BrainOpenGLShapeSphere.h"
+#include "BrainOpenGLSurfaceBufferCache.h"
 #include "BrainOpenGLViewportContent.h"
 #include "BrainStructure.h"
 #include "BrowserTabContent.h"
@@ -63,6 +64,7 @@
 #include "CaretMappableDataFile.h"
 #include "CaretMappableDataFileAndMapSelectionModel.h"
 #include "CaretPreferences.h"
+#include "CaretTriangleBVH.h"
 #include "ChartableMatrixInterface.h"
 #include "ChartableMatrixSeriesInterface.h"
 #include "ChartModelDataSeries.h"
@@ -175,6 +177,7 @@ m_windowIndex(windowIndex)
     this->colorIdentification   = new IdentificationWithColor();
     m_annotationDrawing.grabNew(new BrainOpenGLAnnotationDrawingFixedPipeline(this));
     m_textureManager.grabNew(new BrainOpenGLTextureManager(m_windowIndex));
+    m_surfaceBufferCache.grabNew(new BrainOpenGLSurfaceBufferCache(m_windowIndex));
                              
     m_shapeSphere = NULL;
     m_shapeCone   = NULL;
@@ -514,6 +517,8 @@ BrainOpenGLFixedPipeline::drawModels(Brain* brain,
     
     this->checkForOpenGLError(NULL, "At beginning of drawModels()");
     
+    m_surfaceBufferCache->deleteBuffersForRemovedSurfaces();
+    
     /*
      * Default the background colors to first model
      * NOTE: If there are no models, the surface background color is used
@@ -963,6 +968,17 @@ BrainOpenGLFixedPipeline::getTextureManager()
     return tm;
 }
 
+/**
+ * @return Get the surface buffer cache.
+ */
+BrainOpenGLSurfaceBufferCache*
+BrainOpenGLFixedPipeline::getSurfaceBufferCache()
+{
+    BrainOpenGLSurfaceBufferCache* sbc = m_surfaceBufferCache.getPointer();
+    CaretAssert(sbc);
+    return sbc;
+}
+
 /**
  * Set the viewport.
  *
@@ -1799,10 +1815,22 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
              */
             glShadeModel(GL_FLAT); 
             if (drawingType != SurfaceDrawingTypeEnum::DRAW_HIDE) {
-                this->drawSurfaceNodes(surface,
-                                       nodeColoringRGBA);
-                this->drawSurfaceTriangles(surface,
+                if (this->identifySurfaceWithRayCast(surface)) {
+                    /*
+                     * Surface is only needed in the depth buffer so
+                     * that items behind it are not identified.
+                     */
+                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    this->drawSurfaceTrianglesWithVertexArrays(surface,
+                                                               NULL);
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                }
+                else {
+                    this->drawSurfaceNodes(surface,
                                            nodeColoringRGBA);
+                    this->drawSurfaceTriangles(surface,
+                                               nodeColoringRGBA);
+                }
             }
 
             this->disableClippingPlanes();
@@ -1850,8 +1878,10 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
              */
             glShadeModel(GL_FLAT);
             if (drawingType != SurfaceDrawingTypeEnum::DRAW_HIDE) {
-                this->drawSurfaceTriangles(surface,
-                                           nodeColoringRGBA);
+                if ( ! this->identifySurfaceWithRayCast(surface)) {
+                    this->drawSurfaceTriangles(surface,
+                                               nodeColoringRGBA);
+                }
             }
             /*
              * Re-enable shading since ID info is encoded in rgba coloring
@@ -2163,6 +2193,258 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
     }
 }
 
+/**
+ * Identify the surface's node and triangle under the mouse, or in
+ * projection mode, project the mouse to the surface, by casting the
+ * mouse's ray against the surface's triangles.  Unlike drawing the
+ * surface in identification colors, this does not render the surface
+ * nor read pixels from the frame buffer, and may be used at any time
+ * the surface's viewing transformations are current.
+ *
+ * @param surface
+ *    Surface that is identified.
+ * @return
+ *    True if the ray was cast (whether or not it hit the surface), false
+ *    if the mouse ray could not be computed in which case the caller
+ *    should identify by drawing.
+ */
+bool
+BrainOpenGLFixedPipeline::identifySurfaceWithRayCast(Surface* surface)
+{
+    SelectionItemSurfaceNode* nodeID = NULL;
+    SelectionItemSurfaceTriangle* triangleID = NULL;
+    bool isProjection = false;
+    switch (this->mode) {
+        case MODE_DRAWING:
+            CaretAssertMessage(0, "Ray cast identification while drawing.");
+            return false;
+            break;
+        case MODE_IDENTIFICATION:
+            nodeID = m_brain->getSelectionManager()->getSurfaceNodeIdentification();
+            if ( ! nodeID->isEnabledForSelection()) {
+                nodeID = NULL;
+            }
+            triangleID = m_brain->getSelectionManager()->getSurfaceTriangleIdentification();
+            if ( ! triangleID->isEnabledForSelection()) {
+                triangleID = NULL;
+            }
+            if ((nodeID == NULL)
+                && (triangleID == NULL)) {
+                return true;
+            }
+            break;
+        case MODE_PROJECTION:
+            isProjection = true;
+            break;
+    }
+    
+    if (surface->getNumberOfTriangles() <= 0) {
+        return true;
+    }
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    /*
+     * Drawing with color identification only finds items in the
+     * viewport, but a ray unprojected from outside the viewport
+     * can still hit the surface, which is not visible there.
+     */
+    if ((this->mouseX < viewport[0])
+        || (this->mouseX >= (viewport[0] + viewport[2]))
+        || (this->mouseY < viewport[1])
+        || (this->mouseY >= (viewport[1] + viewport[3]))) {
+        return true;
+    }
+
+    /*
+     * The mouse ray passes through the center of the pixel
+     * from the near to the far clipping plane.
+     */
+    const double windowX = this->mouseX + 0.5;
+    const double windowY = this->mouseY + 0.5;
+    double nearXYZ[3];
+    double farXYZ[3];
+    if ( ! (gluUnProject(windowX, windowY, 0.0,
+                         modelviewMatrix, projectionMatrix, viewport,
+                         &nearXYZ[0], &nearXYZ[1], &nearXYZ[2])
+            && gluUnProject(windowX, windowY, 1.0,
+                            modelviewMatrix, projectionMatrix, viewport,
+                            &farXYZ[0], &farXYZ[1], &farXYZ[2]))) {
+        return false;
+    }
+    const float rayOrigin[3] = {
+        static_cast<float>(nearXYZ[0]),
+        static_cast<float>(nearXYZ[1]),
+        static_cast<float>(nearXYZ[2])
+    };
+    const float rayDirection[3] = {
+        static_cast<float>(farXYZ[0] - nearXYZ[0]),
+        static_cast<float>(farXYZ[1] - nearXYZ[1]),
+        static_cast<float>(farXYZ[2] - nearXYZ[2])
+    };
+    
+    /*
+     * Enabled clipping planes are in eye coordinates and an
+     * intersection in a clipped region is not visible.
+     */
+    std::vector<GLdouble> clippingPlanes;
+    GLint maximumClipPlanes = 0;
+    glGetIntegerv(GL_MAX_CLIP_PLANES, &maximumClipPlanes);
+    for (GLint i = 0; i < maximumClipPlanes; i++) {
+        if (glIsEnabled(GL_CLIP_PLANE0 + i)) {
+            GLdouble abcd[4];
+            glGetClipPlane(GL_CLIP_PLANE0 + i, abcd);
+            clippingPlanes.insert(clippingPlanes.end(), abcd, abcd + 4);
+        }
+    }
+    
+    CaretPointer<const CaretTriangleBVH> triangleBVH = surface->getTriangleBVH();
+    RayTriangleIntersection intersection;
+    bool intersectionFlag = false;
+    if (clippingPlanes.empty()) {
+        intersectionFlag = triangleBVH->closestRayIntersection(rayOrigin,
+                                                               rayDirection,
+                                                               intersection);
+    }
+    else {
+        std::vector<RayTriangleIntersection> allIntersections;
+        triangleBVH->rayIntersections(rayOrigin,
+                                      rayDirection,
+                                      allIntersections);
+        const int32_t numPlaneComponents = static_cast<int32_t>(clippingPlanes.size());
+        for (std::vector<RayTriangleIntersection>::iterator iter = allIntersections.begin();
+             iter != allIntersections.end();
+             iter++) {
+            const float* xyz = iter->point;
+            double eyeXYZW[4];
+            for (int32_t j = 0; j < 4; j++) {
+                eyeXYZW[j] = (modelviewMatrix[j] * xyz[0]
+                              + modelviewMatrix[4 + j] * xyz[1]
+                              + modelviewMatrix[8 + j] * xyz[2]
+                              + modelviewMatrix[12 + j]);
+            }
+            bool insideFlag = true;
+            for (int32_t k = 0; k < numPlaneComponents; k += 4) {
+                if ((clippingPlanes[k] * eyeXYZW[0]
+                     + clippingPlanes[k + 1] * eyeXYZW[1]
+                     + clippingPlanes[k + 2] * eyeXYZW[2]
+                     + clippingPlanes[k + 3] * eyeXYZW[3]) < 0.0) {
+                    insideFlag = false;
+                    break;
+                }
+            }
+            if (insideFlag) {
+                intersection = *iter;
+                intersectionFlag = true;
+                break;
+            }
+        }
+    }
+    
+    if ( ! intersectionFlag) {
+        return true;
+    }
+    
+    double windowXYZ[3];
+    if ( ! gluProject(intersection.point[0], intersection.point[1], intersection.point[2],
+                      modelviewMatrix, projectionMatrix, viewport,
+                      &windowXYZ[0], &windowXYZ[1], &windowXYZ[2])) {
+        return false;
+    }
+    const float depth = windowXYZ[2];
+    
+    const int32_t triangleIndex = static_cast<int32_t>(intersection.triangle);
+    const int32_t* triangleNodes = surface->getTriangle(triangleIndex);
+    
+    /*
+     * Find the triangle's node nearest the mouse in the window
+     */
+    int32_t nearestNode = -1;
+    double nearestNodeModelXYZ[3] = { 0.0, 0.0, 0.0 };
+    double nearestNodeWindowXYZ[3] = { 0.0, 0.0, 0.0 };
+    double nearestDistanceSquared = std::numeric_limits<double>::max();
+    for (int32_t i = 0; i < 3; i++) {
+        const float* xyz = surface->getCoordinate(triangleNodes[i]);
+        double nodeWindowXYZ[3];
+        if (gluProject(xyz[0], xyz[1], xyz[2],
+                       modelviewMatrix, projectionMatrix, viewport,
+                       &nodeWindowXYZ[0], &nodeWindowXYZ[1], &nodeWindowXYZ[2])) {
+            const double distanceSquared = MathFunctions::distanceSquared2D(nodeWindowXYZ[0],
+                                                                            nodeWindowXYZ[1],
+                                                                            windowX,
+                                                                            windowY);
+            if (distanceSquared < nearestDistanceSquared) {
+                nearestDistanceSquared = distanceSquared;
+                nearestNode = triangleNodes[i];
+                for (int32_t j = 0; j < 3; j++) {
+                    nearestNodeModelXYZ[j]  = xyz[j];
+                    nearestNodeWindowXYZ[j] = nodeWindowXYZ[j];
+                }
+            }
+        }
+    }
+    
+    if (triangleID != NULL) {
+        if (triangleID->isOtherScreenDepthCloserToViewer(depth)) {
+            triangleID->setBrain(surface->getBrainStructure()->getBrain());
+            triangleID->setSurface(surface);
+            triangleID->setTriangleNumber(triangleIndex);
+            triangleID->setNearestNode(triangleNodes[0]);
+            triangleID->setScreenDepth(depth);
+            this->setSelectedItemScreenXYZ(triangleID, intersection.point);
+            if (nearestNode >= 0) {
+                triangleID->setNearestNode(nearestNode);
+                triangleID->setNearestNodeScreenXYZ(nearestNodeWindowXYZ);
+                triangleID->setNearestNodeModelXYZ(nearestNodeModelXYZ);
+            }
+            CaretLogFine("Selected Triangle: " + triangleID->toString());
+        }
+    }
+    
+    if ((nodeID != NULL)
+        && (nearestNode >= 0)) {
+        /*
+         * Nodes are drawn as points so the node is identified only when the
+         * mouse is over its point, otherwise the selection manager uses the
+         * triangle's nearest node.
+         */
+        const float pointSize = std::max(m_brain->getDisplayPropertiesSurface()->getNodeSize(),
+                                         2.0f);
+        const double pointRadius = pointSize / 2.0;
+        if (nearestDistanceSquared <= (pointRadius * pointRadius)) {
+            if (nodeID->isOtherScreenDepthCloserToViewer(nearestNodeWindowXYZ[2])) {
+                nodeID->setBrain(surface->getBrainStructure()->getBrain());
+                nodeID->setSurface(surface);
+                nodeID->setNodeNumber(nearestNode);
+                nodeID->setScreenDepth(nearestNodeWindowXYZ[2]);
+                this->setSelectedItemScreenXYZ(nodeID, surface->getCoordinate(nearestNode));
+                CaretLogFine("Selected Vertex: " + nodeID->toString());
+            }
+        }
+    }
+    
+    if (isProjection) {
+        const int32_t barycentricNodes[3] = {
+            triangleNodes[0],
+            triangleNodes[1],
+            triangleNodes[2]
+        };
+        this->setProjectionModeData(depth,
+                                    intersection.point,
+                                    surface->getStructure(),
+                                    intersection.barycentric,
+                                    barycentricNodes,
+                                    surface->getNumberOfNodes());
+    }
+    
+    return true;
+}
+
 /**
  * During projection mode, set the projected data.  If the 
  * projection data is already set, it will be overridden
@@ -2302,7 +2584,9 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
 
 
 /**
- * Draw a surface triangles with vertex arrays.
+ * Draw a surface triangles with vertex arrays.  When vertex buffers
+ * are the best drawing mode, the surface is drawn from buffers that
+ * are kept between frames, otherwise the arrays are sent every frame.
  * @param surface
  *    Surface that is drawn.
  * @param nodeColoringRGBA
@@ -2312,6 +2596,16 @@ void
 BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
                                                                const float* nodeColoringRGBA)
 {
+    if (BrainOpenGL::getBestDrawingMode() == BrainOpenGL::DRAW_MODE_VERTEX_BUFFERS) {
+        if (nodeColoringRGBA == NULL) {
+            glColor3fv(m_backgroundColorFloat);
+        }
+        if (m_surfaceBufferCache->drawSurfaceTriangles(surface,
+                                                       nodeColoringRGBA)) {
+            return;
+        }
+    }
+    
     glEnableClientState(GL_VERTEX_ARRAY);
     if (nodeColoringRGBA != NULL) {
         glEnableClientState(GL_COLOR_ARRAY);
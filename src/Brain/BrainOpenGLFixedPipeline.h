@@ -52,6 +52,7 @@ namespace caret {
     class BrainOpenGLShapeRing;
     class BrainOpenGLShapeRingOutline;
     class BrainOpenGLShapeSphere;
+    class BrainOpenGLSurfaceBufferCache;
     class BrainOpenGLTextureManager;
     class BrainOpenGLViewportContent;
     class BrowserTabContent;
@@ -131,6 +132,8 @@ namespace caret {
         
         virtual BrainOpenGLTextureManager* getTextureManager();
         
+        virtual BrainOpenGLSurfaceBufferCache* getSurfaceBufferCache();
+        
     private:
         class VolumeDrawInfo {
         public:
@@ -200,6 +203,8 @@ namespace caret {
         void drawSurfaceTriangles(Surface* surface,
                                   const float* nodeColoringRGBA);
         
+        bool identifySurfaceWithRayCast(Surface* surface);
+        
         void drawSurfaceNodeAttributes(Surface* surface);
         
         void drawSurfaceBorderBeingDrawn(const Surface* surface);
@@ -616,6 +621,9 @@ namespace caret {
         /** The texture manager. */
         CaretPointer<BrainOpenGLTextureManager> m_textureManager;
         
+        /** Surfaces kept in vertex buffers for this window's OpenGL context. */
+        CaretPointer<BrainOpenGLSurfaceBufferCache> m_surfaceBufferCache;
+        
         static bool s_staticInitialized;
 
         static const float s_gluLookAtCenterFromEyeOffsetDistance;
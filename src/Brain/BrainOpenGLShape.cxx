@@ -101,6 +101,15 @@ BrainOpenGLShape::setImmediateModeOverride(const bool override)
     s_immediateModeOverride = override;
 }
 
+/**
+ * @return True if immediate mode is forced, such as during image capture.
+ */
+bool
+BrainOpenGLShape::isImmediateModeOverride()
+{
+    return s_immediateModeOverride;
+}
+
 /**
  * Draw the shape.
  *
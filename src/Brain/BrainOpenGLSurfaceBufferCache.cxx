@@ -0,0 +1,495 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <set>
+
+#define __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_DECLARE__
+#include "BrainOpenGLSurfaceBufferCache.h"
+#undef __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_DECLARE__
+
+#include "BrainOpenGL.h"
+#include "BrainOpenGLShape.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "EventManager.h"
+#include "EventSurfacesGet.h"
+#include "Surface.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::BrainOpenGLSurfaceBufferCache
+ * \brief Keeps surfaces in OpenGL vertex buffers between frames.
+ * \ingroup Brain
+ *
+ * Coordinates, normal vectors, triangles, and node coloring are
+ * loaded into vertex buffers when first drawn and then reloaded only
+ * when the surface's modification identifiers show that the data has
+ * changed, so that redrawing a surface does not send it to the
+ * graphics system again.  Coloring is stored as bytes (one quarter
+ * the size of float coloring).
+ *
+ * Each workbench window has its own OpenGL context so each window's
+ * drawing has its own instance of this class.  Methods must only be
+ * called while the window's OpenGL context is current.
+ */
+
+/**
+ * Constructor.
+ *
+ * @param windowIndex
+ *    Index of window whose surfaces are kept in buffers.
+ */
+BrainOpenGLSurfaceBufferCache::BrainOpenGLSurfaceBufferCache(const int32_t windowIndex)
+: CaretObject(),
+m_windowIndex(windowIndex)
+{
+
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLSurfaceBufferCache::~BrainOpenGLSurfaceBufferCache()
+{
+    /*
+     * The buffers are not deleted since when an instance of
+     * this class is deleted, the OpenGL context is also
+     * deleted which deletes all of the buffers.
+     */
+    for (std::map<const Surface*, SurfaceBuffers*>::iterator iter = m_surfaceBuffers.begin();
+         iter != m_surfaceBuffers.end();
+         iter++) {
+        delete iter->second;
+    }
+    m_surfaceBuffers.clear();
+}
+
+/**
+ * Draw a surface's triangles using buffers, loading any of
+ * the surface's data that is not in the buffers or has changed.
+ *
+ * @param surface
+ *    Surface that is drawn.
+ * @param nodeColoringRGBA
+ *    RGBA coloring for the nodes.  If NULL, the color array is
+ *    not used and the surface is drawn in the current color.
+ * @return
+ *    True if the surface was drawn, false if vertex buffers are not
+ *    available in which case the caller must draw the surface.
+ */
+bool
+BrainOpenGLSurfaceBufferCache::drawSurfaceTriangles(const Surface* surface,
+                                                    const float* nodeColoringRGBA)
+{
+    CaretAssert(surface);
+
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    if ((surface->getNumberOfNodes() <= 0)
+        || (surface->getNumberOfTriangles() <= 0)) {
+        return false;
+    }
+
+    SurfaceBuffers* surfaceBuffers = NULL;
+    std::map<const Surface*, SurfaceBuffers*>::iterator iter = m_surfaceBuffers.find(surface);
+    if (iter != m_surfaceBuffers.end()) {
+        surfaceBuffers = iter->second;
+    }
+    else {
+        surfaceBuffers = new SurfaceBuffers();
+        m_surfaceBuffers.insert(std::make_pair(surface,
+                                               surfaceBuffers));
+    }
+
+    if ( ! updateSurfaceBuffers(surface,
+                                surfaceBuffers)) {
+        return false;
+    }
+
+    GLuint colorBufferID = 0;
+    if (nodeColoringRGBA != NULL) {
+        if ( ! updateColorBuffer(surface,
+                                 nodeColoringRGBA,
+                                 surfaceBuffers,
+                                 colorBufferID)) {
+            return false;
+        }
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 surfaceBuffers->m_coordinateBuffer.m_bufferID);
+    glVertexPointer(3,
+                    GL_FLOAT,
+                    0,
+                    (GLvoid*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 surfaceBuffers->m_normalBuffer.m_bufferID);
+    glNormalPointer(GL_FLOAT,
+                    0,
+                    (GLvoid*)0);
+
+    if (colorBufferID > 0) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     colorBufferID);
+        glColorPointer(4,
+                       GL_UNSIGNED_BYTE,
+                       0,
+                       (GLvoid*)0);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 surfaceBuffers->m_triangleBuffer.m_bufferID);
+    glDrawElements(GL_TRIANGLES,
+                   (3 * surfaceBuffers->m_numberOfTriangles),
+                   GL_UNSIGNED_INT,
+                   (GLvoid*)0);
+
+    /*
+     * Deselect active buffers, otherwise, client
+     * arrays drawn later would be taken as offsets
+     * into these buffers.
+     */
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+
+    return true;
+#else // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    return false;
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+}
+
+/**
+ * Load the surface's coordinates, normal vectors, and triangles
+ * into their buffers if they are not loaded or have changed.
+ *
+ * @param surface
+ *    The surface.
+ * @param surfaceBuffers
+ *    Buffers for the surface.
+ * @return
+ *    True if the buffers are valid.
+ */
+bool
+BrainOpenGLSurfaceBufferCache::updateSurfaceBuffers(const Surface* surface,
+                                                    SurfaceBuffers* surfaceBuffers)
+{
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    /*
+     * Image capture may draw in a different OpenGL context
+     * where these buffers do not exist, so use client arrays.
+     */
+    if (BrainOpenGLShape::isImmediateModeOverride()) {
+        return false;
+    }
+    
+    /*
+     * Buffers are lost when the OpenGL context is recreated
+     * (such as by an image capture) so forget all of them.
+     */
+    if (surfaceBuffers->m_coordinateBuffer.m_bufferID > 0) {
+        if (glIsBuffer(surfaceBuffers->m_coordinateBuffer.m_bufferID) == GL_FALSE) {
+            *surfaceBuffers = SurfaceBuffers();
+        }
+    }
+
+    const int64_t coordinateIdentifier = surface->getCoordinateModificationIdentifier();
+    if (surfaceBuffers->m_coordinateBuffer.m_modificationIdentifier != coordinateIdentifier) {
+        const int64_t numberOfBytes = surface->getNumberOfNodes() * 3 * sizeof(float);
+        surfaceBuffers->m_coordinateBuffer.m_bufferID = loadBuffer(GL_ARRAY_BUFFER,
+                                                                   surfaceBuffers->m_coordinateBuffer.m_bufferID,
+                                                                   numberOfBytes,
+                                                                   surface->getCoordinate(0),
+                                                                   GL_STATIC_DRAW);
+        surfaceBuffers->m_normalBuffer.m_bufferID = loadBuffer(GL_ARRAY_BUFFER,
+                                                               surfaceBuffers->m_normalBuffer.m_bufferID,
+                                                               numberOfBytes,
+                                                               surface->getNormalVector(0),
+                                                               GL_STATIC_DRAW);
+        if ((surfaceBuffers->m_coordinateBuffer.m_bufferID == 0)
+            || (surfaceBuffers->m_normalBuffer.m_bufferID == 0)) {
+            return false;
+        }
+        surfaceBuffers->m_coordinateBuffer.m_modificationIdentifier = coordinateIdentifier;
+        surfaceBuffers->m_normalBuffer.m_modificationIdentifier     = coordinateIdentifier;
+    }
+
+    const int64_t topologyIdentifier = surface->getTopologyModificationIdentifier();
+    if (surfaceBuffers->m_triangleBuffer.m_modificationIdentifier != topologyIdentifier) {
+        const int32_t numberOfTriangles = surface->getNumberOfTriangles();
+        surfaceBuffers->m_triangleBuffer.m_bufferID = loadBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                                                                 surfaceBuffers->m_triangleBuffer.m_bufferID,
+                                                                 numberOfTriangles * 3 * sizeof(int32_t),
+                                                                 surface->getTriangle(0),
+                                                                 GL_STATIC_DRAW);
+        if (surfaceBuffers->m_triangleBuffer.m_bufferID == 0) {
+            return false;
+        }
+        surfaceBuffers->m_triangleBuffer.m_modificationIdentifier = topologyIdentifier;
+        surfaceBuffers->m_numberOfTriangles = numberOfTriangles;
+    }
+
+    return true;
+#else // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    return false;
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+}
+
+/**
+ * Load node coloring, as bytes, into its buffer if it is not loaded
+ * or has changed.
+ *
+ * @param surface
+ *    The surface.
+ * @param nodeColoringRGBA
+ *    RGBA coloring for the nodes.
+ * @param surfaceBuffers
+ *    Buffers for the surface.
+ * @param colorBufferIDOut
+ *    Output containing the buffer with the coloring.
+ * @return
+ *    True if the buffer is valid.
+ */
+bool
+BrainOpenGLSurfaceBufferCache::updateColorBuffer(const Surface* surface,
+                                                 const float* nodeColoringRGBA,
+                                                 SurfaceBuffers* surfaceBuffers,
+                                                 GLuint& colorBufferIDOut)
+{
+    colorBufferIDOut = 0;
+
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    /*
+     * Coloring not kept in the surface has no identifier (negative)
+     * and is loaded every time it is drawn.
+     */
+    const int64_t coloringIdentifier = surface->getNodeColoringModificationIdentifier(nodeColoringRGBA);
+
+    Buffer& colorBuffer = surfaceBuffers->m_colorBuffers[nodeColoringRGBA];
+    if ((coloringIdentifier >= 0)
+        && (colorBuffer.m_modificationIdentifier == coloringIdentifier)) {
+        colorBufferIDOut = colorBuffer.m_bufferID;
+        return true;
+    }
+
+    if (coloringIdentifier >= 0) {
+        /*
+         * The surface's coloring changed so its other buffered colorings
+         * (other tabs) are reloaded when next drawn.  Remove them so that
+         * buffers are not kept for coloring that no longer exists.
+         */
+        std::map<const float*, Buffer>::iterator iter = surfaceBuffers->m_colorBuffers.begin();
+        while (iter != surfaceBuffers->m_colorBuffers.end()) {
+            if ((iter->first != nodeColoringRGBA)
+                && (iter->second.m_modificationIdentifier != coloringIdentifier)) {
+                deleteBuffer(iter->second);
+                surfaceBuffers->m_colorBuffers.erase(iter++);
+            }
+            else {
+                iter++;
+            }
+        }
+    }
+
+    const int64_t numberOfComponents = surface->getNumberOfNodes() * 4;
+    m_rgbaBytes.resize(numberOfComponents);
+    for (int64_t i = 0; i < numberOfComponents; i++) {
+        const float value = nodeColoringRGBA[i];
+        m_rgbaBytes[i] = ((value > 0.0f)
+                          ? ((value < 1.0f)
+                             ? static_cast<uint8_t>(value * 255.0f + 0.5f)
+                             : 255)
+                          : 0);
+    }
+
+    colorBuffer.m_bufferID = loadBuffer(GL_ARRAY_BUFFER,
+                                        colorBuffer.m_bufferID,
+                                        numberOfComponents,
+                                        &m_rgbaBytes[0],
+                                        ((coloringIdentifier >= 0)
+                                         ? GL_STATIC_DRAW
+                                         : GL_STREAM_DRAW));
+    colorBuffer.m_modificationIdentifier = coloringIdentifier;
+    colorBufferIDOut = colorBuffer.m_bufferID;
+
+    return (colorBufferIDOut > 0);
+#else // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    return false;
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+}
+
+/**
+ * Load data into a buffer.
+ *
+ * @param target
+ *    GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER.
+ * @param bufferID
+ *    The buffer, if zero a new buffer is created.
+ * @param numberOfBytes
+ *    Number of bytes in the data.
+ * @param data
+ *    The data.
+ * @param usage
+ *    Expected usage (GL_STATIC_DRAW, GL_STREAM_DRAW).
+ * @return
+ *    The buffer containing the data or zero if creating the buffer failed.
+ */
+GLuint
+BrainOpenGLSurfaceBufferCache::loadBuffer(const GLenum target,
+                                          const GLuint bufferID,
+                                          const int64_t numberOfBytes,
+                                          const void* data,
+                                          const GLenum usage)
+{
+    GLuint id = bufferID;
+
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    if (id == 0) {
+        glGenBuffers(1, &id);
+        if (id == 0) {
+            CaretLogSevere("Failed to create a new OpenGL Vertex Buffer for surface drawing in window "
+                           + AString::number(m_windowIndex + 1));
+            return 0;
+        }
+    }
+
+    glBindBuffer(target,
+                 id);
+    glBufferData(target,
+                 numberOfBytes,
+                 data,
+                 usage);
+    glBindBuffer(target,
+                 0);
+#else // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    CaretLogSevere("PROGRAM ERROR: Loading OpenGL vertex buffer but vertex buffers not supported.");
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+
+    return id;
+}
+
+/**
+ * Delete the buffers for surfaces that are no longer in the brain.
+ */
+void
+BrainOpenGLSurfaceBufferCache::deleteBuffersForRemovedSurfaces()
+{
+    if (m_surfaceBuffers.empty()) {
+        return;
+    }
+
+    EventSurfacesGet surfacesGetEvent;
+    EventManager::get()->sendEvent(surfacesGetEvent.getPointer());
+    const std::vector<Surface*> surfaces = surfacesGetEvent.getSurfaces();
+    const std::set<const Surface*> validSurfaces(surfaces.begin(),
+                                                 surfaces.end());
+
+    std::map<const Surface*, SurfaceBuffers*>::iterator iter = m_surfaceBuffers.begin();
+    while (iter != m_surfaceBuffers.end()) {
+        if (validSurfaces.find(iter->first) == validSurfaces.end()) {
+            deleteSurfaceBuffers(iter->second);
+            m_surfaceBuffers.erase(iter++);
+        }
+        else {
+            iter++;
+        }
+    }
+}
+
+/**
+ * Delete the buffers for all surfaces.
+ */
+void
+BrainOpenGLSurfaceBufferCache::deleteAllBuffers()
+{
+    for (std::map<const Surface*, SurfaceBuffers*>::iterator iter = m_surfaceBuffers.begin();
+         iter != m_surfaceBuffers.end();
+         iter++) {
+        deleteSurfaceBuffers(iter->second);
+    }
+    m_surfaceBuffers.clear();
+}
+
+/**
+ * Delete the buffers for a surface and then the surface buffers object.
+ *
+ * @param surfaceBuffers
+ *    Buffers for a surface.
+ */
+void
+BrainOpenGLSurfaceBufferCache::deleteSurfaceBuffers(SurfaceBuffers* surfaceBuffers)
+{
+    CaretAssert(surfaceBuffers);
+
+    deleteBuffer(surfaceBuffers->m_coordinateBuffer);
+    deleteBuffer(surfaceBuffers->m_normalBuffer);
+    deleteBuffer(surfaceBuffers->m_triangleBuffer);
+    for (std::map<const float*, Buffer>::iterator iter = surfaceBuffers->m_colorBuffers.begin();
+         iter != surfaceBuffers->m_colorBuffers.end();
+         iter++) {
+        deleteBuffer(iter->second);
+    }
+
+    delete surfaceBuffers;
+}
+
+/**
+ * Delete a buffer.
+ *
+ * @param buffer
+ *    The buffer, its ID is reset.
+ */
+void
+BrainOpenGLSurfaceBufferCache::deleteBuffer(Buffer& buffer)
+{
+#ifdef BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+    if (buffer.m_bufferID > 0) {
+        if (glIsBuffer(buffer.m_bufferID) == GL_TRUE) {
+            glDeleteBuffers(1, &buffer.m_bufferID);
+        }
+    }
+#endif // BRAIN_OPENGL_INFO_SUPPORTS_VERTEX_BUFFERS
+
+    buffer = Buffer();
+}
+
+/**
+ * Get a description of this object's content.
+ * @return String describing this object's content.
+ */
+AString
+BrainOpenGLSurfaceBufferCache::toString() const
+{
+    return "BrainOpenGLSurfaceBufferCache";
+}
+
@@ -0,0 +1,126 @@
+#ifndef __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_H__
+#define __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <map>
+#include <vector>
+
+#include "CaretObject.h"
+#include "CaretOpenGLInclude.h"
+
+namespace caret {
+
+    class Surface;
+
+    class BrainOpenGLSurfaceBufferCache : public CaretObject {
+
+    public:
+        BrainOpenGLSurfaceBufferCache(const int32_t windowIndex);
+
+        virtual ~BrainOpenGLSurfaceBufferCache();
+
+        bool drawSurfaceTriangles(const Surface* surface,
+                                  const float* nodeColoringRGBA);
+
+        void deleteBuffersForRemovedSurfaces();
+
+        void deleteAllBuffers();
+
+        // ADD_NEW_METHODS_HERE
+
+        virtual AString toString() const;
+
+    private:
+        BrainOpenGLSurfaceBufferCache(const BrainOpenGLSurfaceBufferCache&);
+
+        BrainOpenGLSurfaceBufferCache& operator=(const BrainOpenGLSurfaceBufferCache&);
+
+        /**
+         * A buffer and the modification identifier of
+         * the data when it was loaded into the buffer.
+         */
+        class Buffer {
+        public:
+            Buffer()
+            : m_bufferID(0),
+              m_modificationIdentifier(-1) { }
+
+            GLuint m_bufferID;
+
+            int64_t m_modificationIdentifier;
+        };
+
+        /**
+         * Buffers for one surface.
+         */
+        class SurfaceBuffers {
+        public:
+            SurfaceBuffers()
+            : m_numberOfTriangles(0) { }
+
+            Buffer m_coordinateBuffer;
+
+            Buffer m_normalBuffer;
+
+            Buffer m_triangleBuffer;
+
+            int32_t m_numberOfTriangles;
+
+            /** Buffers of byte RGBA colors, keyed by the surface's coloring they contain */
+            std::map<const float*, Buffer> m_colorBuffers;
+        };
+
+        bool updateSurfaceBuffers(const Surface* surface,
+                                  SurfaceBuffers* surfaceBuffers);
+
+        bool updateColorBuffer(const Surface* surface,
+                               const float* nodeColoringRGBA,
+                               SurfaceBuffers* surfaceBuffers,
+                               GLuint& colorBufferIDOut);
+
+        GLuint loadBuffer(const GLenum target,
+                          const GLuint bufferID,
+                          const int64_t numberOfBytes,
+                          const void* data,
+                          const GLenum usage);
+
+        void deleteSurfaceBuffers(SurfaceBuffers* surfaceBuffers);
+
+        void deleteBuffer(Buffer& buffer);
+
+        const int32_t m_windowIndex;
+
+        std::map<const Surface*, SurfaceBuffers*> m_surfaceBuffers;
+
+        /** Avoids allocation when converting float colors to bytes */
+        std::vector<uint8_t> m_rgbaBytes;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_DECLARE__
+
+} // namespace
+#endif  //__BRAIN_OPEN_G_L_SURFACE_BUFFER_CACHE_H__
@@ -23,6 +23,8 @@
 #include "CiftiConnectivityMatrixDataFileManager.h"
 #undef __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
 
+#include <algorithm>
+
 #include "Brain.h"
 #include "CaretAssert.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
@@ -31,6 +33,7 @@
 #include "EventGetDisplayedDataFiles.h"
 #include "EventManager.h"
 #include "EventSurfaceColoringInvalidate.h"
+#include "GeodesicHelper.h"
 #include "SceneAttributes.h"
 #include "SceneClass.h"
 #include "SceneClassArray.h"
@@ -312,11 +315,107 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
     
     if (haveData) {
         EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+        
+        setRowsToPrefetchNearSurfaceNode(ciftiMatrixFiles,
+                                         surfaceFile,
+                                         nodeIndex);
     }
     
     return haveData;
 }
 
+/**
+ * Set the rows that the files prefetch (see prefetchRows()) to those
+ * for nodes near a node, nearest first, since the user often selects
+ * a nearby node next (or drags across the surface).
+ *
+ * @param ciftiMatrixFiles
+ *    The connectivity files.
+ * @param surfaceFile
+ *    Surface File that contains the node.
+ * @param nodeIndex
+ *    Index of the surface node.
+ */
+void
+CiftiConnectivityMatrixDataFileManager::setRowsToPrefetchNearSurfaceNode(std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFiles,
+                                                                         const SurfaceFile* surfaceFile,
+                                                                         const int32_t nodeIndex)
+{
+    std::vector<int32_t> nearbyNodes;
+    std::vector<float> nearbyDistances;
+    CaretPointer<GeodesicHelper> geodesicHelper = surfaceFile->getGeodesicHelper();
+    geodesicHelper->getNodesToGeoDist(nodeIndex,
+                                      PREFETCH_GEODESIC_DISTANCE,
+                                      nearbyNodes,
+                                      nearbyDistances);
+    
+    std::vector<std::pair<float, int32_t> > distanceAndNode;
+    for (int32_t i = 0; i < static_cast<int32_t>(nearbyNodes.size()); i++) {
+        if (nearbyNodes[i] != nodeIndex) {
+            distanceAndNode.push_back(std::make_pair(nearbyDistances[i],
+                                                     nearbyNodes[i]));
+        }
+    }
+    std::sort(distanceAndNode.begin(),
+              distanceAndNode.end());
+    
+    std::vector<int32_t> prefetchNodes;
+    for (std::vector<std::pair<float, int32_t> >::iterator iter = distanceAndNode.begin();
+         iter != distanceAndNode.end();
+         iter++) {
+        prefetchNodes.push_back(iter->second);
+    }
+    
+    for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
+         iter != ciftiMatrixFiles.end();
+         iter++) {
+        CiftiMappableConnectivityMatrixDataFile* cmf = *iter;
+        if (cmf->isEmpty() == false) {
+            cmf->setRowsToPrefetchForSurfaceNodes(surfaceFile->getNumberOfNodes(),
+                                                  surfaceFile->getStructure(),
+                                                  prefetchNodes);
+        }
+    }
+}
+
+/**
+ * Read the next row that a connectivity file is waiting to prefetch
+ * into the row cache.  Only one row is read per call, since the read
+ * blocks the caller.  Call repeatedly while the user interface is idle,
+ * until false is returned.
+ *
+ * @param brain
+ *    Brain containing the connectivity files.
+ * @return
+ *    True if rows remain to be prefetched.
+ */
+bool
+CiftiConnectivityMatrixDataFileManager::prefetchRows(Brain* brain)
+{
+    std::vector<CiftiMappableConnectivityMatrixDataFile*> ciftiMatrixFiles;
+    getDisplayedConnectivityMatrixFiles(brain,
+                                        ciftiMatrixFiles);
+    
+    bool moreRowsFlag = false;
+    bool rowReadFlag = false;
+    for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
+         iter != ciftiMatrixFiles.end();
+         iter++) {
+        CiftiMappableConnectivityMatrixDataFile* cmf = *iter;
+        if (cmf->hasRowsToPrefetch()) {
+            if ( ! rowReadFlag) {
+                cmf->prefetchRows(PREFETCH_ROWS_PER_CALL);
+                rowReadFlag = true;
+            }
+            if (cmf->hasRowsToPrefetch()) {
+                moreRowsFlag = true;
+            }
+        }
+    }
+    
+    return moreRowsFlag;
+}
+
 /**
  * Load data for each of the given surface node indices and average the data.
  * @param brain
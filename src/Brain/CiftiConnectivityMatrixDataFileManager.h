@@ -72,6 +72,8 @@ namespace caret {
         
         bool hasNetworkFiles(Brain* brain) const;
         
+        bool prefetchRows(Brain* brain);
+        
     private:
         CiftiConnectivityMatrixDataFileManager(const CiftiConnectivityMatrixDataFileManager&);
 
@@ -84,12 +86,24 @@ namespace caret {
     private:
         void getDisplayedConnectivityMatrixFiles(Brain* brain,
                                                  std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFilesOut) const;
+        
+        void setRowsToPrefetchNearSurfaceNode(std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFiles,
+                                              const SurfaceFile* surfaceFile,
+                                              const int32_t nodeIndex);
+        
+        /** Geodesic distance, in mm, from a loaded node to the nodes whose rows are prefetched */
+        static const float PREFETCH_GEODESIC_DISTANCE;
+        
+        /** Rows read in each call to prefetchRows(), one so the user interface stays responsive */
+        static const int32_t PREFETCH_ROWS_PER_CALL;
 
         // ADD_NEW_MEMBERS_HERE
     };
     
 #ifdef __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
     // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const float CiftiConnectivityMatrixDataFileManager::PREFETCH_GEODESIC_DISTANCE = 5.0f;
+    const int32_t CiftiConnectivityMatrixDataFileManager::PREFETCH_ROWS_PER_CALL = 1;
 #endif // __CIFTI_CONNECTIVITY_MATRIX_DATA_FILE_MANAGER_DECLARE__
 
 } // namespace
@@ -0,0 +1,402 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __DATA_FILE_PREFETCHER_DECLARE__
+#include "DataFilePrefetcher.h"
+#undef __DATA_FILE_PREFETCHER_DECLARE__
+
+#include <algorithm>
+#include <new>
+
+#include <QThread>
+
+#include "CaretAssert.h"
+#include "CaretDataFileHelper.h"
+#include "CaretLogger.h"
+#include "DataFile.h"
+#include "FileInformation.h"
+#include "Surface.h"
+
+using namespace caret;
+
+
+/**
+ * \class caret::DataFilePrefetcher
+ * \brief Reads data files on worker threads ahead of their use.
+ * \ingroup Brain
+ *
+ * Files are added in the order they will be used and are read by
+ * a pool of threads in that order.  Only local files of types whose
+ * reading does not send events or depend upon other loaded files are
+ * read on the threads (see isPrefetchSupported()); all other entries,
+ * including files on the network (which use the username and password
+ * and network access of the main thread), are immediately 'done' and
+ * takeFile() returns NULL for them so that the caller reads them in
+ * the usual way.
+ *
+ * The file objects are created on the thread that calls addFile()
+ * since the constructors of some files add event listeners.
+ */
+
+/**
+ * Thread that reads files until none remain or reading is cancelled.
+ */
+class DataFilePrefetcher::ReaderThread : public QThread
+{
+public:
+    ReaderThread(DataFilePrefetcher* prefetcher) {
+        m_prefetcher = prefetcher;
+    }
+
+    void run() {
+        m_prefetcher->readFilesInThread();
+    }
+
+    DataFilePrefetcher* m_prefetcher;
+};
+
+/**
+ * Constructor for an entry.
+ *
+ * @param dataFileType
+ *    Type of the data file.
+ * @param fileName
+ *    Absolute name of the data file.
+ */
+DataFilePrefetcher::Entry::Entry(const DataFileTypeEnum::Enum dataFileType,
+                                 const AString& fileName)
+: m_dataFileType(dataFileType),
+  m_fileName(fileName),
+  m_caretDataFile(NULL),
+  m_readFailed(false),
+  m_done(false)
+{
+
+}
+
+/**
+ * Constructor.
+ */
+DataFilePrefetcher::DataFilePrefetcher()
+: CaretObject()
+{
+    m_nextEntryIndex = 0;
+    m_cancelled = false;
+}
+
+/**
+ * Destructor.  Stops the reading threads and deletes any
+ * files that were not taken.
+ */
+DataFilePrefetcher::~DataFilePrefetcher()
+{
+    cancel();
+
+    for (std::vector<Entry>::iterator iter = m_entries.begin();
+         iter != m_entries.end();
+         iter++) {
+        if (iter->m_caretDataFile != NULL) {
+            delete iter->m_caretDataFile;
+            iter->m_caretDataFile = NULL;
+        }
+    }
+}
+
+/**
+ * Is reading of the given type of file supported on a worker thread?
+ *
+ * @param dataFileType
+ *    Type of data file.
+ * @return
+ *    True if the file type may be read on a worker thread.
+ */
+bool
+DataFilePrefetcher::isPrefetchSupported(const DataFileTypeEnum::Enum dataFileType)
+{
+    bool supportedFlag = false;
+
+    switch (dataFileType) {
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+        case DataFileTypeEnum::LABEL:
+        case DataFileTypeEnum::METRIC:
+        case DataFileTypeEnum::RGBA:
+        case DataFileTypeEnum::SURFACE:
+        case DataFileTypeEnum::VOLUME:
+            supportedFlag = true;
+            break;
+        default:
+            /*
+             * Palettes must be in the brain before other files are added,
+             * annotations and scenes send events while reading, matrix
+             * files are read on demand, and the remaining types are small
+             * or depend upon other loaded files.
+             */
+            break;
+    }
+
+    return supportedFlag;
+}
+
+/**
+ * Add a file for reading.  Must be called before start() and from
+ * the thread that will later take the file.
+ *
+ * @param dataFileType
+ *    Type of the data file.
+ * @param absoluteFileName
+ *    Absolute path name (or URL) of the data file.
+ * @return
+ *    Index of the file for use with waitForFile() and takeFile().
+ */
+int32_t
+DataFilePrefetcher::addFile(const DataFileTypeEnum::Enum dataFileType,
+                            const AString& absoluteFileName)
+{
+    CaretAssert(m_threads.empty());
+
+    Entry entry(dataFileType,
+                absoluteFileName);
+    if (isPrefetchSupported(dataFileType)
+        && ( ! DataFile::isFileOnNetwork(absoluteFileName))) {
+        /*
+         * The brain adds Surface, not SurfaceFile
+         */
+        if (dataFileType == DataFileTypeEnum::SURFACE) {
+            entry.m_caretDataFile = new Surface();
+        }
+        else {
+            entry.m_caretDataFile = CaretDataFileHelper::createCaretDataFileForFileType(dataFileType);
+        }
+    }
+    if (entry.m_caretDataFile == NULL) {
+        entry.m_done = true;
+    }
+
+    m_entries.push_back(entry);
+
+    return static_cast<int32_t>(m_entries.size() - 1);
+}
+
+/**
+ * @return Type of the file at the given index.
+ * @param fileIndex
+ *    Index of the file.
+ */
+DataFileTypeEnum::Enum
+DataFilePrefetcher::getFileType(const int32_t fileIndex) const
+{
+    CaretAssertVectorIndex(m_entries, fileIndex);
+    return m_entries[fileIndex].m_dataFileType;
+}
+
+/**
+ * @return Name of the file at the given index.
+ * @param fileIndex
+ *    Index of the file.
+ */
+AString
+DataFilePrefetcher::getFileName(const int32_t fileIndex) const
+{
+    CaretAssertVectorIndex(m_entries, fileIndex);
+    return m_entries[fileIndex].m_fileName;
+}
+
+/**
+ * Start the reading threads.
+ */
+void
+DataFilePrefetcher::start()
+{
+    CaretAssert(m_threads.empty());
+
+    int32_t numToRead = 0;
+    for (std::vector<Entry>::iterator iter = m_entries.begin();
+         iter != m_entries.end();
+         iter++) {
+        if ( ! iter->m_done) {
+            numToRead++;
+        }
+    }
+
+    const int32_t numThreads = std::min(numToRead,
+                                        std::max(1, QThread::idealThreadCount()));
+    for (int32_t i = 0; i < numThreads; i++) {
+        ReaderThread* thread = new ReaderThread(this);
+        m_threads.push_back(thread);
+        thread->start();
+    }
+}
+
+/**
+ * Wait for a file to finish reading.
+ *
+ * @param fileIndex
+ *    Index of the file.
+ * @param milliseconds
+ *    Maximum time to wait.
+ * @return
+ *    True if the file is done (read, failed, or not prefetched),
+ *    false if still being read when the time elapsed.
+ */
+bool
+DataFilePrefetcher::waitForFile(const int32_t fileIndex,
+                                const unsigned long milliseconds)
+{
+    CaretAssertVectorIndex(m_entries, fileIndex);
+
+    QMutexLocker locker(&m_mutex);
+    if ( ! m_entries[fileIndex].m_done) {
+        m_fileDoneCondition.wait(&m_mutex,
+                                 milliseconds);
+    }
+
+    return m_entries[fileIndex].m_done;
+}
+
+/**
+ * Take a file that is done.  The caller then owns the file.
+ *
+ * @param fileIndex
+ *    Index of the file.
+ * @return
+ *    The file that was read or NULL if the file type is not
+ *    prefetched, in which case the caller must read the file.
+ * @throws DataFileException
+ *    If there was an error reading the file.
+ */
+CaretDataFile*
+DataFilePrefetcher::takeFile(const int32_t fileIndex)
+{
+    CaretAssertVectorIndex(m_entries, fileIndex);
+
+    QMutexLocker locker(&m_mutex);
+    Entry& entry = m_entries[fileIndex];
+    CaretAssert(entry.m_done);
+
+    CaretDataFile* caretDataFile = entry.m_caretDataFile;
+    entry.m_caretDataFile = NULL;
+
+    if (entry.m_readFailed) {
+        delete caretDataFile;
+        throw entry.m_exception;
+    }
+
+    return caretDataFile;
+}
+
+/**
+ * Stop reading files and wait for the threads to finish.  Files that
+ * are being read when this is called will finish reading.
+ */
+void
+DataFilePrefetcher::cancel()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+    }
+
+    for (std::vector<ReaderThread*>::iterator iter = m_threads.begin();
+         iter != m_threads.end();
+         iter++) {
+        ReaderThread* thread = *iter;
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+}
+
+/**
+ * Read files, in order, until none remain or reading is cancelled.
+ * Runs on the reading threads.
+ */
+void
+DataFilePrefetcher::readFilesInThread()
+{
+    const int32_t numEntries = static_cast<int32_t>(m_entries.size());
+
+    while (true) {
+        int32_t entryIndex = -1;
+        {
+            QMutexLocker locker(&m_mutex);
+            while ((m_nextEntryIndex < numEntries)
+                   && m_entries[m_nextEntryIndex].m_done) {
+                m_nextEntryIndex++;
+            }
+            if (m_cancelled
+                || (m_nextEntryIndex >= numEntries)) {
+                return;
+            }
+            entryIndex = m_nextEntryIndex;
+            m_nextEntryIndex++;
+        }
+
+        /*
+         * Only this thread uses the entry's file until the entry is done
+         */
+        Entry& entry = m_entries[entryIndex];
+        const AString& filename = entry.m_fileName;
+        bool readFailed = false;
+        DataFileException exception;
+        try {
+            FileInformation fileInfo(filename);
+            if (fileInfo.exists() == false) {
+                throw DataFileException(filename,
+                                        "File does not exist!");
+            }
+
+            try {
+                entry.m_caretDataFile->readFile(filename);
+            }
+            catch (const std::bad_alloc&) {
+                throw DataFileException(filename,
+                                        CaretDataFileHelper::createBadAllocExceptionMessage(filename));
+            }
+        }
+        catch (const DataFileException& dfe) {
+            readFailed = true;
+            exception = dfe;
+        }
+        catch (const CaretException& ce) {
+            readFailed = true;
+            exception = DataFileException(filename,
+                                          ce.whatString());
+        }
+        catch (const std::exception& e) {
+            readFailed = true;
+            exception = DataFileException(filename,
+                                          e.what());
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (readFailed) {
+            entry.m_readFailed = true;
+            entry.m_exception = exception;
+        }
+        entry.m_done = true;
+        m_fileDoneCondition.wakeAll();
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef __DATA_FILE_PREFETCHER_H__
+#define __DATA_FILE_PREFETCHER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <vector>
+
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "CaretObject.h"
+#include "DataFileException.h"
+#include "DataFileTypeEnum.h"
+
+namespace caret {
+
+    class CaretDataFile;
+
+    class DataFilePrefetcher : public CaretObject {
+
+    public:
+        DataFilePrefetcher();
+
+        virtual ~DataFilePrefetcher();
+
+        static bool isPrefetchSupported(const DataFileTypeEnum::Enum dataFileType);
+
+        int32_t addFile(const DataFileTypeEnum::Enum dataFileType,
+                        const AString& absoluteFileName);
+
+        DataFileTypeEnum::Enum getFileType(const int32_t fileIndex) const;
+
+        AString getFileName(const int32_t fileIndex) const;
+
+        void start();
+
+        bool waitForFile(const int32_t fileIndex,
+                         const unsigned long milliseconds);
+
+        CaretDataFile* takeFile(const int32_t fileIndex);
+
+        void cancel();
+
+    private:
+        DataFilePrefetcher(const DataFilePrefetcher&);
+
+        DataFilePrefetcher& operator=(const DataFilePrefetcher&);
+
+        class Entry {
+        public:
+            Entry(const DataFileTypeEnum::Enum dataFileType,
+                  const AString& fileName);
+
+            DataFileTypeEnum::Enum m_dataFileType;
+
+            AString m_fileName;
+
+            /** File being read, NULL if the file is not prefetched or was taken */
+            CaretDataFile* m_caretDataFile;
+
+            DataFileException m_exception;
+
+            bool m_readFailed;
+
+            bool m_done;
+        };
+
+        class ReaderThread;
+
+        void readFilesInThread();
+
+        std::vector<Entry> m_entries;
+
+        std::vector<ReaderThread*> m_threads;
+
+        /** Protects all members used by the reader threads after start() */
+        QMutex m_mutex;
+
+        QWaitCondition m_fileDoneCondition;
+
+        int32_t m_nextEntryIndex;
+
+        bool m_cancelled;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __DATA_FILE_PREFETCHER_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __DATA_FILE_PREFETCHER_DECLARE__
+
+} // namespace
+#endif  //__DATA_FILE_PREFETCHER_H__
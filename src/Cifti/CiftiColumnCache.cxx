@@ -0,0 +1,221 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiColumnCache.h"
+
+#include "CacheFile.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+QString CiftiColumnCache::s_cacheDir;
+int64_t CiftiColumnCache::s_tileRows = 0;
+int64_t CiftiColumnCache::s_maxBytes = 0;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'C', 'O', 'L', 'C', 'A', '\0' };
+    const int32_t CACHE_VERSION = 1;
+    const int64_t HEADER_SIZE = 64;//common cache header, 5 int64s, padded so the data is aligned
+    const int64_t BUILD_MEMORY = 1<<26;//64MiB, default panel memory limit for automatic tile size
+    const int64_t MIN_TILE_ROWS = 16, MAX_TILE_ROWS = 4096;
+
+    struct CacheHeader
+    {
+        char fileHeader[CacheFile::HEADER_SIZE];
+        int64_t sourceSize, sourceModified, numRows, numCols, tileRows;
+    };
+
+    void fillHeader(CacheHeader& header, const QString& sourceFile, const int64_t& numRows, const int64_t& numCols, const int64_t& tileRows)
+    {
+        memset(&header, 0, sizeof(CacheHeader));
+        CacheFile::writeHeader(header.fileHeader, CACHE_MAGIC, CACHE_VERSION);
+        QFileInfo sourceInfo(sourceFile);
+        header.sourceSize = sourceInfo.size();
+        header.sourceModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+        header.numRows = numRows;
+        header.numCols = numCols;
+        header.tileRows = tileRows;
+    }
+}
+
+QString CiftiColumnCache::getCacheName(const QString& sourceFile)
+{//hash the full path so same-named files in different directories don't collide, keep the file name so the cache directory is understandable
+    QFileInfo sourceInfo(sourceFile);
+    QByteArray pathHash = QCryptographicHash::hash(sourceInfo.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex();
+    return QDir(s_cacheDir).filePath(QString(pathHash) + "_" + sourceInfo.fileName() + ".colcache");
+}
+
+bool CiftiColumnCache::openExisting(CiftiColumnCache& cache, const QString& cacheName, const QString& sourceFile, const int64_t& numRows, const int64_t& numCols)
+{
+    if (!QFile::exists(cacheName)) return false;
+    CacheHeader expected, found;
+    fillHeader(expected, sourceFile, numRows, numCols, 0);
+    try
+    {
+        cache.m_file.open(cacheName);
+        int64_t numRead = 0;
+        cache.m_file.read(&found, sizeof(CacheHeader), &numRead);
+        if (numRead != sizeof(CacheHeader) || !CacheFile::checkHeader(found.fileHeader, CACHE_MAGIC, CACHE_VERSION) || found.sourceSize != expected.sourceSize || found.sourceModified != expected.sourceModified ||
+            found.numRows != numRows || found.numCols != numCols || found.tileRows < 1 ||
+            cache.m_file.size() != HEADER_SIZE + numRows * numCols * (int64_t)sizeof(float))
+        {
+            cache.m_file.close();
+            CaretLogFine("column cache '" + cacheName + "' is out of date or invalid, rebuilding");
+            return false;
+        }
+        cache.m_numRows = numRows;
+        cache.m_numCols = numCols;
+        cache.m_tileRows = found.tileRows;
+    } catch (DataFileException& e) {
+        cache.m_file.close();
+        CaretLogFine("unable to use column cache '" + cacheName + "': " + e.whatString());
+        return false;
+    }
+    return true;
+}
+
+void CiftiColumnCache::build(const QString& cacheName, const QString& sourceFile, const CiftiFile::ReadImplInterface* source, const int64_t& numRows, const int64_t& numCols)
+{
+    int64_t tileRows = s_tileRows;
+    if (tileRows < 1)
+    {
+        tileRows = max(MIN_TILE_ROWS, min(MAX_TILE_ROWS, BUILD_MEMORY / (numCols * (int64_t)sizeof(float))));
+    }
+    tileRows = min(tileRows, numRows);
+    CaretLogInfo("building column cache for '" + sourceFile + "' in '" + s_cacheDir + "'");
+    CacheFileWriter writer(cacheName);
+    CacheHeader header;
+    fillHeader(header, sourceFile, numRows, numCols, tileRows);
+    vector<char> headerBytes(HEADER_SIZE, 0);
+    memcpy(headerBytes.data(), &header, sizeof(CacheHeader));
+    writer.write(headerBytes.data(), HEADER_SIZE);
+    vector<float> row(numCols), panel(tileRows * numCols);
+    vector<int64_t> indexSelect(1);
+    for (int64_t panelStart = 0; panelStart < numRows; panelStart += tileRows)
+    {
+        int64_t panelRows = min(tileRows, numRows - panelStart);
+        for (int64_t r = 0; r < panelRows; ++r)
+        {
+            indexSelect[0] = panelStart + r;
+            source->getRow(row.data(), indexSelect, false);
+            for (int64_t c = 0; c < numCols; ++c)
+            {
+                panel[c * panelRows + r] = row[c];
+            }
+        }
+        int64_t panelBytes = panelRows * numCols * sizeof(float);
+        writer.write(panel.data(), panelBytes);
+        if (!writer.isGood()) throw DataFileException("error writing column cache file: " + writer.getErrorString());
+    }
+    if (!writer.finish()) throw DataFileException("error writing column cache file: " + writer.getErrorString());
+}
+
+CaretPointer<CiftiColumnCache> CiftiColumnCache::openOrBuild(const QString& sourceFile, const CiftiFile::ReadImplInterface* source, const int64_t& numRows, const int64_t& numCols)
+{
+    CaretPointer<CiftiColumnCache> ret;
+    if (s_cacheDir == "" || numRows < 1 || numCols < 1) return ret;
+    QString cacheName = getCacheName(sourceFile);
+    ret.grabNew(new CiftiColumnCache());
+    if (openExisting(*ret, cacheName, sourceFile, numRows, numCols)) return ret;
+    if (s_maxBytes > 0 && numRows * numCols * (int64_t)sizeof(float) > s_maxBytes)
+    {
+        CaretLogFine("not building column cache for '" + sourceFile + "', it would be larger than the size limit");
+        ret.grabNew(NULL);
+        return ret;
+    }
+    try
+    {
+        if (!QDir().mkpath(s_cacheDir)) throw DataFileException("unable to create directory '" + s_cacheDir + "'");
+        build(cacheName, sourceFile, source, numRows, numCols);
+    } catch (DataFileException& e) {//caching is an optimization, fall back to reading the original file
+        CaretLogWarning("failed to build column cache for '" + sourceFile + "': " + e.whatString());
+        ret.grabNew(NULL);
+        return ret;
+    }
+    if (!openExisting(*ret, cacheName, sourceFile, numRows, numCols))
+    {
+        ret.grabNew(NULL);
+    }
+    return ret;
+}
+
+void CiftiColumnCache::getColumn(float* dataOut, const int64_t& index)
+{
+    CaretAssert(index >= 0 && index < m_numCols);
+    for (int64_t panelStart = 0; panelStart < m_numRows; panelStart += m_tileRows)
+    {
+        int64_t panelRows = min(m_tileRows, m_numRows - panelStart);
+        int64_t offset = HEADER_SIZE + (panelStart * m_numCols + index * panelRows) * (int64_t)sizeof(float);
+        m_file.readAt(offset, dataOut + panelStart, panelRows * sizeof(float));
+    }
+}
+
+bool CiftiColumnCacheOnDemand::getColumn(float* dataOut, const int64_t& index, const QString& sourceFile, const CiftiFile::ReadImplInterface* source,
+                                         const int64_t& numRows, const int64_t& numCols)
+{
+    CaretPointer<CiftiColumnCache> myCache;
+    {
+        CaretMutexLocker locked(&m_mutex);
+        switch (m_state)
+        {
+            case NOT_TRIED:
+                if (CiftiColumnCache::getCacheDirectory() == "") return false;
+                m_state = BUILDING;//only try once, if it fails, openOrBuild logs a warning and we use the slow method
+                break;
+            case BUILDING:
+                return false;//don't wait on another thread's build, transposing a large file takes a while
+            case DONE:
+                if (m_cache == NULL) return false;
+                myCache = m_cache;
+                break;
+        }
+    }
+    if (myCache == NULL)
+    {//we set BUILDING above, so build it without holding the lock
+        try
+        {
+            myCache = CiftiColumnCache::openOrBuild(sourceFile, source, numRows, numCols);
+        } catch (...) {
+            CaretMutexLocker locked(&m_mutex);
+            m_state = DONE;
+            throw;
+        }
+        CaretMutexLocker locked(&m_mutex);
+        m_cache = myCache;
+        m_state = DONE;
+        if (myCache == NULL) return false;
+    }
+    myCache->getColumn(dataOut, index);
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef __CIFTI_COLUMN_CACHE_H__
+#define __CIFTI_COLUMN_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBinaryFile.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+#include "CiftiFile.h"
+
+#include <QString>
+
+#include <stdint.h>
+
+namespace caret
+{
+    ///transposed copy of a 2D on-disk cifti matrix, so that getColumn doesn't need one read per row
+    ///the cache file stores panels of consecutive rows, each panel column-major, so a column is one contiguous read per panel,
+    ///and building it only needs one panel of rows in memory
+    class CiftiColumnCache
+    {
+        CaretBinaryFile m_file;
+        int64_t m_numRows, m_numCols, m_tileRows;
+        CiftiColumnCache() { m_numRows = 0; m_numCols = 0; m_tileRows = 0; }
+        static QString s_cacheDir;
+        static int64_t s_tileRows, s_maxBytes;
+        static QString getCacheName(const QString& sourceFile);
+        static bool openExisting(CiftiColumnCache& cache, const QString& cacheName, const QString& sourceFile, const int64_t& numRows, const int64_t& numCols);
+        static void build(const QString& cacheName, const QString& sourceFile, const CiftiFile::ReadImplInterface* source, const int64_t& numRows, const int64_t& numCols);
+    public:
+        ///directory to keep cache files in, empty (the default) disables column caching
+        static void setCacheDirectory(const QString& dir) { s_cacheDir = dir; }
+        static const QString& getCacheDirectory() { return s_cacheDir; }
+        ///rows per panel, larger makes columns faster, but building uses tileRows * numCols floats of memory, 0 (default) chooses based on row length
+        static void setTileRows(const int64_t& tileRows) { s_tileRows = tileRows; }
+        ///don't build caches larger than this many bytes (existing caches are still used), 0 (default) is unlimited
+        static void setMaximumBytes(const int64_t& maxBytes) { s_maxBytes = maxBytes; }
+        ///returns a valid cache for the file, building one if needed, or NULL if caching is disabled or the cache can't be created
+        static CaretPointer<CiftiColumnCache> openOrBuild(const QString& sourceFile, const CiftiFile::ReadImplInterface* source, const int64_t& numRows, const int64_t& numCols);
+        ///safe to call from multiple threads
+        void getColumn(float* dataOut, const int64_t& index);
+    };
+
+    ///cache for one open file that is built the first time a column is requested
+    ///the build happens without holding the lock, other threads asking for columns meanwhile read the original file instead of waiting
+    class CiftiColumnCacheOnDemand
+    {
+        enum State
+        {
+            NOT_TRIED,
+            BUILDING,
+            DONE
+        };
+        CaretPointer<CiftiColumnCache> m_cache;
+        State m_state;
+        CaretMutex m_mutex;
+        CiftiColumnCacheOnDemand(const CiftiColumnCacheOnDemand&);
+        CiftiColumnCacheOnDemand& operator=(const CiftiColumnCacheOnDemand&);
+    public:
+        CiftiColumnCacheOnDemand() { m_state = NOT_TRIED; }
+        ///returns false if caching is disabled, failed, or is still being built by another thread, in which case dataOut is untouched
+        bool getColumn(float* dataOut, const int64_t& index, const QString& sourceFile, const CiftiFile::ReadImplInterface* source,
+                       const int64_t& numRows, const int64_t& numCols);
+    };
+}
+
+#endif //__CIFTI_COLUMN_CACHE_H__
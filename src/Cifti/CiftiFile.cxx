@@ -24,6 +24,8 @@
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CiftiColumnCache.h"
+#include "CiftiQuantizedFile.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
@@ -40,11 +42,14 @@ namespace
     {
         mutable NiftiIO m_nifti;//because file objects aren't stateless (current position), so reading "changes" them
         CiftiXML m_xml;//because we need to parse it to set up the dimensions anyway
+        bool m_readOnly;//column cache is only valid if the file can't change under us
+        mutable CiftiColumnCacheOnDemand m_columnCache;//built on the first getColumn, if a cache directory is set
     public:
-        CiftiOnDiskImpl(const QString& filename);//read-only
+        CiftiOnDiskImpl(const QString& filename, const bool& memoryMap = false);//read-only
         CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
@@ -60,10 +65,24 @@ namespace
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
         bool isInMemory() const { return true; }
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const { return m_array.get(1, indexSelect); }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
     };
     
+    class CiftiQuantizedImpl : public CiftiFile::ReadImplInterface
+    {
+        CiftiQuantizedFile m_file;
+        QString m_filename;
+        mutable CiftiColumnCacheOnDemand m_columnCache;
+    public:
+        CiftiQuantizedImpl(const QString& filename);//read-only, writing is done with CiftiQuantizedFileWriter
+        void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
+        void getColumn(float* dataOut, const int64_t& index) const;
+        const CiftiXML& getCiftiXML() const { return m_file.getCiftiXML(); }
+        QString getFilename() const { return m_filename; }
+    };
+    
     class CiftiXnatImpl : public CiftiFile::ReadImplInterface
     {
         CiftiXML m_xml;//because we need to parse it to check the dimensions anyway
@@ -111,14 +130,21 @@ CiftiFile::CiftiFile(const QString& fileName)
     openFile(fileName);
 }
 
-void CiftiFile::openFile(const QString& fileName)
+void CiftiFile::openFile(const QString& fileName, const bool& memoryMap)
 {
     m_writingImpl.grabNew(NULL);
     m_readingImpl.grabNew(NULL);//to make sure it closes everything first, even if the open throws
     m_dims.clear();
-    CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(FileInformation(fileName).getAbsoluteFilePath()));//this constructor opens existing file read-only
-    m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
-    m_xml = newRead->getCiftiXML();
+    if (CiftiQuantizedFile::isQuantizedFileName(fileName))
+    {//quantized files decode rows as they are read, so memoryMap doesn't apply
+        CaretPointer<CiftiQuantizedImpl> newRead(new CiftiQuantizedImpl(FileInformation(fileName).getAbsoluteFilePath()));
+        m_readingImpl = newRead;
+        m_xml = newRead->getCiftiXML();
+    } else {
+        CaretPointer<CiftiOnDiskImpl> newRead(new CiftiOnDiskImpl(FileInformation(fileName).getAbsoluteFilePath(), memoryMap));//this constructor opens existing file read-only
+        m_readingImpl = newRead;//it should be noted that if the constructor throws (if the file isn't readable), new guarantees the memory allocated for the object will be freed
+        m_xml = newRead->getCiftiXML();
+    }
     m_dims = m_xml.getDimensions();
     m_onDiskVersion = m_xml.getParsedVersion();
     m_fileName = fileName;
@@ -150,6 +176,7 @@ void CiftiFile::openURL(const QString& url)
 
 void CiftiFile::setWritingFile(const QString& fileName, const CiftiVersion& writingVersion, const ENDIAN& endian)
 {
+    if (CiftiQuantizedFile::isQuantizedFileName(fileName)) throw DataFileException("quantized cifti file '" + fileName + "' cannot be written with on-disk writing, use wb_command -cifti-convert -to-wbquant");
     m_writingFile = FileInformation(fileName).getAbsoluteFilePath();//always resolve paths as soon as they enter CiftiFile, in case some clown changes directory before writing data
     m_writingImpl.grabNew(NULL);//prevent writing to previous writing implementation, let the next set...() set up for writing
     m_onDiskVersion = writingVersion;//so that we can do on-disk writing with the old version
@@ -160,6 +187,7 @@ void CiftiFile::setWritingFile(const QString& fileName, const CiftiVersion& writ
 void CiftiFile::writeFile(const QString& fileName, const CiftiVersion& writingVersion, const ENDIAN& endian)
 {
     if (m_readingImpl == NULL || m_dims.empty()) throw DataFileException("writeFile called on uninitialized CiftiFile");
+    if (CiftiQuantizedFile::isQuantizedFileName(fileName)) throw DataFileException("quantized cifti file '" + fileName + "' cannot be written as nifti, use wb_command -cifti-convert -to-wbquant");
     bool writeSwapped = shouldSwap(endian);
     FileInformation myInfo(fileName);
     QString canonicalFilename = myInfo.getCanonicalFilePath();//NOTE: returns EMPTY STRING for nonexistant file
@@ -224,6 +252,20 @@ void CiftiFile::getColumn(float* dataOut, const int64_t& index) const
     m_readingImpl->getColumn(dataOut, index);
 }
 
+const float* CiftiFile::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_readingImpl == NULL) return NULL;
+    return m_readingImpl->getRowPointer(indexSelect);
+}
+
+const float* CiftiFile::getRowPointer(const int64_t& index) const
+{
+    if (m_dims.empty()) throw DataFileException("getRowPointer called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRowPointer with single index called on non-2D CiftiFile");
+    return getRowPointer(vector<int64_t>(1, index));
+}
+
 void CiftiFile::setCiftiXML(const CiftiXML& xml, const bool useOldMetadata)
 {
     if (xml.getNumberOfDimensions() == 0) throw DataFileException("setCiftiXML called with 0-dimensional CiftiXML");
@@ -424,9 +466,10 @@ void CiftiMemoryImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
-CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
+CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const bool& memoryMap)
 {//opens existing file for reading
-    m_nifti.openRead(filename);//read-only, so we don't need write permission to read a cifti file
+    m_readOnly = true;
+    m_nifti.openRead(filename, memoryMap);//read-only, so we don't need write permission to read a cifti file
     if (m_nifti.getNumComponents() != 1) throw DataFileException("complex or rgb datatype found in file '" + filename + "', these are not supported in cifti");
     const NiftiHeader& myHeader = m_nifti.getHeader();
     int numExts = (int)myHeader.m_extensions.size(), whichExt = -1;
@@ -572,6 +615,7 @@ namespace
 
 CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename, const CiftiXML& xml, const CiftiVersion& version, const bool& swapEndian)
 {//starts writing new file
+    m_readOnly = false;
     warnForBadExtension(filename, xml);
     NiftiHeader outHeader;
     outHeader.setDataType(NIFTI_TYPE_FLOAT32);//actually redundant currently, default is float32
@@ -613,14 +657,23 @@ void CiftiOnDiskImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     m_nifti.readData(dataOut, 5, indexSelect, tolerateShortRead);//5 means 4 reserved (space and time) plus the first cifti dimension
 }
 
+const float* CiftiOnDiskImpl::getRowPointer(const vector<int64_t>& indexSelect) const
+{
+    return m_nifti.getMappedFloatData(5, indexSelect);//NULL unless the file is mapped and is native float32
+}
+
 void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_xml.getNumberOfDimensions() == 2);//otherwise this shouldn't be called
     CaretAssert(index >= 0 && index < m_xml.getDimensionLength(CiftiXML::ALONG_ROW));
+    int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    if (m_readOnly && m_columnCache.getColumn(dataOut, index, getFilename(), this, colLength, m_xml.getDimensionLength(CiftiXML::ALONG_ROW)))
+    {
+        return;
+    }
     CaretLogFine("getColumn called on CiftiOnDiskImpl, this will be slow");//generate logging messages at a low priority
     vector<int64_t> indexSelect(2);
     indexSelect[0] = index;
-    int64_t colLength = m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
     for (int64_t i = 0; i < colLength; ++i)//assume if they really want getColumn on disk, they don't want their pagecache obliterated, so read it 1 element at a time
     {
         indexSelect[1] = i;
@@ -648,6 +701,35 @@ void CiftiOnDiskImpl::setColumn(const float* dataIn, const int64_t& index)
     }
 }
 
+CiftiQuantizedImpl::CiftiQuantizedImpl(const QString& filename)
+{
+    m_file.openFile(filename);
+    m_filename = filename;
+}
+
+void CiftiQuantizedImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect, const bool&) const
+{
+    CaretAssert(indexSelect.size() == 1);//quantized files are always 2D
+    m_file.getRow(dataOut, indexSelect[0]);
+}
+
+void CiftiQuantizedImpl::getColumn(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(index >= 0 && index < m_file.getRowLength());
+    int64_t colLength = m_file.getNumberOfRows();
+    if (m_columnCache.getColumn(dataOut, index, m_filename, this, colLength, m_file.getRowLength()))
+    {
+        return;
+    }
+    CaretLogFine("getColumn called on CiftiQuantizedImpl, this will be slow");
+    vector<float> scratchRow(m_file.getRowLength());//rows are the smallest unit that can be decoded
+    for (int64_t i = 0; i < colLength; ++i)
+    {
+        m_file.getRow(scratchRow.data(), i);
+        dataOut[i] = scratchRow[index];
+    }
+}
+
 CiftiXnatImpl::CiftiXnatImpl(const QString& url, const QString& user, const QString& pass)
 {
     CaretHttpManager::setAuthentication(url, user, pass);
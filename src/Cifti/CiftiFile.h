@@ -47,7 +47,7 @@ namespace caret
 
         CiftiFile() { m_endianPref = NATIVE; }
         explicit CiftiFile(const QString &fileName);//calls openFile
-        void openFile(const QString& fileName);//starts on-disk reading
+        void openFile(const QString& fileName, const bool& memoryMap = false);//starts on-disk reading, memoryMap allows lock-free reads and getRowPointer() on uncompressed files
         void openURL(const QString& url, const QString& user, const QString& pass);//open from XNAT
         void openURL(const QString& url);//same, without user/pass (or curently, reusing existing auth if the server matches
         void setWritingFile(const QString& fileName, const CiftiVersion& writingVersion = CiftiVersion(), const ENDIAN& endian = NATIVE);//starts on-disk writing
@@ -63,6 +63,9 @@ namespace caret
             return MultiDimIterator<int64_t>(std::vector<int64_t>(m_dims.begin() + 1, m_dims.end()));
         }
         void getColumn(float* dataOut, const int64_t& index) const;//for 2D only, will be slow if on disk!
+        ///pointer to the row data without copying, NULL if not available (only in-memory, or memory mapped native-endian unscaled float32) - invalidated by any set...() or write call
+        const float* getRowPointer(const std::vector<int64_t>& indexSelect) const;
+        const float* getRowPointer(const int64_t& index) const;//2D only
         
         void setCiftiXML(const CiftiXML& xml, const bool useOldMetadata = true);
         void setCiftiXML(const CiftiXMLOld &xml, const bool useOldMetadata = true);//set xml from old implementation
@@ -82,6 +85,7 @@ namespace caret
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
             virtual bool isInMemory() const { return false; }
+            virtual const float* getRowPointer(const std::vector<int64_t>&) const { return NULL; }
             virtual ~ReadImplInterface();
         };
         //assume if you can write to it, you can also read from it
@@ -0,0 +1,471 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiQuantizedFile.h"
+
+#include "ByteSwapping.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataCompressZLib.h"
+#include "DataFileException.h"
+#include "Float16Helper.h"
+#include "MathFunctions.h"
+
+#include <QFile>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+//SSE2 is part of the x86-64 baseline, so no runtime dispatch is needed for decoding
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CIFTI_QUANTIZED_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const char magic[] = "\0\0\0\0cqt\0";
+    const int32_t FORMAT_VERSION = 1;
+    const int32_t FLAG_COMPRESSED = 1;
+    const int64_t HEADER_FIXED_SIZE = 8 + 4 * sizeof(int32_t) + 2 * sizeof(int64_t);//magic, version, encoding, flags, reserved, dims
+    const int64_t ROW_PARAMS_SIZE = 2 * sizeof(float);//scale and offset at the start of each row record
+    
+    int32_t getMaxCode(const CiftiQuantizedFile::Encoding& encoding)
+    {
+        switch (encoding)
+        {
+            case CiftiQuantizedFile::INT8:
+                return 127;
+            case CiftiQuantizedFile::INT16:
+                return 32767;
+            default:
+                CaretAssert(false);
+                return 0;
+        }
+    }
+    
+#ifdef CIFTI_QUANTIZED_USE_SSE2
+    //codes and NaN mask are 4 int32 lanes
+    inline void storeScaled(const __m128i& codes, const __m128i& nanMask, const __m128& scale, const __m128& offset, float* out)
+    {
+        __m128 values = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(codes), scale), offset);
+        _mm_storeu_ps(out, _mm_or_ps(values, _mm_castsi128_ps(nanMask)));//all bits set is a NaN
+    }
+#endif
+    
+    void decodeInt8(const int8_t* codes, const int64_t& count, const float& scale, const float& offset, float* out)
+    {
+        int64_t i = 0;
+#ifdef CIFTI_QUANTIZED_USE_SSE2
+        const __m128i nanCode = _mm_set1_epi8(-128);
+        const __m128 scaleVec = _mm_set1_ps(scale), offsetVec = _mm_set1_ps(offset);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i raw = _mm_loadu_si128((const __m128i*)(codes + i));
+            __m128i isNan = _mm_cmpeq_epi8(raw, nanCode);
+            //sign extend by unpacking each byte with itself and shifting arithmetically
+            __m128i low16 = _mm_srai_epi16(_mm_unpacklo_epi8(raw, raw), 8), high16 = _mm_srai_epi16(_mm_unpackhi_epi8(raw, raw), 8);
+            __m128i lowNan16 = _mm_unpacklo_epi8(isNan, isNan), highNan16 = _mm_unpackhi_epi8(isNan, isNan);
+            storeScaled(_mm_srai_epi32(_mm_unpacklo_epi16(low16, low16), 16), _mm_unpacklo_epi16(lowNan16, lowNan16), scaleVec, offsetVec, out + i);
+            storeScaled(_mm_srai_epi32(_mm_unpackhi_epi16(low16, low16), 16), _mm_unpackhi_epi16(lowNan16, lowNan16), scaleVec, offsetVec, out + i + 4);
+            storeScaled(_mm_srai_epi32(_mm_unpacklo_epi16(high16, high16), 16), _mm_unpacklo_epi16(highNan16, highNan16), scaleVec, offsetVec, out + i + 8);
+            storeScaled(_mm_srai_epi32(_mm_unpackhi_epi16(high16, high16), 16), _mm_unpackhi_epi16(highNan16, highNan16), scaleVec, offsetVec, out + i + 12);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            if (codes[i] == -128)
+            {
+                out[i] = numeric_limits<float>::quiet_NaN();
+            } else {
+                out[i] = ((float)codes[i]) * scale + offset;
+            }
+        }
+    }
+    
+    void decodeInt16(const int16_t* codes, const int64_t& count, const float& scale, const float& offset, float* out)
+    {
+        int64_t i = 0;
+#ifdef CIFTI_QUANTIZED_USE_SSE2
+        const __m128i nanCode = _mm_set1_epi16(-32768);
+        const __m128 scaleVec = _mm_set1_ps(scale), offsetVec = _mm_set1_ps(offset);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i raw = _mm_loadu_si128((const __m128i*)(codes + i));
+            __m128i isNan = _mm_cmpeq_epi16(raw, nanCode);
+            storeScaled(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16), _mm_unpacklo_epi16(isNan, isNan), scaleVec, offsetVec, out + i);
+            storeScaled(_mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16), _mm_unpackhi_epi16(isNan, isNan), scaleVec, offsetVec, out + i + 4);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            if (codes[i] == -32768)
+            {
+                out[i] = numeric_limits<float>::quiet_NaN();
+            } else {
+                out[i] = ((float)codes[i]) * scale + offset;
+            }
+        }
+    }
+    
+    //quantize one row into little endian codes, returns scale and offset
+    void encodeRow(const float* row, const int64_t& count, const CiftiQuantizedFile::Encoding& encoding, char* codesOut, float& scaleOut, float& offsetOut)
+    {
+        if (encoding == CiftiQuantizedFile::FLOAT16)
+        {
+            uint16_t* halves = (uint16_t*)codesOut;
+            Float16Helper::toFloat16(row, count, halves);
+            if (ByteSwapping::isBigEndian()) ByteSwapping::swapBytes(halves, count);
+            scaleOut = 1.0f;
+            offsetOut = 0.0f;
+            return;
+        }
+        bool haveFinite = false;
+        double minVal = 0.0, maxVal = 0.0;
+        for (int64_t i = 0; i < count; ++i)
+        {
+            if (MathFunctions::isNumeric(row[i]))
+            {
+                if (!haveFinite)
+                {
+                    minVal = row[i];
+                    maxVal = row[i];
+                    haveFinite = true;
+                } else {
+                    if (row[i] < minVal) minVal = row[i];
+                    if (row[i] > maxVal) maxVal = row[i];
+                }
+            }
+        }
+        const int32_t maxCode = getMaxCode(encoding);
+        offsetOut = (float)((minVal + maxVal) / 2.0);
+        scaleOut = (float)((maxVal - minVal) / (2.0 * maxCode));
+        double invScale = (scaleOut > 0.0f ? 1.0 / scaleOut : 0.0);//use the stored float values, so rounding matches what decode will do
+        for (int64_t i = 0; i < count; ++i)
+        {
+            int32_t code;
+            if (row[i] != row[i])
+            {
+                code = -maxCode - 1;
+            } else if (!MathFunctions::isNumeric(row[i])) {//infinities are clamped to the range of the finite values, checked first because infinity times a zero invScale is NaN
+                code = (row[i] > 0.0f ? maxCode : -maxCode);
+            } else {
+                double scaled = (row[i] - (double)offsetOut) * invScale;
+                if (scaled >= maxCode)
+                {
+                    code = maxCode;
+                } else if (scaled <= -maxCode) {
+                    code = -maxCode;
+                } else {
+                    code = (int32_t)floor(scaled + 0.5);
+                }
+            }
+            if (encoding == CiftiQuantizedFile::INT8)
+            {
+                ((int8_t*)codesOut)[i] = (int8_t)code;
+            } else {
+                ((int16_t*)codesOut)[i] = (int16_t)code;
+            }
+        }
+        if (encoding == CiftiQuantizedFile::INT16 && ByteSwapping::isBigEndian()) ByteSwapping::swapBytes((int16_t*)codesOut, count);
+    }
+    
+    //group the low bytes of 2-byte codes before the high bytes, which compresses much better since the high bytes of neighbors are similar
+    void shuffleBytes(const char* in, const int64_t& numValues, char* out)
+    {
+        for (int64_t i = 0; i < numValues; ++i)
+        {
+            out[i] = in[2 * i];
+            out[numValues + i] = in[2 * i + 1];
+        }
+    }
+    
+    void unshuffleBytes(const char* in, const int64_t& numValues, char* out)
+    {
+        for (int64_t i = 0; i < numValues; ++i)
+        {
+            out[2 * i] = in[i];
+            out[2 * i + 1] = in[numValues + i];
+        }
+    }
+}
+
+int64_t CiftiQuantizedFile::getBytesPerValue(const Encoding& encoding)
+{
+    switch (encoding)
+    {
+        case INT8:
+            return 1;
+        case INT16:
+        case FLOAT16:
+            return 2;
+    }
+    CaretAssert(false);
+    return 0;
+}
+
+bool CiftiQuantizedFile::encodingFromName(const QString& name, Encoding& encodingOut)
+{
+    if (name == "INT8")
+    {
+        encodingOut = INT8;
+    } else if (name == "INT16") {
+        encodingOut = INT16;
+    } else if (name == "FLOAT16") {
+        encodingOut = FLOAT16;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+CiftiQuantizedFile::CiftiQuantizedFile(const QString& fileName)
+{
+    openFile(fileName);
+}
+
+void CiftiQuantizedFile::openFile(const QString& fileName)
+{
+    m_file.close();
+    m_dims[0] = 0;
+    m_dims[1] = 0;
+    m_rowOffsets.clear();
+    if (fileName.endsWith(".gz"))
+    {
+        throw DataFileException("quantized cifti files cannot be read while gzipped, use the -compress option when writing them instead");
+    }
+    m_file.open(fileName);
+    int64_t fileSize = m_file.size();
+    char magicBuf[8];
+    m_file.read(magicBuf, 8);
+    for (int i = 0; i < 8; ++i)
+    {
+        if (magicBuf[i] != magic[i]) throw DataFileException("file '" + fileName + "' has the wrong magic string for a quantized cifti file");
+    }
+    int32_t header[4];//version, encoding, flags, reserved
+    m_file.read(header, 4 * sizeof(int32_t));
+    m_file.read(m_dims, 2 * sizeof(int64_t));
+    if (ByteSwapping::isBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+        ByteSwapping::swapBytes(m_dims, 2);
+    }
+    if (header[0] != FORMAT_VERSION) throw DataFileException("quantized cifti file '" + fileName + "' has unsupported version " + QString::number(header[0]));
+    if (header[1] != INT8 && header[1] != INT16 && header[1] != FLOAT16) throw DataFileException("quantized cifti file '" + fileName + "' has unknown encoding " + QString::number(header[1]));
+    if ((header[2] & ~FLAG_COMPRESSED) != 0) throw DataFileException("quantized cifti file '" + fileName + "' has unknown flags set");
+    m_encoding = (Encoding)header[1];
+    m_compressed = ((header[2] & FLAG_COMPRESSED) != 0);
+    if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
+    int64_t headerSize = HEADER_FIXED_SIZE + (m_dims[1] + 1) * sizeof(int64_t);
+    if (fileSize >= 0 && headerSize > fileSize) throw DataFileException("file is truncated");
+    m_rowOffsets.resize(m_dims[1] + 1);
+    m_file.read(m_rowOffsets.data(), (m_dims[1] + 1) * sizeof(int64_t));
+    if (ByteSwapping::isBigEndian())
+    {
+        ByteSwapping::swapBytes(m_rowOffsets.data(), m_rowOffsets.size());
+    }
+    if (m_rowOffsets[0] != headerSize) throw DataFileException("impossible value found in row offset index");
+    int64_t rawRecordSize = ROW_PARAMS_SIZE + m_dims[0] * getBytesPerValue(m_encoding);
+    for (int64_t i = 0; i < m_dims[1]; ++i)
+    {
+        int64_t recordSize = m_rowOffsets[i + 1] - m_rowOffsets[i];
+        if (recordSize <= ROW_PARAMS_SIZE || recordSize > rawRecordSize || (!m_compressed && recordSize != rawRecordSize))
+        {
+            throw DataFileException("impossible value found in row offset index");
+        }
+    }
+    int64_t xmlOffset = m_rowOffsets[m_dims[1]];
+    if (fileSize >= 0 && xmlOffset >= fileSize) throw DataFileException("file is truncated");
+    int64_t xmlLength = fileSize - xmlOffset;
+    QByteArray xmlBytes(xmlLength, '\0');
+    m_file.seek(xmlOffset);
+    m_file.read(xmlBytes.data(), xmlLength);
+    m_xml.readXML(xmlBytes);
+    if (m_xml.getNumberOfDimensions() != 2 || m_xml.getDimensionLength(CiftiXML::ALONG_ROW) != m_dims[0] || m_xml.getDimensionLength(CiftiXML::ALONG_COLUMN) != m_dims[1])
+    {
+        throw DataFileException("cifti XML doesn't match dimensions of quantized cifti file");
+    }
+}
+
+void CiftiQuantizedFile::getRow(float* dataOut, const int64_t& index) const
+{
+    CaretAssert(index >= 0 && index < m_dims[1]);
+    int64_t recordSize = m_rowOffsets[index + 1] - m_rowOffsets[index];
+    int64_t codesSize = m_dims[0] * getBytesPerValue(m_encoding);
+    vector<char> record(recordSize);//local buffers, so concurrent calls don't interfere
+    m_file.readAt(m_rowOffsets[index], record.data(), recordSize);
+    float params[2];//scale, offset
+    memcpy(params, record.data(), ROW_PARAMS_SIZE);
+    if (ByteSwapping::isBigEndian()) ByteSwapping::swapBytes(params, 2);
+    const char* codes = record.data() + ROW_PARAMS_SIZE;
+    vector<char> decompressed, unshuffled;
+    if (recordSize - ROW_PARAMS_SIZE != codesSize)
+    {//rows that didn't get smaller are stored uncompressed
+        CaretAssert(m_compressed);
+        decompressed.resize(codesSize);
+        DataCompressZLib myZLib;
+        if (myZLib.uncompressData((const unsigned char*)codes, recordSize - ROW_PARAMS_SIZE, (unsigned char*)decompressed.data(), codesSize) != (uint64_t)codesSize)
+        {
+            throw DataFileException("error decompressing row " + QString::number(index) + " of quantized cifti file '" + m_file.getFilename() + "'");
+        }
+        codes = decompressed.data();
+        if (getBytesPerValue(m_encoding) == 2)
+        {
+            unshuffled.resize(codesSize);
+            unshuffleBytes(codes, m_dims[0], unshuffled.data());
+            codes = unshuffled.data();
+        }
+    }
+    if (getBytesPerValue(m_encoding) == 2 && ByteSwapping::isBigEndian())
+    {
+        if (unshuffled.empty()) unshuffled.assign(codes, codes + codesSize);
+        ByteSwapping::swapBytes((uint16_t*)unshuffled.data(), m_dims[0]);
+        codes = unshuffled.data();
+    }
+    switch (m_encoding)
+    {
+        case INT8:
+            decodeInt8((const int8_t*)codes, m_dims[0], params[0], params[1], dataOut);
+            break;
+        case INT16:
+            decodeInt16((const int16_t*)codes, m_dims[0], params[0], params[1], dataOut);
+            break;
+        case FLOAT16:
+            Float16Helper::fromFloat16((const uint16_t*)codes, m_dims[0], dataOut);
+            break;
+    }
+}
+
+CiftiQuantizedFileWriter::CiftiQuantizedFileWriter(const QString& fileName, const CiftiXML& xml, const CiftiQuantizedFile::Encoding& encoding, const bool& compress)
+{
+    m_finished = false;
+    if (!CiftiQuantizedFile::isQuantizedFileName(fileName))
+    {
+        CaretLogWarning("quantized cifti file '" + fileName + "' should be saved ending in .wbquant, or it will not be recognized when reading");
+    }
+    if (fileName.endsWith(".gz"))
+    {
+        throw DataFileException("quantized cifti files cannot be written gzipped");
+    }//because after we finish writing the data, we have to come back and write the row index
+    if (xml.getNumberOfDimensions() != 2) throw DataFileException("quantized cifti files must be 2D");
+    m_dims[0] = xml.getDimensionLength(CiftiXML::ALONG_ROW);
+    m_dims[1] = xml.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    if (m_dims[0] < 1 || m_dims[1] < 1) throw DataFileException("both dimensions must be positive");
+    m_xml = xml;
+    m_encoding = encoding;
+    m_compressed = compress;
+    m_file.open(fileName, CaretBinaryFile::WRITE_TRUNCATE);
+    m_file.write(magic, 8);
+    int32_t header[4] = { FORMAT_VERSION, (int32_t)encoding, (compress ? FLAG_COMPRESSED : 0), 0 };
+    int64_t tempDims[2] = { m_dims[0], m_dims[1] };
+    if (ByteSwapping::isBigEndian())
+    {
+        ByteSwapping::swapBytes(header, 4);
+        ByteSwapping::swapBytes(tempDims, 2);
+    }
+    m_file.write(header, 4 * sizeof(int32_t));
+    m_file.write(tempDims, 2 * sizeof(int64_t));
+    m_rowOffsets.resize(m_dims[1] + 1, 0);
+    m_file.write(m_rowOffsets.data(), m_rowOffsets.size() * sizeof(int64_t));//placeholder, written again in finish()
+    m_curOffset = HEADER_FIXED_SIZE + (m_dims[1] + 1) * sizeof(int64_t);
+    m_nextRowIndex = 0;
+}
+
+void CiftiQuantizedFileWriter::writeOneRow(const float* row)
+{
+    int64_t codesSize = m_dims[0] * CiftiQuantizedFile::getBytesPerValue(m_encoding);
+    m_scratchCodes.resize(codesSize);
+    float params[2];
+    encodeRow(row, m_dims[0], m_encoding, m_scratchCodes.data(), params[0], params[1]);
+    const char* payload = m_scratchCodes.data();
+    int64_t payloadSize = codesSize;
+    if (m_compressed)
+    {
+        const char* toCompress = m_scratchCodes.data();
+        if (CiftiQuantizedFile::getBytesPerValue(m_encoding) == 2)
+        {
+            m_scratchShuffled.resize(codesSize);
+            shuffleBytes(m_scratchCodes.data(), m_dims[0], m_scratchShuffled.data());
+            toCompress = m_scratchShuffled.data();
+        }
+        DataCompressZLib myZLib;
+        uint64_t space = myZLib.getMaximumCompressionSpace(codesSize);
+        m_scratchCompressed.resize(space);
+        uint64_t compressedSize = myZLib.compressData((const unsigned char*)toCompress, codesSize, (unsigned char*)m_scratchCompressed.data(), space);
+        if (compressedSize > 0 && (int64_t)compressedSize < codesSize)
+        {
+            payload = m_scratchCompressed.data();
+            payloadSize = compressedSize;
+        }//otherwise store it uncompressed, the reader tells by the size
+    }
+    if (ByteSwapping::isBigEndian()) ByteSwapping::swapBytes(params, 2);
+    m_file.write(params, ROW_PARAMS_SIZE);
+    m_file.write(payload, payloadSize);
+    m_rowOffsets[m_nextRowIndex] = m_curOffset;
+    m_curOffset += ROW_PARAMS_SIZE + payloadSize;
+    ++m_nextRowIndex;
+}
+
+void CiftiQuantizedFileWriter::writeRow(const float* row, const int64_t& index)
+{
+    if (m_finished) throw DataFileException("writeRow called on finished quantized cifti writer");
+    if (index < m_nextRowIndex || index >= m_dims[1]) throw DataFileException("quantized cifti rows must be written in order");
+    if (index > m_nextRowIndex) m_zeroRow.resize(m_dims[0], 0.0f);
+    while (m_nextRowIndex < index)
+    {
+        writeOneRow(m_zeroRow.data());
+    }
+    writeOneRow(row);
+}
+
+void CiftiQuantizedFileWriter::finish()
+{
+    if (m_finished) return;
+    if (m_nextRowIndex < m_dims[1]) m_zeroRow.resize(m_dims[0], 0.0f);
+    while (m_nextRowIndex < m_dims[1])
+    {
+        writeOneRow(m_zeroRow.data());
+    }
+    m_rowOffsets[m_dims[1]] = m_curOffset;
+    QByteArray xmlBytes = m_xml.writeXMLToQByteArray();
+    m_file.write(xmlBytes.constData(), xmlBytes.size());
+    m_file.seek(HEADER_FIXED_SIZE);
+    if (ByteSwapping::isBigEndian())
+    {
+        ByteSwapping::swapBytes(m_rowOffsets.data(), m_rowOffsets.size());
+    }
+    m_file.write(m_rowOffsets.data(), m_rowOffsets.size() * sizeof(int64_t));
+    m_file.close();
+    m_finished = true;
+}
+
+CiftiQuantizedFileWriter::~CiftiQuantizedFileWriter()
+{//don't call finish() here, it can throw, and an exception that skipped it means the rows are incomplete anyway
+    if (!m_finished)
+    {
+        QString fileName = m_file.getFilename();
+        m_file.close();//writing files are never gzipped, so this doesn't throw
+        if (!fileName.isEmpty()) QFile::remove(fileName);
+    }
+}
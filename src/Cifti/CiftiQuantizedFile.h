@@ -0,0 +1,94 @@
+#ifndef __CIFTI_QUANTIZED_FILE_H__
+#define __CIFTI_QUANTIZED_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBinaryFile.h"
+#include "CiftiXML.h"
+
+#include <QString>
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+    ///2D cifti matrix stored with each row quantized separately, for large dense connectomes where row reads are bandwidth-bound
+    ///int8 and int16 store value = offset + scale * code per row (most negative code means NaN), float16 stores the values directly
+    ///each row can optionally be zlib compressed on its own, and an index of row offsets keeps row reads to a single seek
+    class CiftiQuantizedFile
+    {
+    public:
+        enum Encoding
+        {
+            INT8 = 1,
+            INT16 = 2,
+            FLOAT16 = 3
+        };
+        CiftiQuantizedFile() { m_dims[0] = 0; m_dims[1] = 0; m_encoding = INT16; m_compressed = false; }
+        explicit CiftiQuantizedFile(const QString& fileName);//calls openFile
+        void openFile(const QString& fileName);
+        const CiftiXML& getCiftiXML() const { return m_xml; }
+        int64_t getRowLength() const { return m_dims[0]; }
+        int64_t getNumberOfRows() const { return m_dims[1]; }
+        Encoding getEncoding() const { return m_encoding; }
+        bool isCompressed() const { return m_compressed; }
+        ///safe to call from multiple threads
+        void getRow(float* dataOut, const int64_t& index) const;
+        
+        ///files are recognized by name so that CiftiFile doesn't need to sniff every file it opens
+        static bool isQuantizedFileName(const QString& fileName) { return fileName.endsWith(".wbquant"); }
+        static int64_t getBytesPerValue(const Encoding& encoding);
+        static bool encodingFromName(const QString& name, Encoding& encodingOut);
+    private:
+        mutable CaretBinaryFile m_file;//only readAt() is used, which doesn't touch the shared position
+        int64_t m_dims[2];
+        std::vector<int64_t> m_rowOffsets;//numRows + 1 entries, last is the start of the XML
+        Encoding m_encoding;
+        bool m_compressed;
+        CiftiXML m_xml;
+        CiftiQuantizedFile(const CiftiQuantizedFile&);
+        CiftiQuantizedFile& operator=(const CiftiQuantizedFile&);
+    };
+    
+    class CiftiQuantizedFileWriter
+    {
+        CaretBinaryFile m_file;
+        CiftiXML m_xml;
+        int64_t m_dims[2], m_nextRowIndex, m_curOffset;
+        std::vector<int64_t> m_rowOffsets;
+        CiftiQuantizedFile::Encoding m_encoding;
+        bool m_compressed, m_finished;
+        std::vector<char> m_scratchCodes, m_scratchShuffled, m_scratchCompressed;
+        std::vector<float> m_zeroRow;
+        void writeOneRow(const float* row);
+        CiftiQuantizedFileWriter(const CiftiQuantizedFileWriter&);
+        CiftiQuantizedFileWriter& operator=(const CiftiQuantizedFileWriter&);
+    public:
+        CiftiQuantizedFileWriter(const QString& fileName, const CiftiXML& xml, const CiftiQuantizedFile::Encoding& encoding, const bool& compress);
+        ///rows must be written in increasing order, skipped rows are written as zeros
+        void writeRow(const float* row, const int64_t& index);
+        void finish();//writes the XML and the row index, must be called explicitly
+        ~CiftiQuantizedFileWriter();//if finish() didn't complete, removes the file, as it can't be read without the row index
+    };
+}
+
+#endif //__CIFTI_QUANTIZED_FILE_H__
@@ -0,0 +1,186 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiRowPipeline.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+#include "MultiDimIterator.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+
+using namespace caret;
+using namespace std;
+
+CiftiRowPipeline::Worker::~Worker()
+{
+}
+
+namespace
+{
+    const int64_t BATCH_MEMORY = 1<<25;//32MiB per batch, three batches are in flight (reading, computing, writing)
+    const int64_t MAX_BATCH_JOBS = 4096;
+
+    ///reads or writes a contiguous range of jobs in order, can't throw out of a thread, so it saves the message instead
+    class PipelineIOThread : public QThread
+    {
+        CiftiRowPipeline::Worker& m_worker;
+        vector<vector<float> >& m_buffers;
+        int64_t m_start, m_count;
+        bool m_writing;
+    public:
+        bool m_failed;
+        AString m_message;
+        PipelineIOThread(CiftiRowPipeline::Worker& worker, vector<vector<float> >& buffers, const int64_t& start, const int64_t& count, const bool& writing) :
+            m_worker(worker), m_buffers(buffers)
+        {
+            m_start = start;
+            m_count = count;
+            m_writing = writing;
+            m_failed = false;
+        }
+        void run()
+        {
+            try
+            {
+                for (int64_t i = 0; i < m_count; ++i)
+                {
+                    if (m_writing)
+                    {
+                        m_worker.writeJob(m_start + i, m_buffers[i]);
+                    } else {
+                        m_worker.readJob(m_start + i, m_buffers[i]);
+                    }
+                }
+            } catch (CaretException& e) {
+                m_failed = true;
+                m_message = e.whatString();
+            } catch (exception& e) {
+                m_failed = true;
+                m_message = e.what();
+            } catch (...) {
+                m_failed = true;
+                m_message = "caught unknown exception type in row pipeline";
+            }
+        }
+    };
+}
+
+void CiftiRowPipeline::run(Worker& worker, const int64_t& numJobs, const int64_t& jobFloats)
+{
+    if (numJobs < 1) return;
+    const int64_t batchJobs = min(numJobs, max((int64_t)1, min(MAX_BATCH_JOBS, BATCH_MEMORY / (max((int64_t)1, jobFloats) * (int64_t)sizeof(float)))));
+    const int64_t numBatches = (numJobs + batchJobs - 1) / batchJobs;
+    const bool parallel = worker.canComputeInParallel();
+    vector<vector<float> > inputs[3], outputs[3];//batch b uses index b % 3, so batches b - 1, b, b + 1 never share buffers
+    for (int i = 0; i < 3; ++i)
+    {
+        inputs[i].resize(batchJobs);
+        outputs[i].resize(batchJobs);
+    }
+    for (int64_t i = 0; i < batchJobs; ++i)
+    {//nothing to overlap with for the first batch
+        worker.readJob(i, inputs[0][i]);
+    }
+    for (int64_t batch = 0; batch < numBatches; ++batch)
+    {
+        const int64_t batchStart = batch * batchJobs, batchCount = min(batchJobs, numJobs - batchStart);
+        const int cur = batch % 3, next = (batch + 1) % 3, prev = (batch + 2) % 3;
+        const int64_t nextStart = batchStart + batchCount, nextCount = min(batchJobs, numJobs - nextStart);
+        PipelineIOThread reader(worker, inputs[next], nextStart, nextCount, false);
+        PipelineIOThread writer(worker, outputs[prev], batchStart - batchJobs, (batch > 0 ? batchJobs : 0), true);
+        if (nextCount > 0) reader.start();
+        if (batch > 0) writer.start();
+        bool computeFailed = false;
+        AString computeMessage;
+        if (parallel)
+        {
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = 0; i < batchCount; ++i)
+            {
+                if (computeFailed) continue;//can't break out of a parallel for, or throw out of a parallel region
+                int thread = 0;
+#ifdef CARET_OMP
+                thread = omp_get_thread_num();
+#endif
+                try
+                {
+                    worker.computeJob(batchStart + i, inputs[cur][i], outputs[cur][i], thread);
+                } catch (CaretException& e) {
+#pragma omp critical
+                    {
+                        computeFailed = true;
+                        computeMessage = e.whatString();
+                    }
+                } catch (exception& e) {
+#pragma omp critical
+                    {
+                        computeFailed = true;
+                        computeMessage = e.what();
+                    }
+                } catch (...) {
+#pragma omp critical
+                    {
+                        computeFailed = true;
+                        computeMessage = "caught unknown exception type in row pipeline";
+                    }
+                }
+            }
+        } else {
+            try
+            {
+                for (int64_t i = 0; i < batchCount; ++i)
+                {
+                    worker.computeJob(batchStart + i, inputs[cur][i], outputs[cur][i], 0);
+                }
+            } catch (...) {//the io threads reference our buffers, wait for them before rethrowing
+                reader.wait();
+                writer.wait();
+                throw;
+            }
+        }
+        reader.wait();
+        writer.wait();
+        if (computeFailed) throw CaretException(computeMessage);
+        if (reader.m_failed) throw DataFileException(reader.m_message);
+        if (writer.m_failed) throw DataFileException(writer.m_message);
+    }
+    const int64_t lastStart = (numBatches - 1) * batchJobs, lastCount = numJobs - lastStart;
+    const int last = (numBatches - 1) % 3;
+    for (int64_t i = 0; i < lastCount; ++i)
+    {
+        worker.writeJob(lastStart + i, outputs[last][i]);
+    }
+}
+
+vector<vector<int64_t> > CiftiRowPipeline::getIndexList(const vector<int64_t>& dims)
+{
+    vector<vector<int64_t> > ret;
+    for (MultiDimIterator<int64_t> iter(dims); !iter.atEnd(); ++iter)
+    {
+        ret.push_back(*iter);
+    }
+    return ret;
+}
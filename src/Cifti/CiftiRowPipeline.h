@@ -0,0 +1,56 @@
+#ifndef __CIFTI_ROW_PIPELINE_H__
+#define __CIFTI_ROW_PIPELINE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+    ///runs row-by-row cifti processing as a pipeline: while one batch of rows is computed, a reading thread fetches the next batch
+    ///and a writing thread stores the previous one, in order, so disk and decompression overlap with computation
+    class CiftiRowPipeline
+    {
+    public:
+        class Worker
+        {
+        public:
+            ///called in increasing job order, from one thread at a time: the first batch from the thread that calls run(), the rest from a reading thread
+            virtual void readJob(const int64_t& job, std::vector<float>& inputOut) = 0;
+            ///called from the thread that calls run(), in an openmp parallel loop unless canComputeInParallel() returns false,
+            ///thread is less than omp_get_max_threads(), for per-thread scratch space
+            virtual void computeJob(const int64_t& job, const std::vector<float>& input, std::vector<float>& outputOut, const int& thread) = 0;
+            ///called in increasing job order, from one thread at a time, concurrently with readJob: the last batch from the thread that calls run(), the rest from a writing thread
+            virtual void writeJob(const int64_t& job, const std::vector<float>& output) = 0;
+            ///serial computation is still overlapped with reading and writing, and can use openmp internally
+            virtual bool canComputeInParallel() const { return true; }
+            virtual ~Worker();
+        };
+        ///jobFloats is the approximate size of a job's input plus output, to limit the memory used by a batch
+        static void run(Worker& worker, const int64_t& numJobs, const int64_t& jobFloats);
+        ///all index vectors of the given dimensions, in MultiDimIterator order, so jobs can be mapped to rows
+        ///for all rows of a file, use the file dimensions without the first (as getIteratorOverRows does)
+        static std::vector<std::vector<int64_t> > getIndexList(const std::vector<int64_t>& dims);
+    };
+}
+
+#endif //__CIFTI_ROW_PIPELINE_H__
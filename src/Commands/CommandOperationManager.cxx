@@ -81,6 +81,7 @@
 #include "AlgorithmMetricFillHoles.h"
 #include "AlgorithmMetricFindClusters.h"
 #include "AlgorithmMetricGradient.h"
+#include "AlgorithmMetricPermutation.h"
 #include "AlgorithmMetricReduce.h"
 #include "AlgorithmMetricRegression.h"
 #include "AlgorithmMetricRemoveIslands.h"
@@ -239,8 +240,11 @@
 #include "ProgramParameters.h"
 
 #include "CaretLogger.h"
+#include "CiftiColumnCache.h"
 #include "dot_wrapper.h"
+#include "GzipIndexedReader.h"
 #include "StructureEnum.h"
+#include "WeightCache.h"
 
 #include <iostream>
 
@@ -338,6 +342,7 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricFillHoles()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricFindClusters()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricGradient()));
+    this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricPermutation()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricReduce()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricRegression()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmMetricRemoveIslands()));
@@ -533,6 +538,18 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         if (!valid) throw CommandException("unrecognized logging level: '" + globalOptionArgs[0] + "'");
         CaretLogger::getLogger()->setLevel(level);
     }
+    if (getGlobalOption(parameters, "-cifti-column-cache", 1, globalOptionArgs))
+    {
+        CiftiColumnCache::setCacheDirectory(globalOptionArgs[0]);
+    }
+    if (getGlobalOption(parameters, "-gzip-index-files", 0, globalOptionArgs))
+    {
+#ifdef CARET_GZIP_INDEXED_READER
+        GzipIndexedReader::setUseSidecarFiles(true);
+#else
+        CaretLogWarning("-gzip-index-files requires zlib 1.2.8 or later at compile time, ignoring");
+#endif
+    }
     if (getGlobalOption(parameters, "-simd", 1, globalOptionArgs))
     {
         bool valid = false;
@@ -544,6 +561,10 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
     }
+    if (getGlobalOption(parameters, "-weight-cache", 1, globalOptionArgs))
+    {
+        WeightCache::setCacheDirectory(globalOptionArgs[0]);
+    }
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -633,6 +654,12 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
+    OptionInfo columnCacheInfo = parseGlobalOption(parameters, "-cifti-column-cache", 1, globalOptionArgs, true);
+    if (columnCacheInfo.specified && !columnCacheInfo.complete)
+    {
+        return "fileglob *";
+    }
+    parseGlobalOption(parameters, "-gzip-index-files", 0, globalOptionArgs, true);
     OptionInfo simdInfo = parseGlobalOption(parameters, "-simd", 1, globalOptionArgs, true);//the previous option doesn't take arguments, doesn't need completion testing
     if (simdInfo.specified && !simdInfo.complete)
     {//user is tab completing the logging option, and as it only takes one argument, we know what the completions are
@@ -645,7 +672,12 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    OptionInfo weightCacheInfo = parseGlobalOption(parameters, "-weight-cache", 1, globalOptionArgs, true);
+    if (weightCacheInfo.specified && !weightCacheInfo.complete)
+    {
+        return "fileglob *";
+    }
+    ret = "wordlist -cifti-column-cache\\ -disable-provenance\\ -gzip-index-files\\ -logging\\ -simd\\ -weight-cache";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -905,7 +937,16 @@ void CommandOperationManager::printHelpInfo()
     cout << "   -all-commands-help          show all processing subcommands and their help" << endl;
     cout << "                                  info - VERY LONG" << endl;
     cout << endl << "Global options (can be added to any command):" << endl;
+    cout << "   -cifti-column-cache <dir>   keep transposed copies of 2D cifti files in <dir>," << endl;
+    cout << "                                  built the first time a command needs columns" << endl;
+    cout << "                                  of an on-disk file, to speed up column access" << endl;
     cout << "   -disable-provenance         don't generate provenance info in output files" << endl;
+    cout << "   -gzip-index-files           save seek indexes for .gz input files as" << endl;
+    cout << "                                  <file>.gzidx, and use them when they exist," << endl;
+    cout << "                                  to speed up later random access" << endl;
+    cout << "   -weight-cache <dir>         save surface smoothing and resampling weights in" << endl;
+    cout << "                                  <dir>, and reuse them when later commands use" << endl;
+    cout << "                                  the same surfaces, kernel, method, and roi" << endl;
     cout << "   -logging <level>            set the logging level, valid values are:" << endl;
     vector<LogLevelEnum::Enum> logLevels;
     LogLevelEnum::getAllEnums(logLevels);
@@ -173,7 +173,11 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 {
                     FileInformation myInfo(nextArg);
                     CaretPointer<CiftiFile> myFile(new CiftiFile());
-                    myFile->openFile(nextArg);
+#ifdef CARET_OS_WINDOWS
+                    myFile->openFile(nextArg);//windows won't truncate a mapped file, which would break writing an output with the same name as an input
+#else
+                    myFile->openFile(nextArg, true);//input files are read-only, so map them when possible, to allow lock-free reads from multiple threads
+#endif
                     m_inputCiftiNames[myInfo.getCanonicalFilePath()] = myFile;//track input cifti, so we can check their size
                     if (m_doProvenance)//just an optimization, if we aren't going to write provenance, don't generate it, either
                     {
@@ -928,9 +932,10 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
             {
                 CiftiParameter* myCiftiParam = (CiftiParameter*)myParam;
                 FileInformation myInfo(outAssociation[i].m_fileName);
-                map<AString, const CiftiFile*>::iterator iter = m_inputCiftiNames.find(myInfo.getCanonicalFilePath());
+                map<AString, CiftiFile*>::iterator iter = m_inputCiftiNames.find(myInfo.getCanonicalFilePath());
                 if (iter != m_inputCiftiNames.end())
                 {
+                    iter->second->openFile(iter->second->getFileName());//reopen without memory mapping, so writing the output can't pull the pages out from under the input
                     vector<int64_t> dims = iter->second->getDimensions();
                     int64_t totalSize = sizeof(float);
                     for (int j = 0; j < (int)dims.size(); ++j)
@@ -0,0 +1,147 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Base64StreamDecoder.h"
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+namespace
+{
+    //-1 for characters that are not part of the base64 alphabet, including padding and whitespace, so the fast path only needs one test per group
+    const signed char DECODE_TABLE[256] =
+    {
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+        52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+        -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+        15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+        -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+        41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+    };
+    
+    inline bool isWhitespace(const unsigned char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+}
+
+Base64StreamDecoder::Base64StreamDecoder()
+{
+    reset();
+}
+
+void Base64StreamDecoder::reset()
+{
+    m_numPending = 0;
+    m_finished = false;
+    m_error = false;
+}
+
+int64_t Base64StreamDecoder::decode(const char* text, const int64_t& length, unsigned char* output)
+{
+    CaretAssert(length >= 0);
+    const unsigned char* input = (const unsigned char*)text;
+    int64_t position = 0, written = 0;
+    while (position < length && !m_finished && !m_error)
+    {
+        if (m_numPending == 0)
+        {//fast path: whole groups of 4 with no whitespace or padding, one branch per group, stops at the first group it can't handle
+            const int64_t groupEnd = position + (length - position) / 4 * 4;
+            while (position < groupEnd)
+            {
+                const int d0 = DECODE_TABLE[input[position]], d1 = DECODE_TABLE[input[position + 1]];
+                const int d2 = DECODE_TABLE[input[position + 2]], d3 = DECODE_TABLE[input[position + 3]];
+                if ((d0 | d1 | d2 | d3) < 0) break;
+                const uint32_t bits = ((uint32_t)d0 << 18) | ((uint32_t)d1 << 12) | ((uint32_t)d2 << 6) | (uint32_t)d3;
+                output[written] = (unsigned char)(bits >> 16);
+                output[written + 1] = (unsigned char)(bits >> 8);
+                output[written + 2] = (unsigned char)bits;
+                written += 3;
+                position += 4;
+            }
+        }
+        if (position < length)
+        {//line breaks, padding, bad characters, or the start of a group that doesn't fit in this text
+            written += decodeGroupsSlow(text, length, position, output + written);
+        }
+    }
+    return written;
+}
+
+int64_t Base64StreamDecoder::decodeGroupsSlow(const char* text, const int64_t& length, int64_t& position, unsigned char* output)
+{//handles one character at a time until it completes a group, then returns to let the fast path try again
+    const unsigned char* input = (const unsigned char*)text;
+    while (position < length)
+    {
+        const unsigned char c = input[position];
+        ++position;
+        if (isWhitespace(c)) continue;
+        if (c == '=')
+        {//padding ends the data, only valid after 2 or 3 characters of a group
+            if (m_numPending < 2)
+            {
+                m_error = true;
+                return 0;
+            }
+            m_finished = true;
+            int d0 = DECODE_TABLE[m_pending[0]], d1 = DECODE_TABLE[m_pending[1]];
+            int d2 = (m_numPending > 2 ? DECODE_TABLE[m_pending[2]] : 0);
+            uint32_t bits = ((uint32_t)d0 << 18) | ((uint32_t)d1 << 12) | ((uint32_t)d2 << 6);
+            output[0] = (unsigned char)(bits >> 16);
+            if (m_numPending == 2)
+            {
+                m_numPending = 0;
+                return 1;
+            }
+            output[1] = (unsigned char)(bits >> 8);
+            m_numPending = 0;
+            return 2;
+        }
+        if (DECODE_TABLE[c] < 0)
+        {
+            m_error = true;
+            return 0;
+        }
+        m_pending[m_numPending] = c;
+        ++m_numPending;
+        if (m_numPending == 4)
+        {
+            uint32_t bits = ((uint32_t)DECODE_TABLE[m_pending[0]] << 18) | ((uint32_t)DECODE_TABLE[m_pending[1]] << 12) |
+                            ((uint32_t)DECODE_TABLE[m_pending[2]] << 6) | (uint32_t)DECODE_TABLE[m_pending[3]];
+            output[0] = (unsigned char)(bits >> 16);
+            output[1] = (unsigned char)(bits >> 8);
+            output[2] = (unsigned char)bits;
+            m_numPending = 0;
+            return 3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef __BASE64_STREAM_DECODER_H__
+#define __BASE64_STREAM_DECODER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret
+{
+
+    ///base64 decoder for text that arrives in pieces (such as from a SAX parser), so the whole encoded text never needs to be in memory
+    ///whitespace is skipped, decoding ends at padding, or can simply be stopped when the caller has all the bytes it expects
+    class Base64StreamDecoder
+    {
+        unsigned char m_pending[4];//characters of a partial group of 4 from the end of the previous text
+        int m_numPending;
+        bool m_finished, m_error;
+        int64_t decodeGroupsSlow(const char* text, const int64_t& length, int64_t& position, unsigned char* output);
+    public:
+        Base64StreamDecoder();
+        void reset();
+        ///decode as much of the text as possible, returns the number of bytes written to output, which needs room for getMaxDecodedSize(length) bytes
+        ///characters of an incomplete group are kept for the next call, text after padding is ignored, invalid characters set the error flag and stop decoding
+        int64_t decode(const char* text, const int64_t& length, unsigned char* output);
+        ///true after padding has been seen
+        bool isFinished() const { return m_finished; }
+        bool hasError() const { return m_error; }
+        ///true if characters of an incomplete group are waiting for more text
+        bool hasPartialGroup() const { return m_numPending != 0; }
+        ///allows for up to 3 characters of a partial group from previous text, each character is at most 6 bits of output
+        static int64_t getMaxDecodedSize(const int64_t& textLength) { return (textLength + 3) * 3 / 4; }
+    };
+
+}
+
+#endif //__BASE64_STREAM_DECODER_H__
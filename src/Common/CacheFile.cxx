@@ -0,0 +1,89 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CacheFile.h"
+
+#include <QFile>
+
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+const int64_t CacheFile::HEADER_SIZE;
+
+namespace
+{
+    const int32_t ENDIAN_CHECK = 0x01020304;
+}
+
+void CacheFile::writeHeader(char* headerOut, const char magic[8], const int32_t& version)
+{
+    memcpy(headerOut, magic, 8);
+    memcpy(headerOut + 8, &version, sizeof(int32_t));
+    memcpy(headerOut + 12, &ENDIAN_CHECK, sizeof(int32_t));
+}
+
+bool CacheFile::checkHeader(const char* headerIn, const char magic[8], const int32_t& version)
+{
+    int32_t foundVersion, foundEndian;
+    memcpy(&foundVersion, headerIn + 8, sizeof(int32_t));
+    memcpy(&foundEndian, headerIn + 12, sizeof(int32_t));
+    return memcmp(headerIn, magic, 8) == 0 && foundVersion == version && foundEndian == ENDIAN_CHECK;
+}
+
+CacheFileWriter::CacheFileWriter(const QString& fileName) : m_tempFile(fileName + ".XXXXXX")
+{
+    m_fileName = fileName;
+    m_good = m_tempFile.open();
+    if (!m_good) m_errorString = "unable to create temporary file for '" + fileName + "': " + m_tempFile.errorString();
+}
+
+void CacheFileWriter::write(const void* data, const int64_t& bytes)
+{
+    if (!m_good) return;
+    if (m_tempFile.write((const char*)data, bytes) != bytes)
+    {
+        m_good = false;
+        m_errorString = "error writing '" + m_tempFile.fileName() + "': " + m_tempFile.errorString();
+    }
+}
+
+void CacheFileWriter::writeHeader(const char magic[8], const int32_t& version)
+{
+    char header[CacheFile::HEADER_SIZE];
+    CacheFile::writeHeader(header, magic, version);
+    write(header, CacheFile::HEADER_SIZE);
+}
+
+bool CacheFileWriter::finish()
+{
+    if (!m_good) return false;
+    m_tempFile.close();
+    QFile::remove(m_fileName);//another process may have written the same cache, ours is just as good
+    if (!m_tempFile.rename(m_fileName))
+    {
+        m_good = false;
+        m_errorString = "unable to rename '" + m_tempFile.fileName() + "' to '" + m_fileName + "'";
+        return false;
+    }
+    m_tempFile.setAutoRemove(false);
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef __CACHE_FILE_H__
+#define __CACHE_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QIODevice>
+#include <QString>
+#include <QTemporaryFile>
+
+#include <stdint.h>
+
+namespace caret
+{
+    ///pieces shared by the binary cache files (weight cache, cifti column cache, gzip index sidecars), which all store data in native byte order
+    class CacheFile
+    {
+        CacheFile();
+    public:
+        ///magic, version, endianness check
+        static const int64_t HEADER_SIZE = 16;
+        static void writeHeader(char* headerOut, const char magic[8], const int32_t& version);
+        ///returns false if the magic or version don't match, or the file was written on a machine with different endianness
+        static bool checkHeader(const char* headerIn, const char magic[8], const int32_t& version);
+        template<typename T>
+        static bool readValue(QIODevice& device, T& valueOut)
+        {
+            return device.read((char*)&valueOut, sizeof(T)) == (int64_t)sizeof(T);
+        }
+    };
+    
+    ///writes to a temporary file next to the destination and renames it into place in finish(), so a partially written cache file is never used
+    ///if finish() isn't called or fails, the temporary file is removed
+    class CacheFileWriter
+    {
+        QTemporaryFile m_tempFile;
+        QString m_fileName, m_errorString;
+        bool m_good;
+        CacheFileWriter(const CacheFileWriter&);
+        CacheFileWriter& operator=(const CacheFileWriter&);
+    public:
+        ///the directory of fileName must already exist
+        CacheFileWriter(const QString& fileName);
+        ///failures are remembered and reported by finish(), so callers can write everything and check once
+        void write(const void* data, const int64_t& bytes);
+        template<typename T>
+        void writeValue(const T& value) { write(&value, sizeof(T)); }
+        void writeHeader(const char magic[8], const int32_t& version);
+        ///returns false if any write failed, or the file couldn't be renamed into place, see getErrorString()
+        bool finish();
+        ///lets long writers stop early, instead of waiting for finish() to report the failure
+        bool isGood() const { return m_good; }
+        const QString& getErrorString() const { return m_errorString; }
+    };
+}
+
+#endif //__CACHE_FILE_H__
@@ -29,11 +29,19 @@
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
 #include "DataFileException.h"
+#include "GzipIndexedReader.h"
+#include "GzipParallelWriter.h"
 
 #include <QFile>
 #include "zlib.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef CARET_OS_WINDOWS
+#include <unistd.h>
+#endif
 
 using namespace caret;
 using namespace std;
@@ -64,15 +72,22 @@ namespace caret
     class QFileImpl : public CaretBinaryFile::ImplInterface
     {
         QFile m_file;
+        uchar* m_mapped;//when mapped, read and seek use the mapping and m_mappedPos, rather than the QFile position
+        int64_t m_mappedSize, m_mappedPos;
         const static int64_t CHUNK_SIZE;
     public:
+        QFileImpl() { m_mapped = NULL; m_mappedSize = 0; m_mappedPos = 0; }
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        bool map();//only call after opening read-only, returns false if mapping failed (reading still works without it)
         void close();
         void seek(const int64_t& position);
         int64_t pos();
         int64_t size() { return m_file.size(); }
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
+        const char* getMappedData() const { return (const char*)m_mapped; }
+        bool supportsReadAt() const;
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);
     };
     
     const int64_t QFileImpl::CHUNK_SIZE = 1<<30;//1GiB, QT4 apparently chokes at more than 2GiB via buffer.read using int32
@@ -82,6 +97,12 @@ CaretBinaryFile::ImplInterface::~ImplInterface()
 {
 }
 
+void CaretBinaryFile::ImplInterface::readAt(const int64_t&, void*, const int64_t&, int64_t*)
+{
+    CaretAssert(false);
+    throw DataFileException("positional read not supported for file '" + m_fileName + "'");
+}
+
 CaretBinaryFile::CaretBinaryFile(const QString& filename, const OpenMode& fileMode)
 {
     open(filename, fileMode);
@@ -118,7 +139,21 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     if (filename.endsWith(".gz"))
     {
 #ifdef ZLIB_VERSION
-        m_impl.grabNew(new ZFileImpl());
+        ImplInterface* newImpl = NULL;//ZFileImpl handles whatever the specialized implementations can't
+#ifdef CARET_GZIP_INDEXED_READER
+        if (opmode == READ && GzipIndexedReader::isGzipFile(filename))
+        {//indexed reader makes seeking backwards cheap, which NiftiIO does when reading columns, or rereading frames
+            newImpl = new GzipIndexedReader();
+        }
+#endif //CARET_GZIP_INDEXED_READER
+#ifdef CARET_GZIP_PARALLEL_WRITER
+        if (opmode == WRITE_TRUNCATE)
+        {//compression is usually the bottleneck when writing .gz files, so use all threads
+            newImpl = new GzipParallelWriter();
+        }
+#endif //CARET_GZIP_PARALLEL_WRITER
+        if (newImpl == NULL) newImpl = new ZFileImpl();
+        m_impl.grabNew(newImpl);
 #else //ZLIB_VERSION
         throw DataFileException("can't open .gz file '" + filename + "', compiled without zlib support");
 #endif //ZLIB_VERSION
@@ -129,6 +164,30 @@ void CaretBinaryFile::open(const QString& filename, const OpenMode& opmode)
     m_curMode = opmode;
 }
 
+void CaretBinaryFile::openMapped(const QString& filename)
+{
+    if (filename.endsWith(".gz"))
+    {
+        open(filename, READ);//compressed files can't be mapped, so just use the zlib implementation
+        return;
+    }
+    close();
+    QFileImpl* myImpl = new QFileImpl();
+    m_impl.grabNew(myImpl);
+    myImpl->open(filename, READ);
+    if (!myImpl->map())
+    {
+        CaretLogFine("unable to memory map file '" + filename + "', using normal reads");
+    }
+    m_curMode = READ;
+}
+
+const char* CaretBinaryFile::getMappedData() const
+{
+    if (m_impl == NULL) return NULL;
+    return m_impl->getMappedData();
+}
+
 void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
     CaretAssert(count >= 0);//not sure about allowing 0
@@ -136,6 +195,20 @@ void CaretBinaryFile::read(void* dataOut, const int64_t& count, int64_t* numRead
     m_impl->read(dataOut, count, numRead);
 }
 
+void CaretBinaryFile::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    CaretAssert(position >= 0 && count >= 0);
+    if (m_curMode == NONE || !getOpenForRead()) throw DataFileException("file is not open for reading");
+    if (m_impl->supportsReadAt())
+    {
+        m_impl->readAt(position, dataOut, count, numRead);
+    } else {
+        CaretMutexLocker locked(&m_readAtMutex);
+        m_impl->seek(position);
+        m_impl->read(dataOut, count, numRead);
+    }
+}
+
 void CaretBinaryFile::seek(const int64_t& position)
 {
     CaretAssert(position >= 0);
@@ -316,13 +389,46 @@ void QFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
     }
 }
 
+bool QFileImpl::map()
+{
+    CaretAssert(m_mapped == NULL && m_file.isOpen());
+    int64_t fileSize = m_file.size();
+    if (fileSize <= 0) return false;//QFile won't map 0 bytes
+    if ((uint64_t)fileSize != (uint64_t)(size_t)fileSize) return false;//won't fit in the address space on 32-bit
+    m_mapped = m_file.map(0, fileSize);
+    if (m_mapped == NULL) return false;
+    m_mappedSize = fileSize;
+    m_mappedPos = m_file.pos();
+    return true;
+}
+
 void QFileImpl::close()
 {
+    if (m_mapped != NULL)
+    {
+        m_file.unmap(m_mapped);
+        m_mapped = NULL;
+        m_mappedSize = 0;
+        m_mappedPos = 0;
+    }
     m_file.close();
 }
 
 void QFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
+    if (m_mapped != NULL)
+    {
+        int64_t total = max((int64_t)0, min(count, m_mappedSize - m_mappedPos));
+        if (total > 0) memcpy(dataOut, m_mapped + m_mappedPos, total);
+        m_mappedPos += total;
+        if (numRead == NULL)
+        {
+            if (total != count) throw DataFileException("premature end of file in '" + m_fileName + "'");
+        } else {
+            *numRead = total;
+        }
+        return;
+    }
     int64_t total = 0;
     int64_t readret = -1;
     while (total < count)
@@ -344,13 +450,66 @@ void QFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
     }
 }
 
+bool QFileImpl::supportsReadAt() const
+{
+    if (m_mapped != NULL) return true;
+#ifdef CARET_OS_WINDOWS
+    return false;//ReadFile with an offset still moves the file pointer on synchronous handles
+#else
+    return m_file.isOpen() && !(m_file.openMode() & QIODevice::WriteOnly);//QFile may have buffered writes that pread wouldn't see
+#endif
+}
+
+void QFileImpl::readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    int64_t total = 0;
+    int64_t readret = -1;
+    if (m_mapped != NULL)
+    {
+        total = max((int64_t)0, min(count, m_mappedSize - position));
+        if (total > 0) memcpy(dataOut, m_mapped + position, total);
+        readret = 0;
+    } else {
+#ifdef CARET_OS_WINDOWS
+        CaretAssert(false);
+        throw DataFileException("positional read not supported for file '" + m_fileName + "'");
+#else
+        int fd = m_file.handle();
+        while (total < count)
+        {
+            int64_t maxToRead = min(count - total, CHUNK_SIZE);
+            readret = pread(fd, ((char*)dataOut) + total, maxToRead, position + total);
+            if (readret < 0 && errno == EINTR) continue;
+            if (readret < 1) break;//0 or -1 means error or eof
+            total += readret;
+        }
+#endif
+    }
+    if (numRead == NULL)
+    {
+        if (total != count)
+        {
+            if (readret < 0) throw DataFileException("error while reading file '" + m_fileName + "'");
+            throw DataFileException("premature end of file in '" + m_fileName + "'");
+        }
+    } else {
+        *numRead = total;
+    }
+}
+
 void QFileImpl::seek(const int64_t& position)
 {
+    if (m_mapped != NULL)
+    {
+        m_mappedPos = position;//like QFile, seeking past the end is allowed, reads will come up short
+        return;
+    }
     if (!m_file.seek(position)) throw DataFileException("seek failed in file '" + m_fileName + "'");
 }
 
 int64_t QFileImpl::pos()
 {
+    if (m_mapped != NULL) return m_mappedPos;
     return m_file.pos();
 }
 
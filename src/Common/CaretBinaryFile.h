@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include "CaretMutex.h"
 #include "CaretPointer.h"
 
 #include <QString>
@@ -43,10 +44,12 @@ namespace caret {
             WRITE_TRUNCATE = 6,//ditto
             READ_WRITE_TRUNCATE = 7//ditto
         };
-        CaretBinaryFile() { }
+        CaretBinaryFile() { m_curMode = NONE; }
         ///constructor that opens file
         CaretBinaryFile(const QString& filename, const OpenMode& fileMode = READ);
         void open(const QString& filename, const OpenMode& opmode = READ);
+        ///open read-only, and memory map the whole file if it isn't compressed - if mapping fails, reading works the same as open(filename, READ)
+        void openMapped(const QString& filename);
         void close();
         QString getFilename() const;//not a reference because when no file is open, m_impl is NULL
         bool getOpenForRead();
@@ -54,8 +57,13 @@ namespace caret {
         void seek(const int64_t& position);
         int64_t pos();
         void read(void* dataOut, const int64_t& count, int64_t* numRead = NULL);//throw if numRead is NULL and (error or end of file reached early)
+        ///read from a position without using the shared file position, concurrent readAt calls are safe, but not concurrent with seek/read/write
+        ///uncompressed read-only files use pread or the memory map, other files fall back to seek and read under a mutex (and may change pos())
+        void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead = NULL);
         void write(const void* dataIn, const int64_t& count);//failure to complete write is always an exception
         int64_t size();//may return -1 if size cannot be determined efficiently
+        ///pointer to the start of the file contents if openMapped() succeeded in mapping it, otherwise NULL - valid until close(), must not be written to
+        const char* getMappedData() const;
         class ImplInterface
         {
         protected:
@@ -69,11 +77,15 @@ namespace caret {
             virtual int64_t size() = 0;
             virtual void read(void* dataOut, const int64_t& count, int64_t* numRead) = 0;
             virtual void write(const void* dataIn, const int64_t& count) = 0;
+            virtual const char* getMappedData() const { return NULL; }
+            virtual bool supportsReadAt() const { return false; }
+            virtual void readAt(const int64_t& position, void* dataOut, const int64_t& count, int64_t* numRead);//only called when supportsReadAt() is true
             virtual ~ImplInterface();
         };
     private:
         CaretPointer<ImplInterface> m_impl;
         OpenMode m_curMode;//so implementation classes don't have to track it
+        CaretMutex m_readAtMutex;//for implementations without positional reads
     };
 } //namespace caret
 
@@ -23,11 +23,189 @@
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int BLOCK_SIZE = 256;//values per slot in evaluateMany, small enough that all slots of a typical expression stay in cache
+    
+    double evalFunction(const MathFunctionEnum::Enum& function, const double* args, const int& numArgs)
+    {//shared by the tree evaluation and the compiled program, so they give identical results
+        double ret = 0.0;
+        switch (function)//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+        {
+            case MathFunctionEnum::SIN:
+                CaretAssert(numArgs == 1);
+                ret = sin(args[0]);
+                break;
+            case MathFunctionEnum::COS:
+                CaretAssert(numArgs == 1);
+                ret = cos(args[0]);
+                break;
+            case MathFunctionEnum::TAN:
+                CaretAssert(numArgs == 1);
+                ret = tan(args[0]);
+                break;
+            case MathFunctionEnum::ASIN:
+                CaretAssert(numArgs == 1);
+                ret = asin(args[0]);
+                break;
+            case MathFunctionEnum::ACOS:
+                CaretAssert(numArgs == 1);
+                ret = acos(args[0]);
+                break;
+            case MathFunctionEnum::ATAN:
+                CaretAssert(numArgs == 1);
+                ret = atan(args[0]);
+                break;
+            case MathFunctionEnum::SINH:
+                CaretAssert(numArgs == 1);
+                ret = sinh(args[0]);
+                break;
+            case MathFunctionEnum::COSH:
+                CaretAssert(numArgs == 1);
+                ret = cosh(args[0]);
+                break;
+            case MathFunctionEnum::TANH:
+                CaretAssert(numArgs == 1);
+                ret = tanh(args[0]);
+                break;
+            case MathFunctionEnum::ASINH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = asinh(m_arguments[0].eval(values));//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
+                double arg = args[0];
+                if (arg > 0)
+                {
+                    ret = log(arg + sqrt(arg * arg + 1));
+                } else {
+                    ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
+                }
+                break;
+            }
+            case MathFunctionEnum::ACOSH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = acosh(m_arguments[0].eval(values));
+                double arg = args[0];
+                ret = log(arg + sqrt(arg * arg - 1));
+                break;
+            }
+            case MathFunctionEnum::ATANH:
+            {
+                CaretAssert(numArgs == 1);
+                //ret = atanh(m_arguments[0].eval(values));
+                double arg = args[0];
+                ret = 0.5 * log((1 + arg) / (1 - arg));
+                break;
+            }
+            case MathFunctionEnum::LN:
+                CaretAssert(numArgs == 1);
+                ret = log(args[0]);
+                break;
+            case MathFunctionEnum::EXP:
+                CaretAssert(numArgs == 1);
+                ret = exp(args[0]);
+                break;
+            case MathFunctionEnum::LOG:
+                CaretAssert(numArgs == 1);
+                ret = log10(args[0]);
+                break;
+            case MathFunctionEnum::SQRT:
+                CaretAssert(numArgs == 1);
+                ret = sqrt(args[0]);
+                break;
+            case MathFunctionEnum::ABS:
+                CaretAssert(numArgs == 1);
+                ret = abs(args[0]);
+                break;
+            case MathFunctionEnum::FLOOR:
+                CaretAssert(numArgs == 1);
+                ret = floor(args[0]);
+                break;
+            case MathFunctionEnum::ROUND:
+            {
+                CaretAssert(numArgs == 1);
+                double temp = args[0];//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
+                if (temp > 0.0)
+                {
+                    ret = floor(temp + 0.5);
+                } else {
+                    ret = ceil(temp - 0.5);
+                }
+                break;
+            }
+            case MathFunctionEnum::CEIL:
+                CaretAssert(numArgs == 1);
+                ret = ceil(args[0]);
+                break;
+            case MathFunctionEnum::ATAN2:
+                CaretAssert(numArgs == 2);
+                ret = atan2(args[0], args[1]);
+                break;
+            case MathFunctionEnum::MIN:
+            {
+                CaretAssert(numArgs == 2);
+                ret = args[0];
+                double other = args[1];
+                if (ret > other) ret = other;
+                break;
+            }
+            case MathFunctionEnum::MAX:
+            {
+                CaretAssert(numArgs == 2);
+                ret = args[0];
+                double other = args[1];
+                if (ret < other) ret = other;
+                break;
+            }
+            case MathFunctionEnum::MOD:
+            {
+                CaretAssert(numArgs == 2);
+                double second = args[1];
+                if (second == 0.0)
+                {
+                    ret = 0.0;
+                } else {
+                    double first = args[0];
+                    ret = first - second * floor(first / second);
+                }
+                break;
+            }
+            case MathFunctionEnum::CLAMP:
+            {
+                CaretAssert(numArgs == 3);
+                ret = args[0];
+                double low = args[1];
+                double high = args[2];
+                if (ret < low)
+                {
+                    ret = low;
+                }
+                if (ret > high)
+                {
+                    ret = high;
+                }
+                break;
+            }
+            case MathFunctionEnum::INVALID:
+                CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
+                throw CaretException("parsing problem in CaretMathExpression");
+        }
+        return ret;
+    }
+    
+    float compareAdjust(const double& a, const double& b)
+    {//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
+        return min(abs(a), abs(b)) / 1000000;
+    }
+}
+
 CaretMathExpression::CaretMathExpression(const AString& expression)
 {
     m_input = expression;
@@ -39,6 +217,7 @@ CaretMathExpression::CaretMathExpression(const AString& expression)
         throw CaretException("extra characters on end of expression input: '" + m_input.mid(m_position) + "'");
     }
     CaretLogFiner("parsed '" + expression + "' as '" + toString() + "'");
+    compile();
 }
 
 double CaretMathExpression::evaluate(const vector<float>& variableValues) const
@@ -47,6 +226,399 @@ double CaretMathExpression::evaluate(const vector<float>& variableValues) const
     return m_root->eval(variableValues);
 }
 
+void CaretMathExpression::evaluateMany(const vector<const float*>& inputs, float* output, const int64_t& count) const
+{
+    CaretAssert(inputs.size() == m_varNames.size());
+    const int numSlots = (int)m_program.size();
+    vector<double> scratch(numSlots * BLOCK_SIZE);//per call, so that multiple threads can evaluate at once
+    for (int s = 0; s < numSlots; ++s)
+    {
+        if (m_program[s].m_op == Instruction::CONST_VAL)
+        {
+            m_program[s].apply(NULL, scratch.data() + s * BLOCK_SIZE, BLOCK_SIZE);//constants only need to be filled once
+        }
+    }
+    const double* argData[3];
+    for (int64_t start = 0; start < count; start += BLOCK_SIZE)
+    {
+        const int blockCount = (int)min((int64_t)BLOCK_SIZE, count - start);
+        for (int s = 0; s < numSlots; ++s)
+        {
+            const Instruction& thisInstr = m_program[s];
+            double* slotData = scratch.data() + s * BLOCK_SIZE;
+            switch (thisInstr.m_op)
+            {
+                case Instruction::CONST_VAL:
+                    break;
+                case Instruction::LOAD_VAR:
+                {
+                    CaretAssertVectorIndex(inputs, thisInstr.m_varIndex);
+                    const float* varData = inputs[thisInstr.m_varIndex] + start;
+                    for (int i = 0; i < blockCount; ++i)
+                    {
+                        slotData[i] = varData[i];
+                    }
+                    break;
+                }
+                default:
+                    for (int a = 0; a < thisInstr.m_numArgs; ++a)
+                    {
+                        argData[a] = scratch.data() + thisInstr.m_args[a] * BLOCK_SIZE;
+                    }
+                    thisInstr.apply(argData, slotData, blockCount);
+                    break;
+            }
+        }
+        const double* result = scratch.data() + m_resultSlot * BLOCK_SIZE;
+        float* outBlock = output + start;
+        for (int i = 0; i < blockCount; ++i)
+        {
+            outBlock[i] = result[i];
+        }
+    }
+}
+
+void CaretMathExpression::Instruction::apply(const double* const* argData, double* out, const int& count) const
+{//keep these as simple loops over contiguous arrays, so the compiler can vectorize them
+    switch (m_op)
+    {
+        case CONST_VAL:
+            for (int i = 0; i < count; ++i) out[i] = m_constVal;
+            break;
+        case LOAD_VAR:
+            CaretAssertMessage(0, "LOAD_VAR instruction must be handled by the caller");
+            throw CaretException("internal error in CaretMathExpression");
+        case OR:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = (a[i] > 0.0 || b[i] > 0.0) ? 1.0 : 0.0;
+            break;
+        }
+        case AND:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = (a[i] > 0.0 && b[i] > 0.0) ? 1.0 : 0.0;
+            break;
+        }
+        case EQUAL:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i)
+            {
+                float adjust = compareAdjust(a[i], b[i]);
+                out[i] = (a[i] >= b[i] - adjust && a[i] <= b[i] + adjust) ? 1.0 : 0.0;
+            }
+            break;
+        }
+        case NOT_EQUAL:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i)
+            {
+                float adjust = compareAdjust(a[i], b[i]);
+                out[i] = (a[i] >= b[i] - adjust && a[i] <= b[i] + adjust) ? 0.0 : 1.0;
+            }
+            break;
+        }
+        case GREATER:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = (a[i] > b[i]) ? 1.0 : 0.0;
+            break;
+        }
+        case GREATER_EQUAL:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i)
+            {
+                float adjust = compareAdjust(a[i], b[i]);
+                out[i] = (a[i] >= b[i] - adjust) ? 1.0 : 0.0;
+            }
+            break;
+        }
+        case LESS:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = (a[i] < b[i]) ? 1.0 : 0.0;
+            break;
+        }
+        case LESS_EQUAL:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i)
+            {
+                float adjust = compareAdjust(a[i], b[i]);
+                out[i] = (a[i] <= b[i] + adjust) ? 1.0 : 0.0;
+            }
+            break;
+        }
+        case ADD:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = a[i] + b[i];
+            break;
+        }
+        case SUBTRACT:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = a[i] - b[i];
+            break;
+        }
+        case MULTIPLY:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = a[i] * b[i];
+            break;
+        }
+        case DIVIDE:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = a[i] / b[i];
+            break;
+        }
+        case NOT:
+        {
+            const double* a = argData[0];
+            for (int i = 0; i < count; ++i) out[i] = (a[i] > 0.0) ? 0.0 : 1.0;
+            break;
+        }
+        case NEGATE:
+        {
+            const double* a = argData[0];
+            for (int i = 0; i < count; ++i) out[i] = -a[i];
+            break;
+        }
+        case POW:
+        {
+            const double* a = argData[0], *b = argData[1];
+            for (int i = 0; i < count; ++i) out[i] = pow(a[i], b[i]);
+            break;
+        }
+        case FUNC:
+            switch (m_function)
+            {//special case the cheap functions that the compiler can vectorize, everything else goes through evalFunction
+                case MathFunctionEnum::ABS:
+                {
+                    const double* a = argData[0];
+                    for (int i = 0; i < count; ++i) out[i] = abs(a[i]);
+                    break;
+                }
+                case MathFunctionEnum::SQRT:
+                {
+                    const double* a = argData[0];
+                    for (int i = 0; i < count; ++i) out[i] = sqrt(a[i]);
+                    break;
+                }
+                case MathFunctionEnum::MIN:
+                {
+                    const double* a = argData[0], *b = argData[1];
+                    for (int i = 0; i < count; ++i) out[i] = (a[i] > b[i]) ? b[i] : a[i];//same NaN behavior as evalFunction
+                    break;
+                }
+                case MathFunctionEnum::MAX:
+                {
+                    const double* a = argData[0], *b = argData[1];
+                    for (int i = 0; i < count; ++i) out[i] = (a[i] < b[i]) ? b[i] : a[i];
+                    break;
+                }
+                default:
+                {
+                    double args[3];
+                    for (int i = 0; i < count; ++i)
+                    {
+                        for (int a = 0; a < m_numArgs; ++a)
+                        {
+                            args[a] = argData[a][i];
+                        }
+                        out[i] = evalFunction(m_function, args, m_numArgs);
+                    }
+                    break;
+                }
+            }
+            break;
+    }
+}
+
+void CaretMathExpression::compile()
+{
+    m_program.clear();
+    map<vector<int64_t>, int> seen;
+    int result = compileNode(m_root, seen);
+    vector<bool> used(m_program.size(), false);//constant folding can leave instructions that nothing uses, remove them
+    used[result] = true;
+    for (int s = result; s >= 0; --s)
+    {
+        if (!used[s]) continue;
+        for (int a = 0; a < m_program[s].m_numArgs; ++a)
+        {
+            used[m_program[s].m_args[a]] = true;
+        }
+    }
+    vector<int> newIndex(m_program.size(), -1);
+    vector<Instruction> compacted;
+    for (int s = 0; s < (int)m_program.size(); ++s)
+    {
+        if (!used[s]) continue;
+        Instruction toAdd = m_program[s];
+        for (int a = 0; a < toAdd.m_numArgs; ++a)
+        {
+            CaretAssert(newIndex[toAdd.m_args[a]] != -1);
+            toAdd.m_args[a] = newIndex[toAdd.m_args[a]];
+        }
+        newIndex[s] = (int)compacted.size();
+        compacted.push_back(toAdd);
+    }
+    m_program = compacted;
+    m_resultSlot = newIndex[result];
+    CaretLogFiner("compiled '" + m_input + "' into " + AString::number(m_program.size()) + " instructions");
+}
+
+int CaretMathExpression::compileNode(const MathNode* node, map<vector<int64_t>, int>& seen)
+{
+    Instruction thisInstr;
+    switch (node->m_type)
+    {
+        case MathNode::OR:
+        case MathNode::AND:
+        case MathNode::EQUAL:
+        case MathNode::GREATERLESS:
+        case MathNode::ADDSUB:
+        case MathNode::MULTDIV:
+        {//chains are evaluated left to right, so they become a sequence of binary instructions
+            int end = (int)node->m_arguments.size();
+            CaretAssert(end > 1);
+            int current = compileNode(node->m_arguments[0], seen);
+            for (int i = 1; i < end; ++i)
+            {
+                Instruction step;
+                switch (node->m_type)
+                {
+                    case MathNode::OR:
+                        step.m_op = Instruction::OR;
+                        break;
+                    case MathNode::AND:
+                        step.m_op = Instruction::AND;
+                        break;
+                    case MathNode::EQUAL:
+                        CaretAssertVectorIndex(node->m_invert, i);
+                        step.m_op = (node->m_invert[i] ? Instruction::NOT_EQUAL : Instruction::EQUAL);
+                        break;
+                    case MathNode::GREATERLESS:
+                        CaretAssertVectorIndex(node->m_invert, i);
+                        CaretAssertVectorIndex(node->m_inclusive, i);
+                        if (node->m_inclusive[i])
+                        {
+                            step.m_op = (node->m_invert[i] ? Instruction::LESS_EQUAL : Instruction::GREATER_EQUAL);
+                        } else {
+                            step.m_op = (node->m_invert[i] ? Instruction::LESS : Instruction::GREATER);
+                        }
+                        break;
+                    case MathNode::ADDSUB:
+                        CaretAssertVectorIndex(node->m_invert, i);
+                        step.m_op = (node->m_invert[i] ? Instruction::SUBTRACT : Instruction::ADD);
+                        break;
+                    case MathNode::MULTDIV:
+                        CaretAssertVectorIndex(node->m_invert, i);
+                        step.m_op = (node->m_invert[i] ? Instruction::DIVIDE : Instruction::MULTIPLY);
+                        break;
+                    default:
+                        CaretAssert(0);
+                        break;
+                }
+                step.m_numArgs = 2;
+                step.m_args[0] = current;
+                step.m_args[1] = compileNode(node->m_arguments[i], seen);
+                current = emit(step, seen);
+            }
+            return current;
+        }
+        case MathNode::NOT:
+        case MathNode::NEGATE:
+            CaretAssert(node->m_arguments.size() == 1);
+            thisInstr.m_op = (node->m_type == MathNode::NOT ? Instruction::NOT : Instruction::NEGATE);
+            thisInstr.m_numArgs = 1;
+            thisInstr.m_args[0] = compileNode(node->m_arguments[0], seen);
+            break;
+        case MathNode::POW:
+            CaretAssert(node->m_arguments.size() == 2);
+            thisInstr.m_op = Instruction::POW;
+            thisInstr.m_numArgs = 2;
+            thisInstr.m_args[0] = compileNode(node->m_arguments[0], seen);
+            thisInstr.m_args[1] = compileNode(node->m_arguments[1], seen);
+            break;
+        case MathNode::FUNC:
+            CaretAssert(node->m_arguments.size() >= 1 && node->m_arguments.size() <= 3);
+            thisInstr.m_op = Instruction::FUNC;
+            thisInstr.m_function = node->m_function;
+            thisInstr.m_numArgs = (int)node->m_arguments.size();
+            for (int a = 0; a < thisInstr.m_numArgs; ++a)
+            {
+                thisInstr.m_args[a] = compileNode(node->m_arguments[a], seen);
+            }
+            break;
+        case MathNode::VAR:
+            thisInstr.m_op = Instruction::LOAD_VAR;
+            thisInstr.m_varIndex = node->m_varIndex;
+            break;
+        case MathNode::CONST:
+            thisInstr.m_op = Instruction::CONST_VAL;
+            thisInstr.m_constVal = node->m_constVal;
+            break;
+        case MathNode::INVALID:
+            CaretAssertMessage(0, "parsing left INVALID MathNode");
+            throw CaretException("parsing problem in CaretMathExpression");
+    }
+    return emit(thisInstr, seen);
+}
+
+int CaretMathExpression::emit(const Instruction& instr, map<vector<int64_t>, int>& seen)
+{
+    Instruction toAdd = instr;
+    if (toAdd.m_numArgs > 0)
+    {//if all arguments are constant, compute the value now
+        bool allConst = true;
+        double argVals[3];
+        const double* argPtrs[3];
+        for (int a = 0; a < toAdd.m_numArgs; ++a)
+        {
+            CaretAssertVectorIndex(m_program, toAdd.m_args[a]);
+            const Instruction& argInstr = m_program[toAdd.m_args[a]];
+            if (argInstr.m_op != Instruction::CONST_VAL)
+            {
+                allConst = false;
+                break;
+            }
+            argVals[a] = argInstr.m_constVal;
+            argPtrs[a] = argVals + a;
+        }
+        if (allConst)
+        {
+            double folded = 0.0;
+            toAdd.apply(argPtrs, &folded, 1);
+            toAdd = Instruction();
+            toAdd.m_op = Instruction::CONST_VAL;
+            toAdd.m_constVal = folded;
+        }
+    }
+    int64_t constBits = 0;
+    memcpy(&constBits, &toAdd.m_constVal, sizeof(double));//compare constants bitwise, so NaN constants can be merged
+    vector<int64_t> key;//identical instructions on identical slots give identical results, so reuse the existing slot
+    key.push_back(toAdd.m_op);
+    key.push_back(toAdd.m_function);
+    key.push_back(toAdd.m_varIndex);
+    key.push_back(constBits);
+    for (int a = 0; a < toAdd.m_numArgs; ++a)
+    {
+        key.push_back(toAdd.m_args[a]);
+    }
+    map<vector<int64_t>, int>::iterator iter = seen.find(key);
+    if (iter != seen.end()) return iter->second;
+    int ret = (int)m_program.size();
+    m_program.push_back(toAdd);
+    seen[key] = ret;
+    return ret;
+}
+
 vector<AString> CaretMathExpression::getVarNames() const
 {
     vector<AString> ret(m_varNames.size());
@@ -125,8 +697,8 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
             for (int i = 1; i < end; ++i)
             {
                 double temp = m_arguments[i]->eval(values);
-                float adjust = min(abs(ret), abs(temp)) / 1000000;//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
-                bool equal = (ret >= m_arguments[i]->eval(values) - adjust) && (ret <= m_arguments[i]->eval(values) + adjust);
+                float adjust = compareAdjust(ret, temp);
+                bool equal = (ret >= temp - adjust) && (ret <= temp + adjust);
                 if (m_invert[i])
                 {
                     ret = equal ? 0.0 : 1.0;
@@ -148,7 +720,7 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
                 double temp = m_arguments[i]->eval(values);
                 if (m_inclusive[i])
                 {
-                    float adjust = min(abs(ret), abs(temp)) / 1000000;//because == doesn't always work as expected, include a fudge factor based on the approximate precision of float
+                    float adjust = compareAdjust(ret, temp);
                     if (m_invert[i])
                     {
                         ret = (ret <= temp + adjust ? 1.0 : 0.0);//don't trust booleans to cast to 0 and 1, just because
@@ -216,166 +788,14 @@ double CaretMathExpression::MathNode::eval(const vector<float>& values) const
         }
         case FUNC:
         {
-            switch (m_function)//this could be (partly) moved into MathFunctionEnum, but it wouldn't strictly be an enum class then
+            double args[3];
+            int numArgs = (int)m_arguments.size();
+            CaretAssert(numArgs >= 1 && numArgs <= 3);
+            for (int i = 0; i < numArgs; ++i)
             {
-                case MathFunctionEnum::SIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASIN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = asin(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ACOS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = acos(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = atan(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SINH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sinh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::COSH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = cosh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::TANH:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = tanh(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ASINH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = asinh(m_arguments[0].eval(values));//will work, and be preferred, when we use c++11, but doesn't work on windows with previous standard
-                    double arg = m_arguments[0]->eval(values);
-                    if (arg > 0)
-                    {
-                        ret = log(arg + sqrt(arg * arg + 1));
-                    } else {
-                        ret = -log(-arg + sqrt(arg * arg + 1));//special case negative for stability in large negatives
-                    }
-                    break;
-                }
-                case MathFunctionEnum::ACOSH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = acosh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = log(arg + sqrt(arg * arg - 1));
-                    break;
-                }
-                case MathFunctionEnum::ATANH:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    //ret = atanh(m_arguments[0].eval(values));
-                    double arg = m_arguments[0]->eval(values);
-                    ret = 0.5 * log((1 + arg) / (1 - arg));
-                    break;
-                }
-                case MathFunctionEnum::LN:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::EXP:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = exp(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::LOG:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = log10(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::SQRT:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = sqrt(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ABS:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = abs(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::FLOOR:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = floor(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ROUND:
-                {
-                    CaretAssert(m_arguments.size() == 1);
-                    double temp = m_arguments[0]->eval(values);//windows doesn't use c99 when compiling c++ earlier than c++11, so implement manually
-                    if (temp > 0.0)
-                    {
-                        ret = floor(temp + 0.5);
-                    } else {
-                        ret = ceil(temp - 0.5);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CEIL:
-                    CaretAssert(m_arguments.size() == 1);
-                    ret = ceil(m_arguments[0]->eval(values));
-                    break;
-                case MathFunctionEnum::ATAN2:
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = atan2(m_arguments[0]->eval(values), m_arguments[1]->eval(values));
-                    break;
-                case MathFunctionEnum::MIN:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret > other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MAX:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    ret = m_arguments[0]->eval(values);
-                    double other = m_arguments[1]->eval(values);
-                    if (ret < other) ret = other;
-                    break;
-                }
-                case MathFunctionEnum::MOD:
-                {
-                    CaretAssert(m_arguments.size() == 2);
-                    double second = m_arguments[1]->eval(values);
-                    if (second == 0.0)
-                    {
-                        ret = 0.0;
-                    } else {
-                        double first = m_arguments[0]->eval(values);
-                        ret = first - second * floor(first / second);
-                    }
-                    break;
-                }
-                case MathFunctionEnum::CLAMP:
-                {
-                    CaretAssert(m_arguments.size() == 3);
-                    ret = m_arguments[0]->eval(values);
-                    double low = m_arguments[1]->eval(values);
-                    double high = m_arguments[2]->eval(values);
-                    if (ret < low)
-                    {
-                        ret = low;
-                    }
-                    if (ret > high)
-                    {
-                        ret = high;
-                    }
-                    break;
-                }
-                case INVALID:
-                    CaretAssertMessage(0, "MathNode is type FUNC but INVALID function");
-                    throw CaretException("parsing problem in CaretMathExpression");
+                args[i] = m_arguments[i]->eval(values);
             }
+            ret = evalFunction(m_function, args, numArgs);
             break;
         }
         case VAR:
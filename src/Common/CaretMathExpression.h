@@ -26,6 +26,7 @@
 #include "MathFunctionEnum.h"
 
 #include <map>
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -63,7 +64,41 @@ class CaretMathExpression
         double eval(const std::vector<float>& values) const;
         AString toString(const std::vector<AString>& varNames) const;
     };
+    struct Instruction//one step of the compiled program, each instruction's result is a block of values in its own slot
+    {
+        enum OpCode
+        {
+            CONST_VAL,
+            LOAD_VAR,
+            OR,
+            AND,
+            EQUAL,
+            NOT_EQUAL,
+            GREATER,
+            GREATER_EQUAL,
+            LESS,
+            LESS_EQUAL,
+            ADD,
+            SUBTRACT,
+            MULTIPLY,
+            DIVIDE,
+            NOT,
+            NEGATE,
+            POW,
+            FUNC
+        };
+        OpCode m_op;
+        MathFunctionEnum::Enum m_function;
+        double m_constVal;
+        int m_varIndex;
+        int m_numArgs;
+        int m_args[3];//slot indexes, always earlier in the program
+        Instruction() { m_op = CONST_VAL; m_function = MathFunctionEnum::INVALID; m_constVal = 0.0; m_varIndex = -1; m_numArgs = 0; }
+        void apply(const double* const* argData, double* out, const int& count) const;
+    };
     std::map<AString, int> m_varNames;
+    std::vector<Instruction> m_program;//flattened tree, with constants folded and duplicate subexpressions merged
+    int m_resultSlot;
     AString m_input;
     int m_position, m_end;
     CaretPointer<MathNode> m_root;
@@ -81,11 +116,17 @@ class CaretMathExpression
     CaretPointer<MathNode> funcExpr();//also parenthesis
     CaretPointer<MathNode> terminal();//literal, const, variable
     CaretPointer<MathNode> tryLiteral();//NOTE: does not throw except on early end of input, returns NULL on failure
+    void compile();
+    int compileNode(const MathNode* node, std::map<std::vector<int64_t>, int>& seen);
+    int emit(const Instruction& instr, std::map<std::vector<int64_t>, int>& seen);
 public:
     static AString getExpressionHelpInfo();
     static bool getNamedConstant(const AString& name, double& valueOut);
     CaretMathExpression(const AString& expression);
     double evaluate(const std::vector<float>& variableValues) const;
+    ///evaluate at count points, inputs[v] must point to count values for variable v (in getVarNames() order)
+    ///uses the compiled program, giving the same results as evaluate(), but much faster - thread safe, call it from multiple threads for parallelism
+    void evaluateMany(const std::vector<const float*>& inputs, float* output, const int64_t& count) const;
     std::vector<AString> getVarNames() const;
     AString toString() const;//the expression, with a lot of parentheses added
 };
@@ -976,6 +976,31 @@ CaretPreferences::setDynamicConnectivityDefaultedOn(const bool defaultedOn)
                      defaultedOn);
 }
 
+/**
+ * @return Are transposed copies of on-disk CIFTI matrices kept
+ * so that loading a column is fast?
+ */
+bool
+CaretPreferences::isCiftiColumnCacheEnabled() const
+{
+    return this->ciftiColumnCacheEnabled;
+}
+
+/**
+ * Set caching of transposed copies of on-disk CIFTI matrices.
+ * Takes effect the next time wb_view is started.
+ *
+ * @param enabled
+ *     New status.
+ */
+void
+CaretPreferences::setCiftiColumnCacheEnabled(const bool enabled)
+{
+    this->ciftiColumnCacheEnabled = enabled;
+    this->setBoolean(NAME_CIFTI_COLUMN_CACHE,
+                     enabled);
+}
+
 
 /**
  * @return The image capture method.
@@ -1482,6 +1507,9 @@ CaretPreferences::readPreferences()
     this->dynamicConnectivityDefaultedOn = this->getBoolean(CaretPreferences::NAME_DYNAMIC_CONNECTIVITY_ON,
                                                             true);
     
+    this->ciftiColumnCacheEnabled = this->getBoolean(CaretPreferences::NAME_CIFTI_COLUMN_CACHE,
+                                                     false);
+    
     this->remoteFileUserName = this->getString(NAME_REMOTE_FILE_USER_NAME);
     this->remoteFilePassword = this->getString(NAME_REMOTE_FILE_PASSWORD);
     this->remoteFileLoginSaved = this->getBoolean(NAME_REMOTE_FILE_LOGIN_SAVED,
@@ -0,0 +1,249 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretTriangleBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+const int64_t CaretTriangleBVH::LEAF_TRIANGLES;
+
+namespace
+{
+    ///orders triangles by one coordinate of their centroids
+    struct CentroidLess
+    {
+        const float* m_centroids;
+        int m_axis;
+        CentroidLess(const float* centroids, const int axis) : m_centroids(centroids), m_axis(axis) { }
+        bool operator()(const int64_t& lhs, const int64_t& rhs) const
+        {
+            return m_centroids[lhs * 3 + m_axis] < m_centroids[rhs * 3 + m_axis];
+        }
+    };
+}
+
+CaretTriangleBVH::CaretTriangleBVH(const float* coordsIn, const int64_t numCoords, const int32_t* trianglesIn, const int64_t numTriangles)
+{
+    m_coords.assign(coordsIn, coordsIn + numCoords * 3);
+    m_triangles.assign(trianglesIn, trianglesIn + numTriangles * 3);
+    if (numTriangles < 1) return;
+    vector<float> centroids(numTriangles * 3);
+    m_triOrder.resize(numTriangles);
+    for (int64_t i = 0; i < numTriangles; ++i)
+    {
+        m_triOrder[i] = i;
+        const float* c1 = &m_coords[m_triangles[i * 3] * 3];
+        const float* c2 = &m_coords[m_triangles[i * 3 + 1] * 3];
+        const float* c3 = &m_coords[m_triangles[i * 3 + 2] * 3];
+        for (int j = 0; j < 3; ++j)
+        {
+            centroids[i * 3 + j] = (c1[j] + c2[j] + c3[j]) / 3.0f;
+        }
+    }
+    m_nodes.reserve(2 * (numTriangles / LEAF_TRIANGLES + 1));
+    m_nodes.push_back(Node());
+    buildNode(0, 0, numTriangles, centroids);
+}
+
+void CaretTriangleBVH::buildNode(const int64_t nodeIndex, const int64_t start, const int64_t end, const std::vector<float>& centroids)
+{
+    float boxMin[3], boxMax[3], centMin[3], centMax[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        boxMin[j] = centMin[j] = numeric_limits<float>::max();
+        boxMax[j] = centMax[j] = -numeric_limits<float>::max();
+    }
+    for (int64_t i = start; i < end; ++i)
+    {
+        const int64_t tri = m_triOrder[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            const float* coord = &m_coords[m_triangles[tri * 3 + k] * 3];
+            for (int j = 0; j < 3; ++j)
+            {
+                if (coord[j] < boxMin[j]) boxMin[j] = coord[j];
+                if (coord[j] > boxMax[j]) boxMax[j] = coord[j];
+            }
+        }
+        for (int j = 0; j < 3; ++j)
+        {
+            const float cent = centroids[tri * 3 + j];
+            if (cent < centMin[j]) centMin[j] = cent;
+            if (cent > centMax[j]) centMax[j] = cent;
+        }
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+        m_nodes[nodeIndex].m_min[j] = boxMin[j];
+        m_nodes[nodeIndex].m_max[j] = boxMax[j];
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (centMax[j] - centMin[j] > centMax[axis] - centMin[axis]) axis = j;
+    }
+    if (end - start <= LEAF_TRIANGLES || !(centMax[axis] > centMin[axis]))//also stop when all centroids are identical, splitting can't separate them
+    {
+        m_nodes[nodeIndex].m_start = start;
+        m_nodes[nodeIndex].m_count = end - start;
+        return;
+    }
+    const int64_t mid = (start + end) / 2;
+    nth_element(m_triOrder.begin() + start, m_triOrder.begin() + mid, m_triOrder.begin() + end, CentroidLess(&centroids[0], axis));
+    const int64_t firstChild = (int64_t)m_nodes.size();
+    m_nodes[nodeIndex].m_start = firstChild;
+    m_nodes[nodeIndex].m_count = 0;
+    m_nodes.push_back(Node());//don't hold references to nodes across these, they can reallocate
+    m_nodes.push_back(Node());
+    buildNode(firstChild, start, mid, centroids);
+    buildNode(firstChild + 1, mid, end, centroids);
+}
+
+bool CaretTriangleBVH::rayHitsBox(const Node& node, const double origin[3], const double direction[3], const double maxDist) const
+{
+    double tmin = 0.0, tmax = maxDist;
+    for (int j = 0; j < 3; ++j)
+    {
+        if (direction[j] == 0.0)
+        {
+            if (origin[j] < node.m_min[j] || origin[j] > node.m_max[j]) return false;
+        } else {
+            double t1 = (node.m_min[j] - origin[j]) / direction[j];
+            double t2 = (node.m_max[j] - origin[j]) / direction[j];
+            if (t1 > t2) swap(t1, t2);
+            if (t1 > tmin) tmin = t1;
+            if (t2 < tmax) tmax = t2;
+            if (tmin > tmax) return false;
+        }
+    }
+    return true;
+}
+
+bool CaretTriangleBVH::rayHitsTriangle(const int64_t triangle, const double origin[3], const double direction[3], RayTriangleIntersection& hitOut) const
+{//Moller-Trumbore, in double, not culling either side
+    const float* c1 = &m_coords[m_triangles[triangle * 3] * 3];
+    const float* c2 = &m_coords[m_triangles[triangle * 3 + 1] * 3];
+    const float* c3 = &m_coords[m_triangles[triangle * 3 + 2] * 3];
+    double edge1[3], edge2[3], pvec[3], tvec[3], qvec[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        edge1[j] = c2[j] - c1[j];
+        edge2[j] = c3[j] - c1[j];
+    }
+    pvec[0] = direction[1] * edge2[2] - direction[2] * edge2[1];
+    pvec[1] = direction[2] * edge2[0] - direction[0] * edge2[2];
+    pvec[2] = direction[0] * edge2[1] - direction[1] * edge2[0];
+    const double det = edge1[0] * pvec[0] + edge1[1] * pvec[1] + edge1[2] * pvec[2];
+    if (det == 0.0) return false;//ray is in the plane of the triangle, or triangle is degenerate
+    const double invDet = 1.0 / det;
+    for (int j = 0; j < 3; ++j)
+    {
+        tvec[j] = origin[j] - c1[j];
+    }
+    const double tolerance = 1e-7;//don't let rays slip between triangles that share an edge
+    const double u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * invDet;
+    if (u < -tolerance || u > 1.0 + tolerance) return false;
+    qvec[0] = tvec[1] * edge1[2] - tvec[2] * edge1[1];
+    qvec[1] = tvec[2] * edge1[0] - tvec[0] * edge1[2];
+    qvec[2] = tvec[0] * edge1[1] - tvec[1] * edge1[0];
+    const double v = (direction[0] * qvec[0] + direction[1] * qvec[1] + direction[2] * qvec[2]) * invDet;
+    if (v < -tolerance || u + v > 1.0 + tolerance) return false;
+    const double t = (edge2[0] * qvec[0] + edge2[1] * qvec[1] + edge2[2] * qvec[2]) * invDet;
+    if (t < 0.0) return false;
+    hitOut.triangle = triangle;
+    hitOut.distance = (float)t;
+    hitOut.barycentric[0] = (float)max(0.0, 1.0 - u - v);
+    hitOut.barycentric[1] = (float)max(0.0, u);
+    hitOut.barycentric[2] = (float)max(0.0, v);
+    for (int j = 0; j < 3; ++j)
+    {
+        hitOut.point[j] = (float)(origin[j] + t * direction[j]);
+    }
+    return true;
+}
+
+bool CaretTriangleBVH::closestRayIntersection(const float origin[3], const float direction[3], RayTriangleIntersection& hitOut) const
+{
+    hitOut = RayTriangleIntersection();
+    if (m_nodes.empty()) return false;
+    const double dOrigin[3] = { origin[0], origin[1], origin[2] }, dDirection[3] = { direction[0], direction[1], direction[2] };
+    double best = numeric_limits<double>::max();
+    bool found = false;
+    vector<int64_t> stack;
+    stack.push_back(0);
+    RayTriangleIntersection temp;
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!rayHitsBox(node, dOrigin, dDirection, best)) continue;//boxes farther than the best hit so far can't contain a closer one
+        if (node.m_count == 0)
+        {
+            stack.push_back(node.m_start);
+            stack.push_back(node.m_start + 1);
+        } else {
+            for (int64_t i = node.m_start; i < node.m_start + node.m_count; ++i)
+            {
+                if (rayHitsTriangle(m_triOrder[i], dOrigin, dDirection, temp) && temp.distance < best)
+                {
+                    best = temp.distance;
+                    hitOut = temp;
+                    found = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+void CaretTriangleBVH::rayIntersections(const float origin[3], const float direction[3], std::vector<RayTriangleIntersection>& hitsOut) const
+{
+    hitsOut.clear();
+    if (m_nodes.empty()) return;
+    const double dOrigin[3] = { origin[0], origin[1], origin[2] }, dDirection[3] = { direction[0], direction[1], direction[2] };
+    const double maxDist = numeric_limits<double>::max();
+    vector<int64_t> stack;
+    stack.push_back(0);
+    RayTriangleIntersection temp;
+    while (!stack.empty())
+    {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!rayHitsBox(node, dOrigin, dDirection, maxDist)) continue;
+        if (node.m_count == 0)
+        {
+            stack.push_back(node.m_start);
+            stack.push_back(node.m_start + 1);
+        } else {
+            for (int64_t i = node.m_start; i < node.m_start + node.m_count; ++i)
+            {
+                if (rayHitsTriangle(m_triOrder[i], dOrigin, dDirection, temp))
+                {
+                    hitsOut.push_back(temp);
+                }
+            }
+        }
+    }
+    sort(hitsOut.begin(), hitsOut.end());
+}
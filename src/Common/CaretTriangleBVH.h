@@ -0,0 +1,66 @@
+#ifndef __CARET_TRIANGLE_BVH_H__
+#define __CARET_TRIANGLE_BVH_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    struct RayTriangleIntersection
+    {
+        int64_t triangle;
+        float distance;///along the ray, in multiples of the length of the ray's direction vector
+        float barycentric[3];///weights of the triangle's three vertices at the intersection
+        float point[3];
+        RayTriangleIntersection() : triangle(-1), distance(-1.0f) { }
+        bool operator<(const RayTriangleIntersection& rhs) const { return distance < rhs.distance; }
+    };
+
+    ///bounding volume hierarchy over a set of triangles, for casting rays (such as the mouse ray when identifying) against a surface
+    class CaretTriangleBVH
+    {
+        struct Node
+        {
+            float m_min[3], m_max[3];
+            int64_t m_start, m_count;//leaf: m_count triangles starting at m_start in m_triOrder, otherwise: m_count is 0 and children are nodes m_start and m_start + 1
+        };
+        std::vector<float> m_coords;
+        std::vector<int32_t> m_triangles;
+        std::vector<int64_t> m_triOrder;
+        std::vector<Node> m_nodes;
+        static const int64_t LEAF_TRIANGLES = 4;
+        void buildNode(const int64_t nodeIndex, const int64_t start, const int64_t end, const std::vector<float>& centroids);
+        bool rayHitsBox(const Node& node, const double origin[3], const double direction[3], const double maxDist) const;
+        bool rayHitsTriangle(const int64_t triangle, const double origin[3], const double direction[3], RayTriangleIntersection& hitOut) const;
+        CaretTriangleBVH();
+    public:
+        ///build the hierarchy, the coordinates and triangles are copied
+        CaretTriangleBVH(const float* coordsIn, const int64_t numCoords, const int32_t* trianglesIn, const int64_t numTriangles);
+        ///find the intersection nearest the ray's origin (not behind it), either side of a triangle counts, returns false if the ray misses
+        bool closestRayIntersection(const float origin[3], const float direction[3], RayTriangleIntersection& hitOut) const;
+        ///find all intersections in front of the ray's origin, sorted by distance
+        void rayIntersections(const float origin[3], const float direction[3], std::vector<RayTriangleIntersection>& hitsOut) const;
+    };
+}
+
+#endif //__CARET_TRIANGLE_BVH_H__
@@ -139,7 +139,8 @@ DataFileTypeEnum::initialize()
                                         "Connectivity - Dense",
                                         "CONNECTIVITY",
                                         false,
-                                        "dconn.nii"));
+                                        "dconn.nii",
+                                        "dconn.wbquant"));
     
     enumData.push_back(DataFileTypeEnum(CONNECTIVITY_DENSE_DYNAMIC,
                                         "CONNECTIVITY_DENSE_DYNAMIC",
@@ -0,0 +1,158 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "DotMatrixHelper.h"
+
+#include "CaretAssert.h"
+
+#include <algorithm>
+
+//SSE is part of the x86-64 baseline, so this doesn't need the runtime dispatch that the AVX dot functions use
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DOT_MATRIX_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+const int DotMatrixHelper::BLOCK_A_ROWS;
+const int DotMatrixHelper::BLOCK_B_ROWS;
+const int64_t DotMatrixHelper::L1_TARGET_BYTES;
+const int64_t DotMatrixHelper::L2_TARGET_BYTES;
+
+namespace
+{
+    const int64_t FLUSH_LENGTH = 1024;//number of elements to accumulate in float before adding into the double totals, keeps precision close to sddot
+
+    //computes a NUMA x NUMB block of dot products, the accumulators are few enough to stay in registers, so each loaded value gets used NUMA or NUMB times
+    template<int NUMA, int NUMB>
+    void microKernel(const float* const* aRows, const float* const* bRows, const int64_t& length, double* out, const int64_t& outStride)
+    {
+        double totals[NUMA][NUMB];
+        for (int i = 0; i < NUMA; ++i)
+        {
+            for (int j = 0; j < NUMB; ++j)
+            {
+                totals[i][j] = 0.0;
+            }
+        }
+        int64_t start = 0;
+#ifdef DOT_MATRIX_USE_SSE
+        int64_t vecEnd = length & ~((int64_t)3);
+        while (start < vecEnd)
+        {
+            int64_t end = min(start + FLUSH_LENGTH, vecEnd);
+            __m128 accum[NUMA][NUMB];
+            for (int i = 0; i < NUMA; ++i)
+            {
+                for (int j = 0; j < NUMB; ++j)
+                {
+                    accum[i][j] = _mm_setzero_ps();
+                }
+            }
+            for (int64_t k = start; k < end; k += 4)
+            {
+                __m128 bVals[NUMB];
+                for (int j = 0; j < NUMB; ++j)
+                {
+                    bVals[j] = _mm_loadu_ps(bRows[j] + k);
+                }
+                for (int i = 0; i < NUMA; ++i)
+                {
+                    __m128 aVal = _mm_loadu_ps(aRows[i] + k);
+                    for (int j = 0; j < NUMB; ++j)
+                    {
+                        accum[i][j] = _mm_add_ps(accum[i][j], _mm_mul_ps(aVal, bVals[j]));
+                    }
+                }
+            }
+            for (int i = 0; i < NUMA; ++i)
+            {
+                for (int j = 0; j < NUMB; ++j)
+                {
+                    float temp[4];
+                    _mm_storeu_ps(temp, accum[i][j]);
+                    totals[i][j] += ((double)temp[0] + temp[1]) + ((double)temp[2] + temp[3]);
+                }
+            }
+            start = end;
+        }
+#endif
+        for (int64_t k = start; k < length; ++k)//remainder, or everything if no SSE
+        {
+            for (int i = 0; i < NUMA; ++i)
+            {
+                for (int j = 0; j < NUMB; ++j)
+                {
+                    totals[i][j] += aRows[i][k] * bRows[j][k];
+                }
+            }
+        }
+        for (int i = 0; i < NUMA; ++i)
+        {
+            for (int j = 0; j < NUMB; ++j)
+            {
+                out[i * outStride + j] = totals[i][j];
+            }
+        }
+    }
+}
+
+void DotMatrixHelper::rowBlockDot(const float* const* aRows, const int& numA, const float* const* bRows, const int& numB,
+                                  const int64_t& length, double* out, const int64_t& outStride)
+{
+    CaretAssert(outStride >= numB);
+    int i = 0;
+    for (; i + BLOCK_A_ROWS <= numA; i += BLOCK_A_ROWS)
+    {
+        int j = 0;
+        for (; j + BLOCK_B_ROWS <= numB; j += BLOCK_B_ROWS)
+        {
+            microKernel<BLOCK_A_ROWS, BLOCK_B_ROWS>(aRows + i, bRows + j, length, out + i * outStride + j, outStride);
+        }
+        for (; j < numB; ++j)
+        {
+            microKernel<BLOCK_A_ROWS, 1>(aRows + i, bRows + j, length, out + i * outStride + j, outStride);
+        }
+    }
+    for (; i < numA; ++i)
+    {
+        int j = 0;
+        for (; j + BLOCK_B_ROWS <= numB; j += BLOCK_B_ROWS)
+        {
+            microKernel<1, BLOCK_B_ROWS>(aRows + i, bRows + j, length, out + i * outStride + j, outStride);
+        }
+        for (; j < numB; ++j)
+        {
+            microKernel<1, 1>(aRows + i, bRows + j, length, out + i * outStride + j, outStride);
+        }
+    }
+}
+
+int DotMatrixHelper::getTileRows(const int64_t length, const int64_t targetBytes)
+{
+    int64_t rowBytes = max(length, (int64_t)1) * sizeof(float);
+    int64_t ret = targetBytes / rowBytes;
+    ret -= ret % BLOCK_B_ROWS;//BLOCK_B_ROWS is a multiple of BLOCK_A_ROWS
+    if (ret < BLOCK_B_ROWS) return BLOCK_B_ROWS;
+    if (ret > (1<<20)) return (1<<20);//don't overflow int
+    return (int)ret;
+}
@@ -0,0 +1,51 @@
+#ifndef __DOT_MATRIX_HELPER_H__
+#define __DOT_MATRIX_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret
+{
+
+    ///blocked dot products between sets of float rows, for when many dot products share the same rows (correlation matrices, etc)
+    class DotMatrixHelper
+    {
+        DotMatrixHelper();
+    public:
+        ///out[i * outStride + j] = dot(aRows[i], bRows[j]) for all i < numA, j < numB, accumulates in blocks of float, then double
+        ///caller should tile the rows so that numB rows fit in cache (see getTileRows), the kernel reuses each loaded value across several rows
+        static void rowBlockDot(const float* const* aRows, const int& numA, const float* const* bRows, const int& numB,
+                                const int64_t& length, double* out, const int64_t& outStride);
+
+        ///number of rows of the given length that fit within the given number of bytes, rounded down to a multiple of the kernel block size, minimum of one block
+        static int getTileRows(const int64_t length, const int64_t targetBytes);
+
+        ///rows in the register block of the microkernel, tile sizes should be multiples of these
+        static const int BLOCK_A_ROWS = 2, BLOCK_B_ROWS = 4;
+
+        ///reasonable cache targets, we don't query the hardware, because the tiles only need to be in the right ballpark
+        static const int64_t L1_TARGET_BYTES = 16 * 1024, L2_TARGET_BYTES = 128 * 1024;
+    };
+
+}
+
+#endif //__DOT_MATRIX_HELPER_H__
@@ -0,0 +1,120 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Float16Helper.h"
+
+#include <cstring>
+
+//SSE2 is part of the x86-64 baseline, so no runtime dispatch is needed
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOAT16_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+#ifdef FLOAT16_USE_SSE2
+    //halves are zero extended into 4 int32 lanes
+    inline void storeHalves(const __m128i& halves, float* out)
+    {
+        const __m128i expMantissaMask = _mm_set1_epi32(0x7fff), infNanThreshold = _mm_set1_epi32(0x7bff), infNanExponent = _mm_set1_epi32(255 << 23);
+        const __m128 magicFloat = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+        __m128i expMantissa = _mm_and_si128(halves, expMantissaMask);
+        __m128i sign = _mm_slli_epi32(_mm_xor_si128(halves, expMantissa), 16);
+        __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMantissa, 13)), magicFloat);
+        __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMantissa, infNanThreshold), infNanExponent);
+        _mm_storeu_ps(out, _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan))));
+    }
+#endif
+}
+
+uint16_t Float16Helper::toFloat16(const float& value)
+{
+    const uint32_t F32_INFINITY = 255U << 23, F16_OVERFLOW = (127U + 16U) << 23, DENORM_MAGIC = ((127U - 15U) + (23U - 10U) + 1U) << 23;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    uint32_t sign = bits & 0x80000000U;
+    bits ^= sign;
+    uint16_t ret;
+    if (bits >= F16_OVERFLOW)
+    {
+        ret = (bits > F32_INFINITY) ? 0x7e00 : 0x7c00;
+    } else if (bits < (113U << 23)) {//result is denormal or zero, let float addition do the rounding
+        float temp, magicFloat;
+        memcpy(&temp, &bits, sizeof(float));
+        memcpy(&magicFloat, &DENORM_MAGIC, sizeof(float));
+        temp += magicFloat;
+        memcpy(&bits, &temp, sizeof(float));
+        ret = (uint16_t)(bits - DENORM_MAGIC);
+    } else {
+        uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += ((uint32_t)(15 - 127) << 23) + 0xfff;
+        bits += mantissaOdd;
+        ret = (uint16_t)(bits >> 13);
+    }
+    return ret | (uint16_t)(sign >> 16);
+}
+
+float Float16Helper::fromFloat16(const uint16_t& half)
+{//same arithmetic as the SSE2 version, so results don't depend on where the remainder starts
+    const uint32_t MAGIC_BITS = (254U - 15U) << 23;
+    uint32_t expMantissa = half & 0x7fffU;
+    uint32_t shifted = expMantissa << 13;
+    float scaled, magicFloat;
+    memcpy(&scaled, &shifted, sizeof(float));
+    memcpy(&magicFloat, &MAGIC_BITS, sizeof(float));
+    scaled *= magicFloat;//rebias the exponent, also normalizes denormals
+    uint32_t bits;
+    memcpy(&bits, &scaled, sizeof(float));
+    if (expMantissa > 0x7bffU) bits |= 255U << 23;//infinity or NaN
+    bits |= ((uint32_t)(half & 0x8000U)) << 16;
+    float ret;
+    memcpy(&ret, &bits, sizeof(float));
+    return ret;
+}
+
+void Float16Helper::toFloat16(const float* valuesIn, const int64_t& count, uint16_t* halvesOut)
+{
+    for (int64_t i = 0; i < count; ++i)
+    {
+        halvesOut[i] = toFloat16(valuesIn[i]);
+    }
+}
+
+void Float16Helper::fromFloat16(const uint16_t* halvesIn, const int64_t& count, float* valuesOut)
+{
+    int64_t i = 0;
+#ifdef FLOAT16_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i raw = _mm_loadu_si128((const __m128i*)(halvesIn + i));
+        storeHalves(_mm_unpacklo_epi16(raw, zero), valuesOut + i);
+        storeHalves(_mm_unpackhi_epi16(raw, zero), valuesOut + i + 4);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        valuesOut[i] = fromFloat16(halvesIn[i]);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef __FLOAT16_HELPER_H__
+#define __FLOAT16_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret
+{
+
+    ///conversion of floats to and from IEEE half precision, for storing large arrays where 3 significant digits are enough
+    class Float16Helper
+    {
+        Float16Helper();
+    public:
+        ///rounds to nearest even, keeps infinities, NaN and denormals, values too large for half become infinity
+        static uint16_t toFloat16(const float& value);
+        
+        static float fromFloat16(const uint16_t& half);
+        
+        static void toFloat16(const float* valuesIn, const int64_t& count, uint16_t* halvesOut);
+        
+        ///uses SSE2 when available, with results identical to the single value version
+        static void fromFloat16(const uint16_t* halvesIn, const int64_t& count, float* valuesOut);
+    };
+
+}
+
+#endif //__FLOAT16_HELPER_H__
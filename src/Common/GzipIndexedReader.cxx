@@ -0,0 +1,405 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "GzipIndexedReader.h"
+
+#ifdef CARET_GZIP_INDEXED_READER
+
+#include "CacheFile.h"
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t IN_BUF_SIZE = 1<<17;//128KiB of compressed data per file read
+    const int64_t MIN_SPAN = 1<<20;//uncompressed distance between checkpoints, same as zran
+    const int64_t SPAN_DIVISOR = 256;//for large files, space checkpoints so there are roughly this many per compressed size, to limit memory use (each has a 32KiB window)
+    const int64_t SKIP_BUF_SIZE = 1<<18;
+    const int MAX_WINDOW = 32768;
+    const char SIDECAR_MAGIC[8] = { 'W', 'B', 'G', 'Z', 'I', 'D', 'X', '\0' };
+    const int32_t SIDECAR_VERSION = 1;
+}
+
+bool GzipIndexedReader::s_useSidecar = false;
+
+GzipIndexedReader::GzipIndexedReader()
+{
+    m_strmInit = false;
+    m_rawMode = false;
+    m_atEnd = false;
+    m_indexComplete = false;
+    m_sidecarLoaded = false;
+    m_inPos = 0;
+    m_outPos = 0;
+    m_span = MIN_SPAN;
+    m_totalSize = -1;
+}
+
+bool GzipIndexedReader::isGzipFile(const QString& filename)
+{
+    QFile testFile(filename);
+    if (!testFile.open(QIODevice::ReadOnly)) return false;
+    unsigned char magic[2];
+    if (testFile.read((char*)magic, 2) != 2) return false;
+    return magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+void GzipIndexedReader::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::READ) throw DataFileException("indexed compressed file reading only supports READ mode");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        throw DataFileException("failed to open compressed file '" + filename + "': " + m_file.errorString());
+    }
+    m_span = max(MIN_SPAN, m_file.size() / SPAN_DIVISOR);
+    memset(&m_strm, 0, sizeof(z_stream));//sets zalloc, zfree, opaque to Z_NULL, so zlib uses its defaults
+    if (inflateInit2(&m_strm, 31) != Z_OK)//31 is gzip header only, 15 bit window
+    {
+        throw DataFileException("failed to initialize decompression for file '" + filename + "'");
+    }
+    m_strmInit = true;
+    m_inBuf.resize(IN_BUF_SIZE);
+    resetToStart();
+    if (s_useSidecar) loadSidecar();
+}
+
+void GzipIndexedReader::close()
+{
+    if (m_strmInit)
+    {
+        if (s_useSidecar && m_indexComplete && !m_sidecarLoaded && !m_checkpoints.empty())
+        {
+            writeSidecar();//doesn't throw
+        }
+        inflateEnd(&m_strm);
+        m_strmInit = false;
+    }
+    m_file.close();
+    m_checkpoints.clear();
+    m_inBuf.clear();
+    m_rawMode = false;
+    m_atEnd = false;
+    m_indexComplete = false;
+    m_sidecarLoaded = false;
+    m_inPos = 0;
+    m_outPos = 0;
+    m_totalSize = -1;
+}
+
+bool GzipIndexedReader::fillInput()
+{//keep any unconsumed input, so startNextMember can look ahead across a buffer boundary
+    if (m_strm.avail_in > 0 && m_strm.next_in != m_inBuf.data())
+    {
+        memmove(m_inBuf.data(), m_strm.next_in, m_strm.avail_in);
+    }
+    m_strm.next_in = m_inBuf.data();
+    int64_t toRead = (int64_t)m_inBuf.size() - m_strm.avail_in;
+    if (toRead <= 0) return true;
+    int64_t numRead = m_file.read((char*)m_inBuf.data() + m_strm.avail_in, toRead);
+    if (numRead < 0) throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+    m_inPos += numRead;
+    m_strm.avail_in += numRead;
+    return numRead > 0;
+}
+
+void GzipIndexedReader::resetToStart()
+{
+    if (!m_file.seek(0)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    m_inPos = 0;
+    m_strm.next_in = m_inBuf.data();
+    m_strm.avail_in = 0;
+    if (inflateReset2(&m_strm, 31) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+    m_rawMode = false;
+    m_atEnd = false;
+    m_outPos = 0;
+}
+
+void GzipIndexedReader::restoreCheckpoint(const Checkpoint& point)
+{
+    int64_t startByte = point.m_inPos - (point.m_bits != 0 ? 1 : 0);
+    if (!m_file.seek(startByte)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    m_inPos = startByte;
+    m_strm.next_in = m_inBuf.data();
+    m_strm.avail_in = 0;
+    if (inflateReset2(&m_strm, -15) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");//raw deflate, we are in the middle of a member
+    if (point.m_bits != 0)
+    {
+        if (!fillInput()) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+        int partialByte = m_strm.next_in[0];
+        ++m_strm.next_in;
+        --m_strm.avail_in;
+        inflatePrime(&m_strm, point.m_bits, partialByte >> (8 - point.m_bits));
+    }
+    if (!point.m_window.empty())
+    {
+        if (inflateSetDictionary(&m_strm, point.m_window.data(), point.m_window.size()) != Z_OK)
+        {
+            throw DataFileException("failed to restore decompression state for file '" + m_fileName + "'");
+        }
+    }
+    m_rawMode = true;
+    m_atEnd = false;
+    m_outPos = point.m_outPos;
+}
+
+void GzipIndexedReader::addCheckpoint()
+{
+    Checkpoint newPoint;
+    newPoint.m_outPos = m_outPos;
+    newPoint.m_inPos = m_inPos - m_strm.avail_in;
+    newPoint.m_bits = m_strm.data_type & 7;
+    newPoint.m_window.resize(MAX_WINDOW);
+    uInt windowSize = MAX_WINDOW;
+    if (inflateGetDictionary(&m_strm, newPoint.m_window.data(), &windowSize) != Z_OK) return;//not fatal, the next block boundary will do
+    newPoint.m_window.resize(windowSize);
+    m_checkpoints.push_back(newPoint);
+}
+
+bool GzipIndexedReader::startNextMember()
+{
+    if (m_rawMode)
+    {//zlib didn't parse the header of this member, so it leaves the trailer (crc32 and length) for us to skip
+        for (int i = 0; i < 8; ++i)
+        {
+            if (m_strm.avail_in == 0 && !fillInput()) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+            ++m_strm.next_in;
+            --m_strm.avail_in;
+        }
+    }
+    while (m_strm.avail_in < 2)
+    {
+        if (!fillInput()) break;
+    }//gzread ignores anything after a member that doesn't start with the gzip magic number, so do the same
+    if (m_strm.avail_in < 2 || m_strm.next_in[0] != 0x1f || m_strm.next_in[1] != 0x8b) return false;
+    if (inflateReset2(&m_strm, 31) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+    m_rawMode = false;
+    return true;
+}
+
+int64_t GzipIndexedReader::inflateInto(unsigned char* dataOut, const int64_t& count)
+{
+    int64_t totalOut = 0;
+    while (totalOut < count && !m_atEnd)
+    {
+        if (m_strm.avail_in == 0 && !fillInput())
+        {
+            throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+        }
+        uInt iterSize = (uInt)min(count - totalOut, (int64_t)1<<30);
+        m_strm.next_out = dataOut + totalOut;
+        m_strm.avail_out = iterSize;
+        int ret = inflate(&m_strm, Z_BLOCK);//stop at block boundaries, so we can add checkpoints
+        int64_t produced = iterSize - m_strm.avail_out;
+        totalOut += produced;
+        m_outPos += produced;
+        switch (ret)
+        {
+            case Z_OK:
+                if (!m_indexComplete && (m_strm.data_type & 128) && !(m_strm.data_type & 64))
+                {//at a block boundary that isn't the end of the member
+                    int64_t lastIndexed = (m_checkpoints.empty() ? 0 : m_checkpoints.back().m_outPos);
+                    if (m_outPos >= lastIndexed + m_span) addCheckpoint();
+                }
+                break;
+            case Z_STREAM_END:
+                if (!startNextMember())
+                {
+                    m_atEnd = true;
+                    if (!m_indexComplete)
+                    {//every pass that reaches the end goes through the unindexed region in order, so checkpoints now cover the whole file
+                        m_indexComplete = true;
+                        m_totalSize = m_outPos;
+                    }
+                }
+                break;
+            case Z_BUF_ERROR:
+                if (m_strm.avail_in == 0) break;//needs more input, loop will refill
+                //fall through
+            default://Z_DATA_ERROR, Z_MEM_ERROR, Z_NEED_DICT (shouldn't happen with gzip)
+                throw DataFileException("error while decompressing file '" + m_fileName + "'" +
+                                        (m_strm.msg != NULL ? ": " + QString(m_strm.msg) : QString()));
+        }
+    }
+    return totalOut;
+}
+
+void GzipIndexedReader::read(void* dataOut, const int64_t& count, int64_t* numRead)
+{
+    if (!m_strmInit) throw DataFileException("read called on unopened GzipIndexedReader");//shouldn't happen
+    int64_t totalRead = inflateInto((unsigned char*)dataOut, count);
+    if (numRead == NULL)
+    {
+        if (totalRead != count) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+    } else {
+        *numRead = totalRead;
+    }
+}
+
+void GzipIndexedReader::seek(const int64_t& position)
+{
+    if (!m_strmInit) throw DataFileException("seek called on unopened GzipIndexedReader");//shouldn't happen
+    CaretAssert(position >= 0);
+    if (position == m_outPos) return;
+    if (m_indexComplete && position > m_totalSize) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    int64_t low = 0, high = m_checkpoints.size();//find the last checkpoint at or before position
+    while (low < high)
+    {
+        int64_t mid = (low + high) / 2;
+        if (m_checkpoints[mid].m_outPos <= position)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    const Checkpoint* best = (low > 0 ? &(m_checkpoints[low - 1]) : NULL);
+    if (position < m_outPos || (best != NULL && best->m_outPos > m_outPos))
+    {//deflate can't go backwards, and jumping to a later checkpoint is faster than inflating up to it
+        if (best == NULL)
+        {
+            resetToStart();
+        } else {
+            restoreCheckpoint(*best);
+        }
+    }
+    vector<unsigned char> discard(min(position - m_outPos, SKIP_BUF_SIZE));
+    while (m_outPos < position)
+    {
+        int64_t skipped = inflateInto(discard.data(), min(position - m_outPos, (int64_t)discard.size()));
+        if (skipped == 0) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    }
+}
+
+void GzipIndexedReader::write(const void*, const int64_t&)
+{
+    throw DataFileException("write called on read-only compressed file '" + m_fileName + "'");//shouldn't happen, open() only allows READ
+}
+
+QString GzipIndexedReader::getSidecarName() const
+{
+    return m_fileName + ".gzidx";
+}
+
+bool GzipIndexedReader::loadSidecar()
+{
+    QFile sidecar(getSidecarName());
+    if (!sidecar.open(QIODevice::ReadOnly)) return false;
+    QFileInfo dataInfo(m_fileName);
+    char header[CacheFile::HEADER_SIZE];
+    int64_t compressedSize = -1, modifiedTime = -1, span = -1, totalSize = -1, numPoints = -1;
+    if (sidecar.read(header, CacheFile::HEADER_SIZE) != CacheFile::HEADER_SIZE || !CacheFile::checkHeader(header, SIDECAR_MAGIC, SIDECAR_VERSION) ||
+        !CacheFile::readValue(sidecar, compressedSize) || !CacheFile::readValue(sidecar, modifiedTime) ||
+        !CacheFile::readValue(sidecar, span) || !CacheFile::readValue(sidecar, totalSize) || !CacheFile::readValue(sidecar, numPoints))
+    {
+        CaretLogInfo("ignoring unrecognized gzip index file '" + sidecar.fileName() + "'");
+        return false;
+    }
+    if (compressedSize != dataInfo.size() || modifiedTime != dataInfo.lastModified().toMSecsSinceEpoch())
+    {
+        CaretLogInfo("ignoring out of date gzip index file '" + sidecar.fileName() + "'");
+        return false;
+    }
+    if (span < 1 || totalSize < 0 || numPoints < 0 || numPoints > totalSize / span + 1)
+    {
+        CaretLogInfo("ignoring invalid gzip index file '" + sidecar.fileName() + "'");
+        return false;
+    }
+    vector<Checkpoint> points(numPoints);
+    int64_t lastOut = 0;
+    for (int64_t i = 0; i < numPoints; ++i)
+    {
+        int32_t windowSize = -1;
+        if (!CacheFile::readValue(sidecar, points[i].m_outPos) || !CacheFile::readValue(sidecar, points[i].m_inPos) ||
+            !CacheFile::readValue(sidecar, points[i].m_bits) || !CacheFile::readValue(sidecar, windowSize) ||
+            points[i].m_outPos <= lastOut || points[i].m_outPos > totalSize || points[i].m_inPos > compressedSize ||
+            points[i].m_bits < 0 || points[i].m_bits > 7 || windowSize < 0 || windowSize > MAX_WINDOW)
+        {
+            CaretLogInfo("ignoring invalid gzip index file '" + sidecar.fileName() + "'");
+            return false;
+        }
+        lastOut = points[i].m_outPos;
+        points[i].m_window.resize(windowSize);
+        if (windowSize > 0 && sidecar.read((char*)points[i].m_window.data(), windowSize) != windowSize)
+        {
+            CaretLogInfo("ignoring truncated gzip index file '" + sidecar.fileName() + "'");
+            return false;
+        }
+    }
+    m_checkpoints.swap(points);
+    m_span = span;
+    m_totalSize = totalSize;
+    m_indexComplete = true;
+    m_sidecarLoaded = true;
+    return true;
+}
+
+void GzipIndexedReader::writeSidecar()
+{//failing to write the index isn't an error, it just means the next open has to index the file again
+    CacheFileWriter sidecar(getSidecarName());//written to a temporary name first, so another process never reads a partial index
+    QFileInfo dataInfo(m_fileName);
+    sidecar.writeHeader(SIDECAR_MAGIC, SIDECAR_VERSION);
+    sidecar.writeValue((int64_t)dataInfo.size());
+    sidecar.writeValue((int64_t)dataInfo.lastModified().toMSecsSinceEpoch());
+    sidecar.writeValue(m_span);
+    sidecar.writeValue(m_totalSize);
+    sidecar.writeValue((int64_t)m_checkpoints.size());
+    for (size_t i = 0; i < m_checkpoints.size(); ++i)
+    {
+        const Checkpoint& point = m_checkpoints[i];
+        int32_t windowSize = point.m_window.size();
+        sidecar.writeValue(point.m_outPos);
+        sidecar.writeValue(point.m_inPos);
+        sidecar.writeValue((int32_t)point.m_bits);
+        sidecar.writeValue(windowSize);
+        sidecar.write(point.m_window.data(), windowSize);
+    }
+    if (!sidecar.finish())
+    {
+        CaretLogFine("unable to write gzip index file: " + sidecar.getErrorString());
+    }
+}
+
+GzipIndexedReader::~GzipIndexedReader()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {//handles DataFileException, should be the only culprit
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
+
+#endif //CARET_GZIP_INDEXED_READER
@@ -0,0 +1,88 @@
+#ifndef __GZIP_INDEXED_READER_H__
+#define __GZIP_INDEXED_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBinaryFile.h"
+
+#include <QFile>
+#include "zlib.h"
+
+#include <vector>
+
+//inflateGetDictionary was added in zlib 1.2.8, without it, CaretBinaryFile uses gzread/gzseek for everything
+#if defined(ZLIB_VERNUM) && ZLIB_VERNUM >= 0x1280
+#define CARET_GZIP_INDEXED_READER
+
+namespace caret
+{
+    ///read-only gzip implementation that records inflate checkpoints as it decompresses, so that seeking backwards (or
+    ///re-reading part of a file) only needs to inflate from the nearest checkpoint, rather than from the start of the file
+    ///the technique is the same as zlib's examples/zran.c
+    class GzipIndexedReader : public CaretBinaryFile::ImplInterface
+    {
+        struct Checkpoint
+        {
+            int64_t m_outPos;//uncompressed position of the block boundary
+            int64_t m_inPos;//compressed offset of the first byte that is entirely after the boundary
+            int32_t m_bits;//number of bits of the previous byte that belong to the next block
+            std::vector<unsigned char> m_window;//up to 32KiB of uncompressed data before the boundary, for back-references
+        };
+        QFile m_file;
+        z_stream m_strm;
+        bool m_strmInit, m_rawMode, m_atEnd, m_indexComplete, m_sidecarLoaded;//raw mode means we restored from a checkpoint, so the next member trailer isn't handled by zlib
+        std::vector<unsigned char> m_inBuf;
+        int64_t m_inPos;//compressed bytes read from the file into m_inBuf
+        int64_t m_outPos;//uncompressed position
+        int64_t m_span, m_totalSize;
+        std::vector<Checkpoint> m_checkpoints;//sorted by m_outPos
+        static bool s_useSidecar;
+
+        bool fillInput();//returns false on end of file
+        void resetToStart();
+        void restoreCheckpoint(const Checkpoint& point);
+        void addCheckpoint();
+        bool startNextMember();//after Z_STREAM_END, returns false if there is no further gzip member
+        int64_t inflateInto(unsigned char* dataOut, const int64_t& count);//returns number of bytes decompressed, short only at end of data
+        QString getSidecarName() const;
+        bool loadSidecar();
+        void writeSidecar();
+    public:
+        GzipIndexedReader();
+        ///checks for the gzip magic number, so files that merely end in .gz can still be handled by gzread
+        static bool isGzipFile(const QString& filename);
+        ///when true, a complete index is saved next to the file as filename + ".gzidx" when it is closed, and reused when it is opened
+        static void setUseSidecarFiles(const bool& useSidecar) { s_useSidecar = useSidecar; }
+        static bool getUseSidecarFiles() { return s_useSidecar; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);
+        int64_t pos() { return m_outPos; }
+        int64_t size() { return (m_indexComplete ? m_totalSize : -1); }//uncompressed size is only known after reaching the end once
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~GzipIndexedReader();
+    };
+}
+
+#endif //ZLIB_VERNUM
+
+#endif //__GZIP_INDEXED_READER_H__
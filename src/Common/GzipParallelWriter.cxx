@@ -0,0 +1,220 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "GzipParallelWriter.h"
+
+#ifdef CARET_GZIP_PARALLEL_WRITER
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+const int64_t GzipParallelWriter::BLOCK_SIZE = 1<<18;//256KiB, dictionary priming makes the compression ratio nearly the same as serial deflate
+
+namespace
+{
+    const int64_t MAX_DICT = 32768;
+    const int BLOCKS_PER_THREAD = 4;//compress several blocks per thread at a time, for load balancing and fewer parallel regions
+
+    struct CompressedBlock
+    {
+        vector<unsigned char> m_data;
+        uLong m_crc;
+        int64_t m_inSize;
+    };
+
+    void writeLittleEndian32(unsigned char* out, const uint32_t& value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+        }
+    }
+}
+
+void GzipParallelWriter::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
+{
+    close();
+    m_fileName = filename;
+    if (opmode != CaretBinaryFile::WRITE_TRUNCATE) throw DataFileException("parallel compressed file writing only supports WRITE_TRUNCATE mode");
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw DataFileException("failed to open compressed file '" + filename + "' for writing: " + m_file.errorString());
+    }
+    m_open = true;
+    m_pending.clear();
+    m_dictSize = 0;
+    m_totalIn = 0;
+    m_crc = crc32(0L, Z_NULL, 0);
+    //minimal gzip header: magic, deflate, no flags, no mtime, no extra flags, unknown OS
+    const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };
+    writeToFile(header, 10);
+}
+
+void GzipParallelWriter::writeToFile(const void* data, const int64_t& count)
+{
+    if (m_file.write((const char*)data, count) != count)
+    {
+        throw DataFileException("failed to write to compressed file '" + m_fileName + "': " + m_file.errorString());
+    }
+}
+
+void GzipParallelWriter::compressPending(const bool& finish)
+{
+    int64_t dataSize = (int64_t)m_pending.size() - m_dictSize;
+    int64_t numBlocks = dataSize / BLOCK_SIZE;
+    if (finish && (numBlocks * BLOCK_SIZE < dataSize || numBlocks == 0)) ++numBlocks;//the last block may be partial, and we need a final block even if it is empty
+    if (numBlocks == 0) return;
+    vector<CompressedBlock> blocks(numBlocks);
+    bool failed = false;
+#pragma omp CARET_PAR
+    {
+        z_stream strm;
+        memset(&strm, 0, sizeof(z_stream));
+        bool initOK = (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK);//same defaults as gzopen "wb", raw deflate since we write the header ourselves
+        bool threadFailed = !initOK;//per-thread, so the loop never reads a flag another thread may be writing
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            if (threadFailed) continue;//can't break out of a parallel for
+            const int64_t start = m_dictSize + i * BLOCK_SIZE;
+            CompressedBlock& thisBlock = blocks[i];
+            thisBlock.m_inSize = min(BLOCK_SIZE, (int64_t)m_pending.size() - start);
+            const bool lastBlock = finish && (i == numBlocks - 1);
+            const int64_t dictLength = min(MAX_DICT, start);
+            thisBlock.m_crc = crc32(0L, m_pending.data() + start, thisBlock.m_inSize);
+            thisBlock.m_data.resize(deflateBound(&strm, thisBlock.m_inSize) + 16);//sync flush can add a few bytes more than deflateBound
+            bool blockOK = (deflateReset(&strm) == Z_OK);
+            if (blockOK && dictLength > 0)
+            {
+                blockOK = (deflateSetDictionary(&strm, m_pending.data() + start - dictLength, dictLength) == Z_OK);
+            }
+            strm.next_in = m_pending.data() + start;
+            strm.avail_in = thisBlock.m_inSize;
+            int64_t outUsed = 0;
+            while (blockOK)
+            {
+                strm.next_out = thisBlock.m_data.data() + outUsed;
+                strm.avail_out = thisBlock.m_data.size() - outUsed;
+                int ret = deflate(&strm, (lastBlock ? Z_FINISH : Z_SYNC_FLUSH));
+                outUsed = thisBlock.m_data.size() - strm.avail_out;
+                if (ret == Z_STREAM_ERROR) blockOK = false;
+                if (lastBlock ? ret == Z_STREAM_END : (strm.avail_out != 0 && strm.avail_in == 0)) break;//sync flush is complete when it doesn't fill the output
+                thisBlock.m_data.resize(thisBlock.m_data.size() * 2);
+            }
+            thisBlock.m_data.resize(outUsed);
+            if (!blockOK) threadFailed = true;
+        }
+        if (initOK) deflateEnd(&strm);
+        if (threadFailed)
+        {
+#pragma omp critical
+            failed = true;
+        }
+    }
+    if (failed) throw DataFileException("error while compressing data for file '" + m_fileName + "'");
+    for (int64_t i = 0; i < numBlocks; ++i)
+    {
+        writeToFile(blocks[i].m_data.data(), blocks[i].m_data.size());
+        m_crc = crc32_combine(m_crc, blocks[i].m_crc, blocks[i].m_inSize);
+        m_totalIn += blocks[i].m_inSize;
+    }
+    int64_t keepDict = min(MAX_DICT, (int64_t)m_pending.size());
+    m_pending.erase(m_pending.begin(), m_pending.end() - keepDict);
+    m_dictSize = keepDict;
+}
+
+void GzipParallelWriter::write(const void* dataIn, const int64_t& count)
+{
+    if (!m_open) throw DataFileException("write called on unopened GzipParallelWriter");//shouldn't happen
+    const int64_t batchSize = BLOCK_SIZE * BLOCKS_PER_THREAD * omp_get_max_threads();
+    const unsigned char* charData = (const unsigned char*)dataIn;
+    int64_t written = 0;
+    while (written < count)
+    {//don't buffer more than one batch, even for very large writes
+        int64_t toCopy = min(count - written, batchSize - ((int64_t)m_pending.size() - m_dictSize));
+        m_pending.insert(m_pending.end(), charData + written, charData + written + toCopy);
+        written += toCopy;
+        if ((int64_t)m_pending.size() - m_dictSize >= batchSize)
+        {
+            compressPending(false);
+        }
+    }
+}
+
+void GzipParallelWriter::seek(const int64_t& position)
+{
+    if (!m_open) throw DataFileException("seek called on unopened GzipParallelWriter");//shouldn't happen
+    int64_t curPos = pos();
+    if (position < curPos) throw DataFileException("seek failed in compressed file '" + m_fileName + "', can't seek backwards while writing");
+    if (position == curPos) return;
+    vector<char> zeros(min(position - curPos, BLOCK_SIZE), 0);
+    while (curPos < position)
+    {
+        int64_t toWrite = min(position - curPos, (int64_t)zeros.size());
+        write(zeros.data(), toWrite);
+        curPos += toWrite;
+    }
+}
+
+void GzipParallelWriter::read(void*, const int64_t&, int64_t*)
+{
+    throw DataFileException("read called on write-only compressed file '" + m_fileName + "'");//shouldn't happen, open() only allows WRITE_TRUNCATE
+}
+
+void GzipParallelWriter::close()
+{
+    if (!m_open) return;
+    m_open = false;//if finishing throws, don't try again from the destructor
+    compressPending(true);
+    unsigned char trailer[8];
+    writeLittleEndian32(trailer, (uint32_t)m_crc);
+    writeLittleEndian32(trailer + 4, (uint32_t)(m_totalIn & 0xFFFFFFFF));//gzip stores the length modulo 2^32
+    writeToFile(trailer, 8);
+    m_pending.clear();
+    m_file.close();
+    if (m_file.error() != QFile::NoError)
+    {
+        throw DataFileException("error closing compressed file '" + m_fileName + "': " + m_file.errorString());
+    }
+}
+
+GzipParallelWriter::~GzipParallelWriter()
+{
+    try//throwing from a destructor is a bad idea
+    {
+        close();
+    } catch (CaretException& e) {//handles DataFileException, should be the only culprit
+        CaretLogSevere(e.whatString());
+    } catch (exception& e) {
+        CaretLogSevere(e.what());
+    } catch (...) {
+        CaretLogSevere("caught unknown exception type while closing a compressed file");
+    }
+}
+
+#endif //CARET_GZIP_PARALLEL_WRITER
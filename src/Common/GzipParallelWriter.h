@@ -0,0 +1,67 @@
+#ifndef __GZIP_PARALLEL_WRITER_H__
+#define __GZIP_PARALLEL_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretBinaryFile.h"
+#include "CaretOMP.h"
+
+#include <QFile>
+#include "zlib.h"
+
+#include <vector>
+
+//without openmp, this would just be a slower gzwrite, so CaretBinaryFile only uses it when openmp is enabled
+#if defined(CARET_OMP) && defined(ZLIB_VERNUM) && ZLIB_VERNUM >= 0x1230
+#define CARET_GZIP_PARALLEL_WRITER
+
+namespace caret
+{
+    ///write-only gzip implementation that compresses blocks of the input in parallel, like pigz
+    ///each block is raw deflate primed with the last 32KiB of the previous block, and ends with a sync flush, so the
+    ///output is a single standard gzip member that gunzip, gzread, etc can decompress
+    class GzipParallelWriter : public CaretBinaryFile::ImplInterface
+    {
+        QFile m_file;
+        std::vector<unsigned char> m_pending;//uncompressed data, the first m_dictSize bytes are already compressed, and are kept as the dictionary for the next block
+        int64_t m_dictSize;
+        int64_t m_totalIn;//uncompressed bytes already compressed and written
+        uLong m_crc;
+        bool m_open;
+        void compressPending(const bool& finish);
+        void writeToFile(const void* data, const int64_t& count);
+    public:
+        static const int64_t BLOCK_SIZE;//uncompressed bytes per independently compressed block
+        GzipParallelWriter() { m_dictSize = 0; m_totalIn = 0; m_crc = 0; m_open = false; }
+        void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
+        void close();
+        void seek(const int64_t& position);//only forward, fills with zeros, like gzseek when writing
+        int64_t pos() { return m_totalIn + (int64_t)m_pending.size() - m_dictSize; }
+        int64_t size() { return -1; }
+        void read(void* dataOut, const int64_t& count, int64_t* numRead);
+        void write(const void* dataIn, const int64_t& count);
+        ~GzipParallelWriter();
+    };
+}
+
+#endif //CARET_OMP && ZLIB_VERNUM
+
+#endif //__GZIP_PARALLEL_WRITER_H__
@@ -21,8 +21,11 @@
 #include "ReductionOperation.h"
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretOMP.h"
 #include "MathFunctions.h"
 
+#include <QStringList>
+
 #include <algorithm>
 #include <cmath>
 #include <limits>
@@ -31,6 +34,72 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///median by selection, reorders the data, same result as sorting and taking the center (or averaging the middle two)
+    float selectMedian(vector<float>& data)
+    {
+        const int64_t numElems = (int64_t)data.size();
+        const int64_t half = numElems / 2;
+        nth_element(data.begin(), data.begin() + half, data.end());
+        const float upper = data[half];
+        if ((numElems & 1) == 0)//if even, average middle two
+        {
+            const float lower = *max_element(data.begin(), data.begin() + half);//nth_element leaves only smaller or equal values before half
+            return (lower + upper) / 2.0f;
+        }
+        return upper;//otherwise, take the center
+    }
+    
+    ///most frequent value of sorted data, the smallest such value on ties
+    float modeOfSorted(const vector<float>& dataSorted)
+    {
+        const int64_t numElems = (int64_t)dataSorted.size();
+        int bestCount = 0, curCount = 1;
+        float bestval = -1.0f, curval = dataSorted[0];
+        for (int64_t i = 1; i < numElems; ++i)//search for largest contiguous region
+        {
+            if (dataSorted[i] == curval)
+            {
+                ++curCount;
+            } else {
+                if (curCount > bestCount)
+                {
+                    bestval = curval;
+                    bestCount = curCount;
+                }
+                curval = dataSorted[i];
+                curCount = 1;
+            }
+        }
+        if (curCount > bestCount)
+        {
+            bestval = curval;
+            bestCount = curCount;
+        }
+        return bestval;
+    }
+    
+    ///1-based index of the first max or min numeric value within [low, high], 0 if there is none
+    int64_t extremeIndexInRange(const float* data, const int64_t& numElems, const bool& findMax, const float& low, const float& high)
+    {
+        float extreme = 0.0f;
+        int64_t index = -1;
+        bool first = true;
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if (MathFunctions::isNumeric(data[i]) && data[i] >= low && data[i] <= high &&
+                (first || (findMax ? data[i] > extreme : data[i] < extreme)))
+            {
+                first = false;
+                extreme = data[i];
+                index = i;
+            }
+        }
+        return index + 1;
+    }
+}
+
 float ReductionOperation::reduce(const float* data, const int64_t& numElems, const ReductionEnum::Enum& type)
 {
     CaretAssert(numElems > 0);
@@ -131,44 +200,14 @@ float ReductionOperation::reduce(const float* data, const int64_t& numElems, con
         }
         case ReductionEnum::MEDIAN:
         {
-            vector<float> dataCopy(numElems);
-            for (int64_t i = 0; i < numElems; ++i) dataCopy[i] = data[i];
-            sort(dataCopy.begin(), dataCopy.end());
-            if ((numElems & 1) == 0)//if even, average middle two
-            {
-                return (dataCopy[numElems / 2 - 1] + dataCopy[numElems / 2]) / 2.0f;
-            } else {
-                return dataCopy[numElems / 2];//otherwise, take the center
-            }
+            vector<float> dataCopy(data, data + numElems);
+            return selectMedian(dataCopy);
         }
         case ReductionEnum::MODE:
         {
-            vector<float> dataCopy(numElems);
-            for (int64_t i = 0; i < numElems; ++i) dataCopy[i] = data[i];
+            vector<float> dataCopy(data, data + numElems);
             sort(dataCopy.begin(), dataCopy.end());//sort to put same-value next to each other, a hash based map could be faster for large arrays, but oh well
-            int bestCount = 0, curCount = 1;
-            float bestval = -1.0f, curval = dataCopy[0];
-            for (int64_t i = 1; i < numElems; ++i)//search for largest contiguous region
-            {
-                if (dataCopy[i] == curval)
-                {
-                    ++curCount;
-                } else {
-                    if (curCount > bestCount)
-                    {
-                        bestval = curval;
-                        bestCount = curCount;
-                    }
-                    curval = dataCopy[i];
-                    curCount = 1;
-                }
-            }
-            if (curCount > bestCount)
-            {
-                bestval = curval;
-                bestCount = curCount;
-            }
-            return bestval;
+            return modeOfSorted(dataCopy);
         }
         case ReductionEnum::COUNT_NONZERO:
         {
@@ -538,6 +577,292 @@ float ReductionOperation::reduceWeightedExcludeDev(const float* data, const floa
     return reduceWeighted(excluded.data(), exweights.data(), excluded.size(), type);
 }
 
+void ReductionOperation::reduceMultiple(const float* data, const int64_t& numElems, const vector<ReductionEnum::Enum>& types, float* resultsOut, Scratch& scratch)
+{
+    CaretAssert(numElems > 0);
+    bool needResiduals = false, needProduct = false, needSorted = false, needMedian = false;
+    for (size_t t = 0; t < types.size(); ++t)
+    {
+        switch (types[t])
+        {
+            case ReductionEnum::INVALID:
+                throw CaretException("reduction requested with 'INVALID' method");
+            case ReductionEnum::SAMPSTDEV:
+            case ReductionEnum::TSNR:
+            case ReductionEnum::COV:
+                if (numElems < 2) throw CaretException("taking the sample standard deviation of 1 element would require dividing by zero");
+            case ReductionEnum::STDEV:
+            case ReductionEnum::VARIANCE:
+                needResiduals = true;
+                break;
+            case ReductionEnum::PRODUCT:
+                needProduct = true;
+                break;
+            case ReductionEnum::MEDIAN:
+                needMedian = true;
+                break;
+            case ReductionEnum::MODE:
+                needSorted = true;
+                break;
+            default:
+                break;
+        }
+    }
+    double sum = 0.0;//same order of operations as reduce(), so the results are identical
+    float maxVal = data[0], minVal = data[0];
+    int64_t maxIndex = 0, minIndex = 0, countNonzero = 0;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        const float value = data[i];
+        sum += value;
+        if (value > maxVal)
+        {
+            maxVal = value;
+            maxIndex = i;
+        }
+        if (value < minVal)
+        {
+            minVal = value;
+            minIndex = i;
+        }
+        countNonzero += (value != 0.0f);
+    }
+    const float mean = sum / numElems;
+    double residsqr = 0.0;
+    if (needResiduals)
+    {
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            float tempf = data[i] - mean;
+            residsqr += tempf * tempf;
+        }
+    }
+    double prod = 1.0;
+    if (needProduct)
+    {
+        for (int64_t i = 0; i < numElems; ++i) prod *= data[i];
+    }
+    float median = 0.0f, mode = 0.0f;
+    if (needMedian || needSorted)
+    {
+        scratch.m_sorted.assign(data, data + numElems);
+        if (needSorted)
+        {
+            sort(scratch.m_sorted.begin(), scratch.m_sorted.end());
+            mode = modeOfSorted(scratch.m_sorted);
+        }
+        if (needMedian)
+        {
+            median = selectMedian(scratch.m_sorted);
+        }
+    }
+    for (size_t t = 0; t < types.size(); ++t)
+    {
+        switch (types[t])
+        {
+            case ReductionEnum::INVALID:
+                CaretAssert(0);
+                break;
+            case ReductionEnum::SUM:
+                resultsOut[t] = sum;
+                break;
+            case ReductionEnum::MEAN:
+                resultsOut[t] = sum / numElems;
+                break;
+            case ReductionEnum::STDEV:
+                resultsOut[t] = sqrt(residsqr / numElems);
+                break;
+            case ReductionEnum::SAMPSTDEV:
+                resultsOut[t] = sqrt(residsqr / (numElems - 1));
+                break;
+            case ReductionEnum::VARIANCE:
+                resultsOut[t] = residsqr / numElems;
+                break;
+            case ReductionEnum::TSNR:
+                resultsOut[t] = mean / sqrt(residsqr / (numElems - 1));
+                break;
+            case ReductionEnum::COV:
+                resultsOut[t] = sqrt(residsqr / (numElems - 1)) / mean;
+                break;
+            case ReductionEnum::PRODUCT:
+                resultsOut[t] = prod;
+                break;
+            case ReductionEnum::MAX:
+                resultsOut[t] = maxVal;
+                break;
+            case ReductionEnum::MIN:
+                resultsOut[t] = minVal;
+                break;
+            case ReductionEnum::INDEXMAX:
+                resultsOut[t] = maxIndex + 1;//1-based, to match gui and column arguments
+                break;
+            case ReductionEnum::INDEXMIN:
+                resultsOut[t] = minIndex + 1;
+                break;
+            case ReductionEnum::MEDIAN:
+                resultsOut[t] = median;
+                break;
+            case ReductionEnum::MODE:
+                resultsOut[t] = mode;
+                break;
+            case ReductionEnum::COUNT_NONZERO:
+                resultsOut[t] = countNonzero;
+                break;
+        }
+    }
+}
+
+void ReductionOperation::reduceMultipleExcludeDev(const float* data, const int64_t& numElems, const vector<ReductionEnum::Enum>& types, const float& numDevBelow, const float& numDevAbove,
+                                                  float* resultsOut, Scratch& scratch)
+{
+    CaretAssert(numElems > 0);
+    double sum = 0.0;
+    int64_t validNum = 0;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        if (MathFunctions::isNumeric(data[i]))
+        {
+            ++validNum;
+            sum += data[i];
+        }
+    }
+    if (validNum == 0) throw CaretException("all input values to reduceExcludeDev were non-numeric");
+    float mean = sum / validNum;
+    double residsqr = 0.0;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        if (MathFunctions::isNumeric(data[i]))
+        {
+            float tempf = data[i] - mean;
+            residsqr += tempf * tempf;
+        }
+    }
+    float stdev = sqrt(residsqr / validNum);
+    float low = mean - numDevBelow * stdev, high = mean + numDevAbove * stdev;
+    scratch.m_filtered.clear();
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        if (MathFunctions::isNumeric(data[i]) && data[i] >= low && data[i] <= high) scratch.m_filtered.push_back(data[i]);
+    }
+    bool needFiltered = false;
+    for (size_t t = 0; t < types.size(); ++t)
+    {
+        switch (types[t])
+        {
+            case ReductionEnum::INDEXMAX:
+            case ReductionEnum::INDEXMIN:
+                break;
+            case ReductionEnum::SAMPSTDEV:
+                if (scratch.m_filtered.size() == 1) throw CaretException("SAMPSTDEV requested in reduceExcludeDev when only 1 element passed the exclusion parameters");
+            default:
+                needFiltered = true;
+                break;
+        }
+    }
+    if (needFiltered)
+    {
+        if (scratch.m_filtered.size() == 0) throw CaretException("exclusion parameters to reduceExcludeDev resulted in no usable data");
+        reduceMultiple(scratch.m_filtered.data(), scratch.m_filtered.size(), types, resultsOut, scratch);
+    }
+    for (size_t t = 0; t < types.size(); ++t)
+    {//indices must be of the unfiltered data
+        if (types[t] == ReductionEnum::INDEXMAX) resultsOut[t] = extremeIndexInRange(data, numElems, true, low, high);
+        if (types[t] == ReductionEnum::INDEXMIN) resultsOut[t] = extremeIndexInRange(data, numElems, false, low, high);
+    }
+}
+
+void ReductionOperation::reduceMultipleOnlyNumeric(const float* data, const int64_t& numElems, const vector<ReductionEnum::Enum>& types, float* resultsOut, Scratch& scratch)
+{
+    CaretAssert(numElems > 0);
+    scratch.m_filtered.clear();
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        if (MathFunctions::isNumeric(data[i])) scratch.m_filtered.push_back(data[i]);
+    }
+    if (scratch.m_filtered.size() < 1) throw CaretException("all input values to reduceOnlyNumeric were non-numeric");
+    for (size_t t = 0; t < types.size(); ++t)
+    {
+        if (types[t] == ReductionEnum::SAMPSTDEV && scratch.m_filtered.size() < 2) throw CaretException("SAMPSTDEV requested in reduceOnlyNumeric when only 1 element is numeric");
+    }
+    reduceMultiple(scratch.m_filtered.data(), scratch.m_filtered.size(), types, resultsOut, scratch);
+    const float inf = numeric_limits<float>::infinity();
+    for (size_t t = 0; t < types.size(); ++t)
+    {//indices must be of the unfiltered data
+        if (types[t] == ReductionEnum::INDEXMAX) resultsOut[t] = extremeIndexInRange(data, numElems, true, -inf, inf);
+        if (types[t] == ReductionEnum::INDEXMIN) resultsOut[t] = extremeIndexInRange(data, numElems, false, -inf, inf);
+    }
+}
+
+void ReductionOperation::reduceAcrossColumns(const vector<const float*>& columns, const int64_t& numRows, const vector<ReductionEnum::Enum>& types,
+                                             const vector<float*>& resultsOut, const bool& onlyNumeric,
+                                             const bool& excludeDev, const float& numDevBelow, const float& numDevAbove)
+{
+    const int64_t numCols = (int64_t)columns.size();
+    const int64_t numTypes = (int64_t)types.size();
+    CaretAssert(numCols > 0);
+    CaretAssert(resultsOut.size() == types.size());
+    bool failed = false;
+    AString message;
+#pragma omp CARET_PAR
+    {
+        Scratch scratch;
+        vector<float> values(numCols), results(numTypes);
+        bool threadFailed = false;//per-thread, so the loop never reads a flag another thread may be writing
+        AString threadMessage;
+#pragma omp CARET_FOR schedule(dynamic, 256)
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            if (threadFailed) continue;//can't break out of a parallel for, or throw out of a parallel region
+            for (int64_t j = 0; j < numCols; ++j)
+            {
+                values[j] = columns[j][i];
+            }
+            try
+            {
+                if (excludeDev)
+                {
+                    reduceMultipleExcludeDev(values.data(), numCols, types, numDevBelow, numDevAbove, results.data(), scratch);
+                } else if (onlyNumeric) {
+                    reduceMultipleOnlyNumeric(values.data(), numCols, types, results.data(), scratch);
+                } else {
+                    reduceMultiple(values.data(), numCols, types, results.data(), scratch);
+                }
+            } catch (CaretException& e) {
+                threadFailed = true;
+                threadMessage = e.whatString();
+                continue;
+            }
+            for (int64_t t = 0; t < numTypes; ++t)
+            {
+                resultsOut[t][i] = results[t];
+            }
+        }
+        if (threadFailed)
+        {
+#pragma omp critical
+            {
+                failed = true;
+                message = threadMessage;
+            }
+        }
+    }
+    if (failed) throw CaretException(message);
+}
+
+vector<ReductionEnum::Enum> ReductionOperation::typesFromString(const AString& typeString)
+{
+    vector<ReductionEnum::Enum> ret;
+    QStringList names = typeString.split(',');
+    for (int i = 0; i < names.size(); ++i)
+    {
+        bool ok = false;
+        ReductionEnum::Enum type = ReductionEnum::fromName(names[i].trimmed(), &ok);
+        if (!ok) throw CaretException("unrecognized operation string '" + names[i] + "'");
+        ret.push_back(type);
+    }
+    return ret;
+}
+
 AString ReductionOperation::getHelpInfo()
 {
     AString ret;
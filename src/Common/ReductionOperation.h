@@ -24,6 +24,8 @@
 #include "AString.h"
 #include "ReductionEnum.h"
 
+#include <vector>
+
 namespace caret {
     
     class ReductionOperation
@@ -37,6 +39,24 @@ namespace caret {
         static float reduceWeighted(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
         static float reduceWeightedExcludeDev(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type, const float& numDevBelow, const float& numDevAbove);
         static float reduceWeightedOnlyNumeric(const float* data, const float* weights, const int64_t& numElems, const ReductionEnum::Enum& type);
+        ///reusable buffers for the reduceMultiple functions, so they don't allocate on every call, use one per thread
+        class Scratch
+        {
+            std::vector<float> m_filtered, m_sorted;
+            friend class ReductionOperation;
+        };
+        ///several reductions of the same data, sharing the passes over the data and using selection instead of sorting for MEDIAN
+        ///results match calling the single-type function for each type, resultsOut must have room for types.size() values
+        static void reduceMultiple(const float* data, const int64_t& numElems, const std::vector<ReductionEnum::Enum>& types, float* resultsOut, Scratch& scratch);
+        static void reduceMultipleExcludeDev(const float* data, const int64_t& numElems, const std::vector<ReductionEnum::Enum>& types, const float& numDevBelow, const float& numDevAbove,
+                                             float* resultsOut, Scratch& scratch);
+        static void reduceMultipleOnlyNumeric(const float* data, const int64_t& numElems, const std::vector<ReductionEnum::Enum>& types, float* resultsOut, Scratch& scratch);
+        ///reduces across the columns for every row, in parallel: the values for row i are columns[j][i], and result t for row i goes to resultsOut[t][i]
+        static void reduceAcrossColumns(const std::vector<const float*>& columns, const int64_t& numRows, const std::vector<ReductionEnum::Enum>& types,
+                                        const std::vector<float*>& resultsOut, const bool& onlyNumeric = false,
+                                        const bool& excludeDev = false, const float& numDevBelow = 0.0f, const float& numDevAbove = 0.0f);
+        ///parses a comma separated list of reduction names
+        static std::vector<ReductionEnum::Enum> typesFromString(const AString& typeString);
         static AString getHelpInfo();
     };
     
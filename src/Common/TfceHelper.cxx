@@ -0,0 +1,269 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TfceHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+struct TfceHelper::SurfaceNeighbors
+{
+    const int64_t* m_start;
+    const int32_t* m_list;
+    void getNeighbors(const int64_t& elem, vector<int64_t>& out) const
+    {
+        out.assign(m_list + m_start[elem], m_list + m_start[elem + 1]);
+    }
+};
+
+struct TfceHelper::GridNeighbors
+{
+    int64_t m_dims[3];
+    void getNeighbors(const int64_t& elem, vector<int64_t>& out) const
+    {
+        out.clear();
+        int64_t i = elem % m_dims[0], rest = elem / m_dims[0];
+        int64_t j = rest % m_dims[1], k = rest / m_dims[1];
+        int64_t jstride = m_dims[0], kstride = m_dims[0] * m_dims[1];
+        if (i > 0) out.push_back(elem - 1);
+        if (i + 1 < m_dims[0]) out.push_back(elem + 1);
+        if (j > 0) out.push_back(elem - jstride);
+        if (j + 1 < m_dims[1]) out.push_back(elem + jstride);
+        if (k > 0) out.push_back(elem - kstride);
+        if (k + 1 < m_dims[2]) out.push_back(elem + kstride);
+    }
+};
+
+namespace
+{
+    struct ValueDescending
+    {//ties go in index order, so results don't depend on the sort implementation
+        bool operator()(const pair<float, int64_t>& left, const pair<float, int64_t>& right) const
+        {
+            if (left.first != right.first) return left.first > right.first;
+            return left.second < right.second;
+        }
+    };
+    
+    //each element's score is the sum of m_offset along its path to the root, plus the root's accumulated integral
+    //path compression folds the offsets of the skipped parents into each element, so later lookups are nearly constant time
+    int64_t findRoot(const int64_t& elem, vector<int64_t>& parent, vector<double>& offset, vector<int64_t>& path)
+    {
+        path.clear();
+        int64_t current = elem;
+        while (parent[current] != current)
+        {
+            path.push_back(current);
+            current = parent[current];
+        }
+        for (int64_t i = (int64_t)path.size() - 1; i >= 0; --i)
+        {//start nearest the root, so each parent is already compressed when its children use it
+            int64_t node = path[i], nodeParent = parent[node];
+            if (nodeParent != current)
+            {
+                offset[node] += offset[nodeParent];
+                parent[node] = current;
+            }
+        }
+        return current;
+    }
+}
+
+TfceHelper::TfceHelper(const vector<int64_t>& neighborStart, const vector<int32_t>& neighborList, const vector<float>& elementSizes,
+                       const float& param_e, const float& param_h)
+{
+    CaretAssert(neighborStart.size() == elementSizes.size() + 1);
+    CaretAssert(neighborStart.back() == (int64_t)neighborList.size());
+    m_neighborStart = neighborStart;
+    m_neighborList = neighborList;
+    m_elementSizes = elementSizes;
+    m_numElements = (int64_t)elementSizes.size();
+    m_dims[0] = m_numElements;
+    m_dims[1] = 1;
+    m_dims[2] = 1;
+    m_voxelSize = 0.0f;
+    m_param_e = param_e;
+    m_integrated_h = param_h + 1.0;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+    m_isGrid = false;
+}
+
+TfceHelper::TfceHelper(const int64_t dims[3], const float& voxelSize, const float& param_e, const float& param_h)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        m_dims[i] = dims[i];
+    }
+    m_numElements = dims[0] * dims[1] * dims[2];
+    m_voxelSize = voxelSize;
+    m_param_e = param_e;
+    m_integrated_h = param_h + 1.0;
+    m_isGrid = true;
+}
+
+void TfceHelper::enhance(const float* data, float* outData, const float* roiData) const
+{
+    Workspace work;
+    enhance(data, outData, roiData, work);
+}
+
+void TfceHelper::enhance(const float* data, float* outData, const float* roiData, Workspace& work) const
+{
+    if ((int64_t)work.m_parent.size() != m_numElements)
+    {
+        work.m_parent.assign(m_numElements, -1);//-1 marks elements that aren't in a cluster yet, sweep() resets only the elements it used
+        work.m_count.resize(m_numElements);
+        work.m_offset.resize(m_numElements);
+        work.m_accum.resize(m_numElements);
+        work.m_extent.resize(m_numElements);
+        work.m_lastVal.resize(m_numElements);
+    }
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        outData[i] = 0.0f;
+    }
+    if (m_isGrid)
+    {
+        GridNeighbors neighbors;
+        for (int i = 0; i < 3; ++i)
+        {
+            neighbors.m_dims[i] = m_dims[i];
+        }
+        sweep(neighbors, data, false, outData, roiData, work);
+        sweep(neighbors, data, true, outData, roiData, work);//negatives and positives don't overlap, so they can share the output
+    } else {
+        SurfaceNeighbors neighbors;
+        neighbors.m_start = m_neighborStart.data();
+        neighbors.m_list = m_neighborList.data();
+        sweep(neighbors, data, false, outData, roiData, work);
+        sweep(neighbors, data, true, outData, roiData, work);
+    }
+}
+
+void TfceHelper::enhanceMultiple(const vector<const float*>& dataList, const vector<float*>& outList, const float* roiData) const
+{
+    CaretAssert(dataList.size() == outList.size());
+    int numMaps = (int)dataList.size();
+#pragma omp CARET_PAR
+    {
+        Workspace work;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int i = 0; i < numMaps; ++i)
+        {
+            enhance(dataList[i], outList[i], roiData, work);
+        }
+    }
+}
+
+template <typename NEIGHBORS>
+void TfceHelper::sweep(const NEIGHBORS& neighbors, const float* data, const bool& negate, float* outData, const float* roiData, Workspace& work) const
+{
+    vector<pair<float, int64_t> >& order = work.m_order;
+    vector<int64_t>& parent = work.m_parent, &count = work.m_count, &touching = work.m_touching;
+    vector<double>& offset = work.m_offset, &accum = work.m_accum, &extent = work.m_extent;
+    vector<float>& lastVal = work.m_lastVal;
+    order.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (roiData == NULL || roiData[i] > 0.0f)
+        {
+            float value = (negate ? -data[i] : data[i]);
+            if (value > 0.0f) order.push_back(pair<float, int64_t>(value, i));
+        }
+    }
+    sort(order.begin(), order.end(), ValueDescending());//sorting once replaces the heap, and lets the sweep visit thresholds in order
+    int64_t numActive = (int64_t)order.size();
+    for (int64_t index = 0; index < numActive; ++index)
+    {
+        const float value = order[index].first;
+        const int64_t elem = order[index].second;
+        const double elemSize = (m_isGrid ? m_voxelSize : m_elementSizes[elem]);
+        neighbors.getNeighbors(elem, work.m_neighbors);
+        touching.clear();
+        int64_t numNeigh = (int64_t)work.m_neighbors.size();
+        for (int64_t i = 0; i < numNeigh; ++i)
+        {
+            int64_t neigh = work.m_neighbors[i];
+            if (parent[neigh] == -1) continue;
+            int64_t root = findRoot(neigh, parent, offset, work.m_path);
+            if (find(touching.begin(), touching.end(), root) == touching.end()) touching.push_back(root);
+        }
+        if (touching.empty())
+        {//new cluster, the peak element has no offset from the cluster integral
+            parent[elem] = elem;
+            offset[elem] = 0.0;
+            accum[elem] = 0.0;
+            extent[elem] = elemSize;
+            count[elem] = 1;
+            lastVal[elem] = value;
+            continue;
+        }
+        int64_t numTouching = (int64_t)touching.size();
+        int64_t merged = touching[0];
+        for (int64_t i = 0; i < numTouching; ++i)
+        {
+            int64_t root = touching[i];
+            if (lastVal[root] != value)//integrate the slice since this cluster's last change, all clusters are only integrated when they grow or merge
+            {
+                CaretAssert(value < lastVal[root]);
+                accum[root] += pow(extent[root], m_param_e) * (pow((double)lastVal[root], m_integrated_h) - pow((double)value, m_integrated_h)) / m_integrated_h;
+                lastVal[root] = value;
+            }
+            if (count[root] > count[merged]) merged = root;//attach smaller trees under the largest, to keep paths short
+        }
+        for (int64_t i = 0; i < numTouching; ++i)
+        {
+            int64_t root = touching[i];
+            if (root == merged) continue;
+            offset[root] += accum[root] - accum[merged] - offset[merged];//shift the whole subtree so its members keep their integral once the merged cluster's integral is added
+            parent[root] = merged;
+            extent[merged] += extent[root];
+            count[merged] += count[root];
+        }
+        parent[elem] = merged;
+        offset[elem] = -accum[merged] - offset[merged];//the new element starts at zero, not at the integral accumulated from the peak
+        extent[merged] += elemSize;
+        count[merged] += 1;
+    }
+    for (int64_t index = 0; index < numActive; ++index)
+    {//integrate the slice down to zero for every remaining cluster
+        int64_t root = order[index].second;
+        if (parent[root] != root) continue;
+        accum[root] += pow(extent[root], m_param_e) * pow((double)lastVal[root], m_integrated_h) / m_integrated_h;
+        lastVal[root] = 0.0f;
+    }
+    for (int64_t index = 0; index < numActive; ++index)
+    {
+        int64_t elem = order[index].second;
+        int64_t root = findRoot(elem, parent, offset, work.m_path);
+        double result = offset[root] + accum[root];
+        if (elem != root) result += offset[elem];
+        outData[elem] = (float)(negate ? -result : result);
+    }
+    for (int64_t index = 0; index < numActive; ++index)
+    {
+        parent[order[index].second] = -1;
+    }
+}
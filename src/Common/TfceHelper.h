@@ -0,0 +1,79 @@
+#ifndef __TFCE_HELPER_H__
+#define __TFCE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstddef>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace caret
+{
+
+    ///threshold-free cluster enhancement by a single descending sweep with a union-find of clusters, so one adjacency can be reused for many maps (permutations, etc)
+    class TfceHelper
+    {
+    public:
+        ///working memory for one thread, so repeated calls don't reallocate
+        class Workspace
+        {
+            std::vector<std::pair<float, int64_t> > m_order;
+            std::vector<int64_t> m_parent, m_count, m_neighbors, m_touching, m_path;
+            std::vector<double> m_offset, m_accum, m_extent;
+            std::vector<float> m_lastVal;
+            friend class TfceHelper;
+        };
+        
+        ///surface: neighbors of element i are neighborList[neighborStart[i]] through neighborList[neighborStart[i + 1] - 1], elementSizes are vertex areas
+        TfceHelper(const std::vector<int64_t>& neighborStart, const std::vector<int32_t>& neighborList, const std::vector<float>& elementSizes,
+                   const float& param_e, const float& param_h);
+        
+        ///volume: face neighbors on a grid with the first dimension varying fastest, all elements have the same size
+        TfceHelper(const int64_t dims[3], const float& voxelSize, const float& param_e, const float& param_h);
+        
+        int64_t getNumberOfElements() const { return m_numElements; }
+        
+        ///signed TFCE of a map, negative values are enhanced separately and given negative output, elements outside the roi (if given) are zero
+        void enhance(const float* data, float* outData, const float* roiData, Workspace& work) const;
+        void enhance(const float* data, float* outData, const float* roiData = NULL) const;
+        
+        ///enhance several maps in parallel, each thread keeps its own workspace
+        void enhanceMultiple(const std::vector<const float*>& dataList, const std::vector<float*>& outList, const float* roiData = NULL) const;
+    private:
+        struct SurfaceNeighbors;
+        struct GridNeighbors;
+        
+        template <typename NEIGHBORS>
+        void sweep(const NEIGHBORS& neighbors, const float* data, const bool& negate, float* outData, const float* roiData, Workspace& work) const;
+        
+        std::vector<int64_t> m_neighborStart;
+        std::vector<int32_t> m_neighborList;
+        std::vector<float> m_elementSizes;
+        int64_t m_dims[3], m_numElements;
+        float m_voxelSize;
+        double m_param_e, m_integrated_h;
+        bool m_isGrid;
+    };
+
+}
+
+#endif //__TFCE_HELPER_H__
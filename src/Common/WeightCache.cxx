@@ -0,0 +1,134 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "WeightCache.h"
+
+#include "CacheFile.h"
+#include "CaretLogger.h"
+
+#include <QDir>
+#include <QFile>
+
+using namespace caret;
+using namespace std;
+
+QString WeightCache::s_cacheDir;
+
+const int32_t WeightCache::WEIGHTS_VERSION;
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'W', 'B', 'W', 'E', 'I', 'G', 'H', 'T' };
+    const int32_t CACHE_VERSION = 1;//file layout version, WEIGHTS_VERSION covers the contents
+}
+
+WeightCache::Key::Key(const QString& kind) : m_hash(QCryptographicHash::Sha1)
+{
+    m_kind = kind;
+    m_hash.addData(kind.toUtf8());
+    addValue(WEIGHTS_VERSION);
+}
+
+void WeightCache::Key::addData(const void* data, const int64_t& bytes)
+{
+    m_hash.addData((const char*)data, bytes);
+}
+
+QString WeightCache::Key::getString() const
+{
+    return m_kind + "_" + QString(m_hash.result().toHex());
+}
+
+QString WeightCache::getCacheName(const QString& key)
+{
+    return QDir(s_cacheDir).filePath(key + ".weights");
+}
+
+bool WeightCache::load(const Key& key, WeightCache& cacheOut)
+{
+    if (!isEnabled()) return false;
+    QString cacheName = getCacheName(key.getString());
+    QFile cacheFile(cacheName);
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+    QByteArray contents = cacheFile.readAll();
+    cacheFile.close();
+    int64_t numArrays = -1;
+    if (contents.size() < CacheFile::HEADER_SIZE + (int64_t)sizeof(int64_t))
+    {
+        CaretLogFine("weight cache file '" + cacheName + "' is truncated, recomputing");
+        return false;
+    }
+    memcpy(&numArrays, contents.constData() + CacheFile::HEADER_SIZE, sizeof(int64_t));
+    if (!CacheFile::checkHeader(contents.constData(), CACHE_MAGIC, CACHE_VERSION) || numArrays < 0)
+    {
+        CaretLogFine("weight cache file '" + cacheName + "' is invalid or from a different version, recomputing");
+        return false;
+    }
+    vector<vector<char> > arrays(numArrays);
+    int64_t offset = CacheFile::HEADER_SIZE + sizeof(int64_t);
+    for (int64_t i = 0; i < numArrays; ++i)
+    {
+        int64_t arrayBytes = -1;
+        if (offset + (int64_t)sizeof(int64_t) <= contents.size()) memcpy(&arrayBytes, contents.constData() + offset, sizeof(int64_t));
+        offset += sizeof(int64_t);
+        if (arrayBytes < 0 || offset + arrayBytes > contents.size())
+        {
+            CaretLogFine("weight cache file '" + cacheName + "' is truncated, recomputing");
+            return false;
+        }
+        arrays[i].assign(contents.constData() + offset, contents.constData() + offset + arrayBytes);
+        offset += arrayBytes;
+    }
+    if (offset != contents.size())
+    {
+        CaretLogFine("weight cache file '" + cacheName + "' has extra data, recomputing");
+        return false;
+    }
+    cacheOut.m_arrays.swap(arrays);
+    CaretLogFine("loaded weights from cache file '" + cacheName + "'");
+    return true;
+}
+
+void WeightCache::save(const Key& key, const WeightCache& cache)
+{
+    if (!isEnabled()) return;
+    QString cacheName = getCacheName(key.getString());
+    if (!QDir().mkpath(s_cacheDir))
+    {
+        CaretLogWarning("unable to create weight cache directory '" + s_cacheDir + "'");
+        return;
+    }
+    CacheFileWriter writer(cacheName);
+    writer.writeHeader(CACHE_MAGIC, CACHE_VERSION);
+    int64_t numArrays = cache.m_arrays.size();
+    writer.writeValue(numArrays);
+    for (int64_t i = 0; i < numArrays; ++i)
+    {
+        int64_t arrayBytes = cache.m_arrays[i].size();
+        writer.writeValue(arrayBytes);
+        writer.write(cache.m_arrays[i].data(), arrayBytes);
+    }
+    if (!writer.finish())
+    {
+        CaretLogWarning("error saving weight cache: " + writer.getErrorString());
+        return;
+    }
+    CaretLogFine("saved weights to cache file '" + cacheName + "'");
+}
@@ -0,0 +1,93 @@
+#ifndef __WEIGHT_CACHE_H__
+#define __WEIGHT_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <QCryptographicHash>
+#include <QString>
+
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+    ///persistent cache for expensive precomputed weights (smoothing kernels, resampling weights), stored in a directory set by the
+    ///-weight-cache global option, and looked up by a hash of everything the weights depend on
+    class WeightCache
+    {
+        static QString s_cacheDir;
+        std::vector<std::vector<char> > m_arrays;
+        static QString getCacheName(const QString& key);
+    public:
+        ///increment when any cached weight computation changes, to invalidate existing cache files
+        static const int32_t WEIGHTS_VERSION = 1;
+        ///hashes the inputs that determine the weights, callers should add everything that changes the result
+        class Key
+        {
+            QCryptographicHash m_hash;
+            QString m_kind;
+        public:
+            ///kind names the computation and prefixes the cache file name, WEIGHTS_VERSION is hashed automatically
+            Key(const QString& kind);
+            void addData(const void* data, const int64_t& bytes);
+            template<typename T>
+            void addValue(const T& value) { addData(&value, sizeof(T)); }
+            ///adds a surface's topology and coordinates, templated because SurfaceFile isn't available in Common
+            template<typename S>
+            void addSurface(const S* surface)
+            {
+                int32_t numNodes = surface->getNumberOfNodes(), numTriangles = surface->getNumberOfTriangles();
+                addValue(numNodes);
+                addValue(numTriangles);
+                addData(surface->getCoordinateData(), numNodes * 3 * sizeof(float));
+                if (numTriangles > 0) addData(surface->getTriangle(0), numTriangles * 3 * sizeof(int32_t));
+            }
+            QString getString() const;
+        };
+        ///directory to keep cache files in, empty (the default) disables weight caching
+        static void setCacheDirectory(const QString& dir) { s_cacheDir = dir; }
+        static const QString& getCacheDirectory() { return s_cacheDir; }
+        static bool isEnabled() { return s_cacheDir != ""; }
+        ///returns false if caching is disabled, or there is no valid cache file for the key
+        static bool load(const Key& key, WeightCache& cacheOut);
+        ///failures are logged rather than thrown, as caching is only an optimization
+        static void save(const Key& key, const WeightCache& cache);
+        
+        template<typename T>
+        void addArray(const T* data, const int64_t& count)
+        {
+            m_arrays.push_back(std::vector<char>((const char*)data, (const char*)(data + count)));
+        }
+        ///returns false if the array doesn't exist or its size isn't a multiple of the element size
+        template<typename T>
+        bool getArray(const int& index, std::vector<T>& dataOut) const
+        {
+            if (index < 0 || index >= (int)m_arrays.size() || m_arrays[index].size() % sizeof(T) != 0) return false;
+            dataOut.resize(m_arrays[index].size() / sizeof(T));
+            if (!dataOut.empty()) memcpy((char*)&(dataOut[0]), m_arrays[index].data(), m_arrays[index].size());
+            return true;
+        }
+        int getNumberOfArrays() const { return (int)m_arrays.size(); }
+    };
+}
+
+#endif //__WEIGHT_CACHE_H__
@@ -21,6 +21,7 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QDir>
 #include <QLabel>
 #ifndef WORKBENCH_USE_QT5_QOPENGL_WIDGET
 #include <QGLPixelBuffer>
@@ -28,6 +29,11 @@
 #include <QSplashScreen>
 #include <QStyleFactory>
 #include <QThread>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else // QT_VERSION
+#include <QDesktopServices>
+#endif // QT_VERSION
 
 #include <cstdlib>
 #include <ctime>
@@ -41,6 +47,7 @@
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
 #include "CaretPreferences.h"
+#include "CiftiColumnCache.h"
 #include "CommandOperationManager.h"
 #include "EventBrowserWindowNew.h"
 #include "EventManager.h"
@@ -433,6 +440,26 @@ main(int argc, char* argv[])
          */
         QLocale::setDefault(QLocale(QLocale::English, QLocale::UnitedStates));
         
+        /*
+         * If the user has enabled it in the preferences, keep
+         * transposed copies of on-disk CIFTI matrices so that
+         * loading a column doesn't need one read per row.  The copy
+         * is made while the first column of a file is loaded, which
+         * blocks the GUI and uses disk space, so it is off by default
+         * and limited to files that can be copied in reasonable time.
+         */
+        if (SessionManager::get()->getCaretPreferences()->isCiftiColumnCacheEnabled()) {
+#if QT_VERSION >= 0x050000
+            const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else // QT_VERSION
+            const QString cacheLocation = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif // QT_VERSION
+            if ( ! cacheLocation.isEmpty()) {
+                CiftiColumnCache::setCacheDirectory(QDir(cacheLocation).filePath("cifti_column_cache"));
+                CiftiColumnCache::setMaximumBytes(static_cast<int64_t>(4) << 30);
+            }
+        }
+        
         /*
         * Make sure OpenGL is available.
         */
@@ -19,8 +19,8 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
-#include <iostream>
 
 #define __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
 #include "CiftiConnectivityMatrixDenseDynamicFile.h"
@@ -31,9 +31,10 @@
 #include "CaretOMP.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiFile.h"
+#include "DotMatrixHelper.h"
 #include "FileInformation.h"
+#include "Float16Helper.h"
 #include "SceneClassAssistant.h"
-#include "dot_wrapper.h"
 
 using namespace caret;
 
@@ -46,6 +47,11 @@ using namespace caret;
  * Internally, the file format is the same as a data series file.  When
  * a row is requested, the row is correlated with all other rows
  * producing the connectivity from that row to all other rows.
+ *
+ * The rows are demeaned and scaled to unit length when the file is read,
+ * so the correlation of two rows is their dot product, and a row of
+ * connectivity is a single matrix-vector product over one contiguous
+ * buffer.  Long scans store the normalized rows as float16.
  */
 
 /**
@@ -60,9 +66,9 @@ m_parentDataSeriesFile(parentDataSeriesFile),
 m_parentDataSeriesCiftiFile(NULL),
 m_numberOfBrainordinates(-1),
 m_numberOfTimePoints(-1),
+m_paddedLength(0),
 m_validDataFlag(false),
-m_enabledAsLayer(true),
-m_cacheDataFlag(false)
+m_enabledAsLayer(true)
 {
     CaretAssert(m_parentDataSeriesFile);
 
@@ -127,6 +133,30 @@ CiftiConnectivityMatrixDenseDynamicFile::supportsWriting() const
     return false;
 }
 
+/**
+ * @return Size of the normalized data, as float, at or above which it
+ * is stored as float16.
+ */
+int64_t
+CiftiConnectivityMatrixDenseDynamicFile::getFloat16StorageMinimumBytes()
+{
+    return s_float16StorageMinimumBytes;
+}
+
+/**
+ * Set the size of the normalized data, as float, at or above which it
+ * is stored as float16.  Applies to files read afterwards.
+ *
+ * @param numberOfBytes
+ *    The new size, zero stores all files as float16.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::setFloat16StorageMinimumBytes(const int64_t numberOfBytes)
+{
+    s_float16StorageMinimumBytes = std::max(numberOfBytes,
+                                            static_cast<int64_t>(0));
+}
+
 /**
  * @return Is the data within the file valid?
  */
@@ -165,35 +195,221 @@ CiftiConnectivityMatrixDenseDynamicFile::updateAfterReading(const CiftiFile* cif
     m_numberOfBrainordinates = ciftiXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN).getLength();
     m_numberOfTimePoints     = ciftiXML.getSeriesMap(CiftiXML::ALONG_ROW).getLength();
     
-    m_rowData.clear();
+    m_normalizedData.clear();
+    m_normalizedDataFloat16.clear();
     
     if ((m_numberOfBrainordinates > 0)
         && (m_numberOfTimePoints > 0)) {
-        m_rowData.resize(m_numberOfBrainordinates);
+        readNormalizedData();
         
-        if (m_cacheDataFlag) {
-            /*
-             * Read all of the data.  Time-series type files are not
-             * too large and by caching the data, it eliminates
-             * numerous calls to read the data when correlation
-             * is performed.
-             *
-             * READ DATA FROM PARENT FILE
-             */
-            for (int32_t i = 0; i < m_numberOfBrainordinates; i++) {
-                CaretAssertVectorIndex(m_rowData, i);
-                m_rowData[i].m_data.resize(m_numberOfTimePoints);
-                m_parentDataSeriesCiftiFile->getRow(&m_rowData[i].m_data[0],
-                                                    i);
+        m_validDataFlag = true;
+    }
+}
+
+/**
+ * Read all rows of the parent data series file, demean them, scale
+ * them to unit length, and store them in one buffer.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::readNormalizedData()
+{
+    CaretAssert(m_numberOfBrainordinates > 0);
+    CaretAssert(m_numberOfTimePoints > 0);
+    
+    /*
+     * Pad to a multiple of 4 so that the SIMD dot products have no remainder
+     */
+    m_paddedLength = ((m_numberOfTimePoints + 3) / 4) * 4;
+    const int64_t numberOfValues = static_cast<int64_t>(m_numberOfBrainordinates) * m_paddedLength;
+    const bool float16Flag = ((numberOfValues * static_cast<int64_t>(sizeof(float))) >= s_float16StorageMinimumBytes);
+    if (float16Flag) {
+        m_normalizedDataFloat16.resize(numberOfValues);
+    }
+    else {
+        m_normalizedData.resize(numberOfValues);
+    }
+    
+#pragma omp CARET_PAR
+    {
+        std::vector<float> data(m_numberOfTimePoints);
+        std::vector<float> normalizedData(m_paddedLength);
+        
+        /*
+         * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
+         * there is almost no overhead to dynamic scheduling
+         */
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+#pragma omp critical
+            {//TSC: this can do disk access, which is not currently thread-safe
+                m_parentDataSeriesCiftiFile->getRow(&data[0], iRow);
+            }
+            const int64_t offset = static_cast<int64_t>(iRow) * m_paddedLength;
+            if (float16Flag) {
+                normalizeData(&data[0],
+                              m_numberOfTimePoints,
+                              m_paddedLength,
+                              &normalizedData[0]);
+                Float16Helper::toFloat16(&normalizedData[0],
+                                         m_paddedLength,
+                                         &m_normalizedDataFloat16[offset]);
+            }
+            else {
+                normalizeData(&data[0],
+                              m_numberOfTimePoints,
+                              m_paddedLength,
+                              &m_normalizedData[offset]);
             }
         }
-        
-        preComputeRowMeanAndSumSquared();
-        
-        m_validDataFlag = true;
     }
 }
 
+/**
+ * Demean data and scale it to unit length, so that the correlation
+ * coefficient of two normalized rows is their dot product.
+ *
+ * @param data
+ *     Data that is normalized.
+ * @param dataLength
+ *     Number of items in data.
+ * @param paddedLength
+ *     Length of the output, items after dataLength are zero.
+ * @param normalizedOut
+ *     Output with normalized data.  All zeros if the data has
+ *     no variance (or contains NaN), so its correlations are zero.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::normalizeData(const float* data,
+                                                       const int32_t dataLength,
+                                                       const int32_t paddedLength,
+                                                       float* normalizedOut)
+{
+    CaretAssert(paddedLength >= dataLength);
+    
+    double sum = 0.0;
+    for (int32_t i = 0; i < dataLength; i++) {
+        sum += data[i];
+    }
+    const double mean = ((dataLength > 0) ? (sum / dataLength) : 0.0);
+    
+    double ssxx = 0.0;
+    for (int32_t i = 0; i < dataLength; i++) {
+        const double d = data[i] - mean;
+        ssxx += (d * d);
+    }
+    
+    if (ssxx > 0.0) {
+        const double scale = 1.0 / std::sqrt(ssxx);
+        for (int32_t i = 0; i < dataLength; i++) {
+            normalizedOut[i] = (data[i] - mean) * scale;
+        }
+    }
+    else {
+        std::fill(normalizedOut, normalizedOut + dataLength, 0.0f);
+    }
+    std::fill(normalizedOut + dataLength, normalizedOut + paddedLength, 0.0f);
+}
+
+/**
+ * Get a normalized row as float.
+ *
+ * @param rowIndex
+ *     Index of the row.
+ * @param normalizedOut
+ *     Output with the normalized row, must hold the padded length.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getNormalizedRow(const int32_t rowIndex,
+                                                          float* normalizedOut) const
+{
+    CaretAssert((rowIndex >= 0) && (rowIndex < m_numberOfBrainordinates));
+    const int64_t offset = static_cast<int64_t>(rowIndex) * m_paddedLength;
+    if (m_normalizedDataFloat16.empty()) {
+        CaretAssertVectorIndex(m_normalizedData, offset + m_paddedLength - 1);
+        std::copy(&m_normalizedData[offset],
+                  &m_normalizedData[offset] + m_paddedLength,
+                  normalizedOut);
+    }
+    else {
+        CaretAssertVectorIndex(m_normalizedDataFloat16, offset + m_paddedLength - 1);
+        Float16Helper::fromFloat16(&m_normalizedDataFloat16[offset],
+                                   m_paddedLength,
+                                   normalizedOut);
+    }
+}
+
+/**
+ * Correlate normalized seed data with all rows.  All of the seeds are
+ * processed together in one pass over the rows, so each tile of rows is
+ * loaded (and converted from float16) once for all seeds.
+ *
+ * @param normalizedSeedData
+ *     Seeds normalized with normalizeData(), each with the padded length.
+ * @param correlationRowsOut
+ *     For each seed, output with its correlation to every row.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::computeCorrelationRows(const std::vector<const float*>& normalizedSeedData,
+                                                                const std::vector<float*>& correlationRowsOut) const
+{
+    CaretAssert(normalizedSeedData.size() == correlationRowsOut.size());
+    const int32_t numberOfSeeds = static_cast<int32_t>(normalizedSeedData.size());
+    if (numberOfSeeds <= 0) {
+        return;
+    }
+    
+    const bool float16Flag = ( ! m_normalizedDataFloat16.empty());
+    const int32_t tileRows = DotMatrixHelper::getTileRows(m_paddedLength,
+                                                          DotMatrixHelper::L2_TARGET_BYTES);
+    const int32_t numberOfTiles = (m_numberOfBrainordinates + tileRows - 1) / tileRows;
+    
+#pragma omp CARET_PAR
+    {
+        std::vector<const float*> tileRowPointers(tileRows);
+        std::vector<float> tileFloatData(float16Flag ? (static_cast<int64_t>(tileRows) * m_paddedLength) : 0);
+        std::vector<double> tileCorrelations(static_cast<int64_t>(numberOfSeeds) * tileRows);
+        
+        /*
+         * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
+         * there is almost no overhead to dynamic scheduling
+         */
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int32_t iTile = 0; iTile < numberOfTiles; iTile++) {
+            const int32_t firstRow = iTile * tileRows;
+            const int32_t numberOfRows = std::min(tileRows,
+                                                  m_numberOfBrainordinates - firstRow);
+            for (int32_t i = 0; i < numberOfRows; i++) {
+                const int64_t offset = static_cast<int64_t>(firstRow + i) * m_paddedLength;
+                if (float16Flag) {
+                    float* rowData = &tileFloatData[static_cast<int64_t>(i) * m_paddedLength];
+                    Float16Helper::fromFloat16(&m_normalizedDataFloat16[offset],
+                                               m_paddedLength,
+                                               rowData);
+                    tileRowPointers[i] = rowData;
+                }
+                else {
+                    tileRowPointers[i] = &m_normalizedData[offset];
+                }
+            }
+            
+            DotMatrixHelper::rowBlockDot(&normalizedSeedData[0],
+                                         numberOfSeeds,
+                                         &tileRowPointers[0],
+                                         numberOfRows,
+                                         m_paddedLength,
+                                         &tileCorrelations[0],
+                                         tileRows);
+            
+            for (int32_t iSeed = 0; iSeed < numberOfSeeds; iSeed++) {
+                float* correlationRow = correlationRowsOut[iSeed];
+                const double* seedCorrelations = &tileCorrelations[static_cast<int64_t>(iSeed) * tileRows];
+                for (int32_t i = 0; i < numberOfRows; i++) {
+                    correlationRow[firstRow + i] = seedCorrelations[i];
+                }
+            }
+        }
+    }
+}
 
 /**
  * Load data for the given column.
@@ -268,25 +484,17 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(float* dataOut,
         return;
     }
     
-    std::vector<float> rowData(m_numberOfTimePoints);
-    m_parentDataSeriesCiftiFile->getRow(&rowData[0], index);
-    const float mean = m_rowData[index].m_mean;
-    const float ssxx = m_rowData[index].m_sqrt_ssxx;
+    std::vector<float> normalizedRow(m_paddedLength);
+    getNormalizedRow(index,
+                     &normalizedRow[0]);
+    
+    computeCorrelationRows(std::vector<const float*>(1, &normalizedRow[0]),
+                           std::vector<float*>(1, dataOut));
     
     /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
+     * A row is correlated with itself even if it has no variance
      */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-        float coefficient = 1.0;
-        
-        if (iRow != index) {
-            coefficient = correlation(rowData, mean, ssxx, iRow, m_numberOfTimePoints);
-        }
-        
-        dataOut[iRow] = coefficient;
-    }
+    dataOut[index] = 1.0;
 }
 
 /**
@@ -316,251 +524,20 @@ CiftiConnectivityMatrixDenseDynamicFile::processRowAverageData(std::vector<float
         return;
     }
     
-    float mean = 0.0;
-    float sumSquared = 0.0;
-    computeDataMeanAndSumSquared(&rowAverageDataInOut[0],
-                                 dataLength,
-                                 mean,
-                                 sumSquared);
+    std::vector<float> normalizedRowAverage(m_paddedLength);
+    normalizeData(&rowAverageDataInOut[0],
+                  dataLength,
+                  m_paddedLength,
+                  &normalizedRowAverage[0]);
     
     std::vector<float> processedRowAverageData(m_numberOfBrainordinates);
-    
-    /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
-     */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-        const float coefficient = correlation(rowAverageDataInOut,
-                                              mean,
-                                              sumSquared,
-                                              iRow,
-                                              dataLength);
-        CaretAssertVectorIndex(processedRowAverageData, iRow);
-        processedRowAverageData[iRow] = coefficient;
-    }
+    computeCorrelationRows(std::vector<const float*>(1, &normalizedRowAverage[0]),
+                           std::vector<float*>(1, &processedRowAverageData[0]));
     
     rowAverageDataInOut = processedRowAverageData;
 }
 
 
-/**
- * Compute the mean and sum-squared for each row so that they
- * are only calculated once.
- */
-void
-CiftiConnectivityMatrixDenseDynamicFile::preComputeRowMeanAndSumSquared()
-{
-    CaretAssert(m_numberOfBrainordinates > 0);
-    CaretAssert(m_numberOfTimePoints > 0);
-
-    /*
-     * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
-     * there is almost no overhead to dynamic scheduling
-     */
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
-
-        CaretAssertVectorIndex(m_rowData, iRow);
-        
-        if (m_cacheDataFlag) {
-            CaretAssertVectorIndex(m_rowData[iRow].m_data, (m_numberOfTimePoints - 1));
-            computeDataMeanAndSumSquared(&m_rowData[iRow].m_data[0],
-                                         m_numberOfTimePoints,
-                                         m_rowData[iRow].m_mean,
-                                         m_rowData[iRow].m_sqrt_ssxx);
-        }
-        else {
-            std::vector<float> data(m_numberOfTimePoints);
-#pragma omp critical
-            {//TSC: this can do disk access, which is not currently thread-safe
-                m_parentDataSeriesCiftiFile->getRow(&data[0], iRow);
-            }
-            computeDataMeanAndSumSquared(&data[0],
-                                         m_numberOfTimePoints,
-                                         m_rowData[iRow].m_mean,
-                                         m_rowData[iRow].m_sqrt_ssxx);
-        }
-        
-//        double sum = 0.0;
-//        double sumSquared = 0.0;
-//        if (m_cacheDataFlag) {
-//            for (int32_t iPoint = 0; iPoint < m_numberOfTimePoints; iPoint++) {
-//                CaretAssertVectorIndex(m_rowData[iRow].m_data, iPoint);
-//                const float d = m_rowData[iRow].m_data[iPoint];
-//                sum        += d;
-//                sumSquared += (d * d);
-//            }
-//        }
-//        else {
-//            std::vector<float> data(m_numberOfTimePoints);
-//            m_parentDataSeriesCiftiFile->getRow(&data[0], iRow);
-//            for (int32_t iPoint = 0; iPoint < m_numberOfTimePoints; iPoint++) {
-//                CaretAssertVectorIndex(data, iPoint);
-//                const float d = data[iPoint];
-//                sum        += d;
-//                sumSquared += (d * d);
-//            }
-//        }
-//        
-//        const float mean       = (sum / numPointsFloat);
-//        const float ssxx = (sumSquared - (numPointsFloat * mean * mean));
-//        CaretAssert(ssxx >= 0.0);
-//        
-//        const float meanDiff = std::fabs(mean - m_rowData[iRow].m_mean);
-//        const float ssDiff   = std::fabs(std::sqrt(ssxx) - m_rowData[iRow].m_sqrt_ssxx);
-//        if ((meanDiff > 0.0001) || (ssDiff > 0.0001)) {
-//            std::cout << "Mean/SS diff" << std::endl;
-//        }
-//        
-//        m_rowData[iRow].m_mean = mean;
-//        m_rowData[iRow].m_sqrt_ssxx = std::sqrt(ssxx);
-    }
-}
-
-/**
- * Compute data's mean and sum-squared
- *
- * @param data
- *     Data on which mean and sum-squared are calculated
- * @param dataLength
- *     Number of items in data.
- * @param meanOut
- *     Output with mean of data.
- * @param sumSquaredOut
- *     Output with sum-squared.
- */
-void
-CiftiConnectivityMatrixDenseDynamicFile::computeDataMeanAndSumSquared(const float* data,
-                                                                      const int32_t dataLength,
-                                                                      float& meanOut,
-                                                                      float& sumSquaredOut) const
-{
-    meanOut = 0.0;
-    sumSquaredOut = 0.0;
-    if (dataLength <= 0) {
-        return;
-    }
-    
-    double sum = 0.0;
-    double sumSquared = 0.0;
-    
-    for (int32_t i = 0; i < dataLength; i++) {
-        const float d = data[i];
-        sum        += d;
-        sumSquared += (d * d);
-    }
-    
-    meanOut = (sum / dataLength);
-    const float ssxx = (sumSquared - (dataLength * meanOut * meanOut));
-    //TSC: do not assert things that depend on input file content (a NaN in the data will trip it), you could print a warning instead
-    //CaretAssert(ssxx >= 0.0);
-    sumSquaredOut = std::sqrt(ssxx);
-}
-
-
-/**
- * Correlation from https://en.wikipedia.org/wiki/Pearson_product-moment_correlation_coefficient
- *
- * @param data
- *     Data for correlation
- * @param mean
- *     Mean of data
- * @param sumSquared
- *     Sum squared of data.
- * @param otherRowIndex
- *     Index of another row
- * @param numberOfPoints
- *     Number of points int the two arrays
- * @return
- *     The correlation coefficient computed on the two arrays.
- */
-float
-CiftiConnectivityMatrixDenseDynamicFile::correlation(const std::vector<float>& data,
-                                                     const float mean,
-                                                     const float sumSquared,
-                                                     const int32_t otherRowIndex,
-                                                     const int32_t numberOfPoints) const
-{
-    const double numFloat = numberOfPoints;
-    double xySum = 0.0;
-    
-    CaretAssertVectorIndex(m_rowData, otherRowIndex);
-    const RowData& otherData = m_rowData[otherRowIndex];
-    
-    if (m_cacheDataFlag) {
-        xySum = sddot(&data[0], &otherData.m_data[0], numberOfPoints);
-    }
-    else {
-        std::vector<float> otherDataVector(m_numberOfTimePoints);
-        m_parentDataSeriesCiftiFile->getRow(&otherDataVector[0], otherRowIndex);
-        xySum = sddot(&data[0], &otherDataVector[0], numberOfPoints);
-    }
-    
-    const double ssxy = xySum - (numFloat * mean * otherData.m_mean);
-    
-    float correlationCoefficient = 0.0;
-    if ((sumSquared > 0.0)
-        && (otherData.m_sqrt_ssxx > 0.0)) {
-        correlationCoefficient = (ssxy / (sumSquared * otherData.m_sqrt_ssxx));
-    }
-    return correlationCoefficient;
-}
-
-/**
- * Correlation from https://en.wikipedia.org/wiki/Pearson_product-moment_correlation_coefficient
- *
- * @param rowIndex
- *     Index of a row
- * @param otherRowIndex
- *     Index of another row
- * @param numberOfPoints
- *     Number of points int the two arrays
- * @return
- *     The correlation coefficient computed on the two arrays.
- */
-float
-CiftiConnectivityMatrixDenseDynamicFile::correlation(const int32_t rowIndex,
-                                                     const int32_t otherRowIndex,
-                                                     const int32_t numberOfPoints) const
-{
-    const double numFloat = numberOfPoints;
-    double xySum = 0.0;
-    
-    CaretAssertVectorIndex(m_rowData, rowIndex);
-    CaretAssertVectorIndex(m_rowData, otherRowIndex);
-    const RowData& data = m_rowData[rowIndex];
-    const RowData& otherData = m_rowData[otherRowIndex];
-    
-    if (m_cacheDataFlag) {
-        for (int i = 0; i < numberOfPoints; i++) {
-            CaretAssertVectorIndex(data.m_data, i);
-            CaretAssertVectorIndex(otherData.m_data, i);
-            xySum += data.m_data[i] * otherData.m_data[i];
-        }
-    }
-    else {
-        std::vector<float> dataVector(m_numberOfTimePoints);
-        std::vector<float> otherDataVector(m_numberOfTimePoints);
-        m_parentDataSeriesCiftiFile->getRow(&dataVector[0], rowIndex);
-        m_parentDataSeriesCiftiFile->getRow(&otherDataVector[0], otherRowIndex);
-        
-        for (int i = 0; i < numberOfPoints; i++) {
-            CaretAssertVectorIndex(dataVector, i);
-            CaretAssertVectorIndex(otherDataVector, i);
-            xySum += dataVector[i] * otherDataVector[i];
-        }
-    }
-    
-    const double ssxy = xySum - (numFloat * data.m_mean * otherData.m_mean);
-    
-    float correlationCoefficient = 0.0;
-    if ((data.m_sqrt_ssxx > 0.0)
-        && (otherData.m_sqrt_ssxx > 0.0)) {
-        correlationCoefficient = (ssxy / (data.m_sqrt_ssxx * otherData.m_sqrt_ssxx));
-    }
-    return correlationCoefficient;
-}
 /**
  * Save subclass data to the scene.
  *
@@ -49,6 +49,13 @@ namespace caret {
         
         const CiftiBrainordinateDataSeriesFile* getParentBrainordinateDataSeriesFile() const;
         
+        static int64_t getFloat16StorageMinimumBytes();
+        
+        static void setFloat16StorageMinimumBytes(const int64_t numberOfBytes);
+        
+        /** Default size, as float, at or above which normalized data is stored as float16 to halve its memory */
+        static const int64_t DEFAULT_FLOAT16_STORAGE_MINIMUM_BYTES = 1024LL * 1024LL * 1024LL;
+        
     private:
         CiftiConnectivityMatrixDenseDynamicFile(const CiftiConnectivityMatrixDenseDynamicFile&);
 
@@ -72,33 +79,18 @@ namespace caret {
                                                   const SceneClass* sceneClass);
         
     private:
-        class RowData {
-        public:
-            RowData() { }
-            
-            ~RowData() { }
-            
-            std::vector<float> m_data;
-            float m_mean;
-            float m_sqrt_ssxx;
-        };
-        
-        float correlation(const int32_t rowIndex,
-                          const int32_t otherRowIndex,
-                          const int32_t numberOfPoints) const;
-        
-        float correlation(const std::vector<float>& data,
-                          const float mean,
-                          const float sumSquared,
-                          const int32_t otherRowIndex,
-                          const int32_t numberOfPoints) const;
-        
-        void preComputeRowMeanAndSumSquared();
-        
-        void computeDataMeanAndSumSquared(const float* data,
-                                          const int32_t dataLength,
-                                          float& meanOut,
-                                          float& sumSquaredOut) const;
+        void readNormalizedData();
+        
+        static void normalizeData(const float* data,
+                                  const int32_t dataLength,
+                                  const int32_t paddedLength,
+                                  float* normalizedOut);
+        
+        void getNormalizedRow(const int32_t rowIndex,
+                              float* normalizedOut) const;
+        
+        void computeCorrelationRows(const std::vector<const float*>& normalizedSeedData,
+                                    const std::vector<float*>& correlationRowsOut) const;
         
         CiftiBrainordinateDataSeriesFile* m_parentDataSeriesFile;
         
@@ -108,22 +100,30 @@ namespace caret {
         
         int32_t m_numberOfTimePoints;
         
-        std::vector<RowData> m_rowData;
+        /** Number of time points rounded up to a multiple of the SIMD width, normalized rows are zero padded to this length */
+        int32_t m_paddedLength;
+        
+        /** Normalized rows, one after another, when stored as float */
+        std::vector<float> m_normalizedData;
+        
+        /** Normalized rows, one after another, when stored as float16 */
+        std::vector<uint16_t> m_normalizedDataFloat16;
         
         bool m_validDataFlag;
         
         bool m_enabledAsLayer;
         
-        const bool m_cacheDataFlag;
-        
         CaretPointer<SceneClassAssistant> m_sceneAssistant;
         
+        static int64_t s_float16StorageMinimumBytes;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
     
 #ifdef __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const int64_t CiftiConnectivityMatrixDenseDynamicFile::DEFAULT_FLOAT16_STORAGE_MINIMUM_BYTES;
+    int64_t CiftiConnectivityMatrixDenseDynamicFile::s_float16StorageMinimumBytes = CiftiConnectivityMatrixDenseDynamicFile::DEFAULT_FLOAT16_STORAGE_MINIMUM_BYTES;
 #endif // __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
 
 } // namespace
@@ -0,0 +1,284 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CIFTI_CONNECTIVITY_ROW_CACHE_DECLARE__
+#include "CiftiConnectivityRowCache.h"
+#undef __CIFTI_CONNECTIVITY_ROW_CACHE_DECLARE__
+
+#include <algorithm>
+
+#include "CaretAssert.h"
+
+using namespace caret;
+
+
+/**
+ * \class caret::CiftiConnectivityRowCache
+ * \brief Least recently used cache of rows read from connectivity matrix files.
+ * \ingroup Files
+ *
+ * One cache is shared by all connectivity files so that the memory
+ * budget applies to all of them.  Rows are identified by the file that
+ * read them (the 'owner') and the row's index.  A file must remove
+ * its rows when its data changes or the file is destroyed.
+ */
+
+const int64_t CiftiConnectivityRowCache::DEFAULT_MEMORY_BUDGET;
+
+/**
+ * @return The cache shared by all connectivity files.
+ */
+CiftiConnectivityRowCache*
+CiftiConnectivityRowCache::get()
+{
+    static CiftiConnectivityRowCache s_cache;
+    return &s_cache;
+}
+
+/**
+ * Constructor.
+ */
+CiftiConnectivityRowCache::CiftiConnectivityRowCache()
+: CaretObject()
+{
+    m_memoryBudget = DEFAULT_MEMORY_BUDGET;
+    m_memoryUsed = 0;
+}
+
+/**
+ * Destructor.
+ */
+CiftiConnectivityRowCache::~CiftiConnectivityRowCache()
+{
+}
+
+/**
+ * Get a row from the cache.  A row that is found becomes the
+ * most recently used row.
+ *
+ * @param owner
+ *    File that read the row.
+ * @param rowIndex
+ *    Index of the row.
+ * @param dataOut
+ *    Output with the row's data, must hold rowLength elements.
+ * @param rowLength
+ *    Number of elements in the row.
+ * @return
+ *    True if the row was in the cache and copied to dataOut.
+ */
+bool
+CiftiConnectivityRowCache::getRow(const void* owner,
+                                  const int64_t rowIndex,
+                                  float* dataOut,
+                                  const int64_t rowLength)
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    std::map<RowKey, EntryList::iterator>::iterator lookupIter = m_entryLookup.find(RowKey(owner, rowIndex));
+    if (lookupIter == m_entryLookup.end()) {
+        return false;
+    }
+
+    EntryList::iterator entryIter = lookupIter->second;
+    if (static_cast<int64_t>(entryIter->m_data.size()) != rowLength) {
+        return false;
+    }
+
+    std::copy(entryIter->m_data.begin(),
+              entryIter->m_data.end(),
+              dataOut);
+    m_entries.splice(m_entries.begin(),
+                     m_entries,
+                     entryIter);
+
+    return true;
+}
+
+/**
+ * Is a row in the cache?  Does not change the order of use.
+ *
+ * @param owner
+ *    File that read the row.
+ * @param rowIndex
+ *    Index of the row.
+ * @return
+ *    True if the row is in the cache.
+ */
+bool
+CiftiConnectivityRowCache::hasRow(const void* owner,
+                                  const int64_t rowIndex)
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    return (m_entryLookup.find(RowKey(owner, rowIndex)) != m_entryLookup.end());
+}
+
+/**
+ * Add a row to the cache as the most recently used row, removing the
+ * least recently used rows if the memory budget is exceeded.  Rows
+ * larger than the budget are not added.
+ *
+ * @param owner
+ *    File that read the row.
+ * @param rowIndex
+ *    Index of the row.
+ * @param data
+ *    The row's data.
+ * @param rowLength
+ *    Number of elements in the row.
+ */
+void
+CiftiConnectivityRowCache::addRow(const void* owner,
+                                  const int64_t rowIndex,
+                                  const float* data,
+                                  const int64_t rowLength)
+{
+    CaretAssert(data);
+
+    CaretMutexLocker locker(&m_mutex);
+
+    const RowKey key(owner, rowIndex);
+    std::map<RowKey, EntryList::iterator>::iterator lookupIter = m_entryLookup.find(key);
+    if (lookupIter != m_entryLookup.end()) {
+        EntryList::iterator entryIter = lookupIter->second;
+        m_memoryUsed -= getEntryBytes(*entryIter);
+        m_entries.erase(entryIter);
+        m_entryLookup.erase(lookupIter);
+    }
+
+    const int64_t rowBytes = rowLength * static_cast<int64_t>(sizeof(float));
+    if (rowBytes > m_memoryBudget) {
+        return;
+    }
+
+    m_entries.push_front(Entry());
+    Entry& entry = m_entries.front();
+    entry.m_key = key;
+    entry.m_data.assign(data,
+                        data + rowLength);
+    m_entryLookup.insert(std::make_pair(key,
+                                        m_entries.begin()));
+    m_memoryUsed += getEntryBytes(entry);
+
+    while (m_memoryUsed > m_memoryBudget) {
+        removeLeastRecentlyUsed();
+    }
+}
+
+/**
+ * Remove all rows read by a file.
+ *
+ * @param owner
+ *    File that read the rows.
+ */
+void
+CiftiConnectivityRowCache::removeRowsForOwner(const void* owner)
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    std::map<RowKey, EntryList::iterator>::iterator lookupIter = m_entryLookup.lower_bound(RowKey(owner, 0));
+    while ((lookupIter != m_entryLookup.end())
+           && (lookupIter->first.first == owner)) {
+        m_memoryUsed -= getEntryBytes(*lookupIter->second);
+        m_entries.erase(lookupIter->second);
+        m_entryLookup.erase(lookupIter++);
+    }
+}
+
+/**
+ * Remove all rows.
+ */
+void
+CiftiConnectivityRowCache::clear()
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    m_entries.clear();
+    m_entryLookup.clear();
+    m_memoryUsed = 0;
+}
+
+/**
+ * @return Maximum number of bytes of row data in the cache.
+ */
+int64_t
+CiftiConnectivityRowCache::getMemoryBudget() const
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    return m_memoryBudget;
+}
+
+/**
+ * Set the maximum number of bytes of row data in the cache, removing
+ * the least recently used rows if needed.
+ *
+ * @param numberOfBytes
+ *    New budget, zero disables the cache.
+ */
+void
+CiftiConnectivityRowCache::setMemoryBudget(const int64_t numberOfBytes)
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    m_memoryBudget = std::max(numberOfBytes,
+                              static_cast<int64_t>(0));
+    while (m_memoryUsed > m_memoryBudget) {
+        removeLeastRecentlyUsed();
+    }
+}
+
+/**
+ * @return Number of bytes of row data in the cache.
+ */
+int64_t
+CiftiConnectivityRowCache::getMemoryUsed() const
+{
+    CaretMutexLocker locker(&m_mutex);
+
+    return m_memoryUsed;
+}
+
+/**
+ * Remove the least recently used row.  Caller must hold the mutex.
+ */
+void
+CiftiConnectivityRowCache::removeLeastRecentlyUsed()
+{
+    CaretAssert( ! m_entries.empty());
+
+    Entry& entry = m_entries.back();
+    m_memoryUsed -= getEntryBytes(entry);
+    m_entryLookup.erase(entry.m_key);
+    m_entries.pop_back();
+}
+
+/**
+ * @return Number of bytes of row data in an entry.
+ * @param entry
+ *    The entry.
+ */
+int64_t
+CiftiConnectivityRowCache::getEntryBytes(const Entry& entry) const
+{
+    return static_cast<int64_t>(entry.m_data.size() * sizeof(float));
+}
@@ -0,0 +1,110 @@
+#ifndef __CIFTI_CONNECTIVITY_ROW_CACHE_H__
+#define __CIFTI_CONNECTIVITY_ROW_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "CaretMutex.h"
+#include "CaretObject.h"
+
+namespace caret {
+
+    class CiftiConnectivityRowCache : public CaretObject {
+
+    public:
+        static CiftiConnectivityRowCache* get();
+
+        bool getRow(const void* owner,
+                    const int64_t rowIndex,
+                    float* dataOut,
+                    const int64_t rowLength);
+
+        bool hasRow(const void* owner,
+                    const int64_t rowIndex);
+
+        void addRow(const void* owner,
+                    const int64_t rowIndex,
+                    const float* data,
+                    const int64_t rowLength);
+
+        void removeRowsForOwner(const void* owner);
+
+        void clear();
+
+        int64_t getMemoryBudget() const;
+
+        void setMemoryBudget(const int64_t numberOfBytes);
+
+        int64_t getMemoryUsed() const;
+
+        /** Default memory budget, in bytes */
+        static const int64_t DEFAULT_MEMORY_BUDGET = 1024LL * 1024LL * 1024LL;
+
+    private:
+        CiftiConnectivityRowCache();
+
+        virtual ~CiftiConnectivityRowCache();
+
+        CiftiConnectivityRowCache(const CiftiConnectivityRowCache&);
+
+        CiftiConnectivityRowCache& operator=(const CiftiConnectivityRowCache&);
+
+        typedef std::pair<const void*, int64_t> RowKey;
+
+        class Entry {
+        public:
+            RowKey m_key;
+
+            std::vector<float> m_data;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        void removeLeastRecentlyUsed();
+
+        int64_t getEntryBytes(const Entry& entry) const;
+
+        /** Entries with the most recently used first */
+        EntryList m_entries;
+
+        std::map<RowKey, EntryList::iterator> m_entryLookup;
+
+        int64_t m_memoryBudget;
+
+        int64_t m_memoryUsed;
+
+        /** Protects all members since rows may be added from more than one thread */
+        mutable CaretMutex m_mutex;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __CIFTI_CONNECTIVITY_ROW_CACHE_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __CIFTI_CONNECTIVITY_ROW_CACHE_DECLARE__
+
+} // namespace
+#endif  //__CIFTI_CONNECTIVITY_ROW_CACHE_H__
@@ -23,7 +23,10 @@
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #undef __CIFTI_MAPPABLE_CONNECTIVITY_MATRIX_DATA_FILE_DECLARE__
 
+#include <algorithm>
+
 #include "CaretAssert.h"
+#include "CiftiConnectivityRowCache.h"
 #include "CiftiFile.h"
 #include "CaretLogger.h"
 #include "ChartableMatrixParcelInterface.h"
@@ -94,6 +97,9 @@ CiftiMappableConnectivityMatrixDataFile::clear()
 void
 CiftiMappableConnectivityMatrixDataFile::clearPrivate()
 {
+    CiftiConnectivityRowCache::get()->removeRowsForOwner(this);
+    m_rowsToPrefetch.clear();
+    m_nextRowToPrefetchIndex = 0;
     m_loadedRowData.clear();
     m_rowLoadedTextForMapName = "";
     m_rowLoadedText = "";
@@ -368,6 +374,13 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
         indices    = columnIndices;
     }
     
+    /*
+     * Read in file order so that reads of nearby rows are sequential
+     * (order does not matter for the sum)
+     */
+    std::sort(indices.begin(),
+              indices.end());
+    
     const int64_t numIndices = static_cast<int64_t>(indices.size());
     if (numIndices > 0) {
         std::vector<double> sum(dataLength, 0.0);
@@ -590,8 +603,8 @@ CiftiMappableConnectivityMatrixDataFile::getDataForColumn(float* dataOut, const
 void
 CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int64_t& index) const
 {
-    m_ciftiFile->getRow(dataOut,
-                        index);
+    getRowUsingCache(dataOut,
+                     index);
 }
 
 /**
@@ -624,8 +637,173 @@ CiftiMappableConnectivityMatrixDataFile::getProcessedDataForColumn(float* dataOu
 void
 CiftiMappableConnectivityMatrixDataFile::getProcessedDataForRow(float* dataOut, const int64_t& index) const
 {
+    getRowUsingCache(dataOut,
+                     index);
+}
+
+/**
+ * @return True if rows read from this file are kept in the row cache.
+ * Rows of files in memory are already fast to get and dense dynamic
+ * files compute their rows from the data.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::isRowCacheUsed() const
+{
+    if (m_ciftiFile == NULL) {
+        return false;
+    }
+    if (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC) {
+        return false;
+    }
+    return ( ! m_ciftiFile->isInMemory());
+}
+
+/**
+ * Get a row from the row cache or, if it is not cached, from the
+ * file, and then add it to the cache.
+ *
+ * @param dataOut
+ *     Output with data.
+ * @param index of the row.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::getRowUsingCache(float* dataOut, const int64_t& index) const
+{
+    if ( ! isRowCacheUsed()) {
+        m_ciftiFile->getRow(dataOut,
+                            index);
+        return;
+    }
+    
+    CiftiConnectivityRowCache* rowCache = CiftiConnectivityRowCache::get();
+    const int64_t rowLength = m_ciftiFile->getNumberOfColumns();
+    if (rowCache->getRow(this,
+                         index,
+                         dataOut,
+                         rowLength)) {
+        return;
+    }
+    
     m_ciftiFile->getRow(dataOut,
                         index);
+    rowCache->addRow(this,
+                     index,
+                     dataOut,
+                     rowLength);
+}
+
+/**
+ * Set the rows that are read into the row cache by prefetchRows(),
+ * replacing any rows not yet prefetched.  Typically these are the rows
+ * for nodes near the last node that was loaded, so that nearby
+ * loads are fast.
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of nodes, in the order they should be prefetched.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::setRowsToPrefetchForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                          const StructureEnum::Enum structure,
+                                                                          const std::vector<int32_t>& nodeIndices)
+{
+    m_rowsToPrefetch.clear();
+    m_nextRowToPrefetchIndex = 0;
+    
+    if ( ! isRowCacheUsed()) {
+        return;
+    }
+    
+    CiftiConnectivityRowCache* rowCache = CiftiConnectivityRowCache::get();
+    for (std::vector<int32_t>::const_iterator iter = nodeIndices.begin();
+         iter != nodeIndices.end();
+         iter++) {
+        int64_t rowIndex = -1;
+        int64_t columnIndex = -1;
+        getRowColumnIndexForNodeWhenLoading(structure,
+                                            surfaceNumberOfNodes,
+                                            *iter,
+                                            rowIndex,
+                                            columnIndex);
+        if (rowIndex >= 0) {
+            if ( ! rowCache->hasRow(this,
+                                    rowIndex)) {
+                m_rowsToPrefetch.push_back(rowIndex);
+            }
+        }
+    }
+}
+
+/**
+ * @return True if there are rows waiting for prefetchRows().
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::hasRowsToPrefetch() const
+{
+    return (m_nextRowToPrefetchIndex < static_cast<int64_t>(m_rowsToPrefetch.size()));
+}
+
+/**
+ * Read some of the rows set by setRowsToPrefetchForSurfaceNodes() into
+ * the row cache.  Intended to be called repeatedly when the user
+ * interface is idle, so each call reads only a few rows.
+ *
+ * @param maximumNumberOfRows
+ *    Maximum number of rows read by this call.
+ * @return
+ *    True if there are more rows to prefetch.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::prefetchRows(const int32_t maximumNumberOfRows)
+{
+    if ( ! isRowCacheUsed()) {
+        m_rowsToPrefetch.clear();
+        m_nextRowToPrefetchIndex = 0;
+        return false;
+    }
+    
+    const int64_t numRowsToPrefetch = static_cast<int64_t>(m_rowsToPrefetch.size());
+    const int64_t lastIndex = std::min(m_nextRowToPrefetchIndex + maximumNumberOfRows,
+                                       numRowsToPrefetch);
+    
+    /*
+     * Within a batch, read in file order
+     */
+    std::vector<int64_t> batchRows(m_rowsToPrefetch.begin() + m_nextRowToPrefetchIndex,
+                                   m_rowsToPrefetch.begin() + lastIndex);
+    std::sort(batchRows.begin(),
+              batchRows.end());
+    m_nextRowToPrefetchIndex = lastIndex;
+    
+    CiftiConnectivityRowCache* rowCache = CiftiConnectivityRowCache::get();
+    std::vector<float> rowData(m_ciftiFile->getNumberOfColumns());
+    try {
+        for (std::vector<int64_t>::iterator iter = batchRows.begin();
+             iter != batchRows.end();
+             iter++) {
+            if ( ! rowCache->hasRow(this,
+                                    *iter)) {
+                getRowUsingCache(&rowData[0],
+                                 *iter);
+            }
+        }
+    }
+    catch (const DataFileException& dfe) {
+        /*
+         * Prefetching is optional, errors are reported when the row is loaded
+         */
+        CaretLogWarning("Prefetching rows from "
+                        + getFileNameNoPath()
+                        + " failed: "
+                        + dfe.whatString());
+        m_rowsToPrefetch.clear();
+        m_nextRowToPrefetchIndex = 0;
+    }
+    
+    return hasRowsToPrefetch();
 }
 
 /**
@@ -93,6 +93,14 @@ namespace caret {
         
         ChartMatrixLoadingDimensionEnum::Enum getChartMatrixLoadingDimension() const;
         
+        void setRowsToPrefetchForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                              const StructureEnum::Enum structure,
+                                              const std::vector<int32_t>& nodeIndices);
+        
+        bool hasRowsToPrefetch() const;
+        
+        bool prefetchRows(const int32_t maximumNumberOfRows);
+        
         //TSC: HACK to expose dynconn enabled as layer status
         virtual bool isEnabledAsLayer() const { return true; }
         
@@ -169,6 +177,10 @@ namespace caret {
         
         int32_t getCifitDirectionForLoadingRowOrColumn();
         
+        bool isRowCacheUsed() const;
+        
+        void getRowUsingCache(float* dataOut, const int64_t& index) const;
+        
         // ADD_NEW_MEMBERS_HERE
         
         SceneClassAssistant* m_sceneAssistant;
@@ -183,6 +195,12 @@ namespace caret {
         
         ConnectivityDataLoaded* m_connectivityDataLoaded;
         
+        /** Rows for prefetchRows(), in the order they are prefetched */
+        std::vector<int64_t> m_rowsToPrefetch;
+        
+        /** Index in m_rowsToPrefetch of the next row to prefetch */
+        int64_t m_nextRowToPrefetchIndex;
+        
         /*
          * This is really a member of parcel file since it the parcel
          * file is the only file that can load by row or column.
@@ -22,19 +22,28 @@
 
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "SurfaceFile.h"
 #include "MetricFile.h"
 #include "GeodesicHelper.h"
 #include "TopologyHelper.h"
 #include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    const int BLOCK_COLUMNS = 16;//columns smoothed per pass in smoothMetric, 16 floats from each neighbor is one cache line
+}
+
 MetricSmoothingObject::MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi, Method myMethod, const float* nodeAreas)
 {
     CaretAssert(mySurf != NULL);
+    m_numNodes = 0;
     if (myRoi != NULL && mySurf->getNumberOfNodes() != myRoi->getNumberOfNodes())
     {
         throw CaretException("roi number of nodes doesn't match the surface");
@@ -46,7 +55,7 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(columnOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
@@ -54,14 +63,14 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
     {
         throw CaretException("invalid column number");
     }
-    if (columnOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || columnOut->getNumberOfColumns() != 1)
+    if (columnOut->getNumberOfNodes() != m_numNodes || columnOut->getNumberOfColumns() != 1)
     {
-        columnOut->setNumberOfNodesAndColumns(m_weightLists.size(), 1);
+        columnOut->setNumberOfNodesAndColumns(m_numNodes, 1);
     }
     vector<float> scratch(metricIn->getNumberOfNodes());
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
@@ -75,15 +84,15 @@ void MetricSmoothingObject::smoothColumn(const MetricFile* metricIn, const int&
 {
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricOut->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("output metric does not match surface number of nodes");
     }
-    if (roi != NULL && (roi->getNumberOfNodes() != (int32_t)m_weightLists.size()))
+    if (roi != NULL && (roi->getNumberOfNodes() != m_numNodes))
     {
         throw CaretException("roi does not match surface number of nodes");
     }
@@ -113,29 +122,135 @@ void MetricSmoothingObject::smoothMetric(const MetricFile* metricIn, MetricFile*
     CaretAssert(metricIn != NULL);
     CaretAssert(metricOut != NULL);
     int32_t numCols = metricIn->getNumberOfColumns();
-    if (metricIn->getNumberOfNodes() != (int32_t)m_weightLists.size())
+    if (metricIn->getNumberOfNodes() != m_numNodes)
     {
         throw CaretException("metric does not match surface number of nodes");
     }
-    if (metricOut->getNumberOfNodes() != (int32_t)m_weightLists.size() || metricOut->getNumberOfColumns() != numCols)
+    if (metricOut->getNumberOfNodes() != m_numNodes || metricOut->getNumberOfColumns() != numCols)
     {
-        metricOut->setNumberOfNodesAndColumns(m_weightLists.size(), numCols);
+        metricOut->setNumberOfNodesAndColumns(m_numNodes, numCols);
     }
-    vector<float> scratch(metricIn->getNumberOfNodes());
+    smoothColumns(metricIn, 0, numCols, metricOut, roi, fixZeros);
+}
+
+int32_t MetricSmoothingObject::getColumnsPerPass()
+{
+    return BLOCK_COLUMNS;
+}
+
+void MetricSmoothingObject::smoothColumns(const MetricFile* metricIn, const int32_t& firstColumn, const int32_t& numColumns, MetricFile* metricOut,
+                                          const MetricFile* roi, const bool& fixZeros) const
+{
+    CaretAssert(metricIn != NULL);
+    CaretAssert(metricOut != NULL);
+    CaretAssert(firstColumn >= 0 && numColumns >= 0 && firstColumn + numColumns <= metricIn->getNumberOfColumns());
+    if (metricIn->getNumberOfNodes() != m_numNodes)
+    {
+        throw CaretException("metric does not match surface number of nodes");
+    }
+    if (metricOut->getNumberOfNodes() != m_numNodes || metricOut->getNumberOfColumns() != metricIn->getNumberOfColumns())
+    {
+        throw CaretException("output metric does not match input metric dimensions");
+    }
+    if (numColumns < 1) return;
+    const float* roiColumn = NULL;
     if (roi != NULL)
     {
-        if (roi->getNumberOfNodes() != (int32_t)m_weightLists.size())
+        if (roi->getNumberOfNodes() != m_numNodes)
         {
             throw CaretException("roi does not match surface number of nodes");
         }
-        for (int32_t i = 0; i < numCols; ++i)
+        roiColumn = roi->getValuePointerForColumn(0);
+    }
+    const int32_t endColumn = firstColumn + numColumns;
+    int blockColumns = min(BLOCK_COLUMNS, numColumns);
+    vector<float> interleaved(m_numNodes * blockColumns), outBlock(m_numNodes * blockColumns);
+    vector<const float*> columnPointers(blockColumns);
+    for (int32_t blockStart = firstColumn; blockStart < endColumn; blockStart += BLOCK_COLUMNS)
+    {
+        int blockSize = min(BLOCK_COLUMNS, endColumn - blockStart);
+        for (int c = 0; c < blockSize; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, roi, 0, fixZeros);
+            columnPointers[c] = metricIn->getValuePointerForColumn(blockStart + c);
         }
-    } else {
-        for (int32_t i = 0; i < numCols; ++i)
+#pragma omp CARET_PARFOR schedule(static)
+        for (int32_t i = 0; i < m_numNodes; ++i)//interleave the columns, so that each neighbor's values for the whole block are contiguous
+        {
+            float* nodeValues = interleaved.data() + (int64_t)i * blockSize;
+            for (int c = 0; c < blockSize; ++c)
+            {
+                nodeValues[c] = columnPointers[c][i];
+            }
+        }
+        smoothColumnBlock(interleaved.data(), blockSize, outBlock.data(), roiColumn, fixZeros);
+        for (int c = 0; c < blockSize; ++c)
+        {
+            metricOut->setValuesForColumn(blockStart + c, outBlock.data() + (int64_t)c * m_numNodes);
+        }
+    }
+}
+
+void MetricSmoothingObject::smoothColumnBlock(const float* interleaved, const int& blockSize, float* columnsOut, const float* roiColumn, const bool& fixZeros) const
+{//gives the same results as smoothColumnInternal on each column, because the per-column sums are accumulated in the same order
+    CaretAssert(blockSize > 0 && blockSize <= BLOCK_COLUMNS);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        if (m_weightSums[i] == 0.0f || (roiColumn != NULL && !(roiColumn[i] > 0.0f)))
+        {
+            for (int c = 0; c < blockSize; ++c)
+            {
+                columnsOut[(int64_t)c * m_numNodes + i] = 0.0f;
+            }
+            continue;
+        }
+        float sum[BLOCK_COLUMNS], weightsum[BLOCK_COLUMNS];
+        float rowWeightSum = 0.0f;
+        for (int c = 0; c < blockSize; ++c)
+        {
+            sum[c] = 0.0f;
+            weightsum[c] = 0.0f;
+        }
+        const int64_t rowEnd = m_rowStart[i + 1];
+        for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
+        {
+            int32_t neighbor = m_weightNodes[j];
+            if (roiColumn != NULL && !(roiColumn[neighbor] > 0.0f)) continue;
+            float weight = m_weights[j];
+            const float* values = interleaved + (int64_t)neighbor * blockSize;
+            if (fixZeros)
+            {
+                for (int c = 0; c < blockSize; ++c)
+                {
+                    float useWeight = (values[c] != 0.0f) ? weight : 0.0f;//branchless, so the compiler can vectorize across columns
+                    sum[c] += useWeight * values[c];
+                    weightsum[c] += useWeight;
+                }
+            } else {
+                for (int c = 0; c < blockSize; ++c)
+                {
+                    sum[c] += weight * values[c];
+                }
+                rowWeightSum += weight;
+            }
+        }
+        for (int c = 0; c < blockSize; ++c)
         {
-            smoothColumnInternal(scratch.data(), metricIn, i, metricOut, i, fixZeros);
+            float divisor;
+            if (fixZeros)
+            {
+                divisor = weightsum[c];
+            } else if (roiColumn != NULL) {
+                divisor = rowWeightSum;
+            } else {
+                divisor = m_weightSums[i];
+            }
+            if (divisor != 0.0f)
+            {
+                columnsOut[(int64_t)c * m_numNodes + i] = sum[c] / divisor;
+            } else {
+                columnsOut[(int64_t)c * m_numNodes + i] = 0.0f;
+            }
         }
     }
 }
@@ -154,17 +269,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            const int64_t rowEnd = m_rowStart[i + 1];
+            if (m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    float value = myColumn[myWeightRef.m_nodes[j]];
+                    float value = myColumn[m_weightNodes[j]];
                     if (value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -183,16 +297,15 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (myWeightRef.m_weightSum != 0.0f)
+            const int64_t rowEnd = m_rowStart[i + 1];
+            if (m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    sum += myWeightRef.m_weights[j] * myColumn[myWeightRef.m_nodes[j]];
+                    sum += m_weights[j] * myColumn[m_weightNodes[j]];
                 }
-                scratch[i] = sum / myWeightRef.m_weightSum;
+                scratch[i] = sum / m_weightSums[i];
             } else {
                 scratch[i] = 0.0f;
             }
@@ -218,18 +331,17 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)//skip nodes with no neighbors quickly
+            const int64_t rowEnd = m_rowStart[i + 1];
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)//skip nodes with no neighbors quickly
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_weightNodes[j];
                     float value = myColumn[neighbor];
                     if (roiColumn[neighbor] > 0.0f && value != 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * value;
                         weightsum += weight;
                     }
@@ -248,17 +360,16 @@ void MetricSmoothingObject::smoothColumnInternal(float* scratch, const MetricFil
 #pragma omp CARET_PARFOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            const WeightList& myWeightRef = m_weightLists[i];
-            if (roiColumn[i] > 0.0f && myWeightRef.m_weightSum != 0.0f)
+            const int64_t rowEnd = m_rowStart[i + 1];
+            if (roiColumn[i] > 0.0f && m_weightSums[i] != 0.0f)
             {
                 float sum = 0.0f, weightsum = 0.0f;
-                int32_t numWeights = myWeightRef.m_nodes.size();
-                for (int32_t j = 0; j < numWeights; ++j)
+                for (int64_t j = m_rowStart[i]; j < rowEnd; ++j)
                 {
-                    int32_t neighbor = myWeightRef.m_nodes[j];
+                    int32_t neighbor = m_weightNodes[j];
                     if (roiColumn[neighbor] > 0.0f)
                     {
-                        float weight = myWeightRef.m_weights[j];
+                        float weight = m_weights[j];
                         sum += weight * myColumn[neighbor];
                         weightsum += weight;
                     }
@@ -282,7 +393,7 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    vector<WeightList> gatherLists(numNodes);
 #pragma omp CARET_PAR
     {
         CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();//don't really need one per thread here, but good practice in case we want getNeighborsToDepth
@@ -291,24 +402,25 @@ void MetricSmoothingObject::precomputeWeightsGeoGauss(const SurfaceFile* mySurf,
 #pragma omp CARET_FOR schedule(dynamic)
         for (int32_t i = 0; i < numNodes; ++i)
         {
-            myGeoHelp->getNodesToGeoDist(i, myGeoDist, m_weightLists[i].m_nodes, distances, true);
+            myGeoHelp->getNodesToGeoDist(i, myGeoDist, gatherLists[i].m_nodes, distances, true);
             if (distances.size() < 7)
             {
-                m_weightLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
-                m_weightLists[i].m_nodes.push_back(i);
-                myGeoHelp->getGeoToTheseNodes(i, m_weightLists[i].m_nodes, distances, true);
+                gatherLists[i].m_nodes = myTopoHelp->getNodeNeighbors(i);
+                gatherLists[i].m_nodes.push_back(i);
+                myGeoHelp->getGeoToTheseNodes(i, gatherLists[i].m_nodes, distances, true);
             }
             int32_t numNeigh = (int32_t)distances.size();
-            m_weightLists[i].m_weights.resize(numNeigh);
-            m_weightLists[i].m_weightSum = 0.0f;
+            gatherLists[i].m_weights.resize(numNeigh);
+            gatherLists[i].m_weightSum = 0.0f;
             for (int32_t j = 0; j < numNeigh; ++j)
             {
                 float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                m_weightLists[i].m_weights[j] = weight;
-                m_weightLists[i].m_weightSum += weight;
+                gatherLists[i].m_weights[j] = weight;
+                gatherLists[i].m_weightSum += weight;
             }
         }
     }
+    setGatheringWeights(gatherLists);
 }
 
 void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi)
@@ -316,7 +428,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
     int32_t numNodes = mySurf->getNumberOfNodes();
     float myGeoDist = myKernel * 3.0f;
     float gaussianDenom = -0.5f / myKernel / myKernel;
-    m_weightLists.resize(numNodes);
+    vector<WeightList> gatherLists(numNodes);
     const float* myRoiColumn = theRoi->getValuePointerForColumn(0);
 #pragma omp CARET_PAR
     {
@@ -337,22 +449,23 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGauss(const SurfaceFile* mySu
                     myGeoHelp->getGeoToTheseNodes(i, nodes, distances, true);
                 }
                 int32_t numNeigh = (int32_t)distances.size();
-                m_weightLists[i].m_weights.reserve(numNeigh);
-                m_weightLists[i].m_nodes.reserve(numNeigh);
-                m_weightLists[i].m_weightSum = 0.0f;
+                gatherLists[i].m_weights.reserve(numNeigh);
+                gatherLists[i].m_nodes.reserve(numNeigh);
+                gatherLists[i].m_weightSum = 0.0f;
                 for (int32_t j = 0; j < numNeigh; ++j)
                 {
                     if (myRoiColumn[nodes[j]] > 0.0f)
                     {
                         float weight = exp(distances[j] * distances[j] * gaussianDenom);//exp(- dist ^ 2 / (2 * sigma ^ 2))
-                        m_weightLists[i].m_weights.push_back(weight);
-                        m_weightLists[i].m_nodes.push_back(nodes[j]);
-                        m_weightLists[i].m_weightSum += weight;
+                        gatherLists[i].m_weights.push_back(weight);
+                        gatherLists[i].m_nodes.push_back(nodes[j]);
+                        gatherLists[i].m_weightSum += weight;
                     }
                 }
             }
         }
     }
+    setGatheringWeights(gatherLists);
 }
 
 void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const float* nodeAreas)
@@ -396,26 +509,7 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussArea(const SurfaceFile* myS
             tempList[i].m_weightSum = nodeAreas[i];
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
-    for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
-    {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
-        size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
-    }
-    for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
-    {
-        int32_t numNeigh = tempList[i].m_nodes.size();
-        for (int32_t j = 0; j < numNeigh; ++j)
-        {
-            int32_t node = tempList[i].m_nodes[j];
-            float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
-        }
-    }
+    setScatteringWeights(tempList);//now convert it to gathering kernels
 }
 
 void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, const float* nodeAreas)
@@ -468,26 +562,7 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussArea(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
-    for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
-    {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
-        size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
-    }
-    for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
-    {
-        int32_t numNeigh = tempList[i].m_nodes.size();
-        for (int32_t j = 0; j < numNeigh; ++j)
-        {
-            int32_t node = tempList[i].m_nodes[j];
-            float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
-        }
-    }
+    setScatteringWeights(tempList);//now convert it to gathering kernels
 }
 
 void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* mySurf, float myKernel)
@@ -530,26 +605,7 @@ void MetricSmoothingObject::precomputeWeightsGeoGaussEqual(const SurfaceFile* my
             tempList[i].m_weightSum = 1.0f;
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
-    for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
-    {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
-        size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes (geodesic distance should be symmetric except for rounding errors, so it should usually be exact)
-        m_weightLists[i].m_weights.reserve(neighborCount);
-    }
-    for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
-    {
-        int32_t numNeigh = tempList[i].m_nodes.size();
-        for (int32_t j = 0; j < numNeigh; ++j)
-        {
-            int32_t node = tempList[i].m_nodes[j];
-            float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
-        }
-    }
+    setScatteringWeights(tempList);//now convert it to gathering kernels
 }
 
 void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi)
@@ -601,24 +657,62 @@ void MetricSmoothingObject::precomputeWeightsROIGeoGaussEqual(const SurfaceFile*
             }
         }
     }
-    m_weightLists.resize(numNodes);//now convert it to gathering kernels
-    for (int32_t i = 0; i < numNodes; ++i)//sadly, this is VERY hard to parallelize in a manner that is efficient, since it needs random access modification
+    setScatteringWeights(tempList);//now convert it to gathering kernels
+}
+
+void MetricSmoothingObject::setGatheringWeights(const vector<WeightList>& gatherLists)
+{
+    m_numNodes = (int32_t)gatherLists.size();
+    m_rowStart.resize(m_numNodes + 1);
+    m_rowStart[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        m_rowStart[i + 1] = m_rowStart[i] + gatherLists[i].m_nodes.size();
+    }
+    m_weightNodes.resize(m_rowStart[m_numNodes]);
+    m_weights.resize(m_rowStart[m_numNodes]);
+    m_weightSums.resize(m_numNodes);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        CaretAssert(gatherLists[i].m_nodes.size() == gatherLists[i].m_weights.size());
+        copy(gatherLists[i].m_nodes.begin(), gatherLists[i].m_nodes.end(), m_weightNodes.begin() + m_rowStart[i]);
+        copy(gatherLists[i].m_weights.begin(), gatherLists[i].m_weights.end(), m_weights.begin() + m_rowStart[i]);
+        m_weightSums[i] = gatherLists[i].m_weightSum;
+    }
+}
+
+void MetricSmoothingObject::setScatteringWeights(const vector<WeightList>& scatterLists)
+{//count the entries for each gathering row first, so the transpose can be written directly into place
+    m_numNodes = (int32_t)scatterLists.size();
+    m_rowStart.assign(m_numNodes + 1, 0);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeigh = (int32_t)scatterLists[i].m_nodes.size();
+        for (int32_t j = 0; j < numNeigh; ++j)
+        {
+            ++m_rowStart[scatterLists[i].m_nodes[j] + 1];
+        }
+    }
+    for (int32_t i = 0; i < m_numNodes; ++i)
     {
-        m_weightLists[i].m_weightSum = 0.0f;//memory initialization may not go much faster in parallel
-        size_t neighborCount = tempList[i].m_nodes.size();
-        m_weightLists[i].m_nodes.reserve(neighborCount);//also preallocate the expected number of nodes, again, should be exact except for rounding errors in geodesic distance
-        m_weightLists[i].m_weights.reserve(neighborCount);
+        m_rowStart[i + 1] += m_rowStart[i];
     }
-    for (int32_t i = 0; i < numNodes; ++i)//and this needs to push onto random vectors in the weight list
+    m_weightNodes.resize(m_rowStart[m_numNodes]);
+    m_weights.resize(m_rowStart[m_numNodes]);
+    m_weightSums.assign(m_numNodes, 0.0f);
+    vector<int64_t> nextEntry(m_rowStart.begin(), m_rowStart.end() - 1);
+    for (int32_t i = 0; i < m_numNodes; ++i)//visit in the same order as the scatter lists, so each row is sorted and the sums are the same as adding them one at a time
     {
-        int32_t numNeigh = tempList[i].m_nodes.size();
+        int32_t numNeigh = (int32_t)scatterLists[i].m_nodes.size();
         for (int32_t j = 0; j < numNeigh; ++j)
         {
-            int32_t node = tempList[i].m_nodes[j];
-            float weight = tempList[i].m_weights[j];
-            m_weightLists[node].m_nodes.push_back(i);
-            m_weightLists[node].m_weights.push_back(weight);
-            m_weightLists[node].m_weightSum += weight;
+            int32_t node = scatterLists[i].m_nodes[j];
+            float weight = scatterLists[i].m_weights[j];
+            int64_t entry = nextEntry[node]++;
+            m_weightNodes[entry] = i;
+            m_weights[entry] = weight;
+            m_weightSums[node] += weight;
         }
     }
 }
@@ -639,6 +733,25 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
         default:
             break;
     }
+    WeightCache::Key cacheKey("MetricSmoothingObject");
+    if (WeightCache::isEnabled())
+    {
+        int32_t numNodes = mySurf->getNumberOfNodes();
+        cacheKey.addSurface(mySurf);
+        cacheKey.addValue(myKernel);
+        cacheKey.addValue((int32_t)myMethod);
+        if (myMethod == GEO_GAUSS_AREA)
+        {
+            cacheKey.addData(passAreas, numNodes * sizeof(float));
+        }
+        int32_t haveRoi = (theRoi != NULL ? 1 : 0);
+        cacheKey.addValue(haveRoi);
+        if (theRoi != NULL)
+        {
+            cacheKey.addData(theRoi->getValuePointerForColumn(0), numNodes * sizeof(float));
+        }
+        if (loadCachedWeights(cacheKey, numNodes)) return;
+    }
     if (theRoi != NULL)
     {
         switch (myMethod)
@@ -671,4 +784,49 @@ void MetricSmoothingObject::precomputeWeights(const SurfaceFile* mySurf, float m
                 throw CaretException("unknown smoothing method specified");
         };
     }
+    if (WeightCache::isEnabled())
+    {
+        saveCachedWeights(cacheKey);
+    }
+}
+
+bool MetricSmoothingObject::loadCachedWeights(const WeightCache::Key& cacheKey, const int32_t& numNodes)
+{
+    WeightCache myCache;
+    if (!WeightCache::load(cacheKey, myCache)) return false;
+    if (!myCache.getArray(0, m_rowStart) || !myCache.getArray(1, m_weightNodes) || !myCache.getArray(2, m_weights) || !myCache.getArray(3, m_weightSums) ||
+        (int32_t)m_rowStart.size() != numNodes + 1 || (int32_t)m_weightSums.size() != numNodes || m_rowStart[0] != 0 ||
+        (int64_t)m_weightNodes.size() != m_rowStart[numNodes] || m_weights.size() != m_weightNodes.size())
+    {
+        CaretLogWarning("smoothing weight cache file has unexpected contents, recomputing");
+        return false;
+    }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        if (m_rowStart[i + 1] < m_rowStart[i])
+        {
+            CaretLogWarning("smoothing weight cache file has unexpected contents, recomputing");
+            return false;
+        }
+    }
+    for (int64_t i = 0; i < (int64_t)m_weightNodes.size(); ++i)
+    {
+        if (m_weightNodes[i] < 0 || m_weightNodes[i] >= numNodes)
+        {
+            CaretLogWarning("smoothing weight cache file has unexpected contents, recomputing");
+            return false;
+        }
+    }
+    m_numNodes = numNodes;
+    return true;
+}
+
+void MetricSmoothingObject::saveCachedWeights(const WeightCache::Key& cacheKey) const
+{
+    WeightCache myCache;
+    myCache.addArray(m_rowStart.data(), m_rowStart.size());
+    myCache.addArray(m_weightNodes.data(), m_weightNodes.size());
+    myCache.addArray(m_weights.data(), m_weights.size());
+    myCache.addArray(m_weightSums.data(), m_weightSums.size());
+    WeightCache::save(cacheKey, myCache);
 }
@@ -30,6 +30,8 @@
 //NOTE: for a static ROI, it is (sometimes much) more efficient to use it in the constructor, and provide no ROI (NULL) to the functions, using both an ROI in constructor and in method
 //      will result in the effective ROI being the logical AND of the two (intersection).
 
+#include "WeightCache.h"
+
 #include "stdint.h"
 #include "stddef.h"
 #include <vector>
@@ -51,17 +53,35 @@ namespace caret {
         MetricSmoothingObject(const SurfaceFile* mySurf, const float& kernel, const MetricFile* myRoi = NULL, Method myMethod = GEO_GAUSS_AREA, const float* nodeAreas = NULL);
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* columnOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
         void smoothColumn(const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi = NULL, const int& whichRoiColumn = 0, const bool& fixZeros = false) const;
+        ///smooths all columns, processing several columns per pass over the weights, which is much faster than smoothColumn on each column
         void smoothMetric(const MetricFile* metricIn, MetricFile* metricOut, const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///smooths numColumns columns starting at firstColumn into the same columns of metricOut, which must already have the same dimensions as metricIn
+        ///call with getColumnsPerPass() columns at a time to report progress between passes
+        void smoothColumns(const MetricFile* metricIn, const int32_t& firstColumn, const int32_t& numColumns, MetricFile* metricOut,
+                           const MetricFile* roi = NULL, const bool& fixZeros = false) const;
+        ///number of columns smoothColumns processes in one pass over the weights
+        static int32_t getColumnsPerPass();
     private:
-        struct WeightList
+        struct WeightList//only used while computing weights
         {
             std::vector<int32_t> m_nodes;
             std::vector<float> m_weights;
             float m_weightSum;
+            WeightList() { m_weightSum = 0.0f; }
         };
-        std::vector<WeightList> m_weightLists;
+        //gathering weights as a sparse matrix in compressed row format, the weights for node i are at m_rowStart[i] through m_rowStart[i + 1] - 1
+        std::vector<int64_t> m_rowStart;
+        std::vector<int32_t> m_weightNodes;
+        std::vector<float> m_weights;
+        std::vector<float> m_weightSums;
+        int32_t m_numNodes;
+        void setGatheringWeights(const std::vector<WeightList>& gatherLists);
+        void setScatteringWeights(const std::vector<WeightList>& scatterLists);//transposes to gathering weights
+        void smoothColumnBlock(const float* interleaved, const int& blockSize, float* columnsOut, const float* roiColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const bool& fixZeros) const;
         void smoothColumnInternal(float* scratch, const MetricFile* metricIn, const int& whichColumn, MetricFile* metricOut, const int& whichOutColumn, const MetricFile* roi, const int& whichRoiColumn, const bool& fixZeros) const;
+        bool loadCachedWeights(const WeightCache::Key& cacheKey, const int32_t& numNodes);
+        void saveCachedWeights(const WeightCache::Key& cacheKey) const;
         void precomputeWeights(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi, Method myMethod, const float* nodeAreas);
         void precomputeWeightsGeoGauss(const SurfaceFile* mySurf, float myKernel);
         void precomputeWeightsROIGeoGauss(const SurfaceFile* mySurf, float myKernel, const MetricFile* theRoi);
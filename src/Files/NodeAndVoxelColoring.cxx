@@ -33,12 +33,13 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretOMP.h"
+#include "CaretPointer.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GroupAndNameHierarchyItem.h"
 #include "Palette.h"
 #include "PaletteColorMapping.h"
-#include "CaretOMP.h"
+#include "PaletteLookupTable.h"
 
 using namespace caret;
 
@@ -57,6 +58,128 @@ static const float negativeThresholdGreenColor[] = {
 };
 
 
+static const uint8_t positiveThresholdGreenColorByte[4] = { 115, 255, 180, 255 };
+
+static const uint8_t negativeThresholdGreenColorByte[4] = { 180, 255, 115, 255 };
+
+namespace {
+/**
+ * Settings, from the palette color mapping, for coloring with a lookup table.
+ */
+struct PaletteColoringSettings {
+    bool hidePositiveValues;
+    bool hideNegativeValues;
+    bool hideZeroValues;
+    bool skipThresholdTesting;
+    bool showOutsideFlag;
+    bool showMappedThresholdFailuresInGreen;
+    float thresholdMinimum;
+    float thresholdMaximum;
+    float thresholdMappedPositive;
+    float thresholdMappedPositiveAverageArea;
+    float thresholdMappedNegative;
+    float thresholdMappedNegativeAverageArea;
+};
+}
+
+/**
+ * Color scalars with a palette lookup table.  Each of the tests (sign,
+ * threshold, threshold failure in green) is evaluated for every scalar
+ * and combined without branching so that the loop can be vectorized.
+ *
+ * @param settings
+ *    Display and threshold settings.
+ * @param lookupTable
+ *    Palette lookup table with colors of type T.
+ * @param positiveGreen
+ *    Color for positive mapped threshold failures.
+ * @param negativeGreen
+ *    Color for negative mapped threshold failures.
+ * @param scalarValues
+ *    Scalars that are colored.
+ * @param normalizedValues
+ *    Scalars normalized to the palette's range.
+ * @param thresholdValues
+ *    Thresholds for inhibiting coloring.
+ * @param numberOfScalars
+ *    Number of scalars, normalized values, and thresholds.
+ * @param rgbaOut
+ *    RGBA colors that are output.
+ */
+template <class T>
+static void
+colorScalarsWithLookupTable(const PaletteColoringSettings& settings,
+                            const T* lookupTable,
+                            const T* positiveGreen,
+                            const T* negativeGreen,
+                            const float* scalarValues,
+                            const float* normalizedValues,
+                            const float* thresholdValues,
+                            const int64_t numberOfScalars,
+                            T* rgbaOut)
+{
+    const bool showPositive = ! settings.hidePositiveValues;
+    const bool showNegative = ! settings.hideNegativeValues;
+    const bool showZero     = ! settings.hideZeroValues;
+    const bool skipThresholdTesting = settings.skipThresholdTesting;
+    const bool showOutsideFlag = settings.showOutsideFlag;
+    const bool greenFlag = settings.showMappedThresholdFailuresInGreen;
+    const float thresholdMinimum = settings.thresholdMinimum;
+    const float thresholdMaximum = settings.thresholdMaximum;
+    
+#pragma omp CARET_PARFOR schedule(static, 16384)
+    for (int64_t i = 0; i < numberOfScalars; i++) {
+        const float scalar = scalarValues[i];
+        const float threshold = thresholdValues[i];
+        
+        /*
+         * Positive/Zero/Negative Test, values very near zero are colored as zero
+         */
+        const bool positiveFlag = (scalar > PaletteColorMapping::SMALL_POSITIVE);
+        const bool negativeFlag = (scalar < PaletteColorMapping::SMALL_NEGATIVE);
+        const bool zeroFlag = ! (positiveFlag | negativeFlag);
+        const bool displayFlag = ((positiveFlag & showPositive)
+                                  | (negativeFlag & showNegative)
+                                  | (zeroFlag & showZero));
+        const float normalValue = (zeroFlag ? 0.0f : normalizedValues[i]);
+        
+        /*
+         * Threshold Test
+         */
+        const bool insideFlag  = ((threshold >= thresholdMinimum) & (threshold <= thresholdMaximum));
+        const bool outsideFlag = ((threshold > thresholdMaximum) | (threshold < thresholdMinimum));
+        const bool thresholdPassedFlag = (skipThresholdTesting
+                                          | (showOutsideFlag ? outsideFlag : insideFlag));
+        
+        /*
+         * Failures of mapped threshold in the average area range may be shown in green
+         */
+        const bool greenPositiveFlag = ((! thresholdPassedFlag) & greenFlag
+                                        & (threshold > 0.0f)
+                                        & (threshold < settings.thresholdMappedPositive)
+                                        & (threshold > settings.thresholdMappedPositiveAverageArea));
+        const bool greenNegativeFlag = ((! thresholdPassedFlag) & greenFlag
+                                        & (threshold < 0.0f)
+                                        & (threshold > settings.thresholdMappedNegative)
+                                        & (threshold < settings.thresholdMappedNegativeAverageArea));
+        
+        const T* rgba = lookupTable + PaletteLookupTable::getIndex(normalValue) * 4;
+        rgba = (greenPositiveFlag ? positiveGreen : (greenNegativeFlag ? negativeGreen : rgba));
+        
+        /*
+         * When the threshold test fails, the color is kept but alpha is zero
+         */
+        const bool alphaFlag = (displayFlag & (thresholdPassedFlag | greenPositiveFlag | greenNegativeFlag));
+        
+        T* rgbaPtr = rgbaOut + i * 4;
+        rgbaPtr[0] = (displayFlag ? rgba[0] : 0);
+        rgbaPtr[1] = (displayFlag ? rgba[1] : 0);
+        rgbaPtr[2] = (displayFlag ? rgba[2] : 0);
+        rgbaPtr[3] = (alphaFlag   ? rgba[3] : 0);
+    }
+}
+
+
     
 /**
  * \class NodeAndVoxelColoring 
@@ -180,191 +303,52 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                                                           numberOfScalars);
     
     /*
-     * Get color for normalized values of -1.0 and 1.0.
-     * Since there may be a large number of values that are -1.0 or 1.0
-     * we can compute the color only once for these values and save time.
+     * Palette colors are looked up in a table of the palette sampled
+     * over [-1, 1] instead of searching the palette for each value.
      */
-    float rgbaPositiveOne[4], rgbaNegativeOne[4];
-    palette->getPaletteColor(1.0,
-                             interpolateFlag,
-                             rgbaPositiveOne);
-    const bool rgbaPositiveOneValid = (rgbaPositiveOne[3] > 0.0);
-    palette->getPaletteColor(-1.0,
-                             interpolateFlag,
-                             rgbaNegativeOne);
-    const bool rgbaNegativeOneValid = (rgbaNegativeOne[3] > 0.0);
+    const CaretPointer<const PaletteLookupTable> lookupTable = palette->getLookupTable(interpolateFlag);
+    
+    PaletteColoringSettings settings;
+    settings.hidePositiveValues = hidePositiveValues;
+    settings.hideNegativeValues = hideNegativeValues;
+    settings.hideZeroValues = hideZeroValues;
+    settings.skipThresholdTesting = skipThresholdTesting;
+    settings.showOutsideFlag = showOutsideFlag;
+    settings.showMappedThresholdFailuresInGreen = (showMappedThresholdFailuresInGreen
+                                                   && (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_MAPPED));
+    settings.thresholdMinimum = thresholdMinimum;
+    settings.thresholdMaximum = thresholdMaximum;
+    settings.thresholdMappedPositive = thresholdMappedPositive;
+    settings.thresholdMappedPositiveAverageArea = thresholdMappedPositiveAverageArea;
+    settings.thresholdMappedNegative = thresholdMappedNegative;
+    settings.thresholdMappedNegativeAverageArea = thresholdMappedNegativeAverageArea;
     
     /*
      * Color all scalars.
      */
-#pragma omp CARET_PARFOR schedule(dynamic, 4096)
-        for (int64_t i = 0; i < numberOfScalars; i++) {
-        const int64_t i4 = i * 4;
-        
-        /*
-         * Initialize coloring for node since one of the
-         * continue statements below may cause moving
-         * on to next node
-         */
-        switch (colorDataType) {
-            case COLOR_TYPE_FLOAT:
-                rgbaFloat[i4]   =  0.0;
-                rgbaFloat[i4+1] =  0.0;
-                rgbaFloat[i4+2] =  0.0;
-                rgbaFloat[i4+3] =  0.0;
-                break;
-            case COLOR_TYPE_UNSIGNED_BTYE:
-                rgbaUnsignedByte[i4]   =  0;
-                rgbaUnsignedByte[i4+1] =  0;
-                rgbaUnsignedByte[i4+2] =  0;
-                rgbaUnsignedByte[i4+3] =  0;
-                break;
-        }
-        
-        float scalar = scalarValues[i];
-        const float threshold = thresholdValues[i];
-        
-        /*
-         * Positive/Zero/Negative Test
-         */
-        if (scalar > PaletteColorMapping::SMALL_POSITIVE) {   // JWH 24 April 2015    NodeAndVoxelColoring::SMALL_POSITIVE) {
-            if (hidePositiveValues) {
-                continue;
-            }
-        }
-        else if (scalar < PaletteColorMapping::SMALL_NEGATIVE) {  // JWH 24 April 2015  NodeAndVoxelColoring::SMALL_NEGATIVE) {
-            if (hideNegativeValues) {
-                continue;
-            }
-        }
-        else {
-            /*
-             * May be very near zero so force to zero.
-             */
-            normalizedValues[i] = 0.0;
-            if (hideZeroValues) {
-                continue;
-            }
-        }
-        
-        /*
-         * Temporary for rgba coloring now that past possible
-         * continue statements
-         */
-        float rgbaOut[4] = {
-             0.0,
-             0.0,
-             0.0,
-             0.0
-        };
-        
-        const float normalValue = normalizedValues[i];
-        
-        /*
-         * RGBA colors have been mapped for extreme values
-         */
-        if (normalValue >= 1.0) {
-            if (rgbaPositiveOneValid) {
-                rgbaOut[0] = rgbaPositiveOne[0];
-                rgbaOut[1] = rgbaPositiveOne[1];
-                rgbaOut[2] = rgbaPositiveOne[2];
-                rgbaOut[3] = rgbaPositiveOne[3];
-            }
-        }
-        else if (normalValue <= -1.0) {
-            if (rgbaNegativeOneValid) {
-                rgbaOut[0] = rgbaNegativeOne[0];
-                rgbaOut[1] = rgbaNegativeOne[1];
-                rgbaOut[2] = rgbaNegativeOne[2];
-                rgbaOut[3] = rgbaNegativeOne[3];
-            }
-        }
-        else {
-            /*
-             * Color scalar using palette
-             */
-            float rgba[4];
-            palette->getPaletteColor(normalValue,
-                                     interpolateFlag,
-                                     rgba);
-            if (rgba[3] > 0.0f) {
-                rgbaOut[0] = rgba[0];
-                rgbaOut[1] = rgba[1];
-                rgbaOut[2] = rgba[2];
-                rgbaOut[3] = rgba[3];
-            }
-        }
-        
-        /*
-         * Threshold Test
-         * Threshold is done last so colors are still set
-         * but if threshold test fails, alpha is set invalid.
-         */
-        bool thresholdPassedFlag = false;
-        if (skipThresholdTesting) {
-            thresholdPassedFlag = true;
-        }
-        else if (showOutsideFlag) {
-            if (threshold > thresholdMaximum) {
-                thresholdPassedFlag = true;
-            }
-            else if (threshold < thresholdMinimum) {
-                thresholdPassedFlag = true;
-            }
-        }
-        else {
-            if ((threshold >= thresholdMinimum) &&
-                (threshold <= thresholdMaximum)) {
-                thresholdPassedFlag = true;
-            }
-        }
-        if (thresholdPassedFlag == false) {
-            rgbaOut[3] = 0.0;
-            if (showMappedThresholdFailuresInGreen) {
-                if (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_MAPPED) {
-                    if (threshold > 0.0f) {
-                        if ((threshold < thresholdMappedPositive) &&
-                            (threshold > thresholdMappedPositiveAverageArea)) {
-                            rgbaOut[0] = positiveThresholdGreenColor[0];
-                            rgbaOut[1] = positiveThresholdGreenColor[1];
-                            rgbaOut[2] = positiveThresholdGreenColor[2];
-                            rgbaOut[3] = positiveThresholdGreenColor[3];
-                        }
-                    }
-                    else if (threshold < 0.0f) {
-                        if ((threshold > thresholdMappedNegative) &&
-                            (threshold < thresholdMappedNegativeAverageArea)) {
-                            rgbaOut[0] = negativeThresholdGreenColor[0];
-                            rgbaOut[1] = negativeThresholdGreenColor[1];
-                            rgbaOut[2] = negativeThresholdGreenColor[2];
-                            rgbaOut[3] = negativeThresholdGreenColor[3];
-                        }
-                    }
-                }
-            }
-        }
-
-        switch (colorDataType) {
-            case COLOR_TYPE_FLOAT:
-                CaretAssertArrayIndex(rgbaFloat, numberOfScalars * 4, i*4+3);
-                rgbaFloat[i4]   = rgbaOut[0];
-                rgbaFloat[i4+1] = rgbaOut[1];
-                rgbaFloat[i4+2] = rgbaOut[2];
-                rgbaFloat[i4+3] = rgbaOut[3];
-                break;
-            case COLOR_TYPE_UNSIGNED_BTYE:
-                CaretAssertArrayIndex(rgbaUnsignedByte, numberOfScalars * 4, i*4+3);
-                rgbaUnsignedByte[i4]   = rgbaOut[0] * 255.0;
-                rgbaUnsignedByte[i4+1] = rgbaOut[1] * 255.0;
-                rgbaUnsignedByte[i4+2] = rgbaOut[2] * 255.0;
-                if (rgbaOut[3] > 0.0) {
-                    rgbaUnsignedByte[i4+3] = rgbaOut[3] * 255.0;
-                }
-                else {
-                    rgbaUnsignedByte[i4+3] = 0;
-                }
-                break;
-        }
+    switch (colorDataType) {
+        case COLOR_TYPE_FLOAT:
+            colorScalarsWithLookupTable(settings,
+                                        lookupTable->getFloatTable(),
+                                        positiveThresholdGreenColor,
+                                        negativeThresholdGreenColor,
+                                        scalarValues,
+                                        &normalizedValues[0],
+                                        thresholdValues,
+                                        numberOfScalars,
+                                        rgbaFloat);
+            break;
+        case COLOR_TYPE_UNSIGNED_BTYE:
+            colorScalarsWithLookupTable(settings,
+                                        lookupTable->getByteTable(),
+                                        positiveThresholdGreenColorByte,
+                                        negativeThresholdGreenColorByte,
+                                        scalarValues,
+                                        &normalizedValues[0],
+                                        thresholdValues,
+                                        numberOfScalars,
+                                        rgbaUnsignedByte);
+            break;
     }
 }
 
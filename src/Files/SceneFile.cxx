@@ -585,6 +585,16 @@ SceneFile::writeFile(const AString& filename)
     }
     checkFileWritability(filename);
     
+    /*
+     * Read any scenes that have not been used so that an error
+     * reading one does not leave a partially written file
+     */
+    for (std::vector<Scene*>::iterator iter = m_scenes.begin();
+         iter != m_scenes.end();
+         iter++) {
+        (*iter)->loadDeferredContent();
+    }
+    
     this->setFileName(filename);
     
     try {
@@ -694,12 +704,19 @@ SceneFile::addToDataFileContentInformation(DataFileContentInformation& dataFileI
     if (numScenes > 0) {
         AString sceneNamesText = "Scenes:";
         for (int32_t i = 0; i < numScenes; i++) {
-            const Scene* scene = getSceneAtIndex(i);
+            Scene* scene = getSceneAtIndex(i);
             sceneNamesText.appendWithNewLine("#" + AString::number(i + 1) + "  " +
                                              scene->getName());
             if (dataFileInformation.isOptionFlag(DataFileContentInformation::OPTION_SHOW_MAP_INFORMATION))
             {
                 sceneNamesText += ":";
+                try {
+                    scene->loadDeferredContent();
+                }
+                catch (const DataFileException& e) {
+                    sceneNamesText.appendWithNewLine(e.whatString());
+                    continue;
+                }
                 const SceneAttributes* myAttrs = scene->getAttributes();
                 const SceneClass* guiMgrClass = scene->getClassWithName("guiManager");
                 if (guiMgrClass == NULL)
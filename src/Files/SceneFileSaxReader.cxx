@@ -350,6 +350,68 @@ SceneFileSaxReader::error(const XmlSaxParserException& e)
     throw e;
 }
 
+/**
+ * @return True if the element might be deferred, which is
+ * true for Scene elements.
+ * @param qName
+ *    Name of the element.
+ */
+bool
+SceneFileSaxReader::isDeferrableElement(const AString& qName) const
+{
+    return ((m_state == STATE_SCENE_FILE)
+            && (qName == SceneXmlElements::SCENE_TAG));
+}
+
+/**
+ * Defer reading of a scene's classes until the scene is used.
+ * A scene is deferred only when the file's scene info directory
+ * contains the scene's name, description, and image since those
+ * are needed before the scene is used.  Older scene files, without
+ * a scene info directory, are read completely.
+ *
+ * @param qName
+ *    Name of the element.
+ * @param attributes
+ *    Attributes of the element.
+ * @param elementText
+ *    Text of the element.
+ * @param elementTextLength
+ *    Length of the text.
+ * @return
+ *    True if the scene was deferred.
+ */
+bool
+SceneFileSaxReader::deferElement(const AString& qName,
+                                 const XmlAttributes& attributes,
+                                 const char* elementText,
+                                 const int64_t elementTextLength)
+{
+    CaretAssert(isDeferrableElement(qName));
+    
+    if (m_sceneInfoMap.find(m_sceneFile->getNumberOfScenes()) == m_sceneInfoMap.end()) {
+        return false;
+    }
+    
+    bool validName = false;
+    const SceneTypeEnum::Enum sceneType = SceneTypeEnum::fromName(attributes.getValue(SceneXmlElements::SCENE_TYPE_ATTRIBUTE),
+                                                                  &validName);
+    if ( ! validName) {
+        /*
+         * startElement() reports the error
+         */
+        return false;
+    }
+    
+    Scene* scene = new Scene(sceneType);
+    scene->setDeferredContent(QByteArray(elementText,
+                                         static_cast<int>(elementTextLength)),
+                              m_sceneFile->getFileName());
+    m_sceneFile->addScene(scene);
+    
+    return true;
+}
+
 void 
 SceneFileSaxReader::startDocument() 
 {    
@@ -69,6 +69,12 @@ namespace caret {
         
         void endDocument();
         
+        bool isDeferrableElement(const AString& qName) const;
+        
+        bool deferElement(const AString& qName,
+                          const XmlAttributes& attributes,
+                          const char* elementText,
+                          const int64_t elementTextLength);
         
     protected:
         /// file reading states
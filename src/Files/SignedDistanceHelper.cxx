@@ -45,129 +45,145 @@ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FO
 DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. */
 
-#include "BoundingBox.h"
-#include "CaretHeap.h"
+#include "MathFunctions.h"
 #include "SignedDistanceHelper.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
+#include <algorithm>
 #include <cmath>
 
 using namespace std;
 using namespace caret;
 
-float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+namespace
 {
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
-    bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    ///squared distance from a point to a box, 0 if inside
+    inline float boxDistSqr(const float coord[3], const float minCoord[3], const float maxCoord[3])
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        float ret = 0.0f;
+        for (int i = 0; i < 3; ++i)
         {
-            if (curOct->m_leaf)
+            float tempf = max(max(minCoord[i] - coord[i], coord[i] - maxCoord[i]), 0.0f);
+            ret += tempf * tempf;
+        }
+        return ret;
+    }
+    
+    ///whether the ray from the point in the positive z direction touches the box
+    inline bool verticalRayHitsBox(const float coord[3], const float minCoord[3], const float maxCoord[3])
+    {
+        return coord[0] >= minCoord[0] && coord[0] <= maxCoord[0] && coord[1] >= minCoord[1] && coord[1] <= maxCoord[1] && coord[2] <= maxCoord[2];
+    }
+    
+    ///whether the line segment touches the box, boundaries count as touching
+    inline bool segmentHitsBox(const float start[3], const float end[3], const float minCoord[3], const float maxCoord[3])
+    {
+        float low = 0.0f, high = 1.0f;//parameterize the segment as start + t * (end - start), t in [0, 1]
+        for (int i = 0; i < 3; ++i)
+        {
+            float direction = end[i] - start[i];
+            if (direction == 0.0f)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
+                if (start[i] < minCoord[i] || start[i] > maxCoord[i]) return false;
             } else {
-                for (int ci = 0; ci < 2; ++ci)
-                {
-                    for (int cj = 0; cj < 2; ++cj)
-                    {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
-                    }
-                }
+                float t1 = (minCoord[i] - start[i]) / direction, t2 = (maxCoord[i] - start[i]) / direction;
+                if (t1 > t2) swap(t1, t2);
+                if (t1 > low) low = t1;
+                if (t2 < high) high = t2;
+                if (low > high) return false;
             }
         }
+        return true;
     }
-    while (numChanged)
-    {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//need to do this before computeSign
-    }
-    return bestTriDist * computeSign(coord, bestInfo, myWinding);
 }
 
-void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
-{
-    CaretMutexLocker locked(&m_mutex);
-    CaretSimpleMinHeap<Oct<SignedDistanceHelperBase::TriVector>*, float> myHeap;
-    myHeap.push(m_base->m_indexRoot, m_base->m_indexRoot->distToPoint(coord));
-    ClosestPointInfo tempInfo, bestInfo;
-    float tempf = -1.0f, bestTriDist = -1.0f;
+float SignedDistanceHelper::closestTriangle(const float coord[3], ClosestPointInfo& bestInfo)
+{//depth first, nearer child first, skipping any box or triangle whose bounding box is no closer than the best triangle so far
+    const SignedDistanceHelperBase& myBase = *m_base;
+    const SignedDistanceHelperBase::BVHNode* nodes = myBase.m_bvhNodes.data();
+    int32_t nodeStack[SignedDistanceHelperBase::MAX_BVH_DEPTH];
+    float nodeStackDist[SignedDistanceHelperBase::MAX_BVH_DEPTH];
+    int stackSize = 0;
+    float lowerBounds[SignedDistanceHelperBase::MAX_LEAF_TRIS];
+    ClosestPointInfo tempInfo;
+    float bestTriDist = -1.0f, bestDistSqr = 0.0f;
     bool first = true;
-    int numChanged = 0;
-    while (!myHeap.isEmpty())
+    int32_t curNode = 0;
+    while (curNode != -1)
     {
-        Oct<SignedDistanceHelperBase::TriVector>* curOct = myHeap.pop(&tempf);
-        if (first || tempf < bestTriDist)
+        const SignedDistanceHelperBase::BVHNode& thisNode = nodes[curNode];
+        if (thisNode.m_count >= 0)
         {
-            if (curOct->m_leaf)
+            const int32_t start = thisNode.m_start, count = thisNode.m_count;
+            const float* minX = myBase.m_bvhTriMin[0].data() + start, *minY = myBase.m_bvhTriMin[1].data() + start, *minZ = myBase.m_bvhTriMin[2].data() + start;
+            const float* maxX = myBase.m_bvhTriMax[0].data() + start, *maxY = myBase.m_bvhTriMax[1].data() + start, *maxZ = myBase.m_bvhTriMax[2].data() + start;
+            for (int i = 0; i < count; ++i)
+            {//distance to the triangle's bounding box is a lower bound on the distance to the triangle, no branches so it vectorizes
+                float dx = max(max(minX[i] - coord[0], coord[0] - maxX[i]), 0.0f);
+                float dy = max(max(minY[i] - coord[1], coord[1] - maxY[i]), 0.0f);
+                float dz = max(max(minZ[i] - coord[2], coord[2] - maxZ[i]), 0.0f);
+                lowerBounds[i] = dx * dx + dy * dy + dz * dz;
+            }
+            for (int i = 0; i < count; ++i)
             {
-                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                int numTris = (int)myVecRef.size();
-                for (int i = 0; i < numTris; ++i)
-                {
-                    if (m_triMarked[myVecRef[i]] != 1)
-                    {
-                        m_triMarked[myVecRef[i]] = 1;
-                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                        tempf = unsignedDistToTri(coord, myVecRef[i], tempInfo);
-                        if (first || tempf < bestTriDist)
-                        {
-                            bestInfo = tempInfo;
-                            bestTriDist = tempf;
-                            first = false;
-                        }
-                    }
-                }
-            } else {
-                for (int ci = 0; ci < 2; ++ci)
+                if (first || lowerBounds[i] < bestDistSqr)
                 {
-                    for (int cj = 0; cj < 2; ++cj)
+                    float tempf = unsignedDistToTri(coord, myBase.m_bvhTriangles[start + i], tempInfo);
+                    if (first || tempf < bestTriDist)
                     {
-                        for (int ck = 0; ck < 2; ++ck)
-                        {
-                            tempf = curOct->m_children[ci][cj][ck]->distToPoint(coord);
-                            if (first || tempf < bestTriDist)
-                            {
-                                myHeap.push(curOct->m_children[ci][cj][ck], tempf);
-                            }
-                        }
+                        bestInfo = tempInfo;
+                        bestTriDist = tempf;
+                        bestDistSqr = tempf * tempf;
+                        first = false;
                     }
                 }
             }
+            curNode = -1;
+        } else {
+            int32_t nearChild = curNode + 1, farChild = thisNode.m_start;
+            float nearDist = boxDistSqr(coord, nodes[nearChild].m_minCoord, nodes[nearChild].m_maxCoord);
+            float farDist = boxDistSqr(coord, nodes[farChild].m_minCoord, nodes[farChild].m_maxCoord);
+            if (farDist < nearDist)
+            {
+                swap(nearChild, farChild);
+                swap(nearDist, farDist);
+            }
+            if (first || farDist < bestDistSqr)
+            {
+                CaretAssert(stackSize < SignedDistanceHelperBase::MAX_BVH_DEPTH);
+                nodeStack[stackSize] = farChild;
+                nodeStackDist[stackSize] = farDist;
+                ++stackSize;
+            }
+            curNode = -1;
+            if (first || nearDist < bestDistSqr)
+            {
+                curNode = nearChild;
+            }
+        }
+        while (curNode == -1 && stackSize > 0)
+        {//the best distance may have improved since the node was pushed
+            --stackSize;
+            if (first || nodeStackDist[stackSize] < bestDistSqr)
+            {
+                curNode = nodeStack[stackSize];
+            }
         }
     }
-    while (numChanged)
-    {
-        m_triMarked[m_triMarkChanged[--numChanged]] = 0;//clean up
-    }
+    return bestTriDist;
+}
+
+float SignedDistanceHelper::dist(const float coord[3], WindingLogic myWinding)
+{//everything the queries use is read-only after construction, so no lock is needed
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
+    return bestTriDist * computeSign(coord, bestInfo, myWinding);
+}
+
+void SignedDistanceHelper::barycentricWeights(const float coord[3], BarycentricInfo& baryInfoOut)
+{
+    ClosestPointInfo bestInfo;
+    float bestTriDist = closestTriangle(coord, bestInfo);
     baryInfoOut.triangle = bestInfo.triangle;
     baryInfoOut.point = bestInfo.tempPoint;
     baryInfoOut.absDistance = bestTriDist;
@@ -252,68 +268,50 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
         case NEGATIVE:
         case NONZERO:
             {
-                int numChanged = 0;
-                float positiveZ[3] = {0, 0, 1};
-                Vector3D point2 = point + positiveZ;
                 int crossCount = 0;
-                vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                myStack.push_back(m_base->m_indexRoot);
+                const SignedDistanceHelperBase& myBase = *m_base;
+                const SignedDistanceHelperBase::BVHNode* nodes = myBase.m_bvhNodes.data();
+                vector<int32_t> myStack;//each triangle is in exactly one leaf, so no need to mark triangles as tested
+                myStack.push_back(0);
                 while (!myStack.empty())
                 {
-                    Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
+                    const SignedDistanceHelperBase::BVHNode& curNode = nodes[myStack.back()];
+                    int32_t curIndex = myStack.back();
                     myStack.pop_back();
-                    if (curOct->m_leaf)
+                    if (!verticalRayHitsBox(coord, curNode.m_minCoord, curNode.m_maxCoord)) continue;
+                    if (curNode.m_count >= 0)
                     {
-                        vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                        int numTris = (int)myVecRef.size();
-                        for (int i = 0; i < numTris; ++i)
+                        for (int32_t entry = curNode.m_start; entry < curNode.m_start + curNode.m_count; ++entry)
                         {
-                            if (m_triMarked[myVecRef[i]] != 1)
+                            float triMin[3] = { myBase.m_bvhTriMin[0][entry], myBase.m_bvhTriMin[1][entry], myBase.m_bvhTriMin[2][entry] };
+                            float triMax[3] = { myBase.m_bvhTriMax[0][entry], myBase.m_bvhTriMax[1][entry], myBase.m_bvhTriMax[2][entry] };
+                            if (!verticalRayHitsBox(coord, triMin, triMax)) continue;
+                            const int32_t* myTileNodes = myBase.getTriangle(myBase.m_bvhTriangles[entry]);
+                            Vector3D verts[3];
+                            verts[0] = myBase.getCoordinate(myTileNodes[0]);
+                            verts[1] = myBase.getCoordinate(myTileNodes[1]);
+                            verts[2] = myBase.getCoordinate(myTileNodes[2]);
+                            Vector3D triNormal;
+                            MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                            float factor = triNormal[2];//equivalent to dot product with positiveZ
+                            if (factor != 0.0f)
                             {
-                                m_triMarked[myVecRef[i]] = 1;
-                                m_triMarkChanged[numChanged++] = myVecRef[i];
-                                const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                Vector3D verts[3];
-                                verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                Vector3D triNormal;
-                                MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                float factor = triNormal[2];//equivalent to dot product with positiveZ
-                                if (factor != 0.0f)
+                                if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
                                 {
-                                    if (triNormal.dot(verts[0] - point) / factor > 0.0f && pointInTri(verts, point, 0, 1))
+                                    if (triNormal[2] < 0.0f)
                                     {
-                                        if (triNormal[2] < 0.0f)
-                                        {
-                                            ++crossCount;
-                                        } else {
-                                            --crossCount;
-                                        }
+                                        ++crossCount;
+                                    } else {
+                                        --crossCount;
                                     }
                                 }
                             }
                         }
                     } else {
-                        for (int ci = 0; ci < 2; ++ci)
-                        {
-                            for (int cj = 0; cj < 2; ++cj)
-                            {
-                                for (int ck = 0; ck < 2; ++ck)
-                                {
-                                    if (curOct->m_children[ci][cj][ck]->rayIntersects(coord, point2))
-                                    {
-                                        myStack.push_back(curOct->m_children[ci][cj][ck]);
-                                    }
-                                }
-                            }
-                        }
+                        myStack.push_back(curNode.m_start);
+                        myStack.push_back(curIndex + 1);
                     }
                 }
-                while (numChanged)
-                {
-                    m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                }
                 switch (myWinding)
                 {
                     case EVEN_ODD:
@@ -339,7 +337,6 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                 case 0://node
                     {
                         int curSign = 0;
-                        int numChanged = 0;
                         const vector<int>& myTiles = m_base->m_topoHelp->getNodeTiles(myInfo.node1);
                         bool first = true;
                         float bestNorm = 0;
@@ -382,71 +379,56 @@ int SignedDistanceHelper::computeSign(const float coord[3], SignedDistanceHelper
                         {
                             midAxis = 2;
                         }
-                        vector<Oct<SignedDistanceHelperBase::TriVector>*> myStack;
-                        myStack.push_back(m_base->m_indexRoot);
+                        const SignedDistanceHelperBase& myBase = *m_base;
+                        const SignedDistanceHelperBase::BVHNode* nodes = myBase.m_bvhNodes.data();
+                        vector<int32_t> myStack;
+                        myStack.push_back(0);
                         while (!myStack.empty())
                         {
-                            Oct<SignedDistanceHelperBase::TriVector>* curOct = myStack[myStack.size() - 1];
+                            const SignedDistanceHelperBase::BVHNode& curNode = nodes[myStack.back()];
+                            int32_t curIndex = myStack.back();
                             myStack.pop_back();
-                            if (curOct->m_leaf)
+                            if (!segmentHitsBox(coord, bestCent, curNode.m_minCoord, curNode.m_maxCoord)) continue;
+                            if (curNode.m_count >= 0)
                             {
-                                vector<int32_t>& myVecRef = *(curOct->m_data.m_triList);
-                                int numTris = (int)myVecRef.size();
-                                for (int i = 0; i < numTris; ++i)
+                                for (int32_t entry = curNode.m_start; entry < curNode.m_start + curNode.m_count; ++entry)
                                 {
-                                    if (m_triMarked[myVecRef[i]] != 1)
+                                    float triMin[3] = { myBase.m_bvhTriMin[0][entry], myBase.m_bvhTriMin[1][entry], myBase.m_bvhTriMin[2][entry] };
+                                    float triMax[3] = { myBase.m_bvhTriMax[0][entry], myBase.m_bvhTriMax[1][entry], myBase.m_bvhTriMax[2][entry] };
+                                    if (!segmentHitsBox(coord, bestCent, triMin, triMax)) continue;
+                                    const int32_t* myTileNodes = myBase.getTriangle(myBase.m_bvhTriangles[entry]);
+                                    Vector3D verts[3];
+                                    verts[0] = myBase.getCoordinate(myTileNodes[0]);
+                                    verts[1] = myBase.getCoordinate(myTileNodes[1]);
+                                    verts[2] = myBase.getCoordinate(myTileNodes[2]);
+                                    Vector3D triNormal;
+                                    MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
+                                    float factor = triNormal.dot(segNormal);
+                                    if (factor == 0.0f)
                                     {
-                                        m_triMarked[myVecRef[i]] = 1;
-                                        m_triMarkChanged[numChanged++] = myVecRef[i];
-                                        const int32_t* myTileNodes = m_base->getTriangle(myVecRef[i]);
-                                        Vector3D verts[3];
-                                        verts[0] = m_base->getCoordinate(myTileNodes[0]);
-                                        verts[1] = m_base->getCoordinate(myTileNodes[1]);
-                                        verts[2] = m_base->getCoordinate(myTileNodes[2]);
-                                        Vector3D triNormal;
-                                        MathFunctions::normalVector(verts[0], verts[1], verts[2], triNormal);
-                                        float factor = triNormal.dot(segNormal);
-                                        if (factor == 0.0f)
-                                        {
-                                            continue;//skip triangles parallel to the line segment
-                                        }
-                                        float intersectDist = triNormal.dot(point - verts[0]) / factor;
-                                        if (intersectDist > 0.0f && intersectDist < bestDist)
-                                        {
-                                            Vector3D inPlane = point - intersectDist * segNormal;
-                                            if (pointInTri(verts, inPlane, majAxis, midAxis))
-                                            {
-                                                bestDist = intersectDist;
-                                                if (triNormal.dot(mySeg) > 0.0f)
-                                                {
-                                                    curSign = 1;
-                                                } else {
-                                                    curSign = -1;
-                                                }
-                                            }
-                                        }
+                                        continue;//skip triangles parallel to the line segment
                                     }
-                                }
-                            } else {
-                                for (int ci = 0; ci < 2; ++ci)
-                                {
-                                    for (int cj = 0; cj < 2; ++cj)
+                                    float intersectDist = triNormal.dot(point - verts[0]) / factor;
+                                    if (intersectDist > 0.0f && intersectDist < bestDist)
                                     {
-                                        for (int ck = 0; ck < 2; ++ck)
+                                        Vector3D inPlane = point - intersectDist * segNormal;
+                                        if (pointInTri(verts, inPlane, majAxis, midAxis))
                                         {
-                                            if (curOct->m_children[ci][cj][ck]->lineSegmentIntersects(coord, bestCent))
+                                            bestDist = intersectDist;
+                                            if (triNormal.dot(mySeg) > 0.0f)
                                             {
-                                                myStack.push_back(curOct->m_children[ci][cj][ck]);
+                                                curSign = 1;
+                                            } else {
+                                                curSign = -1;
                                             }
                                         }
                                     }
                                 }
+                            } else {
+                                myStack.push_back(curNode.m_start);
+                                myStack.push_back(curIndex + 1);
                             }
                         }
-                        while (numChanged)
-                        {
-                            m_triMarked[m_triMarkChanged[--numChanged]] = 0;
-                        }
                         return curSign;
                     }
                     break;
@@ -713,24 +695,11 @@ float SignedDistanceHelper::unsignedDistToTri(const float coord[3], int32_t tria
 SignedDistanceHelper::SignedDistanceHelper(CaretPointer<SignedDistanceHelperBase> myBase)
 {
     m_base = myBase;
-    int32_t numTris = m_base->m_numTris;
-    m_triMarked = CaretArray<int>(numTris);
-    m_triMarkChanged = CaretArray<int>(numTris);
-    for (int32_t i = 0; i < numTris; ++i)
-    {
-        m_triMarked[i] = 0;
-    }
 }
 
 SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
 {
     m_topoHelp = mySurf->getTopologyHelper();
-    const float* myBB = mySurf->getBoundingBox()->getBounds();
-    Vector3D minCoord, maxCoord;
-    minCoord[0] = myBB[0]; maxCoord[0] = myBB[1];
-    minCoord[1] = myBB[2]; maxCoord[1] = myBB[3];
-    minCoord[2] = myBB[4]; maxCoord[2] = myBB[5];
-    m_indexRoot.grabNew(new Oct<TriVector>(minCoord, maxCoord));
     const float* myCoordData = mySurf->getCoordinateData();
     m_numNodes = mySurf->getNumberOfNodes();
     int32_t numNodes3 = m_numNodes * 3;
@@ -741,6 +710,7 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
     }
     m_numTris = mySurf->getNumberOfTriangles();
     m_triangleList.resize(m_numTris * 3);
+    vector<BVHBuildTriangle> buildTris(m_numTris);
     for (int32_t i = 0; i < m_numTris; ++i)
     {
         int32_t i3 = i * 3;
@@ -748,104 +718,96 @@ SignedDistanceHelperBase::SignedDistanceHelperBase(const SurfaceFile* mySurf)
         m_triangleList[i3] = thisTri[0];
         m_triangleList[i3 + 1] = thisTri[1];
         m_triangleList[i3 + 2] = thisTri[2];
-        maxCoord = minCoord = myCoordData + thisTri[0] * 3;//set both to the coordinates of the first node in the triangle
-        for (int j = 1; j < 3; ++j)
+        buildTris[i].m_triangle = i;
+        for (int j = 0; j < 3; ++j)
+        {
+            buildTris[i].m_centroid[j] = (myCoordData[thisTri[0] * 3 + j] + myCoordData[thisTri[1] * 3 + j] + myCoordData[thisTri[2] * 3 + j]) / 3.0f;
+        }
+    }
+    m_bvhNodes.reserve(max(1, 2 * m_numTris / MAX_LEAF_TRIS + 1));
+    buildBVH(buildTris, 0, m_numTris, 0);//also reorders buildTris into leaf order
+    m_bvhTriangles.resize(m_numTris);
+    for (int j = 0; j < 3; ++j)
+    {
+        m_bvhTriMin[j].resize(m_numTris);
+        m_bvhTriMax[j].resize(m_numTris);
+    }
+    for (int32_t i = 0; i < m_numTris; ++i)
+    {
+        m_bvhTriangles[i] = buildTris[i].m_triangle;
+        float minCoord[3], maxCoord[3];
+        getTriangleBounds(buildTris[i].m_triangle, minCoord, maxCoord);
+        for (int j = 0; j < 3; ++j)
         {
-            int32_t thisNode3 = thisTri[j] * 3;
-            if (myCoordData[thisNode3] < minCoord[0]) minCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] < minCoord[1]) minCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] < minCoord[2]) minCoord[2] = myCoordData[thisNode3 + 2];
-            if (myCoordData[thisNode3] > maxCoord[0]) maxCoord[0] = myCoordData[thisNode3];
-            if (myCoordData[thisNode3 + 1] > maxCoord[1]) maxCoord[1] = myCoordData[thisNode3 + 1];
-            if (myCoordData[thisNode3 + 2] > maxCoord[2]) maxCoord[2] = myCoordData[thisNode3 + 2];
+            m_bvhTriMin[j][i] = minCoord[j];
+            m_bvhTriMax[j][i] = maxCoord[j];
         }
-        addTriangle(m_indexRoot, i, minCoord, maxCoord);//use bounding box for now as an easy test to capture any chance of the triangle intersecting the Oct
     }
 }
 
-void SignedDistanceHelperBase::addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3])
-{
-    if (thisOct->m_leaf)
+int32_t SignedDistanceHelperBase::buildBVH(vector<BVHBuildTriangle>& buildTris, const int32_t start, const int32_t end, const int depth)
+{//median split on the longest axis of the triangle centroids, depth first layout so the first child is adjacent to its parent
+    int32_t nodeIndex = (int32_t)m_bvhNodes.size();
+    m_bvhNodes.push_back(BVHNode());
+    float minCoord[3] = { 0.0f, 0.0f, 0.0f }, maxCoord[3] = { 0.0f, 0.0f, 0.0f };
+    float centMin[3] = { 0.0f, 0.0f, 0.0f }, centMax[3] = { 0.0f, 0.0f, 0.0f };
+    for (int32_t i = start; i < end; ++i)
     {
-        thisOct->m_data.m_triList->push_back(triangle);
-        int numTris = (int)thisOct->m_data.m_triList->size();
-        if (numTris >= NUM_TRIS_TO_TEST && numTris % NUM_TRIS_TEST_INCR == NUM_TRIS_TO_TEST % NUM_TRIS_TEST_INCR)//the second modulus should const out
+        float triMin[3], triMax[3];
+        getTriangleBounds(buildTris[i].m_triangle, triMin, triMax);
+        for (int j = 0; j < 3; ++j)
         {
-            Vector3D tempMinCoord, tempMaxCoord;
-            const float* myCoordData = m_coordList.data();
-            int totalSize = 0;
-            int numSplit = 0;
-            for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
-            {
-                const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                for (int j = 1; j < 3; ++j)
-                {
-                    int32_t thisNode3 = tempTri[j] * 3;
-                    if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                    if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                    if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                    if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                }
-                int minOct[3], maxOct[3];
-                thisOct->containingChild(tempMinCoord, minOct);
-                thisOct->containingChild(tempMaxCoord, maxOct);
-                int splitSize = 8;
-                if (minOct[0] == maxOct[0]) splitSize >>= 1;
-                if (minOct[1] == maxOct[1]) splitSize >>= 1;
-                if (minOct[2] == maxOct[2]) splitSize >>= 1;
-                totalSize += splitSize;
-                if (splitSize != 8) ++numSplit;
-            }
-            if (numSplit > 0 && totalSize < 3.0f * numTris)//don't split if all triangles end up in all child octs, and try to balance speedup with memory usage
-            {
-                thisOct->makeChildren();//do the split
-                for (int i = 0; i < numTris; ++i)//gather data on how it would end up splitting
-                {
-                    const int32_t* tempTri = getTriangle((*(thisOct->m_data.m_triList))[i]);
-                    tempMaxCoord = tempMinCoord = myCoordData + tempTri[0] * 3;//set both to the coordinates of the first node in the triangle
-                    for (int j = 1; j < 3; ++j)
-                    {
-                        int32_t thisNode3 = tempTri[j] * 3;
-                        if (myCoordData[thisNode3] < tempMinCoord[0]) tempMinCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] < tempMinCoord[1]) tempMinCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] < tempMinCoord[2]) tempMinCoord[2] = myCoordData[thisNode3 + 2];
-                        if (myCoordData[thisNode3] > tempMaxCoord[0]) tempMaxCoord[0] = myCoordData[thisNode3];
-                        if (myCoordData[thisNode3 + 1] > tempMaxCoord[1]) tempMaxCoord[1] = myCoordData[thisNode3 + 1];
-                        if (myCoordData[thisNode3 + 2] > tempMaxCoord[2]) tempMaxCoord[2] = myCoordData[thisNode3 + 2];
-                    }
-                    for (int ci = 0; ci < 2; ++ci)
-                    {
-                        for (int cj = 0; cj < 2; ++cj)
-                        {
-                            for (int ck = 0; ck < 2; ++ck)
-                            {
-                                if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(tempMinCoord, tempMaxCoord))
-                                {
-                                    addTriangle(thisOct->m_children[ci][cj][ck], (*(thisOct->m_data.m_triList))[i], tempMinCoord, tempMaxCoord);
-                                }
-                            }
-                        }
-                    }
-                }
-                thisOct->m_data.freeData();//and free up some memory
-            }
+            if (i == start || triMin[j] < minCoord[j]) minCoord[j] = triMin[j];
+            if (i == start || triMax[j] > maxCoord[j]) maxCoord[j] = triMax[j];
+            if (i == start || buildTris[i].m_centroid[j] < centMin[j]) centMin[j] = buildTris[i].m_centroid[j];
+            if (i == start || buildTris[i].m_centroid[j] > centMax[j]) centMax[j] = buildTris[i].m_centroid[j];
         }
-    } else {
-        for (int ci = 0; ci < 2; ++ci)
+    }
+    for (int j = 0; j < 3; ++j)
+    {
+        m_bvhNodes[nodeIndex].m_minCoord[j] = minCoord[j];
+        m_bvhNodes[nodeIndex].m_maxCoord[j] = maxCoord[j];
+    }
+    int axis = 0;
+    for (int j = 1; j < 3; ++j)
+    {
+        if (centMax[j] - centMin[j] > centMax[axis] - centMin[axis]) axis = j;
+    }
+    if (end - start <= MAX_LEAF_TRIS)
+    {//closestTriangle relies on leaves never having more than MAX_LEAF_TRIS triangles
+        m_bvhNodes[nodeIndex].m_start = start;
+        m_bvhNodes[nodeIndex].m_count = end - start;
+        return nodeIndex;
+    }
+    CaretAssert(depth < MAX_BVH_DEPTH - 1);
+    int32_t mid = start + (end - start) / 2;
+    if (centMax[axis] > centMin[axis])
+    {//coincident centroids can't be sorted apart, but splitting them in their current order still keeps the leaves small
+        nth_element(buildTris.begin() + start, buildTris.begin() + mid, buildTris.begin() + end, BVHCentroidCompare(axis));
+    }
+    buildBVH(buildTris, start, mid, depth + 1);
+    int32_t secondChild = buildBVH(buildTris, mid, end, depth + 1);
+    m_bvhNodes[nodeIndex].m_start = secondChild;//don't hold a reference across the recursion, push_back can reallocate
+    m_bvhNodes[nodeIndex].m_count = -1;
+    return nodeIndex;
+}
+
+void SignedDistanceHelperBase::getTriangleBounds(const int32_t triangle, float minCoord[3], float maxCoord[3]) const
+{
+    const int32_t* thisTri = getTriangle(triangle);
+    const float* firstCoord = getCoordinate(thisTri[0]);
+    for (int j = 0; j < 3; ++j)
+    {
+        minCoord[j] = firstCoord[j];
+        maxCoord[j] = firstCoord[j];
+    }
+    for (int i = 1; i < 3; ++i)
+    {
+        const float* thisCoord = getCoordinate(thisTri[i]);
+        for (int j = 0; j < 3; ++j)
         {
-            for (int cj = 0; cj < 2; ++cj)
-            {
-                for (int ck = 0; ck < 2; ++ck)
-                {
-                    if (thisOct->m_children[ci][cj][ck]->boundsOverlaps(minCoord, maxCoord))
-                    {
-                        addTriangle(thisOct->m_children[ci][cj][ck], triangle, minCoord, maxCoord);
-                    }
-                }
-            }
+            if (thisCoord[j] < minCoord[j]) minCoord[j] = thisCoord[j];
+            if (thisCoord[j] > maxCoord[j]) maxCoord[j] = thisCoord[j];
         }
     }
 }
@@ -22,9 +22,8 @@
 /*LICENSE_END*/
 
 #include "Vector3D.h"
-#include "CaretMutex.h"
 #include "CaretPointer.h"
-#include "OctTree.h"
+#include <stdint.h>
 #include <vector>
 
 namespace caret {
@@ -34,29 +33,35 @@ namespace caret {
     
     class SignedDistanceHelperBase
     {
-        struct TriVector
-        {//specifically so we can cleanly deallocate the vector from non-leaf nodes when they split
-            std::vector<int32_t>* m_triList;
-            TriVector() { m_triList = new std::vector<int32_t>(); }
-            ~TriVector() { freeData(); }
-            void freeData()
-            {
-                if (m_triList != NULL)
-                {
-                    delete m_triList;
-                    m_triList = NULL;
-                }
-            }
+        struct BVHNode
+        {//flattened bounding volume hierarchy, first child of an interior node immediately follows it
+            float m_minCoord[3], m_maxCoord[3];
+            int32_t m_start;//leaf: first entry in m_bvhTriangles, interior: index of the second child
+            int32_t m_count;//leaf: number of triangles, interior: -1
         };
-        static const int NUM_TRIS_TO_TEST = 50;//test for whether to split leaf at this number
-        static const int NUM_TRIS_TEST_INCR = 50;//and again at further multiples of this
-        CaretPointer<Oct<TriVector> > m_indexRoot;
+        struct BVHBuildTriangle
+        {
+            int32_t m_triangle;
+            float m_centroid[3];
+        };
+        struct BVHCentroidCompare
+        {//for nth_element, without needing a lambda
+            int m_axis;
+            BVHCentroidCompare(const int axis) { m_axis = axis; }
+            bool operator()(const BVHBuildTriangle& left, const BVHBuildTriangle& right) const { return left.m_centroid[m_axis] < right.m_centroid[m_axis]; }
+        };
+        static const int MAX_LEAF_TRIS = 8;
+        static const int MAX_BVH_DEPTH = 64;//every split halves the triangles, so depth is at most log2(triangles / MAX_LEAF_TRIS) + 1, under 32 for any int32 triangle count
+        std::vector<BVHNode> m_bvhNodes;
+        std::vector<int32_t> m_bvhTriangles;//triangle indices in leaf order
+        std::vector<float> m_bvhTriMin[3], m_bvhTriMax[3];//triangle bounding boxes in leaf order, separate arrays per axis so leaf tests vectorize
         int32_t m_numTris, m_numNodes;
         std::vector<float> m_coordList;//make a copy of what we need from SurfaceFile so that if the SurfaceFile gets destroyed, we don't crash
         std::vector<int32_t> m_triangleList;
         CaretPointer<TopologyHelper> m_topoHelp;
         SignedDistanceHelperBase();
-        void addTriangle(Oct<TriVector>* thisOct, int32_t triangle, float minCoord[3], float maxCoord[3]);
+        int32_t buildBVH(std::vector<BVHBuildTriangle>& buildTris, const int32_t start, const int32_t end, const int depth);
+        void getTriangleBounds(const int32_t triangle, float minCoord[3], float maxCoord[3]) const;
         const float* getCoordinate(const int32_t nodeIndex) const;//make these public? probably don't want them to be widely used, that is what SurfaceFile is for (but we don't want to store a SurfaceFile pointer)
         const int32_t* getTriangle(const int32_t tileIndex) const;
     public:
@@ -92,10 +97,7 @@ namespace caret {
             NORMALS
         };
     private:
-        CaretMutex m_mutex;
         CaretPointer<SignedDistanceHelperBase> m_base;
-        CaretArray<int> m_triMarked;
-        CaretArray<int> m_triMarkChanged;
         SignedDistanceHelper();
         struct ClosestPointInfo
         {
@@ -104,6 +106,7 @@ namespace caret {
             Vector3D tempPoint;
         };
         float unsignedDistToTri(const float coord[3], int32_t triangle, ClosestPointInfo& myInfo);
+        float closestTriangle(const float coord[3], ClosestPointInfo& bestInfo);
         int computeSign(const float coord[3], ClosestPointInfo myInfo, WindingLogic myWinding);
         bool pointInTri(Vector3D verts[3], Vector3D inPlane, int majAxis, int midAxis);
     public:
@@ -42,6 +42,7 @@
 #include "Vector3D.h"
 
 #include "CaretPointLocator.h"
+#include "CaretTriangleBVH.h"
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
@@ -49,6 +50,10 @@
 
 using namespace caret;
 
+int64_t SurfaceFile::s_modificationIdentifierCounter = 0;
+
+CaretMutex SurfaceFile::s_modificationIdentifierMutex;
+
 /**
  * Constructor.
  */
@@ -136,6 +141,7 @@ SurfaceFile::clear()
     trianglePointer = NULL;
     GiftiTypeFile::clear();
     invalidateHelpers();
+    m_topologyModificationIdentifier = newModificationIdentifier();
     this->invalidateNodeColoringForBrowserTabs();
 }
 
@@ -460,6 +466,7 @@ void SurfaceFile::setTriangle(const int32_t& index, const int32_t& node1, const
     trianglePointer[offset + 2] = node3;
     invalidateHelpers();
     invalidateNormals();
+    m_topologyModificationIdentifier = newModificationIdentifier();
     setModified();
 }
 
@@ -525,6 +532,9 @@ SurfaceFile::initializeMembersSurfaceFile()
     m_geoHelperIndex = 0;
     m_topoHelperIndex = 0;
     m_normalsComputed = false;
+    m_coordinateModificationIdentifier = newModificationIdentifier();
+    m_topologyModificationIdentifier = newModificationIdentifier();
+    m_nodeColoringModificationIdentifier = newModificationIdentifier();
 }
 
 /**
@@ -565,7 +575,76 @@ void
 SurfaceFile::invalidateNormals()
 {
     m_normalsComputed = false;
+    m_coordinateModificationIdentifier = newModificationIdentifier();
+}
+
+/**
+ * @return Identifier that changes whenever the coordinates or normal
+ * vectors change.  No two surface files ever have the same identifier,
+ * so drawing may cache data for a surface and compare identifiers to
+ * test that the cached data is still valid.
+ */
+int64_t
+SurfaceFile::getCoordinateModificationIdentifier() const
+{
+    return m_coordinateModificationIdentifier;
 }
+
+/**
+ * @return Identifier that changes whenever the triangles change.  No two
+ * surface files ever have the same identifier.
+ */
+int64_t
+SurfaceFile::getTopologyModificationIdentifier() const
+{
+    return m_topologyModificationIdentifier;
+}
+
+/**
+ * Get the identifier that changes whenever node coloring changes.  No two
+ * surface files ever have the same identifier.
+ *
+ * @param rgbaNodeColorComponents
+ *    Coloring, from one of the get...NodeColoringRgbaForBrowserTab() methods.
+ * @return
+ *    The identifier or -1 if the coloring is not contained in this surface,
+ *    in which case its content may change at any time.
+ */
+int64_t
+SurfaceFile::getNodeColoringModificationIdentifier(const float* rgbaNodeColorComponents) const
+{
+    if (rgbaNodeColorComponents == NULL) {
+        return -1;
+    }
+    
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
+        const std::vector<float>* tabColoring[3] = {
+            &this->surfaceNodeColoringForBrowserTabs[i],
+            &this->surfaceMontageNodeColoringForBrowserTabs[i],
+            &this->wholeBrainNodeColoringForBrowserTabs[i]
+        };
+        for (int32_t j = 0; j < 3; j++) {
+            if (( ! tabColoring[j]->empty())
+                && (&(*tabColoring[j])[0] == rgbaNodeColorComponents)) {
+                return m_nodeColoringModificationIdentifier;
+            }
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @return A new modification identifier.
+ */
+int64_t
+SurfaceFile::newModificationIdentifier()
+{
+    CaretMutexLocker locker(&s_modificationIdentifierMutex);//surfaces may be read in threads
+    s_modificationIdentifierCounter++;
+    return s_modificationIdentifierCounter;
+}
+
 /**
  * Compute surface normals.
  */
@@ -577,6 +656,7 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    m_coordinateModificationIdentifier = newModificationIdentifier();
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -858,6 +938,7 @@ CaretPointer<SignedDistanceHelper> SurfaceFile::getSignedDistanceHelper() const
 
 void SurfaceFile::invalidateHelpers()
 {
+    m_coordinateModificationIdentifier = newModificationIdentifier();
     if (m_geoBase != NULL)
     {
         CaretMutexLocker myLock(&m_geoHelperMutex);//make this function threadsafe
@@ -884,6 +965,11 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_triangleBVH != NULL)
+    {
+        CaretMutexLocker myLock5(&m_triangleBVHMutex);
+        m_triangleBVH.grabNew(NULL);
+    }
 }
 
 /**
@@ -988,6 +1074,7 @@ SurfaceFile::applyMatrix(const Matrix4x4& matrix)
             matrix.multiplyPoint3(&coordinatePointer[i*3]);
         }
     }
+    invalidateHelpers();//coordinates moved, also updates the coordinate modification identifier
     
     computeNormals();
     
@@ -1047,6 +1134,7 @@ SurfaceFile::flipNormals()
         trianglePointer[offset + 1] = tempvert;
     }
     invalidateNormals();
+    m_topologyModificationIdentifier = newModificationIdentifier();
     invalidateHelpers();//sorted topology helpers would change, so just for completeness
     setModified();
 }
@@ -1188,6 +1276,19 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const CaretTriangleBVH> SurfaceFile::getTriangleBVH() const
+{
+    if (m_triangleBVH == NULL)//same pattern as the point locator
+    {
+        CaretMutexLocker myLock(&m_triangleBVHMutex);
+        if (m_triangleBVH == NULL)
+        {
+            m_triangleBVH.grabNew(new CaretTriangleBVH(getCoordinateData(), getNumberOfNodes(), trianglePointer, getNumberOfTriangles()));
+        }
+    }
+    return m_triangleBVH;
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1212,6 +1313,10 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_triangleBVHMutex);
+        m_triangleBVH.grabNew(NULL);
+    }
 }
 
 /**
@@ -1351,6 +1456,7 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
         this->surfaceMontageNodeColoringForBrowserTabs[i].clear();
         this->wholeBrainNodeColoringForBrowserTabs[i].clear();
     }    
+    m_nodeColoringModificationIdentifier = newModificationIdentifier();
 }
 
 /**
@@ -1479,6 +1585,7 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringModificationIdentifier = newModificationIdentifier();
 }
 
 /**
@@ -1526,6 +1633,7 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringModificationIdentifier = newModificationIdentifier();
 }
 
 
@@ -1573,6 +1681,7 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    m_nodeColoringModificationIdentifier = newModificationIdentifier();
 }
 
 /**
@@ -37,6 +37,7 @@ namespace caret {
 
     class BoundingBox;
     class CaretPointLocator;
+    class CaretTriangleBVH;
     class DescriptiveStatistics;
     class FastStatistics;
     class GeodesicHelper;
@@ -138,6 +139,9 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        ///get the triangle hierarchy for ray casting, built the first time it is needed
+        CaretPointer<const CaretTriangleBVH> getTriangleBVH() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -176,6 +180,12 @@ namespace caret {
 
         void invalidateNormals();
         
+        int64_t getCoordinateModificationIdentifier() const;
+        
+        int64_t getTopologyModificationIdentifier() const;
+        
+        int64_t getNodeColoringModificationIdentifier(const float* rgbaNodeColorComponents) const;
+        
         void translateToCenterOfMass();
         
         void flipNormals();
@@ -262,6 +272,21 @@ namespace caret {
         
         bool m_skipSanityCheck;
 
+        ///changes whenever the coordinates or normal vectors change, never the same for two surface files
+        int64_t m_coordinateModificationIdentifier;
+        
+        ///changes whenever the triangles change, never the same for two surface files
+        int64_t m_topologyModificationIdentifier;
+        
+        ///changes whenever the node coloring for any browser tab changes, never the same for two surface files
+        int64_t m_nodeColoringModificationIdentifier;
+        
+        static int64_t newModificationIdentifier();
+        
+        static int64_t s_modificationIdentifierCounter;
+        
+        static CaretMutex s_modificationIdentifierMutex;
+
         ///topology base for surface
         mutable CaretPointer<TopologyHelperBase> m_topoBase;
         
@@ -292,12 +317,15 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to cast rays (such as for identification) against the triangles
+        mutable CaretPointer<CaretTriangleBVH> m_triangleBVH;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_triangleBVHMutex;
     };
 
 } // namespace
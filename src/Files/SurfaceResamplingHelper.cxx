@@ -27,6 +27,7 @@
 
 #include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
@@ -44,6 +45,26 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
                                                  const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
     if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    WeightCache::Key cacheKey("SurfaceResamplingHelper");
+    if (WeightCache::isEnabled())
+    {
+        int32_t currentNodes = currentSphere->getNumberOfNodes(), newNodes = newSphere->getNumberOfNodes();
+        cacheKey.addValue((int32_t)myMethod);
+        cacheKey.addSurface(currentSphere);
+        cacheKey.addSurface(newSphere);
+        if (myMethod == SurfaceResamplingMethodEnum::ADAP_BARY_AREA && currentAreas != NULL && newAreas != NULL)
+        {
+            cacheKey.addData(currentAreas, currentNodes * sizeof(float));
+            cacheKey.addData(newAreas, newNodes * sizeof(float));
+        }
+        int32_t haveRoi = (currentRoi != NULL ? 1 : 0);
+        cacheKey.addValue(haveRoi);
+        if (currentRoi != NULL)
+        {
+            cacheKey.addData(currentRoi, currentNodes * sizeof(float));
+        }
+        if (loadCachedWeights(cacheKey, currentNodes, newNodes)) return;
+    }
     SurfaceFile currentSphereMod, newSphereMod;
     changeRadius(100.0f, currentSphere, &currentSphereMod);
     changeRadius(100.0f, newSphere, &newSphereMod);
@@ -58,6 +79,66 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
             computeWeightsBarycentric(&currentSphereMod, &newSphereMod, currentRoi);
             break;
     }
+    if (WeightCache::isEnabled())
+    {
+        saveCachedWeights(cacheKey);
+    }
+}
+
+bool SurfaceResamplingHelper::loadCachedWeights(const WeightCache::Key& cacheKey, const int& currentNodes, const int& newNodes)
+{
+    WeightCache myCache;
+    if (!WeightCache::load(cacheKey, myCache)) return false;
+    vector<int64_t> rowStart;
+    vector<WeightElem> elements;
+    if (!myCache.getArray(0, rowStart) || !myCache.getArray(1, elements) ||
+        (int)rowStart.size() != newNodes + 1 || rowStart[0] != 0 || rowStart[newNodes] != (int64_t)elements.size())
+    {
+        CaretLogWarning("resampling weight cache file has unexpected contents, recomputing");
+        return false;
+    }
+    for (int i = 0; i < newNodes; ++i)
+    {
+        if (rowStart[i + 1] < rowStart[i])
+        {
+            CaretLogWarning("resampling weight cache file has unexpected contents, recomputing");
+            return false;
+        }
+    }
+    for (int64_t i = 0; i < (int64_t)elements.size(); ++i)
+    {
+        if (elements[i].node < 0 || elements[i].node >= currentNodes)
+        {
+            CaretLogWarning("resampling weight cache file has unexpected contents, recomputing");
+            return false;
+        }
+    }
+    m_storagechunk = CaretArray<WeightElem>(elements.size());
+    for (int64_t i = 0; i < (int64_t)elements.size(); ++i)
+    {
+        m_storagechunk[i] = elements[i];
+    }
+    m_weights = CaretArray<WeightElem*>(newNodes + 1);
+    for (int i = 0; i <= newNodes; ++i)
+    {
+        m_weights[i] = m_storagechunk + rowStart[i];
+    }
+    return true;
+}
+
+void SurfaceResamplingHelper::saveCachedWeights(const WeightCache::Key& cacheKey) const
+{
+    int numNodes = (int)m_weights.size() - 1;
+    const WeightElem* base = m_storagechunk;
+    vector<int64_t> rowStart(numNodes + 1);
+    for (int i = 0; i <= numNodes; ++i)
+    {
+        rowStart[i] = m_weights[i] - base;
+    }
+    WeightCache myCache;
+    myCache.addArray(rowStart.data(), rowStart.size());
+    myCache.addArray(base, rowStart[numNodes]);
+    WeightCache::save(cacheKey, myCache);
 }
 
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
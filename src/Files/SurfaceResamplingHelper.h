@@ -23,6 +23,7 @@
 
 #include "CaretPointer.h"
 #include "SurfaceResamplingMethodEnum.h"
+#include "WeightCache.h"
 
 #include <map>
 #include <vector>
@@ -48,6 +49,8 @@ namespace caret {
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
         static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
         void compactWeights(const std::vector<std::map<int, float> >& weights);
+        bool loadCachedWeights(const WeightCache::Key& cacheKey, const int& currentNodes, const int& newNodes);
+        void saveCachedWeights(const WeightCache::Key& cacheKey) const;
     public:
         SurfaceResamplingHelper() { }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
@@ -19,12 +19,14 @@
 /*LICENSE_END*/
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <ostream>
 #include <limits>
 #include <sstream>
 
 #include "Base64.h"
+#include "Base64StreamDecoder.h"
 #include "ByteOrderEnum.h"
 #include "ByteSwapping.h"
 #include "CaretAssert.h"
@@ -42,9 +44,202 @@
 #include "PaletteColorMapping.h"
 #include "SystemUtilities.h"
 #include "XmlWriter.h"
+#include "zlib.h"
 
 using namespace caret;
 
+/**
+ * Decodes base64 text, that may be zlib compressed, into the array's
+ * data as the text arrives.  Only a small buffer of decoded (but still
+ * compressed) bytes is used, so memory use is about the size of the array.
+ */
+class GiftiDataArray::TextStreamDecoder {
+public:
+   TextStreamDecoder(unsigned char* outputIn,
+                     const int64_t outputSizeIn,
+                     const bool compressedIn);
+   
+   ~TextStreamDecoder();
+   
+   void decode(const char* text,
+               const int64_t length);
+   
+   void finish();
+   
+private:
+   void writeDecoded(const int64_t numDecoded);
+   
+   /// bytes of base64 decoded per piece of text (less text is decoded at a time if a piece is larger)
+   static const int64_t DECODED_BUFFER_SIZE = 1 << 16;
+   
+   Base64StreamDecoder base64Decoder;
+   
+   std::vector<unsigned char> decodedBuffer;
+   
+   unsigned char* output;
+   
+   int64_t outputSize;
+   
+   int64_t outputPosition;
+   
+   bool compressed;
+   
+   z_stream zlibStream;
+   
+   bool zlibStreamEnd;
+};
+
+/**
+ * constructor.
+ */
+GiftiDataArray::TextStreamDecoder::TextStreamDecoder(unsigned char* outputIn,
+                                                     const int64_t outputSizeIn,
+                                                     const bool compressedIn)
+{
+   output = outputIn;
+   outputSize = outputSizeIn;
+   outputPosition = 0;
+   compressed = compressedIn;
+   zlibStreamEnd = false;
+   decodedBuffer.resize(DECODED_BUFFER_SIZE);
+   if (compressed) {
+      zlibStream.zalloc = Z_NULL;
+      zlibStream.zfree = Z_NULL;
+      zlibStream.opaque = Z_NULL;
+      zlibStream.next_in = Z_NULL;
+      zlibStream.avail_in = 0;
+      if (inflateInit(&zlibStream) != Z_OK) {
+         throw GiftiException("Unable to initialize decompression of GZip Base64 Binary data.");
+      }
+   }
+}
+
+/**
+ * destructor.
+ */
+GiftiDataArray::TextStreamDecoder::~TextStreamDecoder()
+{
+   if (compressed) {
+      inflateEnd(&zlibStream);
+   }
+}
+
+/**
+ * decode a piece of text.
+ */
+void 
+GiftiDataArray::TextStreamDecoder::decode(const char* text,
+                                          const int64_t length)
+{
+   //
+   // Limit the amount of text so the decoded bytes fit in the buffer,
+   // allowing for an incomplete group of characters from the previous text
+   //
+   const int64_t maxTextPerDecode = (DECODED_BUFFER_SIZE / 3) * 4 - 4;
+   for (int64_t start = 0; start < length; start += maxTextPerDecode) {
+      const int64_t numDecoded = base64Decoder.decode(text + start,
+                                                      std::min(maxTextPerDecode, length - start),
+                                                      &decodedBuffer[0]);
+      if (base64Decoder.hasError()) {
+         throw GiftiException("Decoding of Base64 Binary data failed, invalid character found.");
+      }
+      writeDecoded(numDecoded);
+      if (base64Decoder.isFinished()) {
+         break;
+      }
+   }
+}
+
+/**
+ * copy (or uncompress) decoded bytes into the output.
+ */
+void 
+GiftiDataArray::TextStreamDecoder::writeDecoded(const int64_t numDecoded)
+{
+   if (numDecoded <= 0) {
+      return;
+   }
+   
+   if (compressed == false) {
+      if (outputPosition + numDecoded > outputSize) {
+         throw GiftiException("Decoding of Base64 Binary data failed.\n"
+                              "Decoded more than the "
+                              + AString::number(outputSize)
+                              + " bytes of the array.");
+      }
+      memcpy(output + outputPosition, &decodedBuffer[0], numDecoded);
+      outputPosition += numDecoded;
+      return;
+   }
+   
+   zlibStream.next_in = &decodedBuffer[0];
+   zlibStream.avail_in = static_cast<uInt>(numDecoded);
+   while (zlibStream.avail_in > 0) {
+      if (zlibStreamEnd) {
+         throw GiftiException("Decompression of Binary data failed.\n"
+                              "Data found after the end of the compressed data.");
+      }
+      
+      //
+      // avail_out is an unsigned int, so very large arrays are uncompressed in pieces
+      //
+      const int64_t maxOutput = std::min(outputSize - outputPosition,
+                                         static_cast<int64_t>(1) << 30);
+      unsigned char unusedOutput;
+      zlibStream.next_out = ((maxOutput > 0) ? (output + outputPosition) : &unusedOutput);
+      zlibStream.avail_out = static_cast<uInt>(maxOutput);
+      const int result = inflate(&zlibStream, Z_NO_FLUSH);
+      outputPosition += (maxOutput - zlibStream.avail_out);
+      if (result == Z_STREAM_END) {
+         zlibStreamEnd = true;
+      }
+      else if (result == Z_BUF_ERROR) {
+         //
+         // No progress with input remaining means the output is full
+         //
+         throw GiftiException("Decompression of Binary data failed.\n"
+                              "Compressed data is longer than the "
+                              + AString::number(outputSize)
+                              + " bytes of the array.");
+      }
+      else if (result != Z_OK) {
+         const AString msg = ((zlibStream.msg != NULL)
+                              ? AString(zlibStream.msg)
+                              : AString::number(result));
+         throw GiftiException("Decompression of Binary data failed: "
+                              + msg);
+      }
+   }
+}
+
+/**
+ * verify that all of the array's data was read.
+ */
+void 
+GiftiDataArray::TextStreamDecoder::finish()
+{
+   if (base64Decoder.hasPartialGroup()) {
+      throw GiftiException("Decoding of Base64 Binary data failed.\n"
+                           "Text ended in the middle of a group of four characters.");
+   }
+   
+   if (compressed) {
+      if ((zlibStreamEnd == false)
+          || (outputPosition != outputSize)) {
+         throw GiftiException("Decompression of Binary data failed.\n"
+                              "Uncompressed " + AString::number(outputPosition)
+                              + " bytes but should be "
+                              + AString::number(outputSize) + " bytes.");
+      }
+   }
+   else if (outputPosition != outputSize) {
+      throw GiftiException("Decoding of Base64 Binary data failed.\n"
+                           "Decoded " + AString::number(outputPosition)
+                           + " bytes but should be "
+                           + AString::number(outputSize) + " bytes.");
+   }
+}
+
 /**
  * constructor.
  */
@@ -161,6 +356,9 @@ GiftiDataArray::copyHelperGiftiDataArray(const GiftiDataArray& nda)
         delete this->descriptiveStatisticsLimitedValues;
         this->descriptiveStatisticsLimitedValues = NULL;
     }
+   textStreamDecoder.grabNew(NULL);
+   textStreamRequiredDataType = NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32;
+   textStreamReadOnlyMetaData = false;
    intent = nda.intent;
    encoding = nda.encoding;
    arraySubscriptingOrder = nda.arraySubscriptingOrder;
@@ -413,6 +611,9 @@ GiftiDataArray::clear()
    externalFileOffset = 0;
    minMaxFloatValuesValid = false;
    minMaxPercentageValuesValid = false;
+   textStreamDecoder.grabNew(NULL);
+   textStreamRequiredDataType = NiftiDataTypeEnum::NIFTI_TYPE_FLOAT32;
+   textStreamReadOnlyMetaData = false;
    
     if (this->paletteColorMapping != NULL) {
         delete this->paletteColorMapping;
@@ -590,14 +791,11 @@ GiftiDataArray::readFromText(const AString text,
                              const bool isReadOnlyMetaData)
 {
    const NiftiDataTypeEnum::Enum requiredDataType = dataType;
-   dataType = dataTypeForReading;
-   encoding = encodingForReading;
-   endian   = dataEndianForReading;
-   arraySubscriptingOrder = arraySubscriptingOrderForReading;
-   setDimensions(dimensionsForReading);
-   if (dimensionsForReading.size() == 0) {
-      throw GiftiException("Data array has no dimensions.");
-   }
+   initializeForReading(dataEndianForReading,
+                        arraySubscriptingOrderForReading,
+                        dataTypeForReading,
+                        dimensionsForReading,
+                        encodingForReading);
    //setExternalFileInformation(externalFileNameForReading,
    //                           externalFileOffsetForReading);//TSC: don't set the external filename on the array, because that is what it uses when writing the array
                               
@@ -796,7 +994,41 @@ GiftiDataArray::readFromText(const AString text,
             }
             break;
       }
+   } // If NOT metadata only
    
+   finishReading(requiredDataType,
+                 isReadOnlyMetaData);
+}
+
+/**
+ * set the properties of the data being read and allocate the data.
+ */
+void
+GiftiDataArray::initializeForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                     const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                     const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                     const std::vector<int64_t>& dimensionsForReading,
+                                     const GiftiEncodingEnum::Enum encodingForReading)
+{
+   dataType = dataTypeForReading;
+   encoding = encodingForReading;
+   endian   = dataEndianForReading;
+   arraySubscriptingOrder = arraySubscriptingOrderForReading;
+   setDimensions(dimensionsForReading);
+   if (dimensionsForReading.size() == 0) {
+      throw GiftiException("Data array has no dimensions.");
+   }
+}
+
+/**
+ * convert the data that was read to the required data type
+ * and to row major indexing order.
+ */
+void
+GiftiDataArray::finishReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                              const bool isReadOnlyMetaData)
+{
+   if (isReadOnlyMetaData == false) {
       //
       // Check if data type needs to be converted
       //
@@ -809,14 +1041,102 @@ GiftiDataArray::readFromText(const AString text,
        //
        // Are array indices in opposite order
        //
-       if (arraySubscriptingOrderForReading == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
+       if (arraySubscriptingOrder == GiftiArrayIndexingOrderEnum::COLUMN_MAJOR_ORDER) {
            convertArrayIndexingOrder();
        }
-   } // If NOT metadata only
+   }
    
    setModified();
 }
 
+/**
+ * @return True if the encoding is read by startReadingFromTextStream(),
+ * readFromTextStream(), and finishReadingFromTextStream().  Other
+ * encodings must be read with readFromText().
+ *
+ * @param encodingForReading
+ *    Encoding of the data.
+ */
+bool
+GiftiDataArray::isTextStreamReadingSupported(const GiftiEncodingEnum::Enum encodingForReading)
+{
+   switch (encodingForReading) {
+      case GiftiEncodingEnum::BASE64_BINARY:
+      case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+         return true;
+      case GiftiEncodingEnum::ASCII:
+      case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
+         break;
+   }
+   return false;
+}
+
+/**
+ * start reading a data array from text that arrives in pieces, such as
+ * the character data from a SAX parser.  The binary data is decoded
+ * (and uncompressed) directly into the array as each piece arrives so
+ * that the text is never stored.
+ */
+void
+GiftiDataArray::startReadingFromTextStream(const GiftiEndianEnum::Enum dataEndianForReading,
+                                           const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                           const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                           const std::vector<int64_t>& dimensionsForReading,
+                                           const GiftiEncodingEnum::Enum encodingForReading,
+                                           const bool isReadOnlyMetaData)
+{
+   CaretAssert(isTextStreamReadingSupported(encodingForReading));
+   textStreamRequiredDataType = dataType;
+   textStreamReadOnlyMetaData = isReadOnlyMetaData;
+   textStreamDecoder.grabNew(NULL);
+   initializeForReading(dataEndianForReading,
+                        arraySubscriptingOrderForReading,
+                        dataTypeForReading,
+                        dimensionsForReading,
+                        encodingForReading);
+   if (isReadOnlyMetaData == false) {
+      textStreamDecoder.grabNew(new TextStreamDecoder((data.empty() ? NULL : &data[0]),
+                                                      data.size(),
+                                                      (encoding == GiftiEncodingEnum::GZIP_BASE64_BINARY)));
+   }
+}
+
+/**
+ * read the next piece of text, see startReadingFromTextStream().
+ */
+void
+GiftiDataArray::readFromTextStream(const char* text)
+{
+   if (textStreamDecoder != NULL) {
+      textStreamDecoder->decode(text,
+                                strlen(text));
+   }
+}
+
+/**
+ * finish reading after all of the text has been read,
+ * see startReadingFromTextStream().
+ */
+void
+GiftiDataArray::finishReadingFromTextStream()
+{
+   if (textStreamDecoder != NULL) {
+      CaretPointer<TextStreamDecoder> decoder = textStreamDecoder;
+      textStreamDecoder.grabNew(NULL);
+      decoder->finish();
+      
+      //
+      // Is byte swapping needed ?
+      //
+      if (endian != getSystemEndian()) {
+         byteSwapData(getSystemEndian());
+      }
+   }
+   
+   finishReading(textStreamRequiredDataType,
+                 textStreamReadOnlyMetaData);
+}
+
 /**
  * convert array indexing order of data.
  */
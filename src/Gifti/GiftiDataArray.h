@@ -122,7 +122,24 @@ namespace caret {
                           const AString& externalFileNameForReading,
                           const int64_t externalFileOffsetForReading,
                           const bool isReadOnlyMetaData);
-        
+
+        // is reading from text as it arrives supported for the encoding
+        static bool isTextStreamReadingSupported(const GiftiEncodingEnum::Enum encodingForReading);
+
+        // start reading a data array from text that arrives in pieces
+        void startReadingFromTextStream(const GiftiEndianEnum::Enum dataEndianForReading,
+                                        const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                        const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                        const std::vector<int64_t>& dimensionsForReading,
+                                        const GiftiEncodingEnum::Enum encodingForReading,
+                                        const bool isReadOnlyMetaData);
+
+        // read the next piece of text
+        void readFromTextStream(const char* text);
+
+        // finish reading after all of the text has been read
+        void finishReadingFromTextStream();
+
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
@@ -322,7 +339,29 @@ namespace caret {
         
         /// convert array indexing order of data
         void convertArrayIndexingOrder();
-        
+
+        // set the properties of the data being read and allocate it
+        void initializeForReading(const GiftiEndianEnum::Enum dataEndianForReading,
+                                  const GiftiArrayIndexingOrderEnum::Enum arraySubscriptingOrderForReading,
+                                  const NiftiDataTypeEnum::Enum dataTypeForReading,
+                                  const std::vector<int64_t>& dimensionsForReading,
+                                  const GiftiEncodingEnum::Enum encodingForReading);
+
+        // convert the data that was read to the required type and indexing order
+        void finishReading(const NiftiDataTypeEnum::Enum requiredDataType,
+                           const bool isReadOnlyMetaData);
+
+        class TextStreamDecoder;
+
+        /// decodes binary data as the text arrives, only valid while reading from a text stream
+        CaretPointer<TextStreamDecoder> textStreamDecoder;
+
+        /// data type required after reading from a text stream
+        NiftiDataTypeEnum::Enum textStreamRequiredDataType;
+
+        /// reading metadata only from a text stream
+        bool textStreamReadOnlyMetaData;
+
         /// the data
         std::vector<uint8_t> data;
         
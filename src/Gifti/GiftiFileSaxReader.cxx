@@ -50,6 +50,7 @@ GiftiFileSaxReader::GiftiFileSaxReader(GiftiFile* giftiFileIn)
     this->labelTableSaxReader = NULL;
     this->metaDataSaxReader = NULL;
     this->dataArrayDataHasBeenRead = false;
+    this->dataArrayDataStreaming = false;
 }
 
 /**
@@ -138,6 +139,9 @@ GiftiFileSaxReader::startElement(const AString& namespaceURI,
          }
          else if (qName == GiftiXmlElements::TAG_DATA) {
             this->state = STATE_DATA_ARRAY_DATA;
+            if (GiftiDataArray::isTextStreamReadingSupported(encodingForReadingArrayData)) {
+                this->startArrayDataStream();
+            }
          }
          else if (qName == GiftiXmlElements::TAG_COORDINATE_TRANSFORMATION_MATRIX) {
             this->state = STATE_DATA_ARRAY_MATRIX;
@@ -260,7 +264,12 @@ GiftiFileSaxReader::endElement(const AString& namespaceURI,
          }
          break;
       case STATE_DATA_ARRAY_DATA:
-           this->processArrayData();
+           if (this->dataArrayDataStreaming) {
+               this->finishArrayDataStream();
+           }
+           else {
+               this->processArrayData();
+           }
            break;
       case STATE_DATA_ARRAY_MATRIX:
          this->matrix = NULL;
@@ -531,6 +540,46 @@ GiftiFileSaxReader::processArrayData()
     }
 }
 
+/**
+ * start processing array data as the text arrives so that
+ * the text of large binary arrays is not stored.
+ */
+void
+GiftiFileSaxReader::startArrayDataStream()
+{
+    CaretAssert(dataArray);
+    try {
+        dataArray->startReadingFromTextStream(this->endianForReadingArrayData,
+                                              arraySubscriptingOrderForReadingArrayData,
+                                              dataTypeForReadingArrayData,
+                                              dimensionsForReadingArrayData,
+                                              encodingForReadingArrayData,
+                                              this->giftiFile->getReadMetaDataOnlyFlag());
+    }
+    catch (const GiftiException& e) {
+        throw XmlSaxParserException(e.whatString());
+    }
+    this->dataArrayDataStreaming = true;
+}
+
+/**
+ * finish processing array data that was read as the text arrived.
+ */
+void
+GiftiFileSaxReader::finishArrayDataStream()
+{
+    this->dataArrayDataStreaming = false;
+    this->dataArrayDataHasBeenRead = true;
+    
+    CaretAssert(dataArray);
+    try {
+        dataArray->finishReadingFromTextStream();
+    }
+    catch (const GiftiException& e) {
+        throw XmlSaxParserException(e.whatString());
+    }
+}
+
 /**
  * get characters in an element.
  */
@@ -543,6 +592,14 @@ GiftiFileSaxReader::characters(const char* ch)
     else if (this->labelTableSaxReader != NULL) {
         this->labelTableSaxReader->characters(ch);
     }
+    else if (this->dataArrayDataStreaming) {
+        try {
+            dataArray->readFromTextStream(ch);
+        }
+        catch (const GiftiException& e) {
+            throw XmlSaxParserException(e.whatString());
+        }
+    }
     else {
         elementText += ch;
     }
@@ -103,6 +103,12 @@ namespace caret {
         // process the array data into numbers
         void processArrayData();
         
+        // start processing array data as the text arrives
+        void startArrayDataStream();
+        
+        // finish processing array data that was read as the text arrived
+        void finishArrayDataStream();
+        
         // create a data array
         void createDataArray(const XmlAttributes& attributes);
         
@@ -162,6 +168,9 @@ namespace caret {
         
         /// tracks if data has been read since external binary may not have DATA tag
         bool dataArrayDataHasBeenRead;
+        
+        /// array data is being decoded as the text arrives instead of being stored in elementText
+        bool dataArrayDataStreaming;
     };
 
 } // namespace
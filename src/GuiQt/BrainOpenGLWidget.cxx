@@ -39,6 +39,7 @@
 #include "BrainBrowserWindow.h"
 #include "BrainOpenGLFixedPipeline.h"
 #include "BrainOpenGLShape.h"
+#include "BrainOpenGLSurfaceBufferCache.h"
 #include "BrainOpenGLTextureManager.h"
 #include "BrainOpenGLViewportContent.h"
 #include "BrainStructure.h"
@@ -1674,11 +1675,15 @@ BrainOpenGLWidget::captureImage(EventImageCapture* imageCaptureEvent)
             BrainOpenGLTextureManager* textureManager = this->openGL->getTextureManager();
             CaretAssert(textureManager);
             textureManager->deleteAllTexturesForWindow(this->windowIndex);
+            BrainOpenGLSurfaceBufferCache* surfaceBufferCache = this->openGL->getSurfaceBufferCache();
+            CaretAssert(surfaceBufferCache);
+            surfaceBufferCache->deleteAllBuffers();
             
             QPixmap pixmap = this->renderPixmap(outputImageWidth,
                                                 outputImageHeight);
             image = pixmap.toImage();
             textureManager->deleteAllTexturesForWindow(this->windowIndex);
+            surfaceBufferCache->deleteAllBuffers();
             this->openGL->setTextRenderer(createTextRenderer());
 #endif
         }
@@ -28,6 +28,7 @@
 #include <QDesktopWidget>
 #include <QMenu>
 #include <QPushButton>
+#include <QTimer>
 
 #define __GUI_MANAGER_DEFINE__
 #include "GuiManager.h"
@@ -172,6 +173,15 @@ GuiManager::initializeGuiManager()
     
     this->cursorManager = new CursorManager();
     
+    /*
+     * A zero interval timer times out whenever there are no
+     * events to process, so prefetching only uses idle time.
+     */
+    m_connectivityRowPrefetchTimer = new QTimer(this);
+    m_connectivityRowPrefetchTimer->setInterval(0);
+    QObject::connect(m_connectivityRowPrefetchTimer, SIGNAL(timeout()),
+                     this, SLOT(connectivityRowPrefetchTimerTimeout()));
+    
     /*
      * Information window.
      */
@@ -288,6 +298,44 @@ GuiManager::initializeGuiManager()
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_USER_INTERFACE_UPDATE);
 }
 
+/**
+ * Called when the event loop is idle, while connectivity files have
+ * rows to prefetch for nodes near the last loaded node.  Each call
+ * reads one row, so pending events are processed between rows.  The
+ * read blocks the event loop, so prefetching stops if a row takes
+ * longer than a short time budget (slow disk or network file).
+ */
+void
+GuiManager::connectivityRowPrefetchTimerTimeout()
+{
+    const double maximumSecondsPerRow = 0.02;
+    
+    ElapsedTimer timer;
+    timer.start();
+    
+    bool moreRowsFlag = false;
+    try {
+        moreRowsFlag = SessionManager::get()->getCiftiConnectivityMatrixDataFileManager()->prefetchRows(getBrain());
+    }
+    catch (const CaretException& e) {
+        CaretLogWarning("Prefetching connectivity rows failed: "
+                        + e.whatString());
+    }
+    
+    const double elapsedSeconds = timer.getElapsedTimeSeconds();
+    if (moreRowsFlag
+        && (elapsedSeconds > maximumSecondsPerRow)) {
+        CaretLogFine("Stopped prefetching connectivity rows, reading a row took "
+                     + AString::number(elapsedSeconds, 'f', 3)
+                     + " seconds");
+        moreRowsFlag = false;
+    }
+    
+    if ( ! moreRowsFlag) {
+        m_connectivityRowPrefetchTimer->stop();
+    }
+}
+
 /**
  * Destructor.
  */
@@ -2607,10 +2655,12 @@ GuiManager::processIdentification(const int32_t tabIndex,
                 try {
                     triedToLoadSurfaceODemandData = true;
                     
-                    ciftiConnectivityManager->loadDataForSurfaceNode(brain,
-                                                                     surface,
-                                                                     nodeIndex,
-                                                                     ciftiLoadingInfo);
+                    if (ciftiConnectivityManager->loadDataForSurfaceNode(brain,
+                                                                         surface,
+                                                                         nodeIndex,
+                                                                         ciftiLoadingInfo)) {
+                        m_connectivityRowPrefetchTimer->start();
+                    }
                     
                     ciftiFiberTrajectoryManager->loadDataForSurfaceNode(brain,
                                                                         surface,
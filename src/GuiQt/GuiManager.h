@@ -36,6 +36,7 @@
 class QAction;
 class QDialog;
 class QMenu;
+class QTimer;
 class QWidget;
 class MovieDialog;
 class WuQWebView;
@@ -198,6 +199,7 @@ namespace caret {
         void helpDialogWasClosed();
         void sceneDialogWasClosed();
         void identifyBrainordinateDialogWasClosed();
+        void connectivityRowPrefetchTimerTimeout();
         
     private:
         GuiManager(QObject* parent = 0);
@@ -247,6 +249,9 @@ namespace caret {
         
         TileTabsConfigurationDialog* m_tileTabsConfigurationDialog;
         
+        /** Zero interval timer that prefetches connectivity rows while the event loop is idle */
+        QTimer* m_connectivityRowPrefetchTimer;
+        
         ClippingPlanesDialog* m_clippingPlanesDialog;
         
         CustomViewDialog* m_customViewDialog;
@@ -331,6 +331,19 @@ PreferencesDialog::createMiscellaneousWidget()
                      this, SLOT(miscDynamicConnectivityComboBoxChanged(bool)));
     m_allWidgets->add(m_dynamicConnectivityComboBox);
     
+    /*
+     * CIFTI column cache
+     */
+    m_ciftiColumnCacheComboBox = new WuQTrueFalseComboBox("On",
+                                                          "Off",
+                                                          this);
+    m_ciftiColumnCacheComboBox->getWidget()->setToolTip("Keep transposed copies of large CIFTI matrix files on disk so that\n"
+                                                        "loading a column is fast.  The copy is made when the first column\n"
+                                                        "of a file is loaded.  Takes effect when wb_view is restarted.");
+    QObject::connect(m_ciftiColumnCacheComboBox, SIGNAL(statusChanged(bool)),
+                     this, SLOT(miscCiftiColumnCacheComboBoxChanged(bool)));
+    m_allWidgets->add(m_ciftiColumnCacheComboBox);
+    
     /*
      * Logging Level
      */
@@ -391,6 +404,9 @@ PreferencesDialog::createMiscellaneousWidget()
     addWidgetToLayout(gridLayout,
                       "Show Dynconn By Default: ",
                       m_dynamicConnectivityComboBox->getWidget());
+    addWidgetToLayout(gridLayout,
+                      "Cache CIFTI Columns on Disk: ",
+                      m_ciftiColumnCacheComboBox->getWidget());
     addWidgetToLayout(gridLayout,
                       "Logging Level: ",
                       m_miscLoggingLevelComboBox);
@@ -425,6 +441,8 @@ PreferencesDialog::updateMiscellaneousWidget(CaretPreferences* prefs)
 {
     m_dynamicConnectivityComboBox->setStatus(prefs->isDynamicConnectivityDefaultedOn());
     
+    m_ciftiColumnCacheComboBox->setStatus(prefs->isCiftiColumnCacheEnabled());
+    
     const LogLevelEnum::Enum loggingLevel = prefs->getLoggingLevel();
     int indx = m_miscLoggingLevelComboBox->findData(LogLevelEnum::toIntegerCode(loggingLevel));
     if (indx >= 0) {
@@ -1015,6 +1033,17 @@ void PreferencesDialog::miscDynamicConnectivityComboBoxChanged(bool value)
     prefs->setDynamicConnectivityDefaultedOn(value);
 }
 
+/**
+ * Called when CIFTI column cache option changed.
+ * @param value
+ *   New value.
+ */
+void PreferencesDialog::miscCiftiColumnCacheComboBoxChanged(bool value)
+{
+    CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
+    prefs->setCiftiColumnCacheEnabled(value);
+}
+
 /**
  * Called when show develop menu option changed.
  * @param value
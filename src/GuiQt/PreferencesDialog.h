@@ -62,6 +62,8 @@ namespace caret {
         
         void miscDynamicConnectivityComboBoxChanged(bool value);
         
+        void miscCiftiColumnCacheComboBoxChanged(bool value);
+        
         void openGLDrawingMethodEnumComboBoxItemActivated();
         void openGLImageCaptureMethodEnumComboBoxItemActivated();
         
@@ -142,6 +144,8 @@ namespace caret {
 
         WuQTrueFalseComboBox* m_dynamicConnectivityComboBox;
         
+        WuQTrueFalseComboBox* m_ciftiColumnCacheComboBox;
+        
         WuQTrueFalseComboBox* m_volumeAxesCrosshairsComboBox;
         WuQTrueFalseComboBox* m_volumeAxesLabelsComboBox;
         WuQTrueFalseComboBox* m_volumeAxesMontageCoordinatesComboBox;
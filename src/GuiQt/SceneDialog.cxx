@@ -792,8 +792,17 @@ SceneDialog::testScenesPushButtonClicked()
      * Same login/password is used for all scenes.
      */
     for (int32_t i = 0; i < numScenes; i++) {
-        const Scene* scene = sceneFile->getSceneAtIndex(i);
+        Scene* scene = sceneFile->getSceneAtIndex(i);
         if (scene != NULL) {
+            try {
+                scene->loadDeferredContent();
+            }
+            catch (const DataFileException&) {
+                /*
+                 * Error is reported when the scene is displayed
+                 */
+                continue;
+            }
             if (scene->hasFilesWithRemotePaths()) {
                 const QString msg("This scene contains files that are on the network.  "
                                   "If accessing the files requires a username and "
@@ -820,7 +829,17 @@ SceneDialog::testScenesPushButtonClicked()
     for (int32_t i = 0; i < numScenes; i++) {
         Scene* origScene = sceneFile->getSceneAtIndex(i);
         if (origScene != NULL) {
-            if (origScene->hasFilesWithRemotePaths()) {
+            bool remotePathsFlag = false;
+            try {
+                origScene->loadDeferredContent();
+                remotePathsFlag = origScene->hasFilesWithRemotePaths();
+            }
+            catch (const DataFileException&) {
+                /*
+                 * Error is reported by displayScenePrivateWithErrorMessage()
+                 */
+            }
+            if (remotePathsFlag) {
                 CaretDataFile::setFileReadingUsernameAndPassword(username,
                                                                  password);
             }
@@ -1609,6 +1628,15 @@ SceneDialog::showSceneButtonClicked()
     }
     Scene* scene = getSelectedScene();
     if (scene != NULL) {
+        try {
+            scene->loadDeferredContent();
+        }
+        catch (const DataFileException& e) {
+            WuQMessageBox::errorOk(this,
+                                   e.whatString());
+            return;
+        }
+        
         if (scene->hasFilesWithRemotePaths()) {
             const QString msg("This scene contains files that are on the network.  "
                               "If accessing the files requires a username and "
@@ -1822,7 +1850,19 @@ SceneDialog::displayScenePrivateWithErrorMessage(SceneFile* sceneFile,
     
     const AString sceneFileName = sceneFile->getFileName();
     
+    try {
+        scene->loadDeferredContent();
+    }
+    catch (const DataFileException& e) {
+        errorMessageOut = e.whatString();
+        return false;
+    }
+    
     const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    if (guiManagerClass == NULL) {
+        errorMessageOut = "Scene is missing guiManager class";
+        return false;
+    }
     if (guiManagerClass->getName() != "guiManager") {
         errorMessageOut = ("Top level scene class should be guiManager but it is: "
                            + guiManagerClass->getName());
@@ -25,9 +25,18 @@
 using namespace std;
 using namespace caret;
 
-void NiftiIO::openRead(const QString& filename)
+const int64_t NiftiIO::PIPELINE_CHUNK_BYTES = 1<<22;//4MiB, a few milliseconds of inflate
+
+void NiftiIO::openRead(const QString& filename, const bool& memoryMap)
 {
-    m_file.open(filename);
+    m_readOnly = false;//in case opening throws
+    m_compressed = false;
+    if (memoryMap)
+    {
+        m_file.openMapped(filename);//falls back to normal reading if it can't be mapped
+    } else {
+        m_file.open(filename);
+    }
     m_header.read(m_file);
     if (m_header.getDataType() == DT_BINARY)
     {
@@ -44,6 +53,8 @@ void NiftiIO::openRead(const QString& filename)
     {
         throw DataFileException("nifti file is truncated: " + filename);
     }
+    m_readOnly = true;
+    m_compressed = filename.endsWith(".gz");
 }
 
 void NiftiIO::writeNew(const QString& filename, const NiftiHeader& header, const int& version, const bool& withRead, const bool& swapEndian)
@@ -52,6 +63,8 @@ void NiftiIO::writeNew(const QString& filename, const NiftiHeader& header, const
     {
         throw DataFileException("writing NIFTI with binary datatype is unsupported");
     }
+    m_readOnly = false;
+    m_compressed = false;//writing doesn't use the read pipeline
     if (withRead)
     {
         m_file.open(filename, CaretBinaryFile::READ_WRITE_TRUNCATE);//for cifti on-disk writing, replace structure with along row needs to RMW
@@ -67,6 +80,63 @@ void NiftiIO::close()
 {
     m_file.close();
     m_dims.clear();
+    m_readOnly = false;
+    m_compressed = false;
+    CaretMutexLocker locked(&m_scratchPoolMutex);
+    m_scratchPool.clear();
+}
+
+void NiftiIO::checkOutScratch(vector<char>& scratchOut)
+{
+    CaretMutexLocker locked(&m_scratchPoolMutex);
+    if (m_scratchPool.empty())
+    {
+        scratchOut.clear();
+    } else {
+        scratchOut.swap(m_scratchPool.back());//swap, so we don't copy or free the buffer while holding the mutex
+        m_scratchPool.pop_back();
+    }
+}
+
+void NiftiIO::checkInScratch(vector<char>& scratch)
+{
+    CaretMutexLocker locked(&m_scratchPoolMutex);
+    m_scratchPool.push_back(vector<char>());
+    m_scratchPool.back().swap(scratch);
+}
+
+int64_t NiftiIO::getDataRange(const int& fullDims, const vector<int64_t>& indexSelect, int64_t& numElemsOut)
+{
+    CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
+    CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+    int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
+    int curDim;
+    for (curDim = 0; curDim < fullDims; ++curDim)
+    {
+        numElems *= m_dims[curDim];
+    }
+    int64_t numDimSkip = numElems, numSkip = 0;
+    for (; curDim < (int)m_dims.size(); ++curDim)
+    {
+        CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
+        numSkip += indexSelect[curDim - fullDims] * numDimSkip;
+        numDimSkip *= m_dims[curDim];
+    }
+    numElemsOut = numElems;
+    return numSkip * numBytesPerElem() + m_header.getDataOffset();
+}
+
+const float* NiftiIO::getMappedFloatData(const int& fullDims, const vector<int64_t>& indexSelect)
+{
+    const char* mapped = m_file.getMappedData();
+    if (mapped == NULL) return NULL;
+    if (m_header.getDataType() != NIFTI_TYPE_FLOAT32 || m_header.isSwapped()) return NULL;
+    double mult, offset;
+    if (m_header.getDataScaling(mult, offset)) return NULL;
+    int64_t numElems;
+    const char* ret = mapped + getDataRange(fullDims, indexSelect, numElems);
+    if (((uintptr_t)ret) % sizeof(float) != 0) return NULL;//vox_offset isn't required to be aligned
+    return (const float*)ret;
 }
 
 int NiftiIO::getNumComponents() const
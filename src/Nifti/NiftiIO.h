@@ -25,11 +25,13 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretMutex.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 #include "NiftiHeader.h"
 
 #include <QString>
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <vector>
@@ -44,13 +46,25 @@ namespace caret
         std::vector<int64_t> m_dims;
         std::vector<char> m_scratch;//scratch memory for byteswapping, type conversion, etc
         CaretMutex m_mutex;//protect multithreaded calls from each other
+        std::vector<std::vector<char> > m_scratchPool;//for read-only files, each read checks out its own scratch buffer, so reads don't serialize
+        CaretMutex m_scratchPoolMutex;//only held while checking buffers in or out
+        bool m_readOnly, m_compressed;
+        static const int64_t PIPELINE_CHUNK_BYTES;//for compressed files, decompress this much at a time while converting the previous chunk
+        void checkOutScratch(std::vector<char>& scratchOut);
+        void checkInScratch(std::vector<char>& scratch);
         int numBytesPerElem();//for resizing scratch
+        int64_t getDataRange(const int& fullDims, const std::vector<int64_t>& indexSelect, int64_t& numElemsOut);//returns byte offset in file of the selected data
+        template<typename T>
+        void readDataPipelined(T* dataOut, const int64_t& startByte, const int64_t& numElems);
+        template<typename T>
+        void convertReadAnyType(T* out, char* in, const int64_t& count);//switch on datatype, in may be modified if swapped
         template<typename TO, typename FROM>
         void convertRead(TO* out, FROM* in, const int64_t& count);//for reading from file
         template<typename TO, typename FROM>
         void convertWrite(TO* out, const FROM* in, const int64_t& count);//for writing to file
     public:
-        void openRead(const QString& filename);
+        NiftiIO() { m_readOnly = false; m_compressed = false; }
+        void openRead(const QString& filename, const bool& memoryMap = false);//memoryMap avoids a copy in readData, and allows getMappedFloatData to work
         void writeNew(const QString& filename, const NiftiHeader& header, const int& version = 1, const bool& withRead = false, const bool& swapEndian = false);
         QString getFilename() const { return m_file.getFilename(); }
         void overrideDimensions(const std::vector<int64_t>& newDims) { m_dims = newDims; }//HACK: deal with reading/writing CIFTI-1's broken headers
@@ -64,75 +78,147 @@ namespace caret
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
+        ///pointer directly into the memory map, only if the file is mapped and the data is exactly what readData would give (float32, native endian, unscaled), otherwise NULL
+        const float* getMappedFloatData(const int& fullDims, const std::vector<int64_t>& indexSelect);
     };
     
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
+        int64_t numElems;
+        int64_t startByte = getDataRange(fullDims, indexSelect, numElems);
+        int64_t numBytes = numElems * numBytesPerElem();
+        const char* mapped = m_file.getMappedData();
+        if (mapped != NULL && !m_header.isSwapped() && ((uintptr_t)(mapped + startByte)) % (numBytesPerElem() / getNumComponents()) == 0)
+        {//openRead checked that the file isn't truncated, so this is all in the mapping, vox_offset isn't required to be aligned, so use the positional read otherwise
+            convertReadAnyType(dataOut, const_cast<char*>(mapped + startByte), numElems);//convertRead only modifies its input when swapping
+            return;
         }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
+        if (m_compressed && m_readOnly && !tolerateShortRead && numBytes >= 2 * PIPELINE_CHUNK_BYTES)
         {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
+            readDataPipelined(dataOut, startByte, numElems);
+            return;
+        }
+        if (m_readOnly)
+        {//positional reads don't use the shared file position, and we use our own scratch buffer, so no mutex
+            std::vector<char> myScratch;
+            checkOutScratch(myScratch);
+            myScratch.resize(numBytes);
+            int64_t numRead = 0;
+            m_file.readAt(startByte, myScratch.data(), numBytes, &numRead);
+            if ((numRead != numBytes && !tolerateShortRead) || numRead < 0)
+            {
+                throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+            }
+            convertReadAnyType(dataOut, myScratch.data(), numElems);
+            checkInScratch(myScratch);
+            return;
         }
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
-        m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        m_scratch.resize(numBytes);
+        m_file.seek(startByte);
         int64_t numRead = 0;
         m_file.read(m_scratch.data(), m_scratch.size(), &numRead);
         if ((numRead != (int64_t)m_scratch.size() && !tolerateShortRead) || numRead < 0)//for now, assume read giving -1 is always a problem
         {
             throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
         }
+        convertReadAnyType(dataOut, m_scratch.data(), numElems);
+    }
+    
+    template<typename T>
+    void NiftiIO::readDataPipelined(T* dataOut, const int64_t& startByte, const int64_t& numElems)
+    {//inflate is single threaded, so have one thread decompress the next chunk while the others convert the current one
+        const int64_t CONVERT_ELEMS = 1<<16;//granularity of conversion work per thread
+        const int64_t bytesPerElem = numBytesPerElem();
+        const int64_t chunkElems = std::max((int64_t)1, PIPELINE_CHUNK_BYTES / bytesPerElem);
+        const int64_t numChunks = (numElems + chunkElems - 1) / chunkElems;
+        std::vector<char> buffers[2];
+        buffers[0].resize(chunkElems * bytesPerElem);
+        buffers[1].resize(chunkElems * bytesPerElem);
+        //readAt serializes with every other reader of this file under CaretBinaryFile's lock, which also covers the seek the gzip implementations need
+        m_file.readAt(startByte, buffers[0].data(), std::min(chunkElems, numElems) * bytesPerElem);//throws on short read
+        bool readFailed = false;
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+        {
+            const int64_t chunkStart = chunk * chunkElems, chunkCount = std::min(chunkElems, numElems - chunkStart);
+            const int64_t nextCount = std::min(chunkElems, numElems - chunkStart - chunkCount);
+            char* curBuffer = buffers[chunk % 2].data();
+            char* nextBuffer = buffers[(chunk + 1) % 2].data();
+            const int64_t numPieces = (chunkCount + CONVERT_ELEMS - 1) / CONVERT_ELEMS;
+#pragma omp CARET_PAR
+            {
+#ifdef CARET_OMP
+                bool readThread = (omp_get_thread_num() == 0);
+#else
+                bool readThread = true;
+#endif
+                if (readThread && nextCount > 0)
+                {
+                    try
+                    {
+                        m_file.readAt(startByte + (chunkStart + chunkCount) * bytesPerElem, nextBuffer, nextCount * bytesPerElem);
+                    } catch (...) {//can't throw out of a parallel region
+                        readFailed = true;
+                    }
+                }//the reading thread joins the conversion when it finishes, dynamic schedule lets the other threads take most of it
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t piece = 0; piece < numPieces; ++piece)
+                {
+                    const int64_t pieceStart = piece * CONVERT_ELEMS, pieceCount = std::min(CONVERT_ELEMS, chunkCount - pieceStart);
+                    convertReadAnyType(dataOut + chunkStart + pieceStart, curBuffer + pieceStart * bytesPerElem, pieceCount);
+                }
+            }
+            if (readFailed)
+            {
+                throw DataFileException("error while reading from nifti file '" + m_file.getFilename() + "'");
+            }
+        }
+    }
+    
+    template<typename T>
+    void NiftiIO::convertReadAnyType(T* dataOut, char* in, const int64_t& numElems)
+    {
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
             case NIFTI_TYPE_RGB24://handled by components
-                convertRead(dataOut, (uint8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint8_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT8:
-                convertRead(dataOut, (int8_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int8_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT16:
-                convertRead(dataOut, (uint16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint16_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT16:
-                convertRead(dataOut, (int16_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int16_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT32:
-                convertRead(dataOut, (uint32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint32_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT32:
-                convertRead(dataOut, (int32_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int32_t*)in, numElems);
                 break;
             case NIFTI_TYPE_UINT64:
-                convertRead(dataOut, (uint64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (uint64_t*)in, numElems);
                 break;
             case NIFTI_TYPE_INT64:
-                convertRead(dataOut, (int64_t*)m_scratch.data(), numElems);
+                convertRead(dataOut, (int64_t*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT32:
             case NIFTI_TYPE_COMPLEX64://components
-                convertRead(dataOut, (float*)m_scratch.data(), numElems);
+                convertRead(dataOut, (float*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT64:
             case NIFTI_TYPE_COMPLEX128:
-                convertRead(dataOut, (double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (double*)in, numElems);
                 break;
             case NIFTI_TYPE_FLOAT128:
             case NIFTI_TYPE_COMPLEX256:
-                convertRead(dataOut, (long double*)m_scratch.data(), numElems);
+                convertRead(dataOut, (long double*)in, numElems);
                 break;
             default:
                 CaretAssert(0);
@@ -143,25 +229,12 @@ namespace caret
     template<typename T>
     void NiftiIO::writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect)
     {
-        CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
-        CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
-        int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
-        int curDim;
-        for (curDim = 0; curDim < fullDims; ++curDim)
-        {
-            numElems *= m_dims[curDim];
-        }
-        int64_t numDimSkip = numElems, numSkip = 0;
-        for (; curDim < (int)m_dims.size(); ++curDim)
-        {
-            CaretAssert(indexSelect[curDim - fullDims] >= 0 && indexSelect[curDim - fullDims] < m_dims[curDim]);
-            numSkip += indexSelect[curDim - fullDims] * numDimSkip;
-            numDimSkip *= m_dims[curDim];
-        }
+        int64_t numElems;
+        int64_t startByte = getDataRange(fullDims, indexSelect, numElems);
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done writing, because we use an internal variable for scratch space
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
         m_scratch.resize(numElems * numBytesPerElem());
-        m_file.seek(numSkip * numBytesPerElem() + m_header.getDataOffset());
+        m_file.seek(startByte);
         switch (m_header.getDataType())
         {
             case NIFTI_TYPE_UINT8:
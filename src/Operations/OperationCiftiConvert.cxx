@@ -24,6 +24,7 @@
 #include "CaretAssert.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiQuantizedFile.h"
 #include "CiftiXML.h"
 #include "FloatMatrix.h"
 #include "GiftiFile.h"
@@ -106,8 +107,15 @@ OperationParameters* OperationCiftiConvert::getParameters()
     ftresetTimeunitsOpt->addStringParameter(1, "unit", "unit identifier (default SECOND)");
     fromText->createOptionalParameter(6, "-reset-scalars", "reset mapping along rows to scalars, taking length from the text file");
     
+    OptionalParameter* toWbquant = ret->createOptionalParameter(7, "-to-wbquant", "convert a 2D cifti file to a quantized file for faster row reading");
+    toWbquant->addCiftiParameter(1, "cifti-in", "the input cifti file");
+    toWbquant->addStringParameter(2, "wbquant-out", "output - the output quantized file");//fake output formatting
+    OptionalParameter* encodingOpt = toWbquant->createOptionalParameter(3, "-encoding", "choose how values are stored");
+    encodingOpt->addStringParameter(1, "type", "INT8, INT16, or FLOAT16 (default INT16)");
+    toWbquant->createOptionalParameter(4, "-compress", "also zlib compress each row");
+    
     AString myText = AString("This command is used to convert a full CIFTI matrix to/from formats that can be used by programs that don't understand CIFTI.  ") +
-        "You must specify exactly one of -to-gifti-ext, -from-gifti-ext, -to-nifti, -from-nifti, -to-text, or -from-text.\n\n" +
+        "You must specify exactly one of -to-gifti-ext, -from-gifti-ext, -to-nifti, -from-nifti, -to-text, -from-text, or -to-wbquant.\n\n" +
         "If you want to write an existing CIFTI file with a different CIFTI version, see -file-convert, and its -cifti-version-convert option.\n\n" +
         "If you want part of the CIFTI file as a metric, label, or volume file, see -cifti-separate.  " +
         "If you want to create a CIFTI file from metric and/or volume files, see the -cifti-create-* commands.\n\n" +
@@ -115,6 +123,12 @@ OperationParameters* OperationCiftiConvert::getParameters()
         "After importing to CIFTI, you can then expand the file into a standard brainordinates space with -cifti-create-dense-from-template.  " +
         "If you want to export only part of a CIFTI file, first create an roi-restricted CIFTI file with -cifti-restrict-dense-mapping.\n\n" +
         "The -transpose option to -from-gifti-ext is needed if the replacement binary file is in column-major order.\n\n" +
+        "The -to-wbquant option writes a file that wb_view and other wb_command operations read like a cifti file, but each row is stored in reduced precision, " +
+        "with a separate scale and offset for each row for the INT8 and INT16 types, which take 1/4 and 1/2 of the space of float32.  " +
+        "FLOAT16 also takes 1/2 the space, and keeps relative precision of about 3 decimal digits instead of absolute precision, and can store infinities.  " +
+        "INT8 and INT16 store NaN, but infinities are clamped to the range of the other values in the row.  " +
+        "The output filename should end in .wbquant, for instance .dconn.wbquant, as that is how the format is recognized when reading.  " +
+        "To convert back, use the quantized file as the input of a command that writes cifti, such as -cifti-math 'x' with -var x.\n\n" +
         "The -unit options accept these values:\n";
     vector<CiftiSeriesMap::Unit> units = CiftiSeriesMap::getAllUnits();
     for (int i = 0; i < (int)units.size(); ++i)
@@ -135,12 +149,14 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
     OptionalParameter* fromNifti = myParams->getOptionalParameter(4);
     OptionalParameter* toText = myParams->getOptionalParameter(5);
     OptionalParameter* fromText = myParams->getOptionalParameter(6);
+    OptionalParameter* toWbquant = myParams->getOptionalParameter(7);
     if (toGiftiExt->m_present) ++modes;
     if (fromGiftiExt->m_present) ++modes;
     if (toNifti->m_present) ++modes;
     if (fromNifti->m_present) ++modes;
     if (toText->m_present) ++modes;
     if (fromText->m_present) ++modes;
+    if (toWbquant->m_present) ++modes;
     if (modes != 1)
     {
         throw OperationException("you must specify exactly one conversion mode");
@@ -491,4 +507,29 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
             ciftiOut->setRow(temprow.data(), j);
         }
     }
+    if (toWbquant->m_present)
+    {
+        CiftiFile* ciftiIn = toWbquant->getCifti(1);
+        AString wbquantOutName = toWbquant->getString(2);
+        CiftiQuantizedFile::Encoding encoding = CiftiQuantizedFile::INT16;
+        OptionalParameter* encodingOpt = toWbquant->getOptionalParameter(3);
+        if (encodingOpt->m_present)
+        {
+            if (!CiftiQuantizedFile::encodingFromName(encodingOpt->getString(1), encoding))
+            {
+                throw OperationException("unrecognized encoding type: '" + encodingOpt->getString(1) + "'");
+            }
+        }
+        const CiftiXML& myXML = ciftiIn->getCiftiXML();
+        if (myXML.getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
+        vector<int64_t> dims = myXML.getDimensions();
+        vector<float> scratchRow(dims[0]);
+        CiftiQuantizedFileWriter myWriter(wbquantOutName, myXML, encoding, toWbquant->getOptionalParameter(4)->m_present);
+        for (int64_t i = 0; i < dims[1]; ++i)
+        {
+            ciftiIn->getRow(scratchRow.data(), i);
+            myWriter.writeRow(scratchRow.data(), i);
+        }
+        myWriter.finish();
+    }
 }
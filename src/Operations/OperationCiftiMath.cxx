@@ -24,15 +24,23 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "CiftiXML.h"
 #include "MultiDimIterator.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t CHUNK_SIZE = 16384;//values per parallel work unit, evaluateMany does its own blocking internally
+    const int64_t BATCH_VALUES = 1<<20;//values per variable to buffer before evaluating
+}
+
 AString OperationCiftiMath::getCommandSwitch()
 {
     return "-cifti-math";
@@ -235,57 +243,83 @@ void OperationCiftiMath::useParameters(OperationParameters* myParams, ProgressOb
     }
     if (outXML.getNumberOfDimensions() < 1) throw OperationException("output must have at least 1 dimension");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> values(numVars), scratchRow(outDims[0]);
-    vector<vector<float> > inputRows(numVars);
+    const int64_t rowLength = outDims[0];
+    const int64_t batchRows = max((int64_t)1, BATCH_VALUES / rowLength);//evaluate several rows at once, so short rows still have enough work to parallelize
+    vector<vector<float> > inputRows(numVars), batchInputs(numVars);
     vector<vector<int64_t> > loadedRow(numVars);//to detect and prevent rereading the same row
     for (int v = 0; v < numVars; ++v)
     {
         inputRows[v].resize(varCiftiFiles[v]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
         loadedRow[v].resize(varCiftiFiles[v]->getCiftiXML().getNumberOfDimensions() - 1, -1);//we always load a full row, so ignore first dim
+        batchInputs[v].resize(batchRows * rowLength);
     }
-    for (MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end())); !iter.atEnd(); ++iter)
+    vector<float> batchOut(batchRows * rowLength);
+    vector<vector<int64_t> > batchIndices;
+    MultiDimIterator<int64_t> iter(vector<int64_t>(outDims.begin() + 1, outDims.end()));
+    while (!iter.atEnd())
     {
-        for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
+        batchIndices.clear();
+        for (; !iter.atEnd() && (int64_t)batchIndices.size() < batchRows; ++iter)
         {
-            bool needToLoad = false;
-            for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
+            const int64_t batchOffset = batchIndices.size() * rowLength;
+            for (int v = 0; v < numVars; ++v)//first, retrieve whichever rows are needed
             {
-                int64_t indexNeeded = -1;
-                if (selectInfo[v][dim + 1] == -1)
+                bool needToLoad = false;
+                for (int dim = 0; dim < (int)loadedRow[v].size(); ++dim)
                 {
-                    CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
-                    indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
-                } else {
-                    indexNeeded = selectInfo[v][dim + 1];
+                    int64_t indexNeeded = -1;
+                    if (selectInfo[v][dim + 1] == -1)
+                    {
+                        CaretAssert(dim + 1 < (int)outDims.size());//"match to output index" can't work past output dimensionality
+                        indexNeeded = (*iter)[dim];//NOTE: iter also doesn't include the first dim
+                    } else {
+                        indexNeeded = selectInfo[v][dim + 1];
+                    }
+                    if (indexNeeded != loadedRow[v][dim])
+                    {
+                        needToLoad = true;
+                        loadedRow[v][dim] = indexNeeded;
+                    }
                 }
-                if (indexNeeded != loadedRow[v][dim])
+                if (needToLoad)
                 {
-                    needToLoad = true;
-                    loadedRow[v][dim] = indexNeeded;
+                    varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
+                }
+                float* batchRow = batchInputs[v].data() + batchOffset;
+                if (selectInfo[v][0] == -1)//now we check for select along row
+                {
+                    copy(inputRows[v].begin(), inputRows[v].begin() + rowLength, batchRow);
+                } else {
+                    fill(batchRow, batchRow + rowLength, inputRows[v][selectInfo[v][0]]);
                 }
             }
-            if (needToLoad)
-            {
-                varCiftiFiles[v]->getRow(inputRows[v].data(), loadedRow[v]);
-            }
+            batchIndices.push_back(*iter);
         }
-        for (int j = 0; j < outDims[0]; ++j)
+        const int64_t batchValues = batchIndices.size() * rowLength;
+        const int64_t numChunks = (batchValues + CHUNK_SIZE - 1) / CHUNK_SIZE;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t c = 0; c < numChunks; ++c)
         {
-            for (int v = 0; v < numVars; ++v)//now we check for select along row
+            const int64_t start = c * CHUNK_SIZE;
+            const int64_t count = min(CHUNK_SIZE, batchValues - start);
+            vector<const float*> chunkInputs(numVars);
+            for (int v = 0; v < numVars; ++v)
             {
-                if (selectInfo[v][0] == -1)
-                {
-                    values[v] = inputRows[v][j];
-                } else {
-                    values[v] = inputRows[v][selectInfo[v][0]];
-                }
+                chunkInputs[v] = batchInputs[v].data() + start;
             }
-            scratchRow[j] = (float)myExpr.evaluate(values);
-            if (nanfix && scratchRow[j] != scratchRow[j])
+            float* chunkOut = batchOut.data() + start;
+            myExpr.evaluateMany(chunkInputs, chunkOut, count);
+            if (nanfix)
             {
-                scratchRow[j] = nanfixval;
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    if (chunkOut[i] != chunkOut[i]) chunkOut[i] = nanfixval;
+                }
             }
         }
-        myCiftiOut->setRow(scratchRow.data(), *iter);
+        for (int64_t r = 0; r < (int64_t)batchIndices.size(); ++r)
+        {
+            myCiftiOut->setRow(batchOut.data() + r * rowLength, batchIndices[r]);
+        }
     }
 }
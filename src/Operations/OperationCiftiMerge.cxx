@@ -24,12 +24,55 @@
 #include "CaretAssert.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiRowPipeline.h"
 
 #include <algorithm>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///one job per row, reads the row from every input, then picks out the selected columns
+    class MergeWorker : public CiftiRowPipeline::Worker
+    {
+        vector<const CiftiFile*> m_inputs;
+        vector<int64_t> m_inputOffsets;//where each input's row goes in the job's input
+        vector<int64_t> m_selection;//index into the job's input for each output column
+        CiftiFile* m_ciftiOut;
+    public:
+        MergeWorker(const vector<const CiftiFile*>& inputs, const vector<int64_t>& inputOffsets, const vector<int64_t>& selection, CiftiFile* ciftiOut)
+        {
+            m_inputs = inputs;
+            m_inputOffsets = inputOffsets;
+            m_selection = selection;
+            m_ciftiOut = ciftiOut;
+        }
+        int64_t getJobFloats() const { return m_inputOffsets.back() + m_selection.size(); }
+        void readJob(const int64_t& row, vector<float>& inputOut)
+        {
+            inputOut.resize(m_inputOffsets.back());
+            for (int i = 0; i < (int)m_inputs.size(); ++i)
+            {
+                m_inputs[i]->getRow(inputOut.data() + m_inputOffsets[i], row);
+            }
+        }
+        void computeJob(const int64_t&, const vector<float>& input, vector<float>& outputOut, const int&)
+        {
+            int64_t numOutColumns = (int64_t)m_selection.size();
+            outputOut.resize(numOutColumns);
+            for (int64_t c = 0; c < numOutColumns; ++c)
+            {
+                outputOut[c] = input[m_selection[c]];
+            }
+        }
+        void writeJob(const int64_t& row, const vector<float>& output)
+        {
+            m_ciftiOut->setRow(output.data(), row);
+        }
+    };
+}
+
 AString OperationCiftiMerge::getCommandSwitch()
 {
     return "-cifti-merge";
@@ -140,7 +183,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +193,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -256,53 +298,51 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    vector<const CiftiFile*> inputFiles;
+    vector<int64_t> inputOffsets(1, 0), selection;//inputOffsets has an extra element at the end for the total length
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
+        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
+        const int64_t offset = inputOffsets.back();
+        inputFiles.push_back(ciftiIn);
+        inputOffsets.push_back(offset + thisXML.getDimensionLength(CiftiXML::ALONG_ROW));
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        if (numColumnOpts > 0)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            for (int j = 0; j < numColumnOpts; ++j)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
+                if (upToOpt->m_present)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
+                        for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
+                            selection.push_back(offset + c);
                         }
                     } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
+                        for (int c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            selection.push_back(offset + c);
+                        }
                     }
+                } else {
+                    selection.push_back(offset + initialColumn);
                 }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
+            }
+        } else {
+            for (int64_t c = 0; c < thisXML.getDimensionLength(CiftiXML::ALONG_ROW); ++c)
+            {
+                selection.push_back(offset + c);
             }
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
     }
+    CaretAssert((int64_t)selection.size() == numOutColumns);
+    MergeWorker myWorker(inputFiles, inputOffsets, selection, ciftiOut);
+    CiftiRowPipeline::run(myWorker, numRows, myWorker.getJobFloats());
 }
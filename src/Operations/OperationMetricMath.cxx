@@ -24,13 +24,20 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "MetricFile.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int CHUNK_SIZE = 16384;//values per parallel work unit, evaluateMany does its own blocking internally
+}
+
 AString OperationMetricMath::getCommandSwitch()
 {
     return "-metric-math";
@@ -181,8 +188,9 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
     {
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output columns from");
     }
-    vector<float> values(numVars), colScratch(numNodes);
+    vector<float> colScratch(numNodes);
     vector<const float*> columnPointers(numVars);
+    const int numChunks = (numNodes + CHUNK_SIZE - 1) / CHUNK_SIZE;
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
     myMetricOut->setStructure(myStructure);
     for (int j = 0; j < numColumns; ++j)
@@ -197,16 +205,24 @@ void OperationMetricMath::useParameters(OperationParameters* myParams, ProgressO
                 columnPointers[v] = varMetrics[v]->getValuePointerForColumn(metricColumns[v]);
             }
         }
-        for (int i = 0; i < numNodes; ++i)
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int c = 0; c < numChunks; ++c)
         {
+            const int start = c * CHUNK_SIZE;
+            const int count = min(CHUNK_SIZE, numNodes - start);
+            vector<const float*> chunkPointers(numVars);
             for (int v = 0; v < numVars; ++v)
             {
-                values[v] = columnPointers[v][i];
+                chunkPointers[v] = columnPointers[v] + start;
             }
-            colScratch[i] = (float)myExpr.evaluate(values);
-            if (nanfix && colScratch[i] != colScratch[i])
+            float* chunkOut = colScratch.data() + start;
+            myExpr.evaluateMany(chunkPointers, chunkOut, count);
+            if (nanfix)
             {
-                colScratch[i] = nanfixval;
+                for (int i = 0; i < count; ++i)
+                {
+                    if (chunkOut[i] != chunkOut[i]) chunkOut[i] = nanfixval;
+                }
             }
         }
         myMetricOut->setValuesForColumn(j, colScratch.data());
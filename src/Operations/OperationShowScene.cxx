@@ -227,7 +227,11 @@ OperationShowScene::useParameters(OperationParameters* myParams,
     /*
      * Restore the scene
      */
+    scene->loadDeferredContent();
     const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+    if (guiManagerClass == NULL) {
+        throw OperationException("Scene is missing guiManager class");
+    }
     if (guiManagerClass->getName() != "guiManager") {
         throw OperationException("Top level scene class should be guiManager but it is: "
                                  + guiManagerClass->getName());
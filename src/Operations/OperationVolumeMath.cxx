@@ -24,13 +24,20 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "CaretMathExpression.h"
+#include "CaretOMP.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t CHUNK_SIZE = 16384;//values per parallel work unit, evaluateMany does its own blocking internally
+}
+
 AString OperationVolumeMath::getCommandSwitch()
 {
     return "-volume-math";
@@ -189,8 +196,9 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
         throw OperationException("all -var options used -repeat, there is no file to get number of desired output subvolumes from");
     }
     int64_t frameSize = outDims[0] * outDims[1] * outDims[2];
-    vector<float> values(numVars), outFrame(frameSize);
+    vector<float> outFrame(frameSize);
     vector<const float*> inputFrames(numVars);
+    const int64_t numChunks = (frameSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
     myVolOut->reinitialize(outDims, first->getSform());//DO NOT take volume type from first volume, because we don't check for or copy label tables, nor do we want to
     for (int s = 0; s < numSubvols; ++s)
     {
@@ -204,18 +212,25 @@ void OperationVolumeMath::useParameters(OperationParameters* myParams, ProgressO
                 inputFrames[v] = varVolumes[v]->getFrame(varSubvolumes[v]);
             }
         }
-        for (int64_t i = 0; i < frameSize; ++i)
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t c = 0; c < numChunks; ++c)
         {
+            const int64_t start = c * CHUNK_SIZE;
+            const int64_t count = min(CHUNK_SIZE, frameSize - start);
+            vector<const float*> chunkFrames(numVars);
             for (int v = 0; v < numVars; ++v)
             {
-                values[v] = inputFrames[v][i];
+                chunkFrames[v] = inputFrames[v] + start;
             }
-            float tempf = (float)myExpr.evaluate(values);
-            if (nanfix && tempf != tempf)
+            float* chunkOut = outFrame.data() + start;
+            myExpr.evaluateMany(chunkFrames, chunkOut, count);
+            if (nanfix)
             {
-                tempf = nanfixval;
+                for (int64_t i = 0; i < count; ++i)
+                {
+                    if (chunkOut[i] != chunkOut[i]) chunkOut[i] = nanfixval;
+                }
             }
-            outFrame[i] = tempf;
         }
         myVolOut->setFrame(outFrame.data(), s);
     }
@@ -140,6 +140,7 @@ void OperationZipSceneFile::createZipFile(const AString& sceneFileName,
     for (int i = 0; i < numScenes; ++i)
     {
         Scene* thisScene = sceneFile.getSceneAtIndex(i);
+        thisScene->loadDeferredContent();
         SceneAttributes* myAttrs = thisScene->getAttributes();
         const SceneClass* guiMgrClass = thisScene->getClassWithName("guiManager");
         if (guiMgrClass == NULL)
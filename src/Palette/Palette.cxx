@@ -491,6 +491,28 @@ Palette::getPaletteColor(
     }
 }
 
+/**
+ * Get a lookup table of the palette's colors.  The table is created
+ * when first requested and recreated if the palette's scalars or
+ * colors have changed.
+ *
+ * @param interpolateColorFlag
+ *    Interpolate colors between the palette's scalars.
+ * @return
+ *    The lookup table.
+ */
+CaretPointer<const PaletteLookupTable>
+Palette::getLookupTable(const bool interpolateColorFlag) const
+{
+    CaretMutexLocker locked(&this->lookupTableMutex);
+    CaretPointer<const PaletteLookupTable>& lookupTable = this->lookupTables[interpolateColorFlag ? 1 : 0];
+    if ((lookupTable == NULL)
+        || ( ! lookupTable->isValidForPalette(this, interpolateColorFlag))) {
+        lookupTable.grabNew(new PaletteLookupTable(this, interpolateColorFlag));
+    }
+    return lookupTable;
+}
+
 /**
  * Set this object has been modified.
  *
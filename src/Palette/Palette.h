@@ -25,7 +25,10 @@
 #include <vector>
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretObject.h"
+#include "CaretPointer.h"
+#include "PaletteLookupTable.h"
 #include "TracksModificationInterface.h"
 
 
@@ -96,6 +99,8 @@ namespace caret {
                              const bool interpolateColorFlag,
                              float rgbaOut[4]) const;
         
+        CaretPointer<const PaletteLookupTable> getLookupTable(const bool interpolateColorFlag) const;
+        
         void setModified();
         
         void clearModified();
@@ -125,6 +130,12 @@ namespace caret {
         /**The scalars in the palette. */
         std::vector<PaletteScalarAndColor*> paletteScalars;
         
+        /**Lookup tables, without [0] and with [1] interpolation, created when needed. (DO NOT CLONE) */
+        mutable CaretPointer<const PaletteLookupTable> lookupTables[2];
+        
+        /**Protects the lookup tables. */
+        mutable CaretMutex lookupTableMutex;
+        
     };
 
     
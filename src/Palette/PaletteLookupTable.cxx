@@ -0,0 +1,122 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteLookupTable.h"
+
+#include "CaretAssert.h"
+#include "Palette.h"
+#include "PaletteScalarAndColor.h"
+
+using namespace caret;
+
+const int32_t PaletteLookupTable::RESOLUTION;
+
+/**
+ * Constructor, samples the palette so that entries for
+ * 0.0, 1.0, and -1.0 are exact.
+ *
+ * @param palette
+ *    Palette that is sampled.
+ * @param interpolateColorFlag
+ *    Interpolate colors between the palette's scalars.
+ */
+PaletteLookupTable::PaletteLookupTable(const Palette* palette,
+                                       const bool interpolateColorFlag)
+{
+    CaretAssert(palette);
+
+    createPaletteSignature(palette,
+                           interpolateColorFlag,
+                           m_paletteSignature);
+
+    const int32_t numEntries = 2 * RESOLUTION + 1;
+    m_floatTable.resize(numEntries * 4, 0.0f);
+    m_byteTable.resize(numEntries * 4, 0);
+    for (int32_t i = 0; i < numEntries; i++) {
+        const float normalizedValue = static_cast<float>(i - RESOLUTION) / RESOLUTION;
+        float rgba[4];
+        palette->getPaletteColor(normalizedValue,
+                                 interpolateColorFlag,
+                                 rgba);
+        if (rgba[3] > 0.0f) {
+            const int32_t i4 = i * 4;
+            for (int32_t j = 0; j < 4; j++) {
+                m_floatTable[i4 + j] = rgba[j];
+                m_byteTable[i4 + j] = static_cast<uint8_t>(rgba[j] * 255.0);
+            }
+        }
+    }
+}
+
+/**
+ * Is this table valid for the palette, i.e., have the palette's scalars
+ * and colors and the interpolation not changed since the table was created?
+ *
+ * @param palette
+ *    The palette.
+ * @param interpolateColorFlag
+ *    Interpolate colors between the palette's scalars.
+ * @return
+ *    True if the table is valid.
+ */
+bool
+PaletteLookupTable::isValidForPalette(const Palette* palette,
+                                      const bool interpolateColorFlag) const
+{
+    std::vector<float> signature;
+    createPaletteSignature(palette,
+                           interpolateColorFlag,
+                           signature);
+    return (signature == m_paletteSignature);
+}
+
+/**
+ * Create values that identify the coloring produced by a palette.  This is
+ * used instead of the palette's modification status since that status is
+ * cleared when the palette is saved and the palette's scalar and colors track
+ * their modification status separately.
+ *
+ * @param palette
+ *    The palette.
+ * @param interpolateColorFlag
+ *    Interpolate colors between the palette's scalars.
+ * @param signatureOut
+ *    Output containing the values.
+ */
+void
+PaletteLookupTable::createPaletteSignature(const Palette* palette,
+                                           const bool interpolateColorFlag,
+                                           std::vector<float>& signatureOut)
+{
+    const int32_t numScalars = palette->getNumberOfScalarsAndColors();
+    signatureOut.clear();
+    signatureOut.reserve(numScalars * 6 + 1);
+    signatureOut.push_back(interpolateColorFlag ? 1.0f : 0.0f);
+    for (int32_t i = 0; i < numScalars; i++) {
+        const PaletteScalarAndColor* psac = palette->getScalarAndColor(i);
+        const float* rgba = psac->getColor();
+        signatureOut.push_back(psac->getScalar());
+        signatureOut.push_back(rgba[0]);
+        signatureOut.push_back(rgba[1]);
+        signatureOut.push_back(rgba[2]);
+        signatureOut.push_back(rgba[3]);
+        signatureOut.push_back(psac->isNoneColor() ? 1.0f : 0.0f);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef __PALETTE_LOOKUP_TABLE_H__
+#define __PALETTE_LOOKUP_TABLE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class Palette;
+
+    /**
+     * Palette colors sampled at a fixed resolution over the normalized
+     * range [-1, 1], so that coloring is a table lookup instead of a
+     * search of the palette's scalars.
+     */
+    class PaletteLookupTable {
+
+    public:
+        /** Number of table entries from 0.0 to 1.0 (and from 0.0 to -1.0), excluding 0.0 */
+        static const int32_t RESOLUTION = 4096;
+
+        PaletteLookupTable(const Palette* palette,
+                           const bool interpolateColorFlag);
+
+        bool isValidForPalette(const Palette* palette,
+                               const bool interpolateColorFlag) const;
+
+        /**
+         * Get the table index for a normalized palette value.
+         *
+         * @param normalizedValue
+         *    Value in [-1, 1], values outside are clamped as is NaN (to -1).
+         * @return
+         *    Index of the entry nearest the value, the RGBA for
+         *    the entry starts at 4 times the index.  Only zero uses
+         *    the entry for zero since palettes often change color
+         *    (or have no color) at zero.
+         */
+        inline static int32_t getIndex(const float normalizedValue) {
+            const float clampedValue = ((1.0f < normalizedValue) ? 1.0f : ((-1.0f < normalizedValue) ? normalizedValue : -1.0f));
+            const int32_t index = static_cast<int32_t>(clampedValue * RESOLUTION + (RESOLUTION + 0.5f));
+            const bool zeroIndexFlag = (index == RESOLUTION);
+            return (index
+                    + static_cast<int32_t>(zeroIndexFlag & (clampedValue > 0.0f))
+                    - static_cast<int32_t>(zeroIndexFlag & (clampedValue < 0.0f)));
+        }
+
+        /** @return RGBA, as floats in [0, 1], for each table entry, zero for entries with no color */
+        inline const float* getFloatTable() const { return &m_floatTable[0]; }
+
+        /** @return RGBA, as bytes, for each table entry, zero for entries with no color */
+        inline const uint8_t* getByteTable() const { return &m_byteTable[0]; }
+
+    private:
+        PaletteLookupTable(const PaletteLookupTable&);
+
+        PaletteLookupTable& operator=(const PaletteLookupTable&);
+
+        static void createPaletteSignature(const Palette* palette,
+                                           const bool interpolateColorFlag,
+                                           std::vector<float>& signatureOut);
+
+        /** Interpolation and the palette's scalars and colors when the table was created */
+        std::vector<float> m_paletteSignature;
+
+        std::vector<float> m_floatTable;
+
+        std::vector<uint8_t> m_byteTable;
+    };
+
+} // namespace
+
+#endif // __PALETTE_LOOKUP_TABLE_H__
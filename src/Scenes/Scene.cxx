@@ -23,10 +23,15 @@
 #include "Scene.h"
 #undef __SCENE_DECLARE__
 
+#include <memory>
+
 #include "CaretAssert.h"
+#include "DataFileException.h"
 #include "SceneAttributes.h"
 #include "SceneClass.h"
 #include "SceneInfo.h"
+#include "SceneSaxReader.h"
+#include "XmlSaxParser.h"
 
 using namespace caret;
 
@@ -247,6 +252,8 @@ Scene::Scene(const Scene& rhs) : CaretObject()
     {
         m_sceneClasses.push_back(new SceneClass(**iter));
     }
+    m_deferredContent = rhs.m_deferredContent;
+    m_deferredContentFileName = rhs.m_deferredContentFileName;
 }
 
 /**
@@ -256,7 +263,7 @@ Scene::~Scene()
 {
     delete m_sceneAttributes;
 
-    const int32_t numberOfSceneClasses = this->getNumberOfClasses();
+    const int32_t numberOfSceneClasses = static_cast<int32_t>(m_sceneClasses.size());
     for (int32_t i = 0; i < numberOfSceneClasses; i++) {
         delete m_sceneClasses[i];
     }
@@ -283,33 +290,51 @@ Scene::getAttributes()
     return m_sceneAttributes;
 }
 
+/**
+ * Add a class to the scene.  If the scene's classes have not been
+ * read from the scene file, they are read first.
+ *
+ * @param sceneClass
+ *    Class added to the scene, the scene takes ownership.
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
+ */
 void
 Scene::addClass(SceneClass* sceneClass)
 {
     if (sceneClass != NULL) {
+        loadDeferredContent();
         m_sceneClasses.push_back(sceneClass);
     }
 }
 
 
 /**
- * @return Number of classes contained in the scene
+ * @return Number of classes contained in the scene.  If the scene's
+ * classes have not been read from the scene file, they are read first.
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
  */
 int32_t
 Scene::getNumberOfClasses() const
 {
+    loadDeferredContent();
     return m_sceneClasses.size();
 }
 
 /**
- * Get the scene class at the given index.
+ * Get the scene class at the given index.  If the scene's classes
+ * have not been read from the scene file, they are read first.
  * @param indx
  *    Index of the scene class.
  * @return Scene class at the given index.
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
  */
 const SceneClass* 
 Scene::getClassAtIndex(const int32_t indx) const
 {
+    loadDeferredContent();
     CaretAssertVectorIndex(m_sceneClasses, indx);
     return m_sceneClasses[indx];
 }
@@ -319,6 +344,8 @@ Scene::getClassAtIndex(const int32_t indx) const
  * @param sceneClassName
  *    Name of the scene class.
  * @return Scene class with the given name or NULL if not found.
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
  */
 const SceneClass* 
 Scene::getClassWithName(const AString& sceneClassName) const
@@ -396,11 +423,16 @@ Scene::setDescription(const AString& sceneDescription)
 }
 
 /**
- * @return true if there are files with remote paths in the scene.
+ * @return true if there are files with remote paths in the scene.  If
+ * the scene's classes have not been read from the scene file, they are
+ * read first since that is where the remote paths are found.
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
  */
 bool
 Scene::hasFilesWithRemotePaths() const
 {
+    loadDeferredContent();
     return m_hasFilesWithRemotePaths;
 }
 
@@ -416,6 +448,70 @@ Scene::setHasFilesWithRemotePaths(const bool hasFilesWithRemotePaths)
     m_hasFilesWithRemotePaths = hasFilesWithRemotePaths;
 }
 
+/**
+ * Set the XML of the scene so that its classes are read when they
+ * are first used instead of when the scene file is read.  Since
+ * the scene info (name, description, etc.) is not read from the
+ * XML, it must be set separately.
+ *
+ * @param sceneXml
+ *    XML (UTF-8) of the Scene element.
+ * @param sceneFileName
+ *    Name of the scene file containing the scene.
+ */
+void
+Scene::setDeferredContent(const QByteArray& sceneXml,
+                          const AString& sceneFileName)
+{
+    CaretAssert(m_sceneClasses.empty());
+    m_deferredContent = sceneXml;
+    m_deferredContentFileName = sceneFileName;
+}
+
+/**
+ * If the classes have not been read from the deferred content, read them.
+ * The accessors for the classes and the remote path status call this, so
+ * it only needs to be called directly to read the classes, and report
+ * any error, at a convenient time.  If the content cannot be read, the
+ * scene is left unchanged so that later attempts also fail.
+ *
+ * @throws DataFileException
+ *    If there is an error reading the scene's classes.
+ */
+void
+Scene::loadDeferredContent() const
+{
+    if (m_deferredContent.isEmpty()) {
+        return;
+    }
+    
+    Scene scene(m_sceneAttributes->getSceneType());
+    try {
+        SceneSaxReader saxReader(m_deferredContentFileName,
+                                 &scene);
+        std::auto_ptr<XmlSaxParser> parser(XmlSaxParser::createXmlParser());
+        parser->parseString(QString::fromUtf8(m_deferredContent.constData(),
+                                              m_deferredContent.size()),
+                            &saxReader);
+    }
+    catch (const XmlSaxParserException& e) {
+        throw DataFileException(m_deferredContentFileName,
+                                "Error reading scene "
+                                + getName()
+                                + ": "
+                                + e.whatString());
+    }
+    
+    m_deferredContent.clear();
+    m_sceneClasses.insert(m_sceneClasses.end(),
+                          scene.m_sceneClasses.begin(),
+                          scene.m_sceneClasses.end());
+    scene.m_sceneClasses.clear();
+    if (scene.m_hasFilesWithRemotePaths) {
+        m_hasFilesWithRemotePaths = true;
+    }
+}
+
 /**
  * Set a static value for the scene that is being created.
  */
@@ -22,6 +22,8 @@
 /*LICENSE_END*/
 
 
+#include <QByteArray>
+
 #include "CaretObject.h"
 #include "SceneTypeEnum.h"
 
@@ -78,6 +80,10 @@ namespace caret {
         
         void setHasFilesWithRemotePaths(const bool hasFilesWithRemotePaths);
 
+        void setDeferredContent(const QByteArray& sceneXml,
+                                const AString& sceneFileName);
+        
+        void loadDeferredContent() const;
         
         // ADD_NEW_METHODS_HERE
 
@@ -90,14 +96,20 @@ namespace caret {
         /** Attributes of the scene*/
         SceneAttributes* m_sceneAttributes;
 
-        /** Classes contained in the scene*/
-        std::vector<SceneClass*> m_sceneClasses;
+        /** Classes contained in the scene, mutable since they are read from the deferred content on first access*/
+        mutable std::vector<SceneClass*> m_sceneClasses;
 
         /** Info about scene */
         SceneInfo* m_sceneInfo;
         
         /** True if it found a ScenePathName with a remote file */
-        bool m_hasFilesWithRemotePaths;
+        mutable bool m_hasFilesWithRemotePaths;
+        
+        /** XML of the Scene element whose classes have not been read, empty if none */
+        mutable QByteArray m_deferredContent;
+        
+        /** Name of scene file containing the deferred content, for resolving path names */
+        AString m_deferredContentFileName;
         
         /** When a scene is being created, this will be set */
         static Scene* s_sceneBeingCreated;
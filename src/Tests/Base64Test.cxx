@@ -0,0 +1,137 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Base64Test.h"
+
+#include "Base64.h"
+#include "Base64StreamDecoder.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+Base64Test::Base64Test(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    ///decode the text in pieces ending at the given split points, returns false on a decoder error
+    bool decodeInPieces(const string& text, const vector<int64_t>& splits, vector<unsigned char>& decodedOut, bool& finishedOut, bool& partialOut)
+    {
+        Base64StreamDecoder myDecoder;
+        decodedOut.clear();
+        int64_t start = 0;
+        for (size_t i = 0; i <= splits.size(); ++i)
+        {
+            int64_t end = (i < splits.size() ? splits[i] : (int64_t)text.size());
+            vector<unsigned char> piece(Base64StreamDecoder::getMaxDecodedSize(end - start) + 1, 0xAB);
+            int64_t numBytes = myDecoder.decode(text.data() + start, end - start, piece.data());
+            if (piece[Base64StreamDecoder::getMaxDecodedSize(end - start)] != 0xAB) return false;//wrote past the documented size
+            decodedOut.insert(decodedOut.end(), piece.begin(), piece.begin() + numBytes);
+            start = end;
+        }
+        finishedOut = myDecoder.isFinished();
+        partialOut = myDecoder.hasPartialGroup();
+        return !myDecoder.hasError();
+    }
+}
+
+void Base64Test::execute()
+{
+    const int64_t lengths[] = { 0, 1, 2, 3, 4, 5, 6, 7, 57, 58, 59, 1000, 4099 };
+    for (size_t whichLength = 0; whichLength < sizeof(lengths) / sizeof(lengths[0]); ++whichLength)
+    {
+        const int64_t length = lengths[whichLength];
+        vector<unsigned char> data(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            data[i] = (unsigned char)(rand() & 0xFF);
+        }
+        vector<unsigned char> encoded(length * 2 + 8);
+        int64_t encodedLength = Base64::encode(data.data(), length, encoded.data());
+        string text;
+        for (int64_t i = 0; i < encodedLength; ++i)
+        {//wrap lines like xml writers do, and add indentation, so groups are split by whitespace
+            if (i % 76 == 0 && i != 0) text += "\n      ";
+            text += (char)encoded[i];
+        }
+        const bool padded = (length % 3 != 0);
+        AString caseName = AString::number(length) + " bytes";
+        vector<unsigned char> decoded;
+        bool finished = false, partial = false;
+        for (int64_t pieceSize = 1; pieceSize <= 9; ++pieceSize)
+        {//every alignment of piece boundaries to groups, including boundaries inside the padding and whitespace
+            vector<int64_t> splits;
+            for (int64_t split = pieceSize; split < (int64_t)text.size(); split += pieceSize)
+            {
+                splits.push_back(split);
+            }
+            if (!decodeInPieces(text, splits, decoded, finished, partial))
+            {
+                setFailed(caseName + ": decoder error with pieces of " + AString::number(pieceSize));
+                continue;
+            }
+            if (decoded != data) setFailed(caseName + ": wrong data with pieces of " + AString::number(pieceSize));
+            if (finished != padded) setFailed(caseName + ": finished flag should be " + AString(padded ? "true" : "false"));
+            if (partial) setFailed(caseName + ": partial group left with pieces of " + AString::number(pieceSize));
+        }
+        for (int trial = 0; trial < 20; ++trial)
+        {//random splits, including empty pieces
+            vector<int64_t> splits;
+            int64_t split = 0;
+            while (true)
+            {
+                split += rand() % 11;
+                if (split >= (int64_t)text.size()) break;
+                splits.push_back(split);
+            }
+            if (!decodeInPieces(text, splits, decoded, finished, partial) || decoded != data)
+            {
+                setFailed(caseName + ": wrong result with random pieces");
+                break;
+            }
+        }
+        if (padded)
+        {//text after the padding must be ignored, even if it isn't valid
+            string trailing = text + "$$ more text";
+            if (!decodeInPieces(trailing, vector<int64_t>(1, (int64_t)text.size() - 1), decoded, finished, partial) || decoded != data || !finished)
+            {
+                setFailed(caseName + ": text after padding was not ignored");
+            }
+        }
+    }
+    vector<unsigned char> decoded;
+    bool finished = false, partial = false;
+    if (decodeInPieces("QUJD$EVG", vector<int64_t>(), decoded, finished, partial))
+    {
+        setFailed("invalid character did not set the error flag");
+    } else if (decoded.size() > 3) {
+        setFailed("decoding continued after an invalid character");
+    }
+    if (!decodeInPieces("QUJDRE", vector<int64_t>(), decoded, finished, partial) || !partial || decoded.size() != 3)
+    {
+        setFailed("incomplete group was not kept for more text");
+    }
+}
@@ -0,0 +1,239 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiAverageTest.h"
+
+#include "AlgorithmCiftiAverage.h"
+#include "CaretException.h"
+#include "CiftiFile.h"
+#include "MathFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiAverageTest::CiftiAverageTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int NUM_FILES = 12;
+    const int64_t NUM_ROWS = 300, ROW_SIZE = 1000;//several row blocks, the last one short
+    
+    ///values for the plain average: arbitrary, with some NaNs, and one element that is NaN in every file
+    float averageValue(const int& file, const int64_t& row, const int64_t& col)
+    {
+        if (row == 0 && col == 0) return numeric_limits<float>::quiet_NaN();
+        if ((row * 7 + col * 3 + file) % 29 == 0) return numeric_limits<float>::quiet_NaN();
+        const int64_t hash = (row * 1009 + col * 9176 + file * 7919) % 2003;
+        return hash / 100.0f - 10.0f;
+    }
+    
+    ///values for outlier exclusion, chosen so that no value is near a cutoff:
+    ///pattern 0 has all values within 1 standard deviation of the mean,
+    ///pattern 1 has one large outlier, pattern 2 has only one numeric value
+    float outlierValue(const int& file, const int64_t& row, const int64_t& col)
+    {
+        const float base = (row % 17) * 0.5f + col * 0.01f;
+        switch ((row + col) % 3)
+        {
+            case 0:
+                return base + ((file + row + col) % 2 == 0 ? 1.0f : -1.0f);
+            case 1:
+                return base + (file == (row + col) % NUM_FILES ? 50.0f : 0.0f);
+            default:
+                return (file == 0 ? base : numeric_limits<float>::quiet_NaN());
+        }
+    }
+    
+    ///the row-at-a-time weighted average that -cifti-average used to compute
+    void referenceAverage(const vector<const CiftiFile*>& ciftiList, const vector<float>& weights, vector<float>& dataOut)
+    {
+        vector<float> myrow(ROW_SIZE);
+        dataOut.resize(NUM_ROWS * ROW_SIZE);
+        for (int64_t i = 0; i < NUM_ROWS; ++i)
+        {
+            vector<double> accum(ROW_SIZE, 0.0), weightaccum(ROW_SIZE, 0.0);
+            for (int j = 0; j < (int)ciftiList.size(); ++j)
+            {
+                ciftiList[j]->getRow(myrow.data(), i);
+                for (int64_t k = 0; k < ROW_SIZE; ++k)
+                {
+                    if (MathFunctions::isNumeric(myrow[k]))
+                    {
+                        weightaccum[k] += weights[j];
+                        accum[k] += myrow[k] * weights[j];
+                    }
+                }
+            }
+            for (int64_t k = 0; k < ROW_SIZE; ++k)
+            {
+                dataOut[i * ROW_SIZE + k] = (weightaccum[k] != 0.0 ? accum[k] / weightaccum[k] : 0.0f);
+            }
+        }
+    }
+    
+    ///the two-pass outlier exclusion that -cifti-average -exclude-outliers used to compute
+    void referenceOutlierAverage(const vector<const CiftiFile*>& ciftiList, const vector<float>& weights,
+                                 const float& sigmaBelow, const float& sigmaAbove, vector<float>& dataOut)
+    {
+        const int numFiles = (int)ciftiList.size();
+        vector<vector<float> > myrows(numFiles, vector<float>(ROW_SIZE));
+        dataOut.resize(NUM_ROWS * ROW_SIZE);
+        for (int64_t i = 0; i < NUM_ROWS; ++i)
+        {
+            for (int j = 0; j < numFiles; ++j)
+            {
+                ciftiList[j]->getRow(myrows[j].data(), i);
+            }
+            for (int64_t k = 0; k < ROW_SIZE; ++k)
+            {
+                double accum = 0.0;
+                int nonnumeric = 0;
+                for (int j = 0; j < numFiles; ++j)
+                {
+                    if (MathFunctions::isNumeric(myrows[j][k]))
+                    {
+                        accum += myrows[j][k];
+                    } else {
+                        ++nonnumeric;
+                    }
+                }
+                float& out = dataOut[i * ROW_SIZE + k];
+                out = 0.0f;
+                if (nonnumeric >= numFiles - 1) continue;
+                const float mean = accum / (numFiles - nonnumeric);
+                accum = 0.0;
+                for (int j = 0; j < numFiles; ++j)
+                {
+                    if (MathFunctions::isNumeric(myrows[j][k]))
+                    {
+                        const float temp = myrows[j][k] - mean;
+                        accum += temp * temp;
+                    }
+                }
+                const float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
+                const float cutoffLow = mean - sigmaBelow * stdev, cutoffHigh = mean + sigmaAbove * stdev;
+                accum = 0.0;
+                double weightaccum = 0.0;
+                for (int j = 0; j < numFiles; ++j)
+                {
+                    if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)
+                    {
+                        accum += myrows[j][k] * weights[j];
+                        weightaccum += weights[j];
+                    }
+                }
+                if (weightaccum != 0.0) out = accum / weightaccum;
+            }
+        }
+    }
+    
+    void fillFiles(vector<CiftiFile>& files, float (*valueFunc)(const int&, const int64_t&, const int64_t&))
+    {
+        CiftiXML myXML;
+        myXML.setNumberOfDimensions(2);
+        myXML.setMap(CiftiXML::ALONG_COLUMN, CiftiSeriesMap(NUM_ROWS));
+        myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(ROW_SIZE));
+        vector<float> row(ROW_SIZE);
+        for (int j = 0; j < (int)files.size(); ++j)
+        {
+            files[j].setCiftiXML(myXML);
+            for (int64_t r = 0; r < NUM_ROWS; ++r)
+            {
+                for (int64_t c = 0; c < ROW_SIZE; ++c)
+                {
+                    row[c] = valueFunc(j, r, c);
+                }
+                files[j].setRow(row.data(), r);
+            }
+        }
+    }
+    
+    ///returns the number of elements that differ by more than a relative tolerance
+    int64_t countDifferences(const CiftiFile& outFile, const vector<float>& expected)
+    {
+        int64_t ret = 0;
+        vector<float> row(ROW_SIZE);
+        for (int64_t r = 0; r < NUM_ROWS; ++r)
+        {
+            outFile.getRow(row.data(), r);
+            for (int64_t c = 0; c < ROW_SIZE; ++c)
+            {
+                const float expect = expected[r * ROW_SIZE + c];
+                if (!(abs(row[c] - expect) <= 1e-5f * max(1.0f, abs(expect)))) ++ret;
+            }
+        }
+        return ret;
+    }
+}
+
+void CiftiAverageTest::execute()
+{
+    try
+    {
+        vector<float> weights(NUM_FILES);
+        for (int j = 0; j < NUM_FILES; ++j)
+        {
+            weights[j] = 0.5f + (j % 4);
+        }
+        vector<CiftiFile> files(NUM_FILES);
+        vector<const CiftiFile*> ciftiList(NUM_FILES), repeatedList(NUM_FILES);
+        for (int j = 0; j < NUM_FILES; ++j)
+        {
+            ciftiList[j] = &(files[j]);
+            repeatedList[j] = &(files[j % 2]);//the same file object more than once is read by one thread
+        }
+        vector<float> expected;
+        fillFiles(files, averageValue);
+        for (int weighted = 0; weighted < 2; ++weighted)
+        {
+            const vector<float> useWeights = (weighted ? weights : vector<float>(NUM_FILES, 1.0f));
+            const vector<float>* weightsPtr = (weighted ? &weights : NULL);
+            for (int repeated = 0; repeated < 2; ++repeated)
+            {
+                const vector<const CiftiFile*>& useList = (repeated ? repeatedList : ciftiList);
+                const AString caseName = AString(weighted ? "weighted" : "unweighted") + (repeated ? " repeated file" : "") + " average";
+                referenceAverage(useList, useWeights, expected);
+                CiftiFile outFile;
+                AlgorithmCiftiAverage(NULL, useList, &outFile, weightsPtr);
+                const int64_t numWrong = countDifferences(outFile, expected);
+                if (numWrong != 0) setFailed(caseName + ": " + AString::number(numWrong) + " elements differ from the row-at-a-time average");
+            }
+        }
+        fillFiles(files, outlierValue);
+        for (int weighted = 0; weighted < 2; ++weighted)
+        {
+            const vector<float> useWeights = (weighted ? weights : vector<float>(NUM_FILES, 1.0f));
+            const vector<float>* weightsPtr = (weighted ? &weights : NULL);
+            referenceOutlierAverage(ciftiList, useWeights, 3.5f, 1.0f, expected);
+            CiftiFile outFile;
+            AlgorithmCiftiAverage(NULL, ciftiList, 3.5f, 1.0f, &outFile, weightsPtr);
+            const int64_t numWrong = countDifferences(outFile, expected);
+            if (numWrong != 0) setFailed(AString(weighted ? "weighted" : "unweighted") + " outlier exclusion: " + AString::number(numWrong) + " elements differ from the row-at-a-time result");
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
@@ -0,0 +1,150 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiColumnCacheTest.h"
+
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "CiftiColumnCache.h"
+#include "CiftiFile.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiColumnCacheTest::CiftiColumnCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float testValue(const int64_t& row, const int64_t& col)
+    {
+        return row * 1000.0f + col;//exact in float for these sizes
+    }
+}
+
+void CiftiColumnCacheTest::execute()
+{
+    const int64_t numRows = 101, numCols = 37;//not a multiple of the panel height, so the last panel is short
+    AString fileName = QDir::tempPath() + "/wb_columncache_test.dscalar.nii";
+    QDir cacheDir(QDir::tempPath() + "/wb_columncache_test_dir");
+    QString oldCacheDir = CiftiColumnCache::getCacheDirectory();
+    try
+    {
+        {
+            CiftiXML myXML;
+            myXML.setNumberOfDimensions(2);
+            myXML.setMap(CiftiXML::ALONG_COLUMN, CiftiSeriesMap(numRows));
+            myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(numCols));
+            CiftiFile outFile;
+            outFile.setWritingFile(fileName);
+            outFile.setCiftiXML(myXML);
+            vector<float> row(numCols);
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                for (int64_t c = 0; c < numCols; ++c)
+                {
+                    row[c] = testValue(r, c);
+                }
+                outFile.setRow(row.data(), r);
+            }
+            outFile.writeFile(fileName);
+        }
+        CiftiColumnCache::setCacheDirectory(cacheDir.absolutePath());
+        CiftiColumnCache::setTileRows(16);
+        for (int pass = 0; pass < 3; ++pass)
+        {//pass 0 builds the cache, pass 1 reuses it, pass 2 is over the size limit (but the cache exists, so it is still used)
+            if (pass == 2) CiftiColumnCache::setMaximumBytes(16);
+            CiftiFile inFile;
+            inFile.openFile(fileName);
+            bool threadFailed = false;
+            vector<int> wrongColumns(numCols, 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t c = 0; c < numCols; ++c)
+            {//several threads at once, so some will find the cache being built and read the original file instead
+                try
+                {
+                    vector<float> column(numRows);
+                    inFile.getColumn(column.data(), c);
+                    for (int64_t r = 0; r < numRows; ++r)
+                    {
+                        if (column[r] != testValue(r, c))
+                        {
+                            wrongColumns[c] = 1;
+                            break;
+                        }
+                    }
+                } catch (...) {
+#pragma omp critical
+                    threadFailed = true;
+                }
+            }
+            if (threadFailed) setFailed("pass " + AString::number(pass) + ": exception reading columns");
+            for (int64_t c = 0; c < numCols; ++c)
+            {
+                if (wrongColumns[c] != 0) setFailed("pass " + AString::number(pass) + ": wrong data in column " + AString::number(c));
+            }
+            if (cacheDir.entryList(QStringList() << "*.colcache", QDir::Files).size() != 1)
+            {
+                setFailed("pass " + AString::number(pass) + ": expected one cache file in '" + cacheDir.absolutePath() + "'");
+            }
+        }
+        {//without an existing cache, the size limit prevents building one, and columns still come from the original file
+            QStringList cacheFiles = cacheDir.entryList(QDir::Files);
+            for (int i = 0; i < cacheFiles.size(); ++i)
+            {
+                cacheDir.remove(cacheFiles[i]);
+            }
+            CiftiFile inFile;
+            inFile.openFile(fileName);
+            vector<float> column(numRows);
+            inFile.getColumn(column.data(), numCols - 1);
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                if (column[r] != testValue(r, numCols - 1))
+                {
+                    setFailed("wrong data in column without cache");
+                    break;
+                }
+            }
+            if (!cacheDir.entryList(QStringList() << "*.colcache", QDir::Files).isEmpty())
+            {
+                setFailed("cache was built despite the size limit");
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    CiftiColumnCache::setCacheDirectory(oldCacheDir);
+    CiftiColumnCache::setTileRows(0);
+    CiftiColumnCache::setMaximumBytes(0);
+    QStringList cacheFiles = cacheDir.entryList(QDir::Files);
+    for (int i = 0; i < cacheFiles.size(); ++i)
+    {
+        cacheDir.remove(cacheFiles[i]);
+    }
+    QDir::temp().rmdir("wb_columncache_test_dir");
+    QFile::remove(fileName);
+}
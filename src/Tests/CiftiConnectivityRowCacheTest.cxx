@@ -0,0 +1,118 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiConnectivityRowCacheTest.h"
+
+#include "CaretException.h"
+#include "CiftiConnectivityRowCache.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiConnectivityRowCacheTest::CiftiConnectivityRowCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t ROW_LENGTH = 4;
+    const int64_t ROW_BYTES = ROW_LENGTH * sizeof(float);
+    
+    vector<float> makeRow(const int64_t& rowIndex, const int64_t& length, const float& offset = 0.0f)
+    {
+        vector<float> ret(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            ret[i] = rowIndex * 100.0f + i + offset;
+        }
+        return ret;
+    }
+}
+
+void CiftiConnectivityRowCacheTest::execute()
+{
+    CiftiConnectivityRowCache* myCache = CiftiConnectivityRowCache::get();
+    const int64_t oldBudget = myCache->getMemoryBudget();
+    int ownerA = 0, ownerB = 0;//only the addresses are used
+    try
+    {
+        myCache->clear();
+        myCache->setMemoryBudget(4 * ROW_BYTES);
+        for (int64_t r = 0; r < 4; ++r)
+        {
+            myCache->addRow(&ownerA, r, makeRow(r, ROW_LENGTH).data(), ROW_LENGTH);
+        }
+        if (myCache->getMemoryUsed() != 4 * ROW_BYTES) setFailed("wrong memory used after filling the cache");
+        vector<float> row(ROW_LENGTH);
+        if (!myCache->getRow(&ownerA, 0, row.data(), ROW_LENGTH) || row != makeRow(0, ROW_LENGTH))
+        {
+            setFailed("wrong data for row 0");
+        }
+        myCache->hasRow(&ownerA, 1);//must not make row 1 recently used
+        //use order, most recent first: 0 3 2 1
+        myCache->addRow(&ownerA, 4, makeRow(4, ROW_LENGTH).data(), ROW_LENGTH);
+        if (myCache->hasRow(&ownerA, 1)) setFailed("least recently used row 1 was not evicted");
+        for (int64_t r = 0; r < 5; ++r)
+        {
+            if (r != 1 && !myCache->hasRow(&ownerA, r)) setFailed("row " + AString::number(r) + " was evicted instead of row 1");
+        }
+        if (myCache->getMemoryUsed() != 4 * ROW_BYTES) setFailed("wrong memory used after eviction");
+        //use order: 4 0 3 2, reading row 2 and replacing row 3 make them the most recent: 3 2 4 0
+        if (!myCache->getRow(&ownerA, 2, row.data(), ROW_LENGTH) || row != makeRow(2, ROW_LENGTH))
+        {
+            setFailed("wrong data for row 2");
+        }
+        myCache->addRow(&ownerA, 3, makeRow(3, ROW_LENGTH, 0.5f).data(), ROW_LENGTH);
+        if (myCache->getMemoryUsed() != 4 * ROW_BYTES) setFailed("replacing a row changed the memory used");
+        if (!myCache->getRow(&ownerA, 3, row.data(), ROW_LENGTH) || row != makeRow(3, ROW_LENGTH, 0.5f))
+        {
+            setFailed("row 3 was not replaced");
+        }
+        if (myCache->getRow(&ownerA, 3, row.data(), ROW_LENGTH + 1)) setFailed("row with the wrong length was returned");
+        //a row twice as long evicts the two least recently used rows
+        myCache->addRow(&ownerB, 0, makeRow(7, 2 * ROW_LENGTH).data(), 2 * ROW_LENGTH);
+        if (myCache->hasRow(&ownerA, 0) || myCache->hasRow(&ownerA, 4)) setFailed("rows 0 and 4 were not evicted by a longer row");
+        if (!myCache->hasRow(&ownerA, 2) || !myCache->hasRow(&ownerA, 3) || !myCache->hasRow(&ownerB, 0))
+        {
+            setFailed("recently used rows were evicted by a longer row");
+        }
+        if (myCache->hasRow(&ownerB, 2)) setFailed("rows of different owners are not separate");
+        //a row larger than the budget is not added and evicts nothing
+        myCache->addRow(&ownerB, 1, makeRow(1, 5 * ROW_LENGTH).data(), 5 * ROW_LENGTH);
+        if (myCache->hasRow(&ownerB, 1)) setFailed("row larger than the budget was added");
+        if (myCache->getMemoryUsed() != 4 * ROW_BYTES) setFailed("row larger than the budget evicted rows");
+        myCache->removeRowsForOwner(&ownerA);
+        if (myCache->hasRow(&ownerA, 2) || myCache->hasRow(&ownerA, 3)) setFailed("rows remain after removing their owner");
+        if (!myCache->hasRow(&ownerB, 0)) setFailed("removing an owner removed another owner's row");
+        if (myCache->getMemoryUsed() != 2 * ROW_BYTES) setFailed("wrong memory used after removing an owner");
+        //lowering the budget evicts rows until they fit
+        myCache->addRow(&ownerA, 5, makeRow(5, ROW_LENGTH).data(), ROW_LENGTH);
+        myCache->setMemoryBudget(ROW_BYTES);
+        if (myCache->hasRow(&ownerB, 0) || !myCache->hasRow(&ownerA, 5)) setFailed("lowering the budget did not evict the least recently used row");
+        if (myCache->getMemoryUsed() != ROW_BYTES) setFailed("wrong memory used after lowering the budget");
+        myCache->setMemoryBudget(0);
+        if (myCache->hasRow(&ownerA, 5) || myCache->getMemoryUsed() != 0) setFailed("a zero budget did not empty the cache");
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    myCache->clear();
+    myCache->setMemoryBudget(oldBudget);
+}
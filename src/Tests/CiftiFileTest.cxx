@@ -182,6 +182,8 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
 
     //reopen output file, and check that frames agree
     CiftiFile test(outFile);
+    CiftiFile testMapped;
+    testMapped.openFile(outFile, true);
 
     float *testRow = new float [rowSize];
     for(int64_t i = 0;i<columnSize;i++)
@@ -193,6 +195,18 @@ void CiftiFileTest::testCiftiReadWriteOnDisk()
             this->setFailed("Input and output Cifti file rows are not the same.");
             return;
         }
+        testMapped.getRow(testRow,i);
+        if(memcmp((void *)row,(void *)testRow,rowSize*sizeof(float)))
+        {
+            this->setFailed("Memory mapped Cifti file rows are not the same.");
+            return;
+        }
+        const float* rowPointer = testMapped.getRowPointer(i);//we wrote native endian float32, so this should always work if mapping does
+        if(rowPointer != NULL && memcmp((const void *)row,(const void *)rowPointer,rowSize*sizeof(float)))
+        {
+            this->setFailed("Memory mapped Cifti file row pointers do not match the rows.");
+            return;
+        }
     }
     std::cout << "Reading and writing of Cifti was successful for all frames." << std::endl;
     delete [] row;
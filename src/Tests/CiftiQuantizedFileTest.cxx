@@ -0,0 +1,174 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiQuantizedFileTest.h"
+
+#include "CaretException.h"
+#include "CiftiQuantizedFile.h"
+#include "Float16Helper.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiQuantizedFileTest::CiftiQuantizedFileTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t ROW_LENGTH = 37;//2 blocks of 16 int8 codes or 4 blocks of 8 int16 codes, plus a remainder of 5 that the scalar loop decodes
+    const int64_t NUM_ROWS = 6;
+    const int64_t SKIPPED_ROW = 4;//not written, so it should read as zeros
+    
+    vector<vector<float> > makeRows()
+    {
+        const float inf = numeric_limits<float>::infinity(), nan = numeric_limits<float>::quiet_NaN();
+        vector<vector<float> > ret(NUM_ROWS, vector<float>(ROW_LENGTH, 0.0f));
+        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+        {
+            ret[0][i] = ((float)rand()) / RAND_MAX * 8.0f - 3.0f;
+            ret[1][i] = ((float)rand()) / RAND_MAX * 2.0f - 1.0f;
+            ret[2][i] = 2.5f;
+            ret[3][i] = nan;
+            ret[5][i] = ((float)rand()) / RAND_MAX * 20000.0f + 10000.0f;
+        }
+        ret[1][3] = nan;//NaN, infinities, and the extremes in both the SIMD part and the remainder
+        ret[1][10] = inf;
+        ret[1][17] = -5.0f;
+        ret[1][33] = 4.0f;
+        ret[1][35] = nan;
+        ret[1][36] = -inf;
+        ret[2][6] = -inf;//a constant row has zero scale, so infinities can't go through the scaling
+        ret[2][34] = inf;
+        ret[3][0] = inf;//no finite values at all
+        ret[3][36] = -inf;
+        return ret;
+    }
+    
+    bool sameFloat(const float& a, const float& b)
+    {
+        if (a != a) return (b != b);
+        return a == b;
+    }
+    
+    //the largest error allowed for quantizing a row to codes in [-maxCode, maxCode], infinities decode to the finite extremes
+    bool checkQuantizedRow(const vector<float>& original, const float* decoded, const int32_t& maxCode)
+    {
+        bool haveFinite = false;
+        float minVal = 0.0f, maxVal = 0.0f;
+        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+        {
+            float value = original[i];
+            if (value != value || value == numeric_limits<float>::infinity() || value == -numeric_limits<float>::infinity()) continue;
+            if (!haveFinite || value < minVal) minVal = value;
+            if (!haveFinite || value > maxVal) maxVal = value;
+            haveFinite = true;
+        }
+        double tolerance = (maxVal - (double)minVal) / (2.0 * maxCode) * 0.501 + max(abs(minVal), abs(maxVal)) * 1e-6;
+        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+        {
+            double expected = original[i];
+            if (expected != expected)
+            {
+                if (decoded[i] == decoded[i]) return false;
+                continue;
+            }
+            if (expected == numeric_limits<float>::infinity()) expected = maxVal;
+            if (expected == -numeric_limits<float>::infinity()) expected = minVal;
+            if (!(abs(decoded[i] - expected) <= tolerance)) return false;
+        }
+        return true;
+    }
+}
+
+void CiftiQuantizedFileTest::execute()
+{
+    AString fileName = QDir::tempPath() + "/wb_quantized_test.wbquant";
+    vector<vector<float> > rows = makeRows();
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, CiftiSeriesMap(NUM_ROWS));
+    myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(ROW_LENGTH));
+    const CiftiQuantizedFile::Encoding encodings[3] = { CiftiQuantizedFile::INT8, CiftiQuantizedFile::INT16, CiftiQuantizedFile::FLOAT16 };
+    const AString encodingNames[3] = { "INT8", "INT16", "FLOAT16" };
+    try
+    {
+        for (int whichEncoding = 0; whichEncoding < 3; ++whichEncoding)
+        {
+            for (int compress = 0; compress < 2; ++compress)
+            {
+                const AString testName = encodingNames[whichEncoding] + (compress ? " compressed" : "");
+                {
+                    CiftiQuantizedFileWriter myWriter(fileName, myXML, encodings[whichEncoding], compress != 0);
+                    for (int64_t r = 0; r < NUM_ROWS; ++r)
+                    {
+                        if (r != SKIPPED_ROW) myWriter.writeRow(rows[r].data(), r);
+                    }
+                    myWriter.finish();
+                }
+                CiftiQuantizedFile myFile(fileName);
+                if (myFile.getRowLength() != ROW_LENGTH || myFile.getNumberOfRows() != NUM_ROWS || myFile.getEncoding() != encodings[whichEncoding] || myFile.isCompressed() != (compress != 0))
+                {
+                    setFailed(testName + ": wrong header values read");
+                    continue;
+                }
+                vector<float> decoded(ROW_LENGTH);
+                for (int64_t r = 0; r < NUM_ROWS; ++r)
+                {
+                    myFile.getRow(decoded.data(), r);
+                    bool good = true;
+                    if (r == SKIPPED_ROW || r == 2)
+                    {//zeros and constants are exact with every encoding, and infinities in a constant row become the constant
+                        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+                        {
+                            float expected = (r == SKIPPED_ROW ? 0.0f : 2.5f);
+                            if (encodings[whichEncoding] == CiftiQuantizedFile::FLOAT16) expected = Float16Helper::fromFloat16(Float16Helper::toFloat16(rows[r][i]));
+                            if (!sameFloat(decoded[i], expected)) good = false;
+                        }
+                    } else if (encodings[whichEncoding] == CiftiQuantizedFile::FLOAT16) {
+                        for (int64_t i = 0; i < ROW_LENGTH; ++i)
+                        {
+                            if (!sameFloat(decoded[i], Float16Helper::fromFloat16(Float16Helper::toFloat16(rows[r][i])))) good = false;
+                        }
+                    } else {
+                        good = checkQuantizedRow(rows[r], decoded.data(), (encodings[whichEncoding] == CiftiQuantizedFile::INT8 ? 127 : 32767));
+                    }
+                    if (!good) setFailed(testName + ": wrong values decoded in row " + AString::number(r));
+                }
+            }
+        }
+        {//a writer destroyed without finish() must not leave an unreadable file
+            CiftiQuantizedFileWriter myWriter(fileName, myXML, CiftiQuantizedFile::INT16, false);
+            myWriter.writeRow(rows[0].data(), 0);
+        }
+        if (QFile::exists(fileName)) setFailed("unfinished quantized file was not removed");
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    QFile::remove(fileName);
+}
@@ -0,0 +1,189 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "DenseDynamicTest.h"
+
+#include "CaretException.h"
+#include "CiftiBrainordinateDataSeriesFile.h"
+#include "CiftiConnectivityMatrixDenseDynamicFile.h"
+#include "CiftiFile.h"
+#include "StructureEnum.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+DenseDynamicTest::DenseDynamicTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int64_t NUM_NODES = 3000;//several tiles of rows for the dot products
+    const int64_t NUM_TIMEPOINTS = 23;//not a multiple of 4, so the normalized rows are padded
+    const int64_t CONSTANT_ROW = 7;
+    
+    vector<vector<float> > makeSeries()
+    {
+        vector<vector<float> > ret(NUM_NODES, vector<float>(NUM_TIMEPOINTS));
+        for (int64_t r = 0; r < NUM_NODES; ++r)
+        {
+            const float baseline = (r % 5 == 0 ? 1000.0f : 0.0f);//a mean far from zero shouldn't cost precision
+            for (int64_t t = 0; t < NUM_TIMEPOINTS; ++t)
+            {
+                ret[r][t] = baseline + sin(0.37f * t * (r % 17 + 1)) + ((float)rand()) / RAND_MAX;
+            }
+        }
+        for (int64_t t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            ret[CONSTANT_ROW][t] = 5.0f;
+        }
+        return ret;
+    }
+    
+    //two-pass Pearson correlation in double, zero when either input has no variance
+    double pearson(const vector<float>& a, const vector<float>& b)
+    {
+        double meanA = 0.0, meanB = 0.0;
+        for (int64_t t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            meanA += a[t];
+            meanB += b[t];
+        }
+        meanA /= NUM_TIMEPOINTS;
+        meanB /= NUM_TIMEPOINTS;
+        double ssab = 0.0, ssaa = 0.0, ssbb = 0.0;
+        for (int64_t t = 0; t < NUM_TIMEPOINTS; ++t)
+        {
+            double diffA = a[t] - meanA, diffB = b[t] - meanB;
+            ssab += diffA * diffB;
+            ssaa += diffA * diffA;
+            ssbb += diffB * diffB;
+        }
+        if (ssaa <= 0.0 || ssbb <= 0.0) return 0.0;
+        return ssab / sqrt(ssaa * ssbb);
+    }
+}
+
+void DenseDynamicTest::execute()
+{
+    AString fileName = QDir::tempPath() + "/wb_densedynamic_test.dtseries.nii";
+    const int64_t oldMinimumBytes = CiftiConnectivityMatrixDenseDynamicFile::getFloat16StorageMinimumBytes();
+    vector<vector<float> > series = makeSeries();
+    try
+    {
+        {
+            CiftiBrainModelsMap myDenseMap;
+            myDenseMap.addSurfaceModel(NUM_NODES, StructureEnum::CORTEX_LEFT);
+            CiftiXML myXML;
+            myXML.setNumberOfDimensions(2);
+            myXML.setMap(CiftiXML::ALONG_COLUMN, myDenseMap);
+            myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(NUM_TIMEPOINTS));
+            CiftiFile outFile;
+            outFile.setWritingFile(fileName);
+            outFile.setCiftiXML(myXML);
+            for (int64_t r = 0; r < NUM_NODES; ++r)
+            {
+                outFile.setRow(series[r].data(), r);
+            }
+            outFile.writeFile(fileName);
+        }
+        vector<int32_t> averageNodes;
+        averageNodes.push_back(3);
+        averageNodes.push_back(10);
+        averageNodes.push_back(2000);
+        vector<float> averageSeries(NUM_TIMEPOINTS);
+        for (int64_t t = 0; t < NUM_TIMEPOINTS; ++t)
+        {//the same float average the file computes before correlating
+            double sum = 0.0;
+            for (int i = 0; i < (int)averageNodes.size(); ++i)
+            {
+                sum += series[averageNodes[i]][t];
+            }
+            averageSeries[t] = sum / (float)averageNodes.size();
+        }
+        vector<int64_t> testRows;
+        testRows.push_back(0);
+        testRows.push_back(CONSTANT_ROW);
+        testRows.push_back(NUM_NODES / 2);
+        testRows.push_back(NUM_NODES - 1);
+        vector<vector<float> > floatResults;
+        for (int pass = 0; pass < 2; ++pass)
+        {//pass 0 stores the normalized rows as float, pass 1 as float16
+            const AString passName = (pass == 0 ? "float" : "float16");
+            const double tolerance = (pass == 0 ? 1e-6 : 1e-3);//float16 keeps about 3 significant digits of each normalized value
+            CiftiConnectivityMatrixDenseDynamicFile::setFloat16StorageMinimumBytes(pass == 0 ? CiftiConnectivityMatrixDenseDynamicFile::DEFAULT_FLOAT16_STORAGE_MINIMUM_BYTES : 0);
+            CiftiBrainordinateDataSeriesFile seriesFile;
+            seriesFile.readFile(fileName);
+            CiftiConnectivityMatrixDenseDynamicFile* dynamicFile = seriesFile.getConnectivityMatrixDenseDynamicFile();
+            if (dynamicFile == NULL || !dynamicFile->isDataValid())
+            {
+                setFailed(passName + ": dense dynamic file is not valid");
+                continue;
+            }
+            vector<vector<float> > results;
+            for (int i = 0; i < (int)testRows.size(); ++i)
+            {
+                dynamicFile->loadDataForRowIndex(testRows[i]);
+                results.push_back(vector<float>());
+                dynamicFile->getMapData(0, results.back());
+            }
+            dynamicFile->loadMapAverageDataForSurfaceNodes(0, NUM_NODES, StructureEnum::CORTEX_LEFT, averageNodes);
+            results.push_back(vector<float>());
+            dynamicFile->getMapData(0, results.back());
+            for (int i = 0; i < (int)results.size(); ++i)
+            {
+                const bool isAverage = (i == (int)testRows.size());
+                const AString testName = passName + (isAverage ? AString(": average of nodes") : ": row " + AString::number(testRows[i]));
+                if ((int64_t)results[i].size() != NUM_NODES)
+                {
+                    setFailed(testName + ": wrong number of correlations");
+                    continue;
+                }
+                const vector<float>& seed = (isAverage ? averageSeries : series[testRows[i]]);
+                for (int64_t r = 0; r < NUM_NODES; ++r)
+                {
+                    double expected = pearson(seed, series[r]);
+                    if (!isAverage && r == testRows[i]) expected = 1.0;//a row is correlated with itself even if it has no variance
+                    if (!(abs(results[i][r] - expected) <= tolerance))
+                    {
+                        setFailed(testName + ": correlation with row " + AString::number(r) + " is " + AString::number(results[i][r]) + ", expected " + AString::number(expected));
+                        break;
+                    }
+                }
+            }
+            if (pass == 0)
+            {
+                floatResults = results;
+            } else if (results == floatResults) {
+                setFailed("float16 storage gave exactly the float results, so it was probably not used");
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    CiftiConnectivityMatrixDenseDynamicFile::setFloat16StorageMinimumBytes(oldMinimumBytes);
+    QFile::remove(fileName);
+}
@@ -20,6 +20,7 @@
 #include "DotTest.h"
 
 #include "CaretAssert.h"
+#include "DotMatrixHelper.h"
 #include "dot_wrapper.h"
 
 #include <cmath>
@@ -169,4 +170,27 @@ void DotTest::execute()
     } else {
         cout << "skipping AVXFMA, not supported" << endl;
     }
+    //blocked dot, compare to naive, use odd sizes to exercise the remainder code
+    dot_set_impl(DOT_NAIVE);
+    const int NUM_BLOCK_ROWS = 7, BLOCK_LENGTH = 1001;
+    vector<vector<float> > blockRowsA(NUM_BLOCK_ROWS), blockRowsB(NUM_BLOCK_ROWS);
+    vector<const float*> blockPtrsA(NUM_BLOCK_ROWS), blockPtrsB(NUM_BLOCK_ROWS);
+    for (int i = 0; i < NUM_BLOCK_ROWS; ++i)
+    {
+        blockRowsA[i] = vectorAdd(randVector01(BLOCK_LENGTH), -0.5f);
+        blockRowsB[i] = vectorAdd(randVector01(BLOCK_LENGTH), -0.5f);
+        blockPtrsA[i] = blockRowsA[i].data();
+        blockPtrsB[i] = blockRowsB[i].data();
+    }
+    vector<double> blockOut(NUM_BLOCK_ROWS * NUM_BLOCK_ROWS);
+    DotMatrixHelper::rowBlockDot(blockPtrsA.data(), NUM_BLOCK_ROWS, blockPtrsB.data(), NUM_BLOCK_ROWS, BLOCK_LENGTH, blockOut.data(), NUM_BLOCK_ROWS);
+    for (int i = 0; i < NUM_BLOCK_ROWS; ++i)
+    {
+        for (int j = 0; j < NUM_BLOCK_ROWS; ++j)
+        {
+            double norm = sqrt(sddot(blockPtrsA[i], blockPtrsA[i], BLOCK_LENGTH) * sddot(blockPtrsB[j], blockPtrsB[j], BLOCK_LENGTH));//normalize, so near-zero results don't need an absolute tolerance
+            checkVal(sddot(blockPtrsA[i], blockPtrsB[j], BLOCK_LENGTH) / norm, blockOut[i * NUM_BLOCK_ROWS + j] / norm,
+                     "block dot element " + AString::number(i) + ", " + AString::number(j));
+        }
+    }
 }
@@ -0,0 +1,121 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GzipTest.h"
+
+#include "CaretBinaryFile.h"
+#include "CaretException.h"
+#include "GzipIndexedReader.h"
+
+#include <QDir>
+#include <QFile>
+
+#include "zlib.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+GzipTest::GzipTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void GzipTest::execute()
+{
+#ifdef CARET_GZIP_INDEXED_READER
+    const int64_t dataSize = 6 << 20;//several checkpoint spans
+    AString fileName = QDir::tempPath() + "/wb_gzip_test.nii.gz";
+    vector<unsigned char> data(dataSize);
+    for (int64_t i = 0; i < dataSize; ++i)
+    {
+        data[i] = (unsigned char)((i / 7) % 251 + (rand() % 4));//compressible, but not trivially
+    }
+    {//two gzip members, like concatenated .gz files
+        gzFile myFile = gzopen(fileName.toLocal8Bit().constData(), "wb");
+        if (myFile == NULL)
+        {
+            setFailed("failed to create test file");
+            return;
+        }
+        gzwrite(myFile, data.data(), dataSize / 3);
+        gzclose(myFile);
+        myFile = gzopen(fileName.toLocal8Bit().constData(), "ab");
+        gzwrite(myFile, data.data() + dataSize / 3, dataSize - dataSize / 3);
+        gzclose(myFile);
+    }
+    bool oldUseSidecar = GzipIndexedReader::getUseSidecarFiles();
+    try
+    {
+        for (int pass = 0; pass < 3; ++pass)
+        {//pass 1 writes the sidecar index when closing, pass 2 reads it
+            GzipIndexedReader::setUseSidecarFiles(pass > 0);
+            CaretBinaryFile myFile(fileName, CaretBinaryFile::READ);
+            vector<unsigned char> buffer(1 << 20);
+            int64_t numRead = 0;
+            myFile.read(buffer.data(), 1000, &numRead);
+            if (numRead != 1000 || memcmp(buffer.data(), data.data(), 1000) != 0)
+            {
+                setFailed("pass " + AString::number(pass) + ": wrong data at start of file");
+            }
+            for (int i = 0; i < 200; ++i)
+            {//random seeks, both directions, some reading across the member boundary
+                int64_t position = ((int64_t)rand() * 4096 + rand()) % dataSize;
+                int64_t count = rand() % (int64_t)buffer.size();
+                if (i % 10 == 0) position = max((int64_t)0, dataSize / 3 - count / 2);
+                myFile.seek(position);
+                myFile.read(buffer.data(), count, &numRead);
+                int64_t expected = min(count, dataSize - position);
+                if (numRead != expected || memcmp(buffer.data(), data.data() + position, numRead) != 0)
+                {
+                    setFailed("pass " + AString::number(pass) + ": wrong data reading " + AString::number(count) + " bytes at " + AString::number(position));
+                    break;
+                }
+                if (myFile.pos() != position + numRead)
+                {
+                    setFailed("pass " + AString::number(pass) + ": wrong position after read");
+                    break;
+                }
+            }
+            myFile.seek(dataSize - 10);
+            myFile.read(buffer.data(), 100, &numRead);
+            if (numRead != 10 || memcmp(buffer.data(), data.data() + dataSize - 10, 10) != 0)
+            {
+                setFailed("pass " + AString::number(pass) + ": wrong data at end of file");
+            }
+            if (myFile.size() != dataSize)
+            {
+                setFailed("pass " + AString::number(pass) + ": wrong size after reaching end, got " + AString::number(myFile.size()));
+            }
+            myFile.close();
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    GzipIndexedReader::setUseSidecarFiles(oldUseSidecar);
+    QFile::remove(fileName);
+    QFile::remove(fileName + ".gzidx");
+#else //CARET_GZIP_INDEXED_READER
+    cout << "skipping indexed gzip reader, zlib is older than 1.2.8" << endl;
+#endif //CARET_GZIP_INDEXED_READER
+}
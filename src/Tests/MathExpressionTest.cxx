@@ -55,4 +55,30 @@ void MathExpressionTest::execute()
     {
         setFailed("output value incorrect, expected " + AString::number(correctresult) + ", got " + AString::number(testresult));
     }
+    CaretMathExpression manyExpr("(x + y) * (x + y) - max(x, 2 * 3) + (x >= y) - mod(y, 0.7)");//repeated subexpression and constant folding in the compiled program
+    const int NUM_VALUES = 1000;
+    vector<AString> manyNames = manyExpr.getVarNames();
+    if (manyNames.size() != 2) setFailed("incorrect number of variables found");
+    vector<vector<float> > manyInputs(2, vector<float>(NUM_VALUES));
+    for (int i = 0; i < NUM_VALUES; ++i)
+    {
+        manyInputs[0][i] = sin(i * 0.37f) * 10.0f;
+        manyInputs[1][i] = ((i % 10 == 0) ? manyInputs[0][i] : cos(i * 0.11f) * 10.0f);//exercise the >= fudge factor
+    }
+    vector<const float*> manyPointers(2);
+    manyPointers[0] = manyInputs[0].data();
+    manyPointers[1] = manyInputs[1].data();
+    vector<float> manyOut(NUM_VALUES);
+    manyExpr.evaluateMany(manyPointers, manyOut.data(), NUM_VALUES);
+    for (int i = 0; i < NUM_VALUES; ++i)
+    {
+        vars[0] = manyInputs[0][i];
+        vars[1] = manyInputs[1][i];
+        float expected = (float)manyExpr.evaluate(vars);
+        if (manyOut[i] != expected)
+        {
+            setFailed("evaluateMany result differs from evaluate at index " + AString::number(i) + ", expected " + AString::number(expected) + ", got " + AString::number(manyOut[i]));
+            break;
+        }
+    }
 }
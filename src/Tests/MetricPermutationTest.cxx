@@ -0,0 +1,127 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "MetricPermutationTest.h"
+
+#include "AlgorithmMetricPermutation.h"
+#include "CaretException.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "TestSurfaces.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+MetricPermutationTest::MetricPermutationTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    bool closeTo(const double& found, const double& expected, const double& relTolerance)
+    {
+        return abs(found - expected) <= relTolerance * max(1.0, abs(expected));
+    }
+}
+
+void MetricPermutationTest::execute()
+{
+    SurfaceFile mySurf;
+    TestSurfaces::makeIcosphere(mySurf, 3);
+    const int numNodes = mySurf.getNumberOfNodes();
+    const int numSubjects = 20, numPermutations = 200;
+    //every subject has the same large value in a cap of the sphere, plus -1, 0 or 1, and zero elsewhere:
+    //the t-statistic is the same at every cap vertex, zero elsewhere, and flipping any sign makes it far smaller,
+    //so the unpermuted data (and the flip of every sign, which has 2^-19 chance per permutation) is the only maximum
+    const float offset = 10000000.0f;//a mean far from zero, so a one-pass variance would lose most of its digits
+    vector<float> areas;
+    mySurf.computeNodeAreas(areas);
+    vector<bool> inCap(numNodes);
+    double capArea = 0.0;
+    for (int i = 0; i < numNodes; ++i)
+    {
+        inCap[i] = (mySurf.getCoordinate(i)[2] > 80.0f);
+        if (inCap[i]) capArea += areas[i];
+    }
+    MetricFile myMetric, negMetric;
+    myMetric.setNumberOfNodesAndColumns(numNodes, numSubjects);
+    negMetric.setNumberOfNodesAndColumns(numNodes, numSubjects);
+    double mean = 0.0, sumSquares = 0.0;
+    for (int s = 0; s < numSubjects; ++s)
+    {
+        const float value = offset + (s % 3 - 1);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            myMetric.setValue(i, s, (inCap[i] ? value : 0.0f));
+            negMetric.setValue(i, s, (inCap[i] ? -value : 0.0f));
+        }
+        mean += value;
+    }
+    mean /= numSubjects;
+    for (int s = 0; s < numSubjects; ++s)
+    {
+        const double diff = offset + (s % 3 - 1) - mean;
+        sumSquares += diff * diff;
+    }
+    const double tStat = mean / sqrt(sumSquares / (numSubjects - 1) / numSubjects);
+    const double expectedTfce = capArea * tStat * tStat * tStat / 3.0;//the cluster doesn't change below the peak, so the integral of area * h^2 is area * t^3 / 3
+    try
+    {
+        for (int test = 0; test < 3; ++test)
+        {
+            const bool useTfce = (test == 0), negated = (test == 2);
+            const AString caseName = (useTfce ? "TFCE" : (negated ? "negated cluster extent" : "cluster extent"));
+            const double expectedStat = (useTfce ? expectedTfce : capArea) * (negated ? -1.0 : 1.0);
+            MetricFile pValues, statOut;
+            vector<float> nullDist;
+            AlgorithmMetricPermutation(NULL, &mySurf, (negated ? &negMetric : &myMetric), numPermutations, &pValues, &statOut, &nullDist,
+                                       NULL, NULL, (useTfce ? -1.0f : 100.0f));
+            const float* pData = pValues.getValuePointerForColumn(0);
+            const float* statData = statOut.getValuePointerForColumn(0);
+            int numWrongP = 0, numWrongStat = 0;
+            for (int i = 0; i < numNodes; ++i)
+            {
+                if (pData[i] != (inCap[i] ? 1.0f / numPermutations : 1.0f)) ++numWrongP;
+                if (!closeTo(statData[i], (inCap[i] ? expectedStat : 0.0), 1e-4)) ++numWrongStat;
+            }
+            if (numWrongP != 0) setFailed(caseName + ": " + AString::number(numWrongP) + " vertices have the wrong p-value");
+            if (numWrongStat != 0) setFailed(caseName + ": " + AString::number(numWrongStat) + " vertices have the wrong statistic");
+            if ((int)nullDist.size() != numPermutations)
+            {
+                setFailed(caseName + ": null distribution has the wrong length");
+                continue;
+            }
+            if (!closeTo(nullDist[0], abs(expectedStat), 1e-4)) setFailed(caseName + ": first permutation is not the unpermuted maximum");
+            for (int p = 1; p < numPermutations; ++p)
+            {
+                if (!(nullDist[p] < nullDist[0]))
+                {
+                    setFailed(caseName + ": permutation " + AString::number(p) + " reached the unpermuted maximum");
+                    break;
+                }
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
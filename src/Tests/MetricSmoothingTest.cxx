@@ -0,0 +1,138 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "MetricSmoothingTest.h"
+
+#include "AlgorithmMetricSmoothing.h"
+#include "CaretException.h"
+#include "EventListenerInterface.h"
+#include "EventManager.h"
+#include "EventProgressUpdate.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "ProgressObject.h"
+#include "SurfaceFile.h"
+#include "TestSurfaces.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+MetricSmoothingTest::MetricSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    ///records the progress reported while smoothing columns
+    class SmoothingProgressListener : public EventListenerInterface
+    {
+        ProgressObject* m_progress;
+    public:
+        vector<float> m_columnProgress;
+        SmoothingProgressListener(ProgressObject* progress)
+        {
+            m_progress = progress;
+            EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_PROGRESS_UPDATE);
+        }
+        ~SmoothingProgressListener()
+        {
+            EventManager::get()->removeAllEventsFromListener(this);
+        }
+        void receiveEvent(Event* event)
+        {
+            EventProgressUpdate* progressEvent = dynamic_cast<EventProgressUpdate*>(event);
+            if (progressEvent != NULL && progressEvent->m_whichObject == m_progress && progressEvent->m_amountUpdate &&
+                m_progress->getTaskDescription().startsWith("Smoothing Columns"))
+            {
+                m_columnProgress.push_back(m_progress->getCurrentProgressFraction());
+            }
+        }
+    };
+}
+
+void MetricSmoothingTest::execute()
+{
+    SurfaceFile mySurf;
+    TestSurfaces::makeIcosphere(mySurf, 4);//2562 vertices
+    const int32_t numNodes = mySurf.getNumberOfNodes();
+    const int32_t columnsPerPass = MetricSmoothingObject::getColumnsPerPass();
+    const int32_t numCols = columnsPerPass * 2 + 3;//partial last pass
+    const int32_t numPasses = (numCols + columnsPerPass - 1) / columnsPerPass;
+    MetricFile myMetric, myRoi, myOut;
+    myMetric.setNumberOfNodesAndColumns(numNodes, numCols);
+    myRoi.setNumberOfNodesAndColumns(numNodes, 1);
+    for (int32_t col = 0; col < numCols; ++col)
+    {
+        vector<float> values(numNodes);
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            values[i] = ((float)rand()) / RAND_MAX;
+        }
+        myMetric.setValuesForColumn(col, values.data());
+    }
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        myRoi.setValue(i, 0, (i % 5 == 0) ? 0.0f : 1.0f);
+    }
+    try
+    {
+        ProgressObject myProgress(AlgorithmMetricSmoothing::getAlgorithmWeight());
+        {
+            SmoothingProgressListener myListener(&myProgress);
+            AlgorithmMetricSmoothing(&myProgress, &mySurf, &myMetric, 8.0, &myOut, &myRoi);
+            if ((int32_t)myListener.m_columnProgress.size() != numPasses)
+            {
+                setFailed("expected " + AString::number(numPasses) + " progress updates while smoothing columns, got " + AString::number(myListener.m_columnProgress.size()));
+            }
+            for (int i = 1; i < (int)myListener.m_columnProgress.size(); ++i)
+            {
+                if (!(myListener.m_columnProgress[i] > myListener.m_columnProgress[i - 1]))
+                {
+                    setFailed("progress did not increase between smoothing passes");
+                }
+            }
+        }
+        if (myProgress.getCurrentProgressFraction() != 1.0f)
+        {
+            setFailed("progress did not finish");
+        }
+        //smoothing several columns per pass should give exactly the same answer as each column separately
+        MetricSmoothingObject mySmoothObj(&mySurf, 8.0f, &myRoi);
+        MetricFile columnOut;
+        for (int32_t col = 0; col < numCols; ++col)
+        {
+            mySmoothObj.smoothColumn(&myMetric, col, &columnOut, &myRoi);//how the algorithm smoothed each column before
+            const float* expected = columnOut.getValuePointerForColumn(0);
+            const float* found = myOut.getValuePointerForColumn(col);
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                if (found[i] != expected[i])
+                {
+                    setFailed("column " + AString::number(col) + " differs from smoothing it separately at vertex " + AString::number(i));
+                    break;
+                }
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
@@ -20,9 +20,14 @@
 
 #include "NiftiTest.h"
 
+#include "CaretOMP.h"
+#include "ElapsedTimer.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QDir>
+#include <QFile>
+
 #include <vector>
 
 using namespace std;
@@ -159,3 +164,91 @@ void NiftiHeaderTest::writeNifti2Header(AString filename, NiftiHeader &header)
     myFile.open(filename, CaretBinaryFile::WRITE_TRUNCATE);
     header.write(myFile, 2);
 }
+
+//benchmark for concurrent row reads, also checks that threaded reads get the right data
+
+NiftiReadThreadsTest::NiftiReadThreadsTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void NiftiReadThreadsTest::execute()
+{
+    const int64_t rowLength = 1200, numRows = 8192;//about 40MB, similar to a row chunk of a large dtseries
+    AString fileName = QDir::tempPath() + "/wb_niftireadthreads_test.nii";
+    vector<int64_t> dims(3);
+    dims[0] = rowLength;
+    dims[1] = numRows;
+    dims[2] = 1;
+    vector<float> data(rowLength * numRows);
+    for (int64_t i = 0; i < (int64_t)data.size(); ++i)
+    {
+        data[i] = (float)(i % 9973) - 4986.0f;
+    }
+    try
+    {
+        {
+            NiftiHeader header;
+            header.setDimensions(dims);
+            header.setDataType(NIFTI_TYPE_FLOAT32);
+            NiftiIO writer;
+            writer.writeNew(fileName, header);
+            writer.writeData(data.data(), 3, vector<int64_t>());
+            writer.close();
+        }
+        for (int mapped = 0; mapped < 2; ++mapped)
+        {
+            NiftiIO reader;
+            reader.openRead(fileName, mapped != 0);
+            vector<float> result(data.size());
+            ElapsedTimer myTimer;
+            myTimer.start();
+            for (int64_t row = 0; row < numRows; ++row)
+            {
+                vector<int64_t> indexSelect(1, row);
+                indexSelect.push_back(0);
+                reader.readData(result.data() + row * rowLength, 1, indexSelect);
+            }
+            double serialTime = myTimer.getElapsedTimeSeconds();
+            if (result != data)
+            {
+                setFailed("serial row reads returned wrong data");
+                break;
+            }
+            result.assign(result.size(), 0.0f);
+            int numThreads = 1;
+            bool threadFailed = false;
+            myTimer.start();
+#pragma omp CARET_PAR
+            {
+#ifdef CARET_OMP
+#pragma omp master
+                numThreads = omp_get_num_threads();
+#endif
+#pragma omp CARET_FOR schedule(dynamic, 16)
+                for (int64_t row = 0; row < numRows; ++row)
+                {
+                    try
+                    {
+                        vector<int64_t> indexSelect(1, row);
+                        indexSelect.push_back(0);
+                        reader.readData(result.data() + row * rowLength, 1, indexSelect);
+                    } catch (...) {
+#pragma omp critical
+                        threadFailed = true;
+                    }
+                }
+            }
+            double parallelTime = myTimer.getElapsedTimeSeconds();
+            if (threadFailed || result != data)
+            {
+                setFailed("threaded row reads returned wrong data");
+                break;
+            }
+            cout << (mapped ? "mapped" : "unmapped") << " reads of " << numRows << " rows: serial " << serialTime << "s, " << numThreads << " threads "
+                 << parallelTime << "s, speedup " << (parallelTime > 0.0 ? serialTime / parallelTime : 0.0) << endl;
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    QFile::remove(fileName);
+}
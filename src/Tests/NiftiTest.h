@@ -44,6 +44,13 @@ public:
     void writeNifti2Header(AString filename, NiftiHeader &header);
 };
 
+class NiftiReadThreadsTest : public TestInterface
+{
+public:
+    NiftiReadThreadsTest(const AString& identifier);
+    virtual void execute();
+};
+
 
 }
 
@@ -0,0 +1,103 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteLookupTableTest.h"
+
+#include "CaretException.h"
+#include "Palette.h"
+#include "PaletteFile.h"
+#include "PaletteLookupTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+PaletteLookupTableTest::PaletteLookupTableTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void PaletteLookupTableTest::execute()
+{
+    const int RESOLUTION = PaletteLookupTable::RESOLUTION;
+    const int NUM_SWEEP = 30001;
+    const float extraValues[4] = { 1.0f, -1.0f, 1.0e6f, -1.0e6f };//exact ends of the range, and values far outside that get clamped
+    try
+    {
+        PaletteFile paletteFile;//contains the default palettes
+        const int32_t numPalettes = paletteFile.getNumberOfPalettes();
+        if (numPalettes == 0) setFailed("palette file has no default palettes");
+        for (int32_t p = 0; p < numPalettes; ++p)
+        {
+            const Palette* myPalette = paletteFile.getPalette(p);
+            for (int interp = 0; interp < 2; ++interp)
+            {
+                CaretPointer<const PaletteLookupTable> myTable = myPalette->getLookupTable(interp != 0);
+                const uint8_t* byteTable = myTable->getByteTable();
+                int colorFailures = 0, indexFailures = 0, maxDiff = 0;
+                for (int i = 0; i < NUM_SWEEP + 4; ++i)
+                {//sweep past both ends of the range, so clamping is tested
+                    float value = (i < NUM_SWEEP ? -1.5f + 3.0f * i / (NUM_SWEEP - 1) : extraValues[i - NUM_SWEEP]);
+                    float clamped = min(1.0f, max(-1.0f, value));
+                    int32_t index = PaletteLookupTable::getIndex(value);
+                    float entryDist = abs((float)(index - RESOLUTION) / RESOLUTION - clamped) * RESOLUTION;
+                    if (clamped != 0.0f && index == RESOLUTION) ++indexFailures;//only zero may use the zero entry
+                    if (entryDist > (abs(clamped) * RESOLUTION < 0.5f ? 1.5f : 0.5f) + 0.001f) ++indexFailures;//otherwise the nearest entry, or the next one out for values near zero
+                    bool nearBoundary = false;//the nearest entry can be on the other side of a change in color, only within the range, the ends are exact
+                    for (int32_t s = 0; s < myPalette->getNumberOfScalarsAndColors(); ++s)
+                    {
+                        if (abs(value) < 1.0f && abs(clamped - myPalette->getScalarAndColor(s)->getScalar()) <= 1.0f / RESOLUTION) nearBoundary = true;
+                    }
+                    if (nearBoundary) continue;
+                    float rgba[4];
+                    myPalette->getPaletteColor(value, interp != 0, rgba);
+                    uint8_t expected[4] = { 0, 0, 0, 0 };//table has zeros for no color
+                    if (rgba[3] > 0.0f)
+                    {
+                        for (int j = 0; j < 4; ++j)
+                        {
+                            expected[j] = (uint8_t)(rgba[j] * 255.0);
+                        }
+                    }
+                    int diff = 0;
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        diff = max(diff, abs((int)byteTable[index * 4 + j] - (int)expected[j]));
+                    }
+                    maxDiff = max(maxDiff, diff);
+                    if (diff > 1) ++colorFailures;
+                }
+                AString caseName = myPalette->getName() + (interp != 0 ? " with interpolation" : "");
+                if (colorFailures != 0)
+                {
+                    setFailed(caseName + ": " + AString::number(colorFailures) + " values differ from the palette by more than one byte level, max difference " + AString::number(maxDiff));
+                }
+                if (indexFailures != 0)
+                {
+                    setFailed(caseName + ": " + AString::number(indexFailures) + " values don't use the nearest table entry");
+                }
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
@@ -0,0 +1,243 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "ReductionTest.h"
+
+#include "CaretException.h"
+#include "ReductionOperation.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+ReductionTest::ReductionTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    ///values with repeats (for MODE), zeros (for COUNT_NONZERO) and both signs, optionally with some non-numeric values
+    vector<float> makeData(const int64_t& numElems, const int& seed, const bool& nonNumeric)
+    {
+        vector<float> ret(numElems);
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            const int64_t hash = (i * 7919 + seed * 104729) % 37;
+            ret[i] = (hash - 12) * 0.25f;
+            if (nonNumeric && numElems > 2)
+            {
+                if (i % 5 == 1) ret[i] = numeric_limits<float>::quiet_NaN();
+                if (i % 11 == 3) ret[i] = (i % 2 == 0 ? 1.0f : -1.0f) * numeric_limits<float>::infinity();
+            }
+        }
+        return ret;
+    }
+    
+    ///the batched functions should give bit-identical results, including NaN and inf from degenerate data
+    bool sameValue(const float& a, const float& b)
+    {
+        if (a != a) return (b != b);
+        return a == b;
+    }
+    
+    enum Variant
+    {
+        PLAIN,
+        ONLY_NUMERIC,
+        EXCLUDE_DEV
+    };
+    
+    AString variantName(const Variant& variant)
+    {
+        switch (variant)
+        {
+            case PLAIN:
+                return "reduce";
+            case ONLY_NUMERIC:
+                return "reduceOnlyNumeric";
+            case EXCLUDE_DEV:
+                return "reduceExcludeDev";
+        }
+        return "";
+    }
+    
+    const float DEV_BELOW = 1.5f, DEV_ABOVE = 1.0f;
+    
+    ///returns true and sets resultOut if the single reduction succeeds, false if it throws
+    bool singleReduce(const Variant& variant, const float* data, const int64_t& numElems, const ReductionEnum::Enum& type, float& resultOut)
+    {
+        try
+        {
+            switch (variant)
+            {
+                case PLAIN:
+                    resultOut = ReductionOperation::reduce(data, numElems, type);
+                    break;
+                case ONLY_NUMERIC:
+                    resultOut = ReductionOperation::reduceOnlyNumeric(data, numElems, type);
+                    break;
+                case EXCLUDE_DEV:
+                    resultOut = ReductionOperation::reduceExcludeDev(data, numElems, type, DEV_BELOW, DEV_ABOVE);
+                    break;
+            }
+        } catch (CaretException&) {
+            return false;
+        }
+        return true;
+    }
+    
+    ///returns true if the batched reduction succeeds, false if it throws
+    bool multipleReduce(const Variant& variant, const float* data, const int64_t& numElems, const vector<ReductionEnum::Enum>& types,
+                        float* resultsOut, ReductionOperation::Scratch& scratch)
+    {
+        try
+        {
+            switch (variant)
+            {
+                case PLAIN:
+                    ReductionOperation::reduceMultiple(data, numElems, types, resultsOut, scratch);
+                    break;
+                case ONLY_NUMERIC:
+                    ReductionOperation::reduceMultipleOnlyNumeric(data, numElems, types, resultsOut, scratch);
+                    break;
+                case EXCLUDE_DEV:
+                    ReductionOperation::reduceMultipleExcludeDev(data, numElems, types, DEV_BELOW, DEV_ABOVE, resultsOut, scratch);
+                    break;
+            }
+        } catch (CaretException&) {
+            return false;
+        }
+        return true;
+    }
+}
+
+void ReductionTest::execute()
+{
+    vector<ReductionEnum::Enum> allTypes;
+    ReductionEnum::getAllEnums(allTypes);
+    vector<ReductionEnum::Enum> types;
+    for (int i = 0; i < (int)allTypes.size(); ++i)
+    {
+        if (allTypes[i] != ReductionEnum::INVALID) types.push_back(allTypes[i]);
+    }
+    vector<ReductionEnum::Enum> repeatedTypes;//repeats and a different order must not change any result
+    repeatedTypes.push_back(ReductionEnum::MEDIAN);
+    repeatedTypes.push_back(ReductionEnum::MEAN);
+    repeatedTypes.push_back(ReductionEnum::MEDIAN);
+    repeatedTypes.push_back(ReductionEnum::INDEXMIN);
+    repeatedTypes.push_back(ReductionEnum::STDEV);
+    const int64_t sizes[] = { 1, 2, 3, 4, 7, 16, 101 };
+    const int numSizes = sizeof(sizes) / sizeof(sizes[0]);
+    const Variant variants[] = { PLAIN, ONLY_NUMERIC, EXCLUDE_DEV };
+    ReductionOperation::Scratch scratch;//reused across calls of different sizes, as in a per-thread loop
+    for (int v = 0; v < 3; ++v)
+    {
+        const Variant variant = variants[v];
+        for (int s = 0; s < numSizes; ++s)
+        {
+            for (int seed = 0; seed < 3; ++seed)
+            {
+                const vector<float> data = makeData(sizes[s], seed, variant != PLAIN);
+                for (int list = 0; list < 2; ++list)
+                {
+                    const vector<ReductionEnum::Enum>& useTypes = (list == 0 ? types : repeatedTypes);
+                    vector<float> multiResults(useTypes.size());
+                    const bool multiOK = multipleReduce(variant, data.data(), sizes[s], useTypes, multiResults.data(), scratch);
+                    bool anySingleFailed = false;
+                    for (int t = 0; t < (int)useTypes.size(); ++t)
+                    {
+                        float single = 0.0f;
+                        if (!singleReduce(variant, data.data(), sizes[s], useTypes[t], single))
+                        {
+                            anySingleFailed = true;
+                            continue;
+                        }
+                        if (multiOK && !sameValue(single, multiResults[t]))
+                        {
+                            setFailed(variantName(variant) + " " + ReductionEnum::toName(useTypes[t]) + " of " + AString::number(sizes[s]) +
+                                      " elements: batched result " + AString::number(multiResults[t]) + ", single result " + AString::number(single));
+                        }
+                    }
+                    if (multiOK == anySingleFailed)
+                    {
+                        setFailed(variantName(variant) + " of " + AString::number(sizes[s]) + " elements: batched reduction " +
+                                  (multiOK ? "succeeded" : "threw") + " but single reductions " + (anySingleFailed ? "threw" : "succeeded"));
+                    }
+                }
+            }
+        }
+    }
+    const int numColumns = 9;
+    const int64_t numRows = 1000;
+    vector<vector<float> > columns(numColumns);
+    vector<const float*> columnPtrs(numColumns);
+    for (int c = 0; c < numColumns; ++c)
+    {
+        columns[c] = makeData(numRows, c + 5, false);
+        columnPtrs[c] = columns[c].data();
+    }
+    for (int v = 0; v < 3; ++v)
+    {
+        const Variant variant = variants[v];
+        vector<vector<float> > results(types.size(), vector<float>(numRows));
+        vector<float*> resultPtrs(types.size());
+        for (int t = 0; t < (int)types.size(); ++t)
+        {
+            resultPtrs[t] = results[t].data();
+        }
+        try
+        {
+            ReductionOperation::reduceAcrossColumns(columnPtrs, numRows, types, resultPtrs, variant == ONLY_NUMERIC,
+                                                    variant == EXCLUDE_DEV, DEV_BELOW, DEV_ABOVE);
+        } catch (CaretException& e) {
+            setFailed("reduceAcrossColumns with " + variantName(variant) + ": exception: " + e.whatString());
+            continue;
+        }
+        vector<float> rowData(numColumns);
+        int64_t numWrong = 0;
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int c = 0; c < numColumns; ++c)
+            {
+                rowData[c] = columns[c][r];
+            }
+            for (int t = 0; t < (int)types.size(); ++t)
+            {
+                float single = 0.0f;
+                if (!singleReduce(variant, rowData.data(), numColumns, types[t], single) || !sameValue(single, results[t][r])) ++numWrong;
+            }
+        }
+        if (numWrong != 0) setFailed("reduceAcrossColumns with " + variantName(variant) + ": " + AString::number(numWrong) + " results differ from single reductions");
+    }
+    {//an error in one row is reported after the parallel region
+        vector<const float*> oneColumn(1, columnPtrs[0]);
+        vector<float> result(numRows);
+        bool threw = false;
+        try
+        {
+            ReductionOperation::reduceAcrossColumns(oneColumn, numRows, vector<ReductionEnum::Enum>(1, ReductionEnum::SAMPSTDEV), vector<float*>(1, result.data()));
+        } catch (CaretException&) {
+            threw = true;
+        }
+        if (!threw) setFailed("reduceAcrossColumns did not throw for SAMPSTDEV of one column");
+    }
+}
@@ -0,0 +1,162 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SignedDistanceTest.h"
+
+#include "CaretException.h"
+#include "SignedDistanceHelper.h"
+#include "SurfaceFile.h"
+#include "TestSurfaces.h"
+#include "Vector3D.h"
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace caret;
+using namespace std;
+
+SignedDistanceTest::SignedDistanceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float randomCoord(const float& range)
+    {
+        return (((float)rand()) / RAND_MAX - 0.5f) * range;
+    }
+    
+    ///closest point on a triangle by region tests, independent of the helper's implementation
+    float bruteForceTriangleDist(const Vector3D& point, const Vector3D& a, const Vector3D& b, const Vector3D& c)
+    {
+        Vector3D ab = b - a, ac = c - a, ap = point - a;
+        float d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if (d1 <= 0.0f && d2 <= 0.0f) return (point - a).length();
+        Vector3D bp = point - b;
+        float d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if (d3 >= 0.0f && d4 <= d3) return (point - b).length();
+        float vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return (point - (a + ab * (d1 / (d1 - d3)))).length();
+        Vector3D cp = point - c;
+        float d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if (d6 >= 0.0f && d5 <= d6) return (point - c).length();
+        float vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return (point - (a + ac * (d2 / (d2 - d6)))).length();
+        float va = d3 * d6 - d5 * d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return (point - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))).length();
+        float denom = 1.0f / (va + vb + vc);
+        return (point - (a + ab * (vb * denom) + ac * (vc * denom))).length();
+    }
+    
+    float bruteForceDist(const SurfaceFile& mySurf, const Vector3D& point)
+    {
+        float best = -1.0f;
+        for (int32_t i = 0; i < mySurf.getNumberOfTriangles(); ++i)
+        {
+            const int32_t* tri = mySurf.getTriangle(i);
+            float tempf = bruteForceTriangleDist(point, mySurf.getCoordinate(tri[0]), mySurf.getCoordinate(tri[1]), mySurf.getCoordinate(tri[2]));
+            if (best < 0.0f || tempf < best) best = tempf;
+        }
+        return best;
+    }
+}
+
+void SignedDistanceTest::execute()
+{
+    SurfaceFile sphereSurf, sharedCentroidSurf;
+    TestSurfaces::makeIcosphere(sphereSurf, 3, 50.0f);
+    const int32_t numShared = 200;//many more triangles than fit in a leaf, all with centroid exactly at the origin
+    sharedCentroidSurf.setNumberOfNodesAndTriangles(numShared * 3, numShared);
+    for (int32_t i = 0; i < numShared; ++i)
+    {
+        float first[3], second[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            first[j] = randomCoord(40.0f);
+            second[j] = randomCoord(40.0f);
+        }
+        sharedCentroidSurf.setCoordinate(i * 3, first);
+        sharedCentroidSurf.setCoordinate(i * 3 + 1, second);
+        sharedCentroidSurf.setCoordinate(i * 3 + 2, -(first[0] + second[0]), -(first[1] + second[1]), -(first[2] + second[2]));
+        sharedCentroidSurf.setTriangle(i, i * 3, i * 3 + 1, i * 3 + 2);
+    }
+    const SurfaceFile* surfaces[2] = { &sphereSurf, &sharedCentroidSurf };
+    const char* names[2] = { "sphere", "shared centroid surface" };
+    try
+    {
+        for (int s = 0; s < 2; ++s)
+        {
+            CaretPointer<SignedDistanceHelper> myHelp = surfaces[s]->getSignedDistanceHelper();
+            int failures = 0;
+            for (int i = 0; i < 500; ++i)
+            {
+                float coord[3] = { randomCoord(150.0f), randomCoord(150.0f), randomCoord(150.0f) };
+                BarycentricInfo myInfo;
+                myHelp->barycentricWeights(coord, myInfo);
+                float expected = bruteForceDist(*(surfaces[s]), Vector3D(coord[0], coord[1], coord[2]));
+                if (abs(myInfo.absDistance - expected) > 1e-4f * max(1.0f, expected) ||
+                    abs(abs(myHelp->dist(coord, SignedDistanceHelper::EVEN_ODD)) - expected) > 1e-4f * max(1.0f, expected))
+                {
+                    ++failures;
+                }
+            }
+            if (failures != 0)
+            {
+                setFailed(AString(names[s]) + ": " + AString::number(failures) + " closest distances differ from brute force");
+            }
+        }
+        CaretPointer<SignedDistanceHelper> sphereHelp = sphereSurf.getSignedDistanceHelper();
+        const SignedDistanceHelper::WindingLogic windings[4] = { SignedDistanceHelper::EVEN_ODD, SignedDistanceHelper::NEGATIVE,
+                                                                 SignedDistanceHelper::NONZERO, SignedDistanceHelper::NORMALS };
+        const char* windingNames[4] = { "even-odd", "negative", "nonzero", "normals" };
+        int signFailures[4] = { 0, 0, 0, 0 };
+        int numInside = 0, numOutside = 0;
+        for (int i = 0; i < 500; ++i)
+        {
+            float coord[3] = { randomCoord(150.0f), randomCoord(150.0f), randomCoord(150.0f) };
+            float radius = Vector3D(coord[0], coord[1], coord[2]).length();
+            if (radius > 45.0f && radius < 55.0f) continue;//the facets of the sphere are within this shell, so the sign is only obvious outside it
+            bool inside = (radius <= 45.0f);
+            if (inside)
+            {
+                ++numInside;
+            } else {
+                ++numOutside;
+            }
+            for (int w = 0; w < 4; ++w)
+            {
+                if ((sphereHelp->dist(coord, windings[w]) < 0.0f) != inside) ++signFailures[w];//negative is inside
+            }
+        }
+        if (numInside == 0 || numOutside == 0)
+        {
+            setFailed("sphere sign test didn't generate points both inside and outside");
+        }
+        for (int w = 0; w < 4; ++w)
+        {
+            if (signFailures[w] != 0)
+            {
+                setFailed(AString("sphere: ") + AString::number(signFailures[w]) + " points have the wrong sign with " + windingNames[w] + " winding");
+            }
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
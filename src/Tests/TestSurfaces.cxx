@@ -0,0 +1,106 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TestSurfaces.h"
+
+#include "SurfaceFile.h"
+
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    int32_t midpoint(vector<float>& coords, map<pair<int32_t, int32_t>, int32_t>& edgeMidpoints, int32_t node1, int32_t node2)
+    {
+        if (node1 > node2) swap(node1, node2);
+        pair<int32_t, int32_t> edge(node1, node2);
+        map<pair<int32_t, int32_t>, int32_t>::iterator iter = edgeMidpoints.find(edge);
+        if (iter != edgeMidpoints.end()) return iter->second;
+        int32_t newNode = (int32_t)(coords.size() / 3);
+        float xyz[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            xyz[j] = (coords[node1 * 3 + j] + coords[node2 * 3 + j]) * 0.5f;
+        }
+        float length = sqrt(xyz[0] * xyz[0] + xyz[1] * xyz[1] + xyz[2] * xyz[2]);
+        for (int j = 0; j < 3; ++j)
+        {
+            coords.push_back(xyz[j] / length);
+        }
+        edgeMidpoints[edge] = newNode;
+        return newNode;
+    }
+}
+
+void TestSurfaces::makeIcosphere(SurfaceFile& surfOut, const int32_t& subdivisions, const float& radius)
+{
+    const float t = (1.0f + sqrt(5.0f)) / 2.0f;
+    const float baseCoords[12][3] = {
+        { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+        { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+        { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+    };
+    const int32_t baseTriangles[20][3] = {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+    };
+    vector<float> coords;//on the unit sphere until the end
+    for (int i = 0; i < 12; ++i)
+    {
+        float length = sqrt(baseCoords[i][0] * baseCoords[i][0] + baseCoords[i][1] * baseCoords[i][1] + baseCoords[i][2] * baseCoords[i][2]);
+        for (int j = 0; j < 3; ++j)
+        {
+            coords.push_back(baseCoords[i][j] / length);
+        }
+    }
+    vector<int32_t> triangles(&baseTriangles[0][0], &baseTriangles[0][0] + 60);
+    for (int32_t s = 0; s < subdivisions; ++s)
+    {
+        map<pair<int32_t, int32_t>, int32_t> edgeMidpoints;
+        vector<int32_t> newTriangles;
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            int32_t a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+            int32_t ab = midpoint(coords, edgeMidpoints, a, b);
+            int32_t bc = midpoint(coords, edgeMidpoints, b, c);
+            int32_t ca = midpoint(coords, edgeMidpoints, c, a);
+            const int32_t split[12] = { a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca };
+            newTriangles.insert(newTriangles.end(), split, split + 12);
+        }
+        triangles.swap(newTriangles);
+    }
+    const int32_t numNodes = (int32_t)(coords.size() / 3), numTriangles = (int32_t)(triangles.size() / 3);
+    surfOut.setNumberOfNodesAndTriangles(numNodes, numTriangles);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        surfOut.setCoordinate(i, coords[i * 3] * radius, coords[i * 3 + 1] * radius, coords[i * 3 + 2] * radius);
+    }
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        surfOut.setTriangle(i, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2]);
+    }
+    surfOut.computeNormals();
+}
@@ -0,0 +1,41 @@
+#ifndef __TEST_SURFACES_H__
+#define __TEST_SURFACES_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+namespace caret {
+
+    class SurfaceFile;
+
+    ///synthetic surfaces for tests that need a mesh but shouldn't depend on the data files
+    class TestSurfaces
+    {
+        TestSurfaces();
+    public:
+        ///sphere made by subdividing an icosahedron, triangles are oriented with normals pointing outward
+        ///subdivisions = 0 gives 12 vertices, each subdivision roughly quadruples the number of triangles
+        static void makeIcosphere(SurfaceFile& surfOut, const int32_t& subdivisions, const float& radius = 100.0f);
+    };
+
+}
+#endif //__TEST_SURFACES_H__
@@ -0,0 +1,293 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TfceTest.h"
+
+#include "CaretAssert.h"
+#include "CaretHeap.h"
+#include "TfceHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TfceTest::TfceTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{//the cluster-list implementation that metric-tfce and volume-tfce used before TfceHelper, as a reference
+    struct Cluster
+    {
+        double accumVal, totalArea;
+        vector<int> members;
+        float lastVal;
+        bool first;
+        Cluster()
+        {
+            first = true;
+            accumVal = 0.0;
+            totalArea = 0.0;
+        }
+        void addMember(const int& node, const float& val, const float& area, const float& param_e, const float& param_h)
+        {
+            update(val, param_e, param_h);
+            members.push_back(node);
+            totalArea += area;
+        }
+        void update(const float& bottomVal, const float& param_e, const float& param_h)
+        {
+            if (first)
+            {
+                lastVal = bottomVal;
+                first = false;
+            } else {
+                if (bottomVal != lastVal)
+                {
+                    double integrated_h = param_h + 1.0f;
+                    accumVal += pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+                    lastVal = bottomVal;
+                }
+            }
+        }
+    };
+    
+    int allocCluster(vector<Cluster>& clusterList, set<int>& deadClusters)
+    {
+        if (deadClusters.empty())
+        {
+            clusterList.push_back(Cluster());
+            return (int)(clusterList.size() - 1);
+        } else {
+            set<int>::iterator iter = deadClusters.begin();
+            int ret = *iter;
+            deadClusters.erase(iter);
+            clusterList[ret] = Cluster();
+            return ret;
+        }
+    }
+    
+    void tfcePosOld(const vector<vector<int> >& neighborLists, const float* colData, double* accumData, const float* roiData,
+                    const float& param_e, const float& param_h, const float* areaData)
+    {
+        int numNodes = (int)neighborLists.size();
+        vector<int> membership(numNodes, -1);
+        vector<Cluster> clusterList;
+        set<int> deadClusters;
+        CaretSimpleMaxHeap<int, float> nodeHeap;
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if ((roiData == NULL || roiData[i] > 0.0f) && colData[i] > 0.0f)
+            {
+                nodeHeap.push(i, colData[i]);
+            }
+        }
+        while (!nodeHeap.isEmpty())
+        {
+            float value;
+            int node = nodeHeap.pop(&value);
+            const vector<int>& neighbors = neighborLists[node];
+            set<int> touchingClusters;
+            for (int i = 0; i < (int)neighbors.size(); ++i)
+            {
+                if (membership[neighbors[i]] != -1)
+                {
+                    touchingClusters.insert(membership[neighbors[i]]);
+                }
+            }
+            switch (touchingClusters.size())
+            {
+                case 0:
+                {
+                    int newCluster = allocCluster(clusterList, deadClusters);
+                    clusterList[newCluster].addMember(node, value, areaData[node], param_e, param_h);
+                    membership[node] = newCluster;
+                    break;
+                }
+                case 1:
+                {
+                    int whichCluster = *(touchingClusters.begin());
+                    clusterList[whichCluster].addMember(node, value, areaData[node], param_e, param_h);
+                    membership[node] = whichCluster;
+                    accumData[node] -= clusterList[whichCluster].accumVal;
+                    break;
+                }
+                default:
+                {
+                    int mergedIndex = -1, biggestSize = 0;
+                    for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
+                    {
+                        if ((int)clusterList[*iter].members.size() > biggestSize)
+                        {
+                            mergedIndex = *iter;
+                            biggestSize = (int)clusterList[*iter].members.size();
+                        }
+                    }
+                    CaretAssertVectorIndex(clusterList, mergedIndex);
+                    Cluster& mergedCluster = clusterList[mergedIndex];
+                    mergedCluster.update(value, param_e, param_h);
+                    for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
+                    {
+                        if (*iter != mergedIndex)
+                        {
+                            Cluster& thisCluster = clusterList[*iter];
+                            thisCluster.update(value, param_e, param_h);
+                            double correctionVal = thisCluster.accumVal - mergedCluster.accumVal;
+                            for (int j = 0; j < (int)thisCluster.members.size(); ++j)
+                            {
+                                accumData[thisCluster.members[j]] += correctionVal;
+                                membership[thisCluster.members[j]] = mergedIndex;
+                            }
+                            mergedCluster.members.insert(mergedCluster.members.end(), thisCluster.members.begin(), thisCluster.members.end());
+                            mergedCluster.totalArea += thisCluster.totalArea;
+                            deadClusters.insert(*iter);
+                            vector<int>().swap(thisCluster.members);
+                        }
+                    }
+                    mergedCluster.addMember(node, value, areaData[node], param_e, param_h);
+                    accumData[node] -= mergedCluster.accumVal;
+                    membership[node] = mergedIndex;
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < (int)clusterList.size(); ++i)
+        {
+            if (deadClusters.find(i) != deadClusters.end()) continue;
+            Cluster& thisCluster = clusterList[i];
+            thisCluster.update(0.0f, param_e, param_h);
+            for (int j = 0; j < (int)thisCluster.members.size(); ++j)
+            {
+                accumData[thisCluster.members[j]] += thisCluster.accumVal;
+            }
+        }
+    }
+    
+    void tfceOld(const vector<vector<int> >& neighborLists, const float* colData, float* outData, const float* roiData,
+                 const float& param_e, const float& param_h, const float* areaData)
+    {
+        int numNodes = (int)neighborLists.size();
+        vector<double> accum(numNodes, 0.0);
+        tfcePosOld(neighborLists, colData, accum.data(), roiData, param_e, param_h, areaData);
+        vector<float> negData(numNodes);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            negData[i] = -colData[i];
+        }
+        tfcePosOld(neighborLists, negData.data(), accum.data(), roiData, param_e, param_h, areaData);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            if (roiData == NULL || roiData[i] > 0.0f)
+            {
+                outData[i] = (colData[i] < 0.0f ? (float)-accum[i] : (float)accum[i]);
+            } else {
+                outData[i] = 0.0f;
+            }
+        }
+    }
+    
+    ///returns the number of elements that differ by more than float rounding allows
+    int countDifferences(const vector<float>& result, const vector<float>& expected)
+    {
+        int ret = 0;
+        for (int i = 0; i < (int)result.size(); ++i)
+        {
+            if (!(abs(result[i] - expected[i]) <= 1e-5f * max(1.0f, abs(expected[i])))) ++ret;
+        }
+        return ret;
+    }
+}
+
+void TfceTest::execute()
+{
+    const int64_t dims[3] = { 23, 17, 11 };
+    const int numElements = (int)(dims[0] * dims[1] * dims[2]);
+    const float voxelSize = 1.7f, param_h = 2.0f;
+    vector<vector<int> > neighborLists(numElements);//face neighbors, so the grid constructor uses the same adjacency
+    for (int k = 0; k < dims[2]; ++k)
+    {
+        for (int j = 0; j < dims[1]; ++j)
+        {
+            for (int i = 0; i < dims[0]; ++i)
+            {
+                const int offsets[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+                for (int n = 0; n < 6; ++n)
+                {
+                    const int64_t ni = i + offsets[n][0], nj = j + offsets[n][1], nk = k + offsets[n][2];
+                    if (ni < 0 || ni >= dims[0] || nj < 0 || nj >= dims[1] || nk < 0 || nk >= dims[2]) continue;
+                    neighborLists[i + dims[0] * (j + dims[1] * k)].push_back((int)(ni + dims[0] * (nj + dims[1] * nk)));
+                }
+            }
+        }
+    }
+    vector<int64_t> neighborStart(numElements + 1, 0);
+    vector<int32_t> neighborList;
+    vector<float> areas(numElements), voxelSizes(numElements, voxelSize);
+    for (int i = 0; i < numElements; ++i)
+    {
+        neighborStart[i] = (int64_t)neighborList.size();
+        neighborList.insert(neighborList.end(), neighborLists[i].begin(), neighborLists[i].end());
+        areas[i] = 0.5f + ((float)rand()) / RAND_MAX;
+    }
+    neighborStart[numElements] = (int64_t)neighborList.size();
+    TfceHelper surfHelper(neighborStart, neighborList, areas, 1.0f, param_h);
+    TfceHelper gridHelper(dims, voxelSize, 0.5f, param_h);
+    vector<float> data(numElements), roi(numElements), result(numElements), expected(numElements);
+    for (int trial = 0; trial < 8; ++trial)
+    {
+        for (int i = 0; i < numElements; ++i)
+        {//smooth enough to make large clusters that merge, rounded to make ties, both signs
+            data[i] = floor((sin(i * 0.013 * (trial + 1)) + ((float)rand()) / RAND_MAX - 0.5f) * 20.0f) / 10.0f;
+            roi[i] = (rand() % 10 != 0 ? 1.0f : 0.0f);
+        }
+        const float* roiData = (trial % 2 == 1 ? roi.data() : NULL);
+        tfceOld(neighborLists, data.data(), expected.data(), roiData, 1.0f, param_h, areas.data());
+        surfHelper.enhance(data.data(), result.data(), roiData);
+        int numWrong = countDifferences(result, expected);
+        if (numWrong != 0) setFailed("surface trial " + AString::number(trial) + ": " + AString::number(numWrong) + " elements differ from the cluster-list implementation");
+        tfceOld(neighborLists, data.data(), expected.data(), roiData, 0.5f, param_h, voxelSizes.data());
+        gridHelper.enhance(data.data(), result.data(), roiData);
+        numWrong = countDifferences(result, expected);
+        if (numWrong != 0) setFailed("volume trial " + AString::number(trial) + ": " + AString::number(numWrong) + " elements differ from the cluster-list implementation");
+    }
+    const int numMaps = 8;
+    vector<vector<float> > inputs(numMaps, vector<float>(numElements)), outputs(numMaps, vector<float>(numElements));
+    vector<const float*> inputPtrs(numMaps);
+    vector<float*> outputPtrs(numMaps);
+    for (int m = 0; m < numMaps; ++m)
+    {
+        for (int i = 0; i < numElements; ++i)
+        {
+            inputs[m][i] = ((float)rand()) / RAND_MAX - 0.5f;
+        }
+        inputPtrs[m] = inputs[m].data();
+        outputPtrs[m] = outputs[m].data();
+    }
+    surfHelper.enhanceMultiple(inputPtrs, outputPtrs, roi.data());
+    for (int m = 0; m < numMaps; ++m)
+    {
+        surfHelper.enhance(inputs[m].data(), result.data(), roi.data());
+        if (result != outputs[m]) setFailed("enhanceMultiple map " + AString::number(m) + " differs from enhance");
+    }
+}
@@ -0,0 +1,175 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TriangleBVHTest.h"
+
+#include "CaretException.h"
+#include "CaretPointer.h"
+#include "CaretTriangleBVH.h"
+#include "SurfaceFile.h"
+#include "TestSurfaces.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TriangleBVHTest::TriangleBVHTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    bool closeTo(const float& a, const float& b)
+    {
+        return abs(a - b) <= 1e-5f * max(1.0f, abs(b));
+    }
+    
+    //the point should be on the ray at the reported distance, and be the barycentric combination of the triangle's vertices
+    bool hitIsConsistent(const RayTriangleIntersection& hit, const float* coords, const int32_t* triangles, const float origin[3], const float direction[3])
+    {
+        float weightSum = hit.barycentric[0] + hit.barycentric[1] + hit.barycentric[2];
+        if (!closeTo(weightSum, 1.0f)) return false;
+        for (int j = 0; j < 3; ++j)
+        {
+            float fromRay = origin[j] + hit.distance * direction[j];
+            float fromWeights = 0.0f;
+            for (int k = 0; k < 3; ++k)
+            {
+                fromWeights += hit.barycentric[k] * coords[triangles[hit.triangle * 3 + k] * 3 + j];
+            }
+            if (abs(hit.point[j] - fromRay) > 1e-3f || abs(hit.point[j] - fromWeights) > 1e-3f) return false;
+        }
+        return true;
+    }
+}
+
+void TriangleBVHTest::execute()
+{
+    try
+    {
+        {//two squares, at z = 0 and z = 5, each split along its diagonal from (0, 0) to (1, 1)
+            const float coords[] = { 0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+                                     0, 0, 5,  1, 0, 5,  1, 1, 5,  0, 1, 5 };
+            const int32_t triangles[] = { 0, 1, 2,  0, 2, 3,  4, 5, 6,  4, 6, 7 };
+            CaretTriangleBVH myBVH(coords, 8, triangles, 4);
+            const float origin[3] = { 0.25f, 0.75f, 10.0f }, direction[3] = { 0.0f, 0.0f, -2.0f };
+            RayTriangleIntersection hit;
+            if (!myBVH.closestRayIntersection(origin, direction, hit))
+            {
+                setFailed("ray through both squares missed");
+            } else {
+                if (hit.triangle != 3 || !closeTo(hit.distance, 2.5f)) setFailed("closest hit should be triangle 3 at distance 2.5, got triangle " + AString::number(hit.triangle) + " at " + AString::number(hit.distance));
+                if (!hitIsConsistent(hit, coords, triangles, origin, direction)) setFailed("closest hit has inconsistent point or barycentric weights");
+            }
+            vector<RayTriangleIntersection> hits;
+            myBVH.rayIntersections(origin, direction, hits);
+            if (hits.size() != 2 || hits[0].triangle != 3 || hits[1].triangle != 1 || !closeTo(hits[0].distance, 2.5f) || !closeTo(hits[1].distance, 5.0f))
+            {
+                setFailed("all hits should be triangle 3 then triangle 1, at distances 2.5 and 5");
+            }
+            const float reversed[3] = { 0.0f, 0.0f, 2.0f };//both squares are behind the origin
+            if (myBVH.closestRayIntersection(origin, reversed, hit) || hit.triangle != -1) setFailed("hit found behind the ray's origin");
+            const float fromBetween[3] = { 0.25f, 0.75f, 2.0f };//starting between the squares, either side of a triangle counts
+            if (!myBVH.closestRayIntersection(fromBetween, reversed, hit) || hit.triangle != 3 || !closeTo(hit.distance, 1.5f)) setFailed("hit on the back of a triangle not found");
+            const float outside[3] = { 1.5f, 0.5f, 10.0f };
+            if (myBVH.closestRayIntersection(outside, direction, hit)) setFailed("ray beside the squares hit them");
+            //exactly on the diagonal edge shared by two triangles, and exactly on a vertex shared by four, the ray must not slip through
+            const float onEdge[3] = { 0.5f, 0.5f, 10.0f }, onVertex[3] = { 1.0f, 1.0f, 10.0f };
+            for (int which = 0; which < 2; ++which)
+            {
+                const float* edgeOrigin = (which == 0 ? onEdge : onVertex);
+                const AString where = (which == 0 ? "shared edge" : "shared vertex");
+                if (!myBVH.closestRayIntersection(edgeOrigin, direction, hit) || (hit.triangle != 2 && hit.triangle != 3) || !closeTo(hit.distance, 2.5f))
+                {
+                    setFailed("ray through a " + where + " did not hit the upper square");
+                } else if (!hitIsConsistent(hit, coords, triangles, edgeOrigin, direction)) {
+                    setFailed("ray through a " + where + " has inconsistent point or barycentric weights");
+                }
+                myBVH.rayIntersections(edgeOrigin, direction, hits);
+                if (hits.size() < 2 || !closeTo(hits.front().distance, 2.5f) || !closeTo(hits.back().distance, 5.0f))
+                {
+                    setFailed("ray through a " + where + " did not hit both squares");
+                }
+                for (size_t i = 1; i < hits.size(); ++i)
+                {
+                    if (hits[i].distance < hits[i - 1].distance) setFailed("hits along a ray through a " + where + " are not sorted");
+                }
+            }
+        }
+        {//closest hits on a sphere should match testing every triangle by itself, from outside and inside
+            SurfaceFile mySurf;
+            TestSurfaces::makeIcosphere(mySurf, 3);
+            const float* coords = mySurf.getCoordinateData();
+            const int32_t numTriangles = mySurf.getNumberOfTriangles();
+            const int32_t* triangles = mySurf.getTriangle(0);
+            CaretPointer<const CaretTriangleBVH> myBVH = mySurf.getTriangleBVH();
+            vector<CaretPointer<CaretTriangleBVH> > singles(numTriangles);
+            for (int32_t i = 0; i < numTriangles; ++i)
+            {
+                singles[i].grabNew(new CaretTriangleBVH(coords, mySurf.getNumberOfNodes(), triangles + i * 3, 1));
+            }
+            int numMissed = 0;
+            for (int ray = 0; ray < 200; ++ray)
+            {
+                float origin[3], direction[3];
+                for (int j = 0; j < 3; ++j)
+                {
+                    origin[j] = (ray % 2 == 0 ? 300.0f : 50.0f) * (((float)rand()) / RAND_MAX * 2.0f - 1.0f);
+                    direction[j] = ((float)rand()) / RAND_MAX * 2.0f - 1.0f - origin[j] / 300.0f;//mostly toward the center
+                }
+                RayTriangleIntersection hit;
+                bool found = myBVH->closestRayIntersection(origin, direction, hit);
+                float bestDistance = -1.0f;
+                for (int32_t i = 0; i < numTriangles; ++i)
+                {
+                    RayTriangleIntersection single;
+                    if (singles[i]->closestRayIntersection(origin, direction, single) && (bestDistance < 0.0f || single.distance < bestDistance))
+                    {
+                        bestDistance = single.distance;
+                    }
+                }
+                if (found != (bestDistance >= 0.0f))
+                {
+                    setFailed("sphere ray " + AString::number(ray) + ": hierarchy and single triangles disagree on whether it hits");
+                    continue;
+                }
+                if (!found)
+                {
+                    ++numMissed;
+                    continue;
+                }
+                if (!closeTo(hit.distance, bestDistance)) setFailed("sphere ray " + AString::number(ray) + ": closest hit is not the closest triangle");
+                if (!hitIsConsistent(hit, coords, triangles, origin, direction)) setFailed("sphere ray " + AString::number(ray) + ": inconsistent point or barycentric weights");
+                vector<RayTriangleIntersection> hits;
+                myBVH->rayIntersections(origin, direction, hits);
+                if (hits.empty() || !closeTo(hits[0].distance, hit.distance)) setFailed("sphere ray " + AString::number(ray) + ": first of all hits is not the closest hit");
+                for (size_t i = 1; i < hits.size(); ++i)
+                {
+                    if (hits[i].distance < hits[i - 1].distance) setFailed("sphere ray " + AString::number(ray) + ": hits are not sorted");
+                }
+            }
+            if (numMissed > 150) setFailed("too few rays hit the sphere to test it");
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+}
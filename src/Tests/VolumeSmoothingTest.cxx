@@ -0,0 +1,139 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeSmoothingTest.h"
+
+#include "AlgorithmVolumeSmoothing.h"
+#include "CaretException.h"
+#include "VolumeFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+VolumeSmoothingTest::VolumeSmoothingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumeSmoothingTest::execute()
+{//long, finely spaced i axis so the i direction is smoothed by FFT, while j and k use direct convolution
+    const int64_t dims[3] = { 400, 5, 4 };
+    const float spacing[3] = { 0.0625f, 1.0f, 1.0f }, kernel = 2.0f;
+    vector<int64_t> myDims(dims, dims + 3);
+    myDims.push_back(2);
+    vector<vector<float> > sform(4, vector<float>(4, 0.0f));
+    sform[3][3] = 1.0f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        sform[axis][axis] = spacing[axis];
+    }
+    int range[3];
+    vector<float> weights[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {//same kernel as the algorithm
+        range[axis] = max(1, (int)floor(kernel * 3.0f / spacing[axis]));
+        weights[axis].resize(range[axis] * 2 + 1);
+        for (int i = 0; i < range[axis] * 2 + 1; ++i)
+        {
+            float tempf = spacing[axis] * (i - range[axis]) / kernel;
+            weights[axis][i] = exp(-tempf * tempf / 2.0f);
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {//make sure both convolution methods are actually tested
+        if (AlgorithmVolumeSmoothing::axisUsesFFT(dims[axis], range[axis]) != (axis == 0))
+        {
+            setFailed("axis " + AString::number(axis) + (axis == 0 ? " is not" : " is") + " smoothed by FFT");
+        }
+    }
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    for (int fixZeros = 0; fixZeros < 2; ++fixZeros)
+    {
+        try
+        {
+            VolumeFile inVol, outVol;
+            inVol.reinitialize(myDims, sform);
+            for (int frame = 0; frame < 2; ++frame)
+            {//second frame is zero for most of the i axis, so with -fix-zeros, some outputs have no data within the kernel
+                vector<float> values(frameSize);
+                for (int64_t i = 0; i < frameSize; ++i)
+                {
+                    values[i] = 1.0f + ((float)rand()) / RAND_MAX;
+                    if (frame == 1 && i % dims[0] < 150) values[i] = 0.0f;
+                }
+                inVol.setFrame(values.data(), frame);
+            }
+            AlgorithmVolumeSmoothing(NULL, &inVol, kernel, &outVol, NULL, fixZeros != 0);
+            for (int frame = 0; frame < 2; ++frame)
+            {
+                const float* inFrame = inVol.getFrame(frame);
+                const float* outFrame = outVol.getFrame(frame);
+                double maxError = 0.0;
+                int64_t wrongZeros = 0;
+                for (int64_t k = 0; k < dims[2]; ++k)
+                {
+                    for (int64_t j = 0; j < dims[1]; ++j)
+                    {
+                        for (int64_t i = 0; i < dims[0]; ++i)
+                        {//direct 3D convolution, the separable smoothing should match this
+                            double sum = 0.0, weightSum = 0.0;
+                            for (int64_t kk = max((int64_t)0, k - range[2]); kk <= min(dims[2] - 1, k + range[2]); ++kk)
+                            {
+                                for (int64_t jj = max((int64_t)0, j - range[1]); jj <= min(dims[1] - 1, j + range[1]); ++jj)
+                                {
+                                    for (int64_t ii = max((int64_t)0, i - range[0]); ii <= min(dims[0] - 1, i + range[0]); ++ii)
+                                    {
+                                        float value = inFrame[inVol.getIndex(ii, jj, kk)];
+                                        if (fixZeros != 0 && value == 0.0f) continue;
+                                        double weight = (double)weights[0][ii - i + range[0]] * weights[1][jj - j + range[1]] * weights[2][kk - k + range[2]];
+                                        sum += weight * value;
+                                        weightSum += weight;
+                                    }
+                                }
+                            }
+                            float found = outFrame[inVol.getIndex(i, j, k)];
+                            if (weightSum == 0.0)
+                            {
+                                if (found != 0.0f) ++wrongZeros;
+                            } else {
+                                maxError = max(maxError, abs(found - sum / weightSum));
+                            }
+                        }
+                    }
+                }
+                AString caseName = "frame " + AString::number(frame) + (fixZeros != 0 ? " with fix zeros" : "");
+                if (maxError > 1e-5)
+                {
+                    setFailed(caseName + " differs from direct smoothing by " + AString::number(maxError));
+                }
+                if (wrongZeros != 0)
+                {
+                    setFailed(caseName + " has " + AString::number(wrongZeros) + " nonzero voxels with no data in the kernel");
+                }
+            }
+        } catch (CaretException& e) {
+            setFailed("exception: " + e.whatString());
+        }
+    }
+}
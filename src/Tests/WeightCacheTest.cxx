@@ -0,0 +1,167 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "WeightCacheTest.h"
+
+#include "CaretException.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+#include "TestSurfaces.h"
+#include "WeightCache.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+WeightCacheTest::WeightCacheTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    QStringList getCacheFiles(const QString& cacheDir)
+    {
+        return QDir(cacheDir).entryList(QStringList() << "*.weights", QDir::Files, QDir::Name);
+    }
+    
+    void removeCacheDir(const QString& cacheDir)
+    {
+        QDir myDir(cacheDir);
+        QStringList files = myDir.entryList(QDir::Files);
+        for (int i = 0; i < files.size(); ++i)
+        {
+            myDir.remove(files[i]);
+        }
+        QDir().rmdir(cacheDir);
+    }
+}
+
+void WeightCacheTest::execute()
+{
+    QString oldCacheDir = WeightCache::getCacheDirectory();
+    QString cacheDir = QDir::tempPath() + "/wb_weight_cache_test";
+    removeCacheDir(cacheDir);
+    try
+    {
+        SurfaceFile mySurf, otherSurf;
+        TestSurfaces::makeIcosphere(mySurf, 3);//642 vertices
+        TestSurfaces::makeIcosphere(otherSurf, 4);//2562 vertices
+        const int32_t numNodes = mySurf.getNumberOfNodes();
+        MetricFile myMetric, uncachedOut, cachedOut;
+        myMetric.setNumberOfNodesAndColumns(numNodes, 1);
+        for (int32_t i = 0; i < numNodes; ++i)
+        {
+            myMetric.setValue(i, 0, ((float)rand()) / RAND_MAX);
+        }
+        WeightCache::setCacheDirectory("");
+        MetricSmoothingObject(&mySurf, 6.0f).smoothColumn(&myMetric, 0, &uncachedOut);
+        //the key must cover everything the weights depend on
+        WeightCache::Key myKey("test"), sameKey("test"), otherKind("other"), otherKernel("test"), otherSurface("test");
+        myKey.addSurface(&mySurf);
+        myKey.addValue(6.0f);
+        sameKey.addSurface(&mySurf);
+        sameKey.addValue(6.0f);
+        otherKind.addSurface(&mySurf);
+        otherKind.addValue(6.0f);
+        otherKernel.addSurface(&mySurf);
+        otherKernel.addValue(6.5f);
+        otherSurface.addSurface(&otherSurf);
+        otherSurface.addValue(6.0f);
+        if (myKey.getString() != sameKey.getString()) setFailed("identical weight cache keys differ");
+        if (myKey.getString() == otherKind.getString() || myKey.getString() == otherKernel.getString() || myKey.getString() == otherSurface.getString())
+        {
+            setFailed("weight cache key did not change with its inputs");
+        }
+        WeightCache::setCacheDirectory(cacheDir);
+        MetricSmoothingObject(&mySurf, 6.0f).smoothColumn(&myMetric, 0, &cachedOut);//computes and saves the weights
+        QStringList cacheFiles = getCacheFiles(cacheDir);
+        if (cacheFiles.size() != 1)
+        {
+            setFailed("expected 1 weight cache file after smoothing, found " + AString::number(cacheFiles.size()));
+        }
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            switch (pass)
+            {
+                case 0://use the weights from the first run
+                    MetricSmoothingObject(&mySurf, 6.0f).smoothColumn(&myMetric, 0, &cachedOut);
+                    break;
+                case 1://a truncated cache file must be ignored and rewritten
+                {
+                    QFile truncFile(QDir(cacheDir).filePath(cacheFiles[0]));
+                    if (!truncFile.resize(truncFile.size() / 2)) setFailed("unable to truncate weight cache file");
+                    MetricSmoothingObject(&mySurf, 6.0f).smoothColumn(&myMetric, 0, &cachedOut);
+                    break;
+                }
+                default://a different kernel must not reuse the cached weights
+                    MetricSmoothingObject(&mySurf, 6.5f).smoothColumn(&myMetric, 0, &cachedOut);
+                    MetricSmoothingObject(&mySurf, 6.0f).smoothColumn(&myMetric, 0, &cachedOut);
+                    if (getCacheFiles(cacheDir).size() != 2)
+                    {
+                        setFailed("expected a second weight cache file for a different kernel");
+                    }
+                    break;
+            }
+            const float* expected = uncachedOut.getValuePointerForColumn(0);
+            const float* found = cachedOut.getValuePointerForColumn(0);
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                if (found[i] != expected[i])
+                {
+                    setFailed("smoothing with cached weights differs at vertex " + AString::number(i) + " in pass " + AString::number(pass));
+                    break;
+                }
+            }
+        }
+        //resampling weights, uncached, computed and saved, then loaded
+        const int32_t newNodes = otherSurf.getNumberOfNodes();
+        vector<float> expected(newNodes), found(newNodes);
+        WeightCache::setCacheDirectory("");
+        SurfaceResamplingHelper(SurfaceResamplingMethodEnum::BARYCENTRIC, &mySurf, &otherSurf).resampleNormal(myMetric.getValuePointerForColumn(0), expected.data());
+        WeightCache::setCacheDirectory(cacheDir);
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            SurfaceResamplingHelper(SurfaceResamplingMethodEnum::BARYCENTRIC, &mySurf, &otherSurf).resampleNormal(myMetric.getValuePointerForColumn(0), found.data());
+            for (int32_t i = 0; i < newNodes; ++i)
+            {
+                if (found[i] != expected[i])
+                {
+                    setFailed("resampling with cached weights differs at vertex " + AString::number(i) + " in pass " + AString::number(pass));
+                    break;
+                }
+            }
+        }
+        if (getCacheFiles(cacheDir).size() != 3)
+        {
+            setFailed("expected a weight cache file for resampling");
+        }
+    } catch (CaretException& e) {
+        setFailed("exception: " + e.whatString());
+    }
+    WeightCache::setCacheDirectory(oldCacheDir);
+    removeCacheDir(cacheDir);
+}
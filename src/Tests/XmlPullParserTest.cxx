@@ -0,0 +1,152 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "XmlPullParserTest.h"
+
+#include "XmlPullParser.h"
+#include "XmlSaxParserException.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+XmlPullParserTest::XmlPullParserTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    string viewToString(const XmlPullParser::StringView& view)
+    {
+        return string(view.m_data, view.m_length);
+    }
+    
+    ///parses the whole document into a compact trace of its events, attribute values are read only after all attributes are parsed
+    string parseToTrace(const string& document)
+    {
+        vector<char> buffer(document.begin(), document.end());
+        buffer.push_back('\0');//the parser needs a writable byte after the document
+        XmlPullParser myParser(buffer.data(), document.size());
+        string trace;
+        while (true)
+        {
+            XmlPullParser::EventType myEvent = myParser.next();
+            switch (myEvent)
+            {
+                case XmlPullParser::START_ELEMENT:
+                    trace += "<" + viewToString(myParser.getName());
+                    for (int32_t i = 0; i < myParser.getNumberOfAttributes(); ++i)
+                    {
+                        trace += " " + viewToString(myParser.getAttributeName(i)) + "=[" + viewToString(myParser.getAttributeValue(i)) + "]";
+                    }
+                    trace += ">";
+                    break;
+                case XmlPullParser::END_ELEMENT:
+                    trace += "</" + viewToString(myParser.getName()) + ">";
+                    break;
+                case XmlPullParser::CHARACTERS:
+                    trace += "{" + viewToString(myParser.getText()) + "}";
+                    break;
+                case XmlPullParser::END_DOCUMENT:
+                    if (string(buffer.data(), document.size()) != document) trace += " DOCUMENT NOT RESTORED";
+                    return trace;
+            }
+        }
+    }
+}
+
+void XmlPullParserTest::execute()
+{
+    //many short attribute values that need decoding, so adding attributes grows the scratch storage after earlier values were decoded into it
+    string manyAttributes = "<e", manyExpected = "<e";
+    for (int i = 0; i < 40; ++i)
+    {
+        string number = AString::number(i).toStdString();
+        manyAttributes += " a" + number + "=\"" + number + "&amp;\"";
+        manyExpected += " a" + number + "=[" + number + "&]";
+    }
+    manyAttributes += "/>";
+    manyExpected += "></e>";
+    const char* validCases[][2] = {
+        { "<a>x &lt;&gt;&amp;&quot;&apos; &#65;&#x42;&#x20AC;</a>", "<a>{x <>&\"' AB\xE2\x82\xAC}</a>" },
+        { "<a>pre<![CDATA[<b>&amp;]]>post<![CDATA[]]></a>", "<a>{pre}{<b>&amp;}{post}</a>" },
+        { "<a b=\"x&amp;y\" c='z' d=\"1\n2\t3\r\n4\" e=\"&lt;&#x41;\"></a>", "<a b=[x&y] c=[z] d=[1 2 3 4] e=[<A]></a>" },
+        { "<a>line1\r\nline2\rline3</a>", "<a>{line1\nline2\nline3}</a>" },
+        { "<?xml version=\"1.0\"?>\n<!DOCTYPE a>\n<!-- comment --><a><b/><!-- <c> --></a>\n", "<a><b></b></a>" },
+        { "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?><a>\xC3\xA9</a>", "<a>{\xC3\xA9}</a>" }
+    };
+    vector<pair<string, string> > cases;
+    for (size_t i = 0; i < sizeof(validCases) / sizeof(validCases[0]); ++i)
+    {
+        cases.push_back(make_pair(string(validCases[i][0]), string(validCases[i][1])));
+    }
+    cases.push_back(make_pair(manyAttributes, manyExpected));
+    for (size_t i = 0; i < cases.size(); ++i)
+    {
+        try
+        {
+            string trace = parseToTrace(cases[i].first);
+            if (trace != cases[i].second)
+            {
+                setFailed("document " + AString::number(i) + " parsed as '" + AString::fromUtf8(trace.c_str()) + "', expected '" + AString::fromUtf8(cases[i].second.c_str()) + "'");
+            }
+        } catch (XmlSaxParserException& e) {
+            setFailed("document " + AString::number(i) + " failed to parse: " + e.whatString());
+        }
+    }
+    const char* malformedCases[] = {
+        "",
+        "<a>",
+        "<a></b>",
+        "<a b=c/>",
+        "<a b=\"1\" c='2>",
+        "<a b=\"<\"/>",
+        "<a>&unknown;</a>",
+        "<a>&amp</a>",
+        "<a>&#xZZ;</a>",
+        "<a>&#0;</a>",
+        "<a/><b/>",
+        "text<a/>",
+        "<a><![CDATA[x</a>",
+        "<a><!-- x</a>",
+        "<a><!BOGUS></a>",
+        "<![CDATA[x]]><a/>"
+    };
+    for (size_t i = 0; i < sizeof(malformedCases) / sizeof(malformedCases[0]); ++i)
+    {
+        try
+        {
+            parseToTrace(malformedCases[i]);
+            setFailed("malformed document '" + AString(malformedCases[i]) + "' did not throw");
+        } catch (XmlSaxParserException&) {
+        }
+    }
+    const char* utf8Document = "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?><a/>";
+    const char* latin1Document = "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?><a/>";
+    const char* notBomDocument = "\xEF\x41\x42<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?><a/>";//only a complete byte order mark is skipped
+    const char utf16Document[] = { '\xFF', '\xFE', '<', '\0', 'a', '\0', '/', '\0', '>', '\0' };
+    if (!XmlPullParser::isEncodingSupported(utf8Document, strlen(utf8Document))) setFailed("UTF-8 document with byte order mark was not supported");
+    if (XmlPullParser::isEncodingSupported(latin1Document, strlen(latin1Document))) setFailed("ISO-8859-1 document with byte order mark was supported");
+    if (!XmlPullParser::isEncodingSupported(notBomDocument, strlen(notBomDocument))) setFailed("partial byte order mark was skipped when checking the encoding");
+    if (XmlPullParser::isEncodingSupported(utf16Document, sizeof(utf16Document))) setFailed("UTF-16 document was supported");
+}
@@ -33,21 +33,38 @@
 #include "CaretException.h"
 
 //tests
+#include "Base64Test.h"
+#include "CiftiAverageTest.h"
+#include "CiftiColumnCacheTest.h"
+#include "CiftiConnectivityRowCacheTest.h"
 #include "CiftiFileTest.h"
+#include "CiftiQuantizedFileTest.h"
+#include "DenseDynamicTest.h"
 #include "DotTest.h"
 #include "GeodesicHelperTest.h"
+#include "GzipTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
+#include "MetricPermutationTest.h"
+#include "MetricSmoothingTest.h"
 #include "NiftiTest.h"
+#include "PaletteLookupTableTest.h"
 #include "PointerTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
+#include "ReductionTest.h"
+#include "SignedDistanceTest.h"
 #include "StatisticsTest.h"
+#include "TfceTest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
+#include "TriangleBVHTest.h"
 #include "VolumeFileTest.h"
+#include "VolumeSmoothingTest.h"
+#include "WeightCacheTest.h"
+#include "XmlPullParserTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -69,22 +86,40 @@ int main(int argc, char** argv)
         caret_global_commandLine_init(argc, argv);
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
+        mytests.push_back(new Base64Test("base64"));
+        mytests.push_back(new CiftiAverageTest("ciftiaverage"));
+        mytests.push_back(new CiftiColumnCacheTest("cifticolumncache"));
+        mytests.push_back(new CiftiConnectivityRowCacheTest("ciftirowcache"));
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CiftiQuantizedFileTest("ciftiquantized"));
+        mytests.push_back(new DenseDynamicTest("densedynamic"));
         mytests.push_back(new DotTest("dotsimd"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
+        mytests.push_back(new GzipTest("gzipindex"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));
         mytests.push_back(new MathExpressionTest("mathexpression"));
+        mytests.push_back(new MetricPermutationTest("metricpermutation"));
+        mytests.push_back(new MetricSmoothingTest("metricsmoothing"));
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
+        mytests.push_back(new NiftiReadThreadsTest("niftireadthreads"));
+        mytests.push_back(new PaletteLookupTableTest("palettelookup"));
         mytests.push_back(new PointerTest("pointer"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
+        mytests.push_back(new ReductionTest("reduction"));
+        mytests.push_back(new SignedDistanceTest("signeddistance"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new TfceTest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
+        mytests.push_back(new TriangleBVHTest("trianglebvh"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new VolumeSmoothingTest("volumesmoothing"));
+        mytests.push_back(new WeightCacheTest("weightcache"));
+        mytests.push_back(new XmlPullParserTest("xmlpullparser"));
         mytests.push_back(new XnatTest("xnat"));
         if (argc < 2)
         {
@@ -0,0 +1,833 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "XmlPullParser.h"
+
+#include <cstring>
+
+#include "CaretAssert.h"
+#include "XmlSaxParserException.h"
+
+using namespace caret;
+
+/**
+ * \class caret::XmlPullParser
+ * \brief Pull parser for a UTF-8 XML document that is in memory.
+ * \ingroup Xml
+ *
+ * Well-formedness is checked for elements, attributes, and entity
+ * references in the parsed content, but not for content that is
+ * skipped with skipElement().
+ */
+
+namespace {
+    inline bool isXmlWhitespace(const char c)
+    {
+        return ((c == ' ') || (c == '\n') || (c == '\r') || (c == '\t'));
+    }
+    
+    inline bool isNameTerminator(const char c)
+    {
+        return (isXmlWhitespace(c) || (c == '>') || (c == '/') || (c == '=')
+                || (c == '<') || (c == '"') || (c == '\'') || (c == '\0'));
+    }
+    
+    void appendUtf8(const uint32_t codePoint,
+                    std::string& textOut)
+    {
+        if (codePoint < 0x80) {
+            textOut += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800) {
+            textOut += static_cast<char>(0xC0 | (codePoint >> 6));
+            textOut += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000) {
+            textOut += static_cast<char>(0xE0 | (codePoint >> 12));
+            textOut += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            textOut += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else {
+            textOut += static_cast<char>(0xF0 | (codePoint >> 18));
+            textOut += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            textOut += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            textOut += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+}
+
+/**
+ * @return True if the views contain the same characters.
+ */
+bool
+XmlPullParser::StringView::operator==(const StringView& rhs) const
+{
+    return ((m_length == rhs.m_length)
+            && (memcmp(m_data, rhs.m_data, m_length) == 0));
+}
+
+/**
+ * Constructor.
+ *
+ * @param data
+ *    The document.  It must remain valid while parsing and must be
+ *    followed by one writable byte since text is null terminated
+ *    in place.  The document is restored as parsing proceeds.
+ * @param length
+ *    Length of the document.
+ */
+XmlPullParser::XmlPullParser(char* data,
+                             const int64_t length)
+{
+    m_data = data;
+    m_length = length;
+    m_position = 0;
+    m_numberOfAttributes = 0;
+    m_elementStartOffset = 0;
+    m_pendingEndElement = false;
+    m_rootElementFound = false;
+    m_terminatorOffset = -1;
+    m_terminatorCharacter = '\0';
+    
+    /*
+     * Skip UTF-8 byte order mark
+     */
+    if ((m_length >= 3)
+        && (static_cast<unsigned char>(m_data[0]) == 0xEF)
+        && (static_cast<unsigned char>(m_data[1]) == 0xBB)
+        && (static_cast<unsigned char>(m_data[2]) == 0xBF)) {
+        m_position = 3;
+    }
+}
+
+/**
+ * Destructor, restores the document.
+ */
+XmlPullParser::~XmlPullParser()
+{
+    restoreTerminator();
+}
+
+/**
+ * Is the document's encoding supported?  The encoding must be UTF-8
+ * (or ASCII, which is a subset of UTF-8).
+ *
+ * @param data
+ *    The document.
+ * @param length
+ *    Length of the document.
+ * @return
+ *    True if there is no encoding declaration (so UTF-8) or the encoding
+ *    declaration is UTF-8 or ASCII.  False for UTF-16 or other encodings.
+ */
+bool
+XmlPullParser::isEncodingSupported(const char* data,
+                                   const int64_t length)
+{
+    if (length >= 2) {
+        const unsigned char c0 = static_cast<unsigned char>(data[0]);
+        const unsigned char c1 = static_cast<unsigned char>(data[1]);
+        if ((c0 == 0) || (c1 == 0)
+            || ((c0 == 0xFE) && (c1 == 0xFF))
+            || ((c0 == 0xFF) && (c1 == 0xFE))) {
+            return false;
+        }
+    }
+    
+    int64_t start = 0;
+    if ((length >= 3)
+        && (static_cast<unsigned char>(data[0]) == 0xEF)
+        && (static_cast<unsigned char>(data[1]) == 0xBB)
+        && (static_cast<unsigned char>(data[2]) == 0xBF)) {
+        start = 3;
+    }
+    if ((length - start < 5)
+        || (strncmp(data + start, "<?xml", 5) != 0)) {
+        return true;
+    }
+    
+    const char* declarationEnd = static_cast<const char*>(memchr(data + start, '>', length - start));
+    if (declarationEnd == NULL) {
+        return true;
+    }
+    const std::string declaration(data + start, declarationEnd);
+    const std::string::size_type encodingIndex = declaration.find("encoding");
+    if (encodingIndex == std::string::npos) {
+        return true;
+    }
+    const std::string::size_type quoteIndex = declaration.find_first_of("\"'", encodingIndex);
+    if (quoteIndex == std::string::npos) {
+        return true;
+    }
+    const std::string::size_type endQuoteIndex = declaration.find(declaration[quoteIndex], quoteIndex + 1);
+    if (endQuoteIndex == std::string::npos) {
+        return true;
+    }
+    const AString encoding = AString::fromLatin1(declaration.c_str() + quoteIndex + 1,
+                                                 static_cast<int>(endQuoteIndex - quoteIndex - 1)).toLower();
+    return ((encoding == "utf-8")
+            || (encoding == "utf8")
+            || (encoding == "us-ascii")
+            || (encoding == "ascii"));
+}
+
+/**
+ * Get the next event.
+ *
+ * @return
+ *    Type of the event.
+ * @throws XmlSaxParserException
+ *    If the document is not well formed.
+ */
+XmlPullParser::EventType
+XmlPullParser::next()
+{
+    restoreTerminator();
+    
+    if (m_pendingEndElement) {
+        m_pendingEndElement = false;
+        CaretAssert( ! m_elementStack.empty());
+        m_name = m_elementStack.back();
+        m_elementStack.pop_back();
+        return END_ELEMENT;
+    }
+    
+    while (true) {
+        if (m_position >= m_length) {
+            if ( ! m_elementStack.empty()) {
+                throwError(("Document ended before the end of element "
+                            + m_elementStack.back().toString()),
+                           m_length);
+            }
+            if ( ! m_rootElementFound) {
+                throwError("Document does not contain an element",
+                           m_length);
+            }
+            return END_DOCUMENT;
+        }
+        
+        if (m_data[m_position] != '<') {
+            const char* nextTag = static_cast<const char*>(memchr(m_data + m_position,
+                                                                  '<',
+                                                                  m_length - m_position));
+            const int64_t textEnd = ((nextTag != NULL)
+                                     ? (nextTag - m_data)
+                                     : m_length);
+            if (m_elementStack.empty()) {
+                for (int64_t i = m_position; i < textEnd; i++) {
+                    if ( ! isXmlWhitespace(m_data[i])) {
+                        throwError("Text is not allowed outside of the root element",
+                                   i);
+                    }
+                }
+                m_position = textEnd;
+                continue;
+            }
+            const int64_t textStart = m_position;
+            m_position = textEnd;
+            setText(textStart,
+                    textEnd,
+                    true);
+            return CHARACTERS;
+        }
+        
+        const char nextChar = ((m_position + 1 < m_length)
+                               ? m_data[m_position + 1]
+                               : '\0');
+        if (nextChar == '/') {
+            parseEndTag();
+            return END_ELEMENT;
+        }
+        else if (nextChar == '?') {
+            const int64_t piEnd = findString("?>", m_position + 2);
+            if (piEnd < 0) {
+                throwError("Processing instruction is not terminated",
+                           m_position);
+            }
+            m_position = piEnd + 2;
+        }
+        else if (nextChar == '!') {
+            if (strncmp(m_data + m_position, "<!--", std::min(static_cast<int64_t>(4), m_length - m_position)) == 0) {
+                const int64_t commentEnd = findString("-->", m_position + 4);
+                if (commentEnd < 0) {
+                    throwError("Comment is not terminated",
+                               m_position);
+                }
+                m_position = commentEnd + 3;
+            }
+            else if ((m_length - m_position >= 9)
+                     && (strncmp(m_data + m_position, "<![CDATA[", 9) == 0)) {
+                if (m_elementStack.empty()) {
+                    throwError("CDATA is not allowed outside of the root element",
+                               m_position);
+                }
+                const int64_t textStart = m_position + 9;
+                const int64_t textEnd = findString("]]>", textStart);
+                if (textEnd < 0) {
+                    throwError("CDATA section is not terminated",
+                               m_position);
+                }
+                m_position = textEnd + 3;
+                if (textEnd > textStart) {
+                    setText(textStart,
+                            textEnd,
+                            false);
+                    return CHARACTERS;
+                }
+            }
+            else if ((m_length - m_position >= 9)
+                     && (strncmp(m_data + m_position, "<!DOCTYPE", 9) == 0)
+                     && m_elementStack.empty()) {
+                skipDocumentType();
+            }
+            else {
+                throwError("Invalid markup",
+                           m_position);
+            }
+        }
+        else {
+            parseStartTag();
+            return START_ELEMENT;
+        }
+    }
+    
+    return END_DOCUMENT;
+}
+
+/**
+ * Find the offset just past the end of the current element (the
+ * element whose START_ELEMENT was just returned) without changing
+ * the state of the parser.  The content is scanned for markup, but
+ * it is not checked for errors other than the end of the document.
+ *
+ * @return
+ *    Offset of the character after the element's end tag.
+ * @throws XmlSaxParserException
+ *    If the document ends before the end of the element.
+ */
+int64_t
+XmlPullParser::findElementEndOffset() const
+{
+    if (m_pendingEndElement) {
+        return m_position;
+    }
+    
+    int64_t depth = 1;
+    int64_t position = m_position;
+    while (true) {
+        const char* nextTag = static_cast<const char*>(memchr(m_data + position,
+                                                              '<',
+                                                              m_length - position));
+        if (nextTag == NULL) {
+            break;
+        }
+        position = nextTag - m_data;
+        const int64_t remaining = m_length - position;
+        if ((remaining >= 4)
+            && (strncmp(nextTag, "<!--", 4) == 0)) {
+            const int64_t commentEnd = findString("-->", position + 4);
+            if (commentEnd < 0) {
+                break;
+            }
+            position = commentEnd + 3;
+        }
+        else if ((remaining >= 9)
+                 && (strncmp(nextTag, "<![CDATA[", 9) == 0)) {
+            const int64_t cdataEnd = findString("]]>", position + 9);
+            if (cdataEnd < 0) {
+                break;
+            }
+            position = cdataEnd + 3;
+        }
+        else if ((remaining >= 2)
+                 && ((nextTag[1] == '?') || (nextTag[1] == '!') || (nextTag[1] == '/'))) {
+            const bool endTagFlag = (nextTag[1] == '/');
+            const char* tagEnd = static_cast<const char*>(memchr(nextTag, '>', remaining));
+            if (tagEnd == NULL) {
+                break;
+            }
+            position = (tagEnd - m_data) + 1;
+            if (endTagFlag) {
+                depth--;
+                if (depth == 0) {
+                    return position;
+                }
+            }
+        }
+        else {
+            /*
+             * Start tag, attribute values may contain '>'
+             */
+            position++;
+            char quote = '\0';
+            bool tagEndFound = false;
+            while (position < m_length) {
+                const char c = m_data[position];
+                if (quote != '\0') {
+                    if (c == quote) {
+                        quote = '\0';
+                    }
+                }
+                else if ((c == '"') || (c == '\'')) {
+                    quote = c;
+                }
+                else if (c == '>') {
+                    tagEndFound = true;
+                    if (m_data[position - 1] != '/') {
+                        depth++;
+                    }
+                    position++;
+                    break;
+                }
+                position++;
+            }
+            if ( ! tagEndFound) {
+                break;
+            }
+        }
+    }
+    
+    throwError(("Document ended before the end of element "
+                + m_elementStack.back().toString()),
+               m_length);
+    return m_length;
+}
+
+/**
+ * Skip the rest of the current element (the element whose START_ELEMENT
+ * was just returned).  No events are returned for its content or its end.
+ *
+ * @param elementEndOffset
+ *    Value returned by findElementEndOffset().
+ */
+void
+XmlPullParser::skipElement(const int64_t elementEndOffset)
+{
+    CaretAssert( ! m_elementStack.empty());
+    CaretAssert(elementEndOffset >= m_position);
+    m_elementStack.pop_back();
+    m_pendingEndElement = false;
+    m_position = elementEndOffset;
+}
+
+/**
+ * Restore the character replaced to null terminate text.
+ */
+void
+XmlPullParser::restoreTerminator()
+{
+    if (m_terminatorOffset >= 0) {
+        m_data[m_terminatorOffset] = m_terminatorCharacter;
+        m_terminatorOffset = -1;
+    }
+}
+
+/**
+ * Set the text for a CHARACTERS event.
+ *
+ * @param start
+ *    Offset of first character.
+ * @param end
+ *    Offset after the last character.
+ * @param decodeEntities
+ *    If true, entity references are decoded (false for CDATA).
+ */
+void
+XmlPullParser::setText(const int64_t start,
+                       const int64_t end,
+                       const bool decodeEntities)
+{
+    const int64_t length = end - start;
+    const bool needsDecoding = (((decodeEntities)
+                                 && (memchr(m_data + start, '&', length) != NULL))
+                                || (memchr(m_data + start, '\r', length) != NULL));
+    if (needsDecoding) {
+        decode(start,
+               end,
+               decodeEntities,
+               false,
+               m_textScratch);
+        m_text = StringView(m_textScratch.c_str(),
+                            m_textScratch.length());
+    }
+    else {
+        m_terminatorOffset = end;
+        m_terminatorCharacter = m_data[end];
+        m_data[end] = '\0';
+        m_text = StringView(m_data + start,
+                            length);
+    }
+}
+
+/**
+ * Parse a start tag and its attributes.
+ */
+void
+XmlPullParser::parseStartTag()
+{
+    m_elementStartOffset = m_position;
+    m_position++;
+    m_name = readName();
+    if (m_name.m_length == 0) {
+        throwError("Invalid element name",
+                   m_position);
+    }
+    
+    m_numberOfAttributes = 0;
+    while (true) {
+        skipWhitespace();
+        if (m_position >= m_length) {
+            throwError(("Document ended in the start tag of element "
+                        + m_name.toString()),
+                       m_position);
+        }
+        const char c = m_data[m_position];
+        if (c == '>') {
+            m_position++;
+            break;
+        }
+        if (c == '/') {
+            if ((m_position + 1 < m_length)
+                && (m_data[m_position + 1] == '>')) {
+                m_position += 2;
+                m_pendingEndElement = true;
+                break;
+            }
+            throwError("Invalid character in start tag",
+                       m_position);
+        }
+        
+        const StringView attributeName = readName();
+        if (attributeName.m_length == 0) {
+            throwError(("Invalid attribute name in start tag of element "
+                        + m_name.toString()),
+                       m_position);
+        }
+        skipWhitespace();
+        if ((m_position >= m_length)
+            || (m_data[m_position] != '=')) {
+            throwError(("Attribute " + attributeName.toString() + " is missing '='"),
+                       m_position);
+        }
+        m_position++;
+        skipWhitespace();
+        if ((m_position >= m_length)
+            || ((m_data[m_position] != '"') && (m_data[m_position] != '\''))) {
+            throwError(("Value of attribute " + attributeName.toString() + " is not quoted"),
+                       m_position);
+        }
+        const char quote = m_data[m_position];
+        const int64_t valueStart = m_position + 1;
+        const char* valueEndPointer = static_cast<const char*>(memchr(m_data + valueStart,
+                                                                      quote,
+                                                                      m_length - valueStart));
+        if (valueEndPointer == NULL) {
+            throwError(("Value of attribute " + attributeName.toString() + " is not terminated"),
+                       m_position);
+        }
+        const int64_t valueEnd = valueEndPointer - m_data;
+        m_position = valueEnd + 1;
+        
+        if (m_numberOfAttributes >= static_cast<int32_t>(m_attributeNames.size())) {
+            m_attributeNames.resize(m_numberOfAttributes + 1);
+            m_attributeValues.resize(m_numberOfAttributes + 1);
+            m_attributeScratch.resize(m_numberOfAttributes + 1);
+        }
+        m_attributeNames[m_numberOfAttributes] = attributeName;
+        
+        /*
+         * Whitespace in attribute values is normalized to spaces
+         */
+        bool needsDecoding = false;
+        for (int64_t i = valueStart; i < valueEnd; i++) {
+            const char vc = m_data[i];
+            if ((vc == '&') || (vc == '\n') || (vc == '\r') || (vc == '\t')) {
+                needsDecoding = true;
+                break;
+            }
+            if (vc == '<') {
+                throwError(("Value of attribute " + attributeName.toString() + " contains '<'"),
+                           i);
+            }
+        }
+        if (needsDecoding) {
+            std::string& scratch = m_attributeScratch[m_numberOfAttributes];
+            decode(valueStart,
+                   valueEnd,
+                   true,
+                   true,
+                   scratch);
+            m_attributeValues[m_numberOfAttributes] = StringView(scratch.c_str(),
+                                                                 scratch.length());
+        }
+        else {
+            m_attributeValues[m_numberOfAttributes] = StringView(m_data + valueStart,
+                                                                 valueEnd - valueStart);
+        }
+        m_numberOfAttributes++;
+    }
+    
+    if (m_elementStack.empty()) {
+        if (m_rootElementFound) {
+            throwError("Document contains more than one root element",
+                       m_elementStartOffset);
+        }
+        m_rootElementFound = true;
+    }
+    m_elementStack.push_back(m_name);
+}
+
+/**
+ * Parse an end tag.
+ */
+void
+XmlPullParser::parseEndTag()
+{
+    const int64_t tagStart = m_position;
+    m_position += 2;
+    m_name = readName();
+    skipWhitespace();
+    if ((m_position >= m_length)
+        || (m_data[m_position] != '>')) {
+        throwError(("End tag of element " + m_name.toString() + " is not terminated"),
+                   tagStart);
+    }
+    m_position++;
+    
+    if (m_elementStack.empty()) {
+        throwError(("End tag of element " + m_name.toString() + " has no start tag"),
+                   tagStart);
+    }
+    if ( ! (m_elementStack.back() == m_name)) {
+        throwError(("End tag of element " + m_name.toString()
+                    + " does not match start tag of element " + m_elementStack.back().toString()),
+                   tagStart);
+    }
+    m_elementStack.pop_back();
+}
+
+/**
+ * Skip a document type declaration, including any internal subset.
+ */
+void
+XmlPullParser::skipDocumentType()
+{
+    const int64_t start = m_position;
+    int32_t bracketDepth = 0;
+    char quote = '\0';
+    for (m_position = start + 9; m_position < m_length; m_position++) {
+        const char c = m_data[m_position];
+        if (quote != '\0') {
+            if (c == quote) {
+                quote = '\0';
+            }
+        }
+        else if ((c == '"') || (c == '\'')) {
+            quote = c;
+        }
+        else if (c == '[') {
+            bracketDepth++;
+        }
+        else if (c == ']') {
+            bracketDepth--;
+        }
+        else if ((c == '>') && (bracketDepth <= 0)) {
+            m_position++;
+            return;
+        }
+    }
+    throwError("Document type declaration is not terminated",
+               start);
+}
+
+/**
+ * @return Name at the current position, empty if there is no name.
+ */
+XmlPullParser::StringView
+XmlPullParser::readName()
+{
+    const int64_t start = m_position;
+    while ((m_position < m_length)
+           && ( ! isNameTerminator(m_data[m_position]))) {
+        m_position++;
+    }
+    return StringView(m_data + start,
+                      m_position - start);
+}
+
+/**
+ * Move the current position past any whitespace.
+ */
+void
+XmlPullParser::skipWhitespace()
+{
+    while ((m_position < m_length)
+           && isXmlWhitespace(m_data[m_position])) {
+        m_position++;
+    }
+}
+
+/**
+ * Find a string in the document.
+ *
+ * @param str
+ *    String that is searched for.
+ * @param start
+ *    Offset at which search starts.
+ * @return
+ *    Offset of the string or negative if not found.
+ */
+int64_t
+XmlPullParser::findString(const char* str,
+                          const int64_t start) const
+{
+    const int64_t strLength = strlen(str);
+    int64_t position = start;
+    while (position + strLength <= m_length) {
+        const char* found = static_cast<const char*>(memchr(m_data + position,
+                                                            str[0],
+                                                            m_length - strLength + 1 - position));
+        if (found == NULL) {
+            break;
+        }
+        if (memcmp(found, str, strLength) == 0) {
+            return (found - m_data);
+        }
+        position = (found - m_data) + 1;
+    }
+    return -1;
+}
+
+/**
+ * Decode entity references and normalize line endings (and for
+ * attributes whitespace).
+ *
+ * @param start
+ *    Offset of first character.
+ * @param end
+ *    Offset after the last character.
+ * @param decodeEntities
+ *    If true, decode entity references.
+ * @param attributeValue
+ *    If true, newlines and tabs are replaced with spaces.
+ * @param decodedOut
+ *    Output containing decoded text.
+ */
+void
+XmlPullParser::decode(const int64_t start,
+                      const int64_t end,
+                      const bool decodeEntities,
+                      const bool attributeValue,
+                      std::string& decodedOut) const
+{
+    decodedOut.clear();
+    decodedOut.reserve(end - start);
+    for (int64_t i = start; i < end; i++) {
+        const char c = m_data[i];
+        if (c == '\r') {
+            decodedOut += (attributeValue ? ' ' : '\n');
+            if ((i + 1 < end)
+                && (m_data[i + 1] == '\n')) {
+                i++;
+            }
+        }
+        else if (attributeValue
+                 && ((c == '\n') || (c == '\t'))) {
+            decodedOut += ' ';
+        }
+        else if ((c == '&')
+                 && decodeEntities) {
+            const char* semicolon = static_cast<const char*>(memchr(m_data + i, ';', end - i));
+            if (semicolon == NULL) {
+                throwError("Entity reference is not terminated",
+                           i);
+            }
+            const std::string entity(m_data + i + 1,
+                                     semicolon - (m_data + i + 1));
+            if (entity == "lt") {
+                decodedOut += '<';
+            }
+            else if (entity == "gt") {
+                decodedOut += '>';
+            }
+            else if (entity == "amp") {
+                decodedOut += '&';
+            }
+            else if (entity == "quot") {
+                decodedOut += '"';
+            }
+            else if (entity == "apos") {
+                decodedOut += '\'';
+            }
+            else if ((entity.length() > 1)
+                     && (entity[0] == '#')) {
+                const bool hexFlag = ((entity[1] == 'x') || (entity[1] == 'X'));
+                const AString number = AString::fromLatin1(entity.c_str() + (hexFlag ? 2 : 1));
+                bool validFlag = false;
+                const uint32_t codePoint = number.toUInt(&validFlag,
+                                                         (hexFlag ? 16 : 10));
+                if (( ! validFlag)
+                    || (codePoint == 0)
+                    || (codePoint > 0x10FFFF)) {
+                    throwError(("Invalid character reference &" + AString::fromLatin1(entity.c_str()) + ";"),
+                               i);
+                }
+                appendUtf8(codePoint,
+                           decodedOut);
+            }
+            else {
+                throwError(("Unsupported entity reference &" + AString::fromUtf8(entity.c_str()) + ";"),
+                           i);
+            }
+            i = semicolon - m_data;
+        }
+        else {
+            decodedOut += c;
+        }
+    }
+}
+
+/**
+ * Throw an exception with the line and column of an offset.
+ *
+ * @param message
+ *    Description of the error.
+ * @param offset
+ *    Offset in the document of the error.
+ * @throws XmlSaxParserException
+ *    Always.
+ */
+void
+XmlPullParser::throwError(const AString& message,
+                          const int64_t offset) const
+{
+    int32_t lineNumber = 1;
+    int64_t lineStart = 0;
+    for (int64_t i = 0; (i < offset) && (i < m_length); i++) {
+        if (m_data[i] == '\n') {
+            lineNumber++;
+            lineStart = i + 1;
+        }
+    }
+    const int32_t columnNumber = static_cast<int32_t>(offset - lineStart + 1);
+    throw XmlSaxParserException(message,
+                                lineNumber,
+                                columnNumber);
+}
@@ -0,0 +1,172 @@
+#ifndef __XML_PULL_PARSER_H__
+#define __XML_PULL_PARSER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "AString.h"
+
+namespace caret {
+
+    /**
+     * \brief Pull parser for a UTF-8 XML document that is in memory.
+     *
+     * Names, attribute values, and text are views into the document
+     * (or into a scratch buffer when they contain entity references
+     * or carriage returns) so nothing is allocated for each element.
+     * Document type declarations are skipped and only the predefined
+     * and character entities are supported.
+     */
+    class XmlPullParser {
+
+    public:
+        /** Pointer and length of characters that are not null terminated */
+        struct StringView {
+            StringView() : m_data(NULL), m_length(0) { }
+
+            StringView(const char* data, const int64_t length) : m_data(data), m_length(length) { }
+
+            bool operator==(const StringView& rhs) const;
+
+            AString toString() const { return AString::fromUtf8(m_data, static_cast<int>(m_length)); }
+
+            const char* m_data;
+
+            int64_t m_length;
+        };
+
+        enum EventType {
+            START_ELEMENT,
+            END_ELEMENT,
+            CHARACTERS,
+            END_DOCUMENT
+        };
+
+        XmlPullParser(char* data,
+                      const int64_t length);
+
+        ~XmlPullParser();
+
+        EventType next();
+
+        /** @return Name of the element for START_ELEMENT and END_ELEMENT */
+        const StringView& getName() const { return m_name; }
+
+        /** @return Number of attributes for START_ELEMENT */
+        int32_t getNumberOfAttributes() const { return m_numberOfAttributes; }
+
+        /** @return Name of attribute at the given index for START_ELEMENT */
+        const StringView& getAttributeName(const int32_t index) const { return m_attributeNames[index]; }
+
+        /** @return Value of attribute at the given index for START_ELEMENT */
+        const StringView& getAttributeValue(const int32_t index) const { return m_attributeValues[index]; }
+
+        /** @return Text for CHARACTERS, null terminated (in place) until the next call to next() */
+        const StringView& getText() const { return m_text; }
+
+        /** @return Offset in the document of the current START_ELEMENT's start tag */
+        int64_t getElementStartOffset() const { return m_elementStartOffset; }
+
+        int64_t findElementEndOffset() const;
+
+        void skipElement(const int64_t elementEndOffset);
+
+        static bool isEncodingSupported(const char* data,
+                                        const int64_t length);
+
+    private:
+        XmlPullParser(const XmlPullParser&);
+
+        XmlPullParser& operator=(const XmlPullParser&);
+
+        void restoreTerminator();
+
+        void setText(const int64_t start,
+                     const int64_t end,
+                     const bool decodeEntities);
+
+        void parseStartTag();
+
+        void parseEndTag();
+
+        void skipDocumentType();
+
+        StringView readName();
+
+        void skipWhitespace();
+
+        int64_t findString(const char* str,
+                           const int64_t start) const;
+
+        void decode(const int64_t start,
+                    const int64_t end,
+                    const bool decodeEntities,
+                    const bool attributeValue,
+                    std::string& decodedOut) const;
+
+        void throwError(const AString& message,
+                        const int64_t offset) const;
+
+        /** The document, there must be a writable byte after the end */
+        char* m_data;
+
+        int64_t m_length;
+
+        int64_t m_position;
+
+        /** Names of the open elements */
+        std::vector<StringView> m_elementStack;
+
+        StringView m_name;
+
+        StringView m_text;
+
+        std::string m_textScratch;
+
+        int32_t m_numberOfAttributes;
+
+        std::vector<StringView> m_attributeNames;
+
+        std::vector<StringView> m_attributeValues;
+
+        /** A deque so that adding an attribute does not move the strings that earlier values point into */
+        std::deque<std::string> m_attributeScratch;
+
+        int64_t m_elementStartOffset;
+
+        /** Current element is empty (<name/>) so the next event is its END_ELEMENT */
+        bool m_pendingEndElement;
+
+        bool m_rootElementFound;
+
+        /** Location and character replaced to null terminate text */
+        int64_t m_terminatorOffset;
+
+        char m_terminatorCharacter;
+    };
+
+} // namespace
+
+#endif //__XML_PULL_PARSER_H__
@@ -20,7 +20,7 @@
 
 #include "XmlSaxParser.h"
 #include "XmlSaxParserException.h"
-#include "XmlSaxParserWithQt.h"
+#include "XmlSaxParserWithPullParser.h"
 
 using namespace caret;
 
@@ -43,7 +43,7 @@ XmlSaxParser::~XmlSaxParser()
 XmlSaxParser* 
 XmlSaxParser::createXmlParser()
 {
-    XmlSaxParser* parser = new XmlSaxParserWithQt();
+    XmlSaxParser* parser = new XmlSaxParserWithPullParser();
     
     return parser;
 }
@@ -23,6 +23,7 @@
 
 
 #include <exception>
+#include <stdint.h>
 #include <AString.h>
 
 #include "CaretObject.h"
@@ -203,6 +204,45 @@ namespace caret {
          *        If an error is encountered and parsing should cease.
          */
         virtual void endDocument() = 0;
+        
+        /**
+         * Might the content of an element with the given name be deferred
+         * (see deferElement())?  Parsers that cannot defer elements do not
+         * call this method.  The default is false.
+         *
+         * @param qName
+         *    Qualified name of the element.
+         * @return
+         *    True if deferElement() should be called for the element.
+         */
+        virtual bool isDeferrableElement(const AString& /*qName*/) const { return false; }
+        
+        /**
+         * Receive the complete text of an element, instead of its events, so
+         * that the element may be parsed later (or never).  Called in place of
+         * startElement() for elements accepted by isDeferrableElement().
+         *
+         * @param qName
+         *    Qualified name of the element.
+         * @param atts
+         *    The element's attributes.
+         * @param elementText
+         *    Text of the element, from its start tag through its end tag
+         *    (UTF-8 and not null terminated), valid only during this call.
+         * @param elementTextLength
+         *    Length of the text.
+         * @return
+         *    True if the element was deferred, in which case the parser skips
+         *    the element.  False if the element should be parsed normally,
+         *    in which case startElement() is called for the element.
+         * @throws
+         *    XmlParsingException
+         *        If an error is encountered and parsing should cease.
+         */
+        virtual bool deferElement(const AString& /*qName*/,
+                                  const XmlAttributes& /*atts*/,
+                                  const char* /*elementText*/,
+                                  const int64_t /*elementTextLength*/) { return false; }
     };
     
 } // namespace
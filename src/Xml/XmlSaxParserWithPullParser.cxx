@@ -0,0 +1,301 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "XmlSaxParserWithPullParser.h"
+
+#include <cstring>
+
+#include <QFile>
+
+#include "CaretHttpManager.h"
+#include "DataFile.h"
+#include "XmlPullParser.h"
+#include "XmlSaxParserHandlerInterface.h"
+#include "XmlSaxParserWithQt.h"
+
+using namespace caret;
+
+/**
+ * Constructor.
+ */
+XmlSaxParserWithPullParser::XmlSaxParserWithPullParser()
+: XmlSaxParser()
+{
+    
+}
+
+/**
+ * Destructor.
+ */
+XmlSaxParserWithPullParser::~XmlSaxParserWithPullParser()
+{
+    
+}
+
+/**
+ * Parse the contents of the specified file using
+ * the specified handler.
+ *
+ * @param filename
+ *    Name of file that is to be parsed.
+ * @param handler
+ *    Handler that will be called to process XML
+ *    as it is read.
+ * @throws XmlSaxParserException
+ *    If an error occurs.
+ */
+void
+XmlSaxParserWithPullParser::parseFile(const QString& filename,
+                                      XmlSaxParserHandlerInterface* handler)
+{
+    if (DataFile::isFileOnNetwork(filename)) {
+        CaretHttpRequest request;
+        request.m_method = CaretHttpManager::GET;
+        request.m_url = filename;
+        CaretHttpResponse response;
+        CaretHttpManager::httpRequest(request,
+                                      response);
+        if (response.m_ok == false) {
+            QString msg = ("HTTP error retrieving: "
+                           + filename
+                           + "\nHTTP Response Code="
+                           + AString::number(response.m_responseCode));
+            throw XmlSaxParserException(msg);
+        }
+        
+        /*
+         * Parser needs a writable byte after the end of the text
+         */
+        const int64_t length = response.m_body.size();
+        response.m_body.push_back('\0');
+        if ( ! XmlPullParser::isEncodingSupported(&response.m_body[0],
+                                                  length)) {
+            XmlSaxParserWithQt qtParser;
+            qtParser.parseString(QString(&response.m_body[0]),
+                                 handler);
+            return;
+        }
+        parseData(&response.m_body[0],
+                  length,
+                  handler);
+        return;
+    }
+    
+    QFile file(filename);
+    if (file.open(QFile::ReadOnly) == false) {
+        throw XmlSaxParserException("Unable to open file " + filename);
+    }
+    QByteArray data = file.readAll();
+    file.close();
+    
+    const int64_t length = data.size();
+    if ( ! XmlPullParser::isEncodingSupported(data.constData(),
+                                              length)) {
+        data.clear();
+        XmlSaxParserWithQt qtParser;
+        qtParser.parseFile(filename,
+                           handler);
+        return;
+    }
+    
+    /*
+     * Parser needs a writable byte after the end of the text
+     */
+    data.append('\0');
+    parseData(data.data(),
+              length,
+              handler);
+}
+
+/**
+ * Parse the contents of the string using
+ * the specified handler.
+ *
+ * @param xmlString
+ *    String whose contents is parsed.  Since the string is converted
+ *    to UTF-8, any encoding declaration in the string is ignored.
+ * @param handler
+ *    Handler that will be called to process XML
+ *    as it is read.
+ * @throws XmlSaxParserException
+ *    If an error occurs.
+ */
+void
+XmlSaxParserWithPullParser::parseString(const QString& xmlString,
+                                        XmlSaxParserHandlerInterface* handler)
+{
+    QByteArray data = xmlString.toUtf8();
+    const int64_t length = data.size();
+    data.append('\0');
+    parseData(data.data(),
+              length,
+              handler);
+}
+
+/**
+ * Parse a UTF-8 document.
+ *
+ * @param data
+ *    The document, followed by one writable byte.
+ * @param length
+ *    Length of the document.
+ * @param handler
+ *    Handler that will be called to process XML
+ *    as it is read.
+ * @throws XmlSaxParserException
+ *    If an error occurs.
+ */
+void
+XmlSaxParserWithPullParser::parseData(char* data,
+                                      const int64_t length,
+                                      XmlSaxParserHandlerInterface* handler)
+{
+    XmlPullParser parser(data,
+                         length);
+    
+    /*
+     * Names are passed without namespace URIs, as with
+     * XmlSaxParserWithQt for documents without namespaces
+     */
+    const AString emptyURI;
+    XmlAttributes attributes;
+    
+    handler->startDocument();
+    
+    bool doneFlag = false;
+    while ( ! doneFlag) {
+        XmlPullParser::EventType eventType = XmlPullParser::END_DOCUMENT;
+        try {
+            eventType = parser.next();
+        }
+        catch (const XmlSaxParserException& e) {
+            handler->fatalError(e);
+            throw;
+        }
+        
+        switch (eventType) {
+            case XmlPullParser::START_ELEMENT:
+            {
+                const ElementName& elementName = getElementName(parser);
+                getAttributes(parser,
+                              attributes);
+                if (handler->isDeferrableElement(elementName.m_qName)) {
+                    const int64_t elementStartOffset = parser.getElementStartOffset();
+                    int64_t elementEndOffset = 0;
+                    try {
+                        elementEndOffset = parser.findElementEndOffset();
+                    }
+                    catch (const XmlSaxParserException& e) {
+                        handler->fatalError(e);
+                        throw;
+                    }
+                    if (handler->deferElement(elementName.m_qName,
+                                              attributes,
+                                              data + elementStartOffset,
+                                              elementEndOffset - elementStartOffset)) {
+                        parser.skipElement(elementEndOffset);
+                        break;
+                    }
+                }
+                handler->startElement(emptyURI,
+                                      elementName.m_localName,
+                                      elementName.m_qName,
+                                      attributes);
+            }
+                break;
+            case XmlPullParser::END_ELEMENT:
+            {
+                const ElementName& elementName = getElementName(parser);
+                handler->endElement(emptyURI,
+                                    elementName.m_localName,
+                                    elementName.m_qName);
+            }
+                break;
+            case XmlPullParser::CHARACTERS:
+                handler->characters(parser.getText().m_data);
+                break;
+            case XmlPullParser::END_DOCUMENT:
+                doneFlag = true;
+                break;
+        }
+    }
+    
+    handler->endDocument();
+}
+
+/**
+ * Get the names of the parser's current element.
+ *
+ * @param parser
+ *    The parser.
+ * @return
+ *    Qualified and local name of the element.
+ */
+const XmlSaxParserWithPullParser::ElementName&
+XmlSaxParserWithPullParser::getElementName(const XmlPullParser& parser)
+{
+    const XmlPullParser::StringView& name = parser.getName();
+    m_elementNameKey.assign(name.m_data,
+                            name.m_length);
+    
+    std::map<std::string, ElementName>::iterator iter = m_elementNames.find(m_elementNameKey);
+    if (iter != m_elementNames.end()) {
+        return iter->second;
+    }
+    
+    ElementName elementName;
+    elementName.m_qName = name.toString();
+    const int colonIndex = elementName.m_qName.indexOf(':');
+    elementName.m_localName = ((colonIndex >= 0)
+                               ? elementName.m_qName.mid(colonIndex + 1)
+                               : elementName.m_qName);
+    
+    return m_elementNames.insert(std::make_pair(m_elementNameKey,
+                                                elementName)).first->second;
+}
+
+/**
+ * Get the attributes of the parser's current element.  Namespace
+ * declarations are not included, as with XmlSaxParserWithQt.
+ *
+ * @param parser
+ *    The parser.
+ * @param attributesOut
+ *    Output containing the attributes.
+ */
+void
+XmlSaxParserWithPullParser::getAttributes(const XmlPullParser& parser,
+                                          XmlAttributes& attributesOut)
+{
+    attributesOut.clear();
+    
+    const int32_t numAttributes = parser.getNumberOfAttributes();
+    for (int32_t i = 0; i < numAttributes; i++) {
+        const XmlPullParser::StringView& name = parser.getAttributeName(i);
+        if ((name.m_length >= 5)
+            && (strncmp(name.m_data, "xmlns", 5) == 0)
+            && ((name.m_length == 5)
+                || (name.m_data[5] == ':'))) {
+            continue;
+        }
+        attributesOut.addAttribute(name.toString(),
+                                   parser.getAttributeValue(i).toString());
+    }
+}
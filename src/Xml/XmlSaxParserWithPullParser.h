@@ -0,0 +1,82 @@
+#ifndef __XML_SAX_PARSER_WITH_PULL_PARSER_H__
+#define __XML_SAX_PARSER_WITH_PULL_PARSER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <map>
+#include <string>
+
+#include "XmlAttributes.h"
+#include "XmlSaxParser.h"
+
+namespace caret {
+    
+    class XmlPullParser;
+    
+    /**
+     * SAX parser that reads the entire document into memory and
+     * parses it with XmlPullParser, which is much faster than
+     * QXmlSimpleReader for large documents.  Documents that are not
+     * UTF-8 are parsed with XmlSaxParserWithQt.
+     */
+    class XmlSaxParserWithPullParser : public XmlSaxParser {
+        
+    public:
+        XmlSaxParserWithPullParser();
+        
+        virtual ~XmlSaxParserWithPullParser();
+        
+        virtual void parseFile(const QString& filename,
+                               XmlSaxParserHandlerInterface* handler);
+        
+        virtual void parseString(const QString& xmlString,
+                                 XmlSaxParserHandlerInterface* handler);
+        
+    private:
+        XmlSaxParserWithPullParser(const XmlSaxParserWithPullParser&);
+        
+        XmlSaxParserWithPullParser& operator=(const XmlSaxParserWithPullParser&);
+        
+        /** Qualified and local name of an element, converted once per name */
+        struct ElementName {
+            AString m_qName;
+            
+            AString m_localName;
+        };
+        
+        void parseData(char* data,
+                       const int64_t length,
+                       XmlSaxParserHandlerInterface* handler);
+        
+        const ElementName& getElementName(const XmlPullParser& parser);
+        
+        void getAttributes(const XmlPullParser& parser,
+                           XmlAttributes& attributesOut);
+        
+        std::map<std::string, ElementName> m_elementNames;
+        
+        /** Reused for looking up element names */
+        std::string m_elementNameKey;
+    };
+    
+} // namespace
+
+#endif // __XML_SAX_PARSER_WITH_PULL_PARSER_H__